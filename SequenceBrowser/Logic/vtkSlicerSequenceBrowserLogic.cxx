@@ -30,6 +30,7 @@
 #include "vtkMRMLModelNode.h"
 #include "vtkMRMLScalarVolumeNode.h"
 #include "vtkMRMLScene.h"
+#include "vtkMRMLTableNode.h"
 #include "vtkMRMLTransformNode.h"
 
 // VTK includes
@@ -40,14 +41,606 @@
 #include <vtkImageData.h>
 #include <vtkPolyData.h>
 #include <vtkAbstractTransform.h>
+#include <vtkDoubleArray.h>
+#include <vtkIntArray.h>
+#include <vtkStringArray.h>
+#include <vtkTable.h>
+#include <vtkWeakPointer.h>
 
 // STL includes
 #include <algorithm>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <limits>
+#include <list>
+#include <map>
+#include <mutex>
+#include <set>
+#include <sstream>
+#include <thread>
 
 #ifdef ENABLE_PERFORMANCE_PROFILING
 #include "vtkTimerLog.h"
 #endif 
 
+//----------------------------------------------------------------------------
+namespace
+{
+  // Period of inserting states recorded in the background into the sequences
+  const double RECORDING_QUEUE_FLUSH_PERIOD_SEC = 0.020;
+
+  // Upper limits of proxy update latency histogram bins (the last bin collects all longer updates)
+  const double LATENCY_HISTOGRAM_BIN_UPPER_LIMITS_SEC[] = { 0.001, 0.002, 0.005, 0.010, 0.020, 0.050, 0.100, std::numeric_limits<double>::infinity() };
+  const int NUMBER_OF_LATENCY_HISTOGRAM_BINS = sizeof(LATENCY_HISTOGRAM_BIN_UPPER_LIMITS_SEC) / sizeof(double);
+}
+
+//----------------------------------------------------------------------------
+class vtkSlicerSequenceBrowserLogic::vtkInternal
+{
+public:
+  /// Snapshot of a proxy node and its copy that will be inserted into a sequence
+  struct RecordedNode
+  {
+    RecordedNode() : Sequencer(NULL), ContentShared(false) {}
+    vtkWeakPointer<vtkMRMLSequenceNode> SequenceNode;
+    vtkMRMLNodeSequencer::NodeSequencer* Sequencer;
+    std::string BaseName;
+    // Copy of the proxy node, taken in the main thread. Its bulk data may be shared with the proxy node
+    // (see NodeSequencer::ShareNodeContent), in which case the worker thread copies it.
+    vtkSmartPointer<vtkMRMLNode> Snapshot;
+    // Node that is inserted into the sequence. It is the snapshot itself, or a preallocated node
+    // of the sequence, which the worker thread fills with the bulk data of the snapshot.
+    vtkSmartPointer<vtkMRMLNode> DataNode;
+    // Snapshot refers to the bulk data of the proxy node
+    bool ContentShared;
+  };
+
+  /// State of all recorded proxy nodes of a browser node at a time point
+  struct RecordingFrame
+  {
+    RecordingFrame() : Started(false), Completed(false) {}
+    vtkWeakPointer<vtkMRMLSequenceBrowserNode> BrowserNode;
+    std::string IndexValue;
+    std::vector<RecordedNode> Nodes;
+    bool Started;
+    bool Completed;
+  };
+
+  enum ProxyCopyMode
+  {
+    DeepCopy,
+    ShallowCopy,
+    SharedCopy
+  };
+
+  /// Data node that was last copied into a proxy node.
+  /// If neither the data node nor the proxy node has been modified since then
+  /// then the proxy node is already up-to-date and the copy can be skipped.
+  /// Modification times include the bulk data objects (see GetNodeContentMTime).
+  struct AppliedDataNode
+  {
+    AppliedDataNode() : DataNodeMTime(0), ProxyNodeMTime(0), CopyMode(DeepCopy) {}
+    vtkWeakPointer<vtkMRMLNode> DataNode;
+    vtkMTimeType DataNodeMTime;
+    vtkMTimeType ProxyNodeMTime;
+    int CopyMode;
+  };
+
+  /// Proxy node that has to be updated from a sequence item
+  struct ProxyUpdate
+  {
+    vtkMRMLSequenceNode* SequenceNode;
+    vtkMRMLNode* SourceDataNode;
+    int SourceItemNumber;
+    vtkMRMLNode* ProxyNode;
+    bool ProxyNodeWasCreated;
+    AppliedDataNode Applied;
+  };
+
+  /// Background task that prepares the content of a source data node in a back buffer of a proxy node
+  struct PreparationTask
+  {
+    std::function<void()> Run;
+    vtkMRMLNode* SourceNode;
+    vtkMRMLNode* TargetNode;
+  };
+
+  /// Number, total and maximum of measured durations (or other sampled values)
+  struct SampleStatistics
+  {
+    SampleStatistics() : Count(0), Total(0.0), Maximum(0.0) {}
+    void AddSample(double value)
+    {
+      this->Count++;
+      this->Total += value;
+      this->Maximum = std::max(this->Maximum, value);
+    }
+    double GetMean() const { return (this->Count > 0 ? this->Total / this->Count : 0.0); }
+    int Count;
+    double Total;
+    double Maximum;
+  };
+
+  /// Performance metrics collected for each browser node
+  struct BrowserMetrics
+  {
+    BrowserMetrics()
+      : LatencyHistogram(NUMBER_OF_LATENCY_HISTOGRAM_BINS, 0)
+      , NumberOfPlaybackFrames(0)
+      , NumberOfSkippedPlaybackFrames(0)
+      , NumberOfLatePlaybackFrames(0)
+    {}
+    void AddLatency(double latencySec)
+    {
+      this->Latency.AddSample(latencySec);
+      int binIndex = 0;
+      while (latencySec > LATENCY_HISTOGRAM_BIN_UPPER_LIMITS_SEC[binIndex] && binIndex < NUMBER_OF_LATENCY_HISTOGRAM_BINS - 1)
+      {
+        binIndex++;
+      }
+      this->LatencyHistogram[binIndex]++;
+    }
+    SampleStatistics Latency;
+    std::vector<int> LatencyHistogram;
+    int NumberOfPlaybackFrames;
+    int NumberOfSkippedPlaybackFrames;
+    int NumberOfLatePlaybackFrames;
+  };
+
+  vtkInternal()
+    : RecordingQueueMaximumSize(100)
+    , RecordingQueuePeakSize(0)
+    , NumberOfDroppedRecordingFrames(0)
+    , StopRequested(false)
+    , NumberOfProxyUpdateThreads(0)
+    , NextContentCopyTask(0)
+    , NumberOfRemainingContentCopyTasks(0)
+    , ContentCopyStopRequested(false)
+    , PerformanceMetricsEnabled(false)
+    , ProxyNodeDoubleBufferingEnabled(false)
+    , NumberOfPrefetchedItems(3)
+    , PrefetchMemoryBudgetMB(512.0)
+    , PreparationInProgress(false)
+    , PreparationSourceNode(NULL)
+    , PreparationTargetNode(NULL)
+    , PreparationStopRequested(false)
+  {
+  }
+
+  ~vtkInternal()
+  {
+    this->StopContentCopyThreads();
+    if (this->PreparationThread.joinable())
+    {
+      {
+        std::lock_guard<std::mutex> lock(this->PreparationMutex);
+        this->PreparationStopRequested = true;
+      }
+      this->PreparationTaskCondition.notify_all();
+      this->PreparationThread.join();
+    }
+    if (this->RecordingThread.joinable())
+    {
+      {
+        std::lock_guard<std::mutex> lock(this->RecordingMutex);
+        this->StopRequested = true;
+      }
+      this->FrameQueuedCondition.notify_all();
+      this->RecordingThread.join();
+    }
+  }
+
+  void StartRecordingThread()
+  {
+    if (!this->RecordingThread.joinable())
+    {
+      this->RecordingThread = std::thread(&vtkInternal::ProcessRecordingQueue, this);
+    }
+  }
+
+  /// Worker thread: copies bulk data of queued snapshots into preallocated data nodes.
+  /// Only raw data buffers are written (see NodeSequencer::PrecopyNodeContent), node properties
+  /// are updated in the main thread when the frame is inserted into the sequences.
+  /// Frames are not added to or removed from the queue here, therefore no MRML node is deleted
+  /// and no MRML event is invoked in this thread.
+  void ProcessRecordingQueue()
+  {
+    std::unique_lock<std::mutex> lock(this->RecordingMutex);
+    while (true)
+    {
+      std::list<RecordingFrame>::iterator frameIt = this->RecordingQueue.end();
+      this->FrameQueuedCondition.wait(lock, [this, &frameIt]
+      {
+        frameIt = std::find_if(this->RecordingQueue.begin(), this->RecordingQueue.end(),
+          [](const RecordingFrame& frame) { return !frame.Started; });
+        return this->StopRequested || frameIt != this->RecordingQueue.end();
+      });
+      if (this->StopRequested)
+      {
+        return;
+      }
+      RecordingFrame& frame = *frameIt;
+      frame.Started = true;
+      lock.unlock();
+      for (std::vector<RecordedNode>::iterator nodeIt = frame.Nodes.begin(); nodeIt != frame.Nodes.end(); ++nodeIt)
+      {
+        if (nodeIt->DataNode.GetPointer() != nodeIt->Snapshot.GetPointer())
+        {
+          nodeIt->Sequencer->PrecopyNodeContent(nodeIt->Snapshot, nodeIt->DataNode);
+        }
+        else if (nodeIt->ContentShared)
+        {
+          // Copy the shared data into a back buffer, which is swapped in when the snapshot is detached
+          nodeIt->Sequencer->PrepareNodeContent(nodeIt->Snapshot, nodeIt->Snapshot);
+        }
+      }
+      lock.lock();
+      frame.Completed = true;
+      this->FrameCompletedCondition.notify_all();
+    }
+  }
+
+  void StopContentCopyThreads()
+  {
+    {
+      std::lock_guard<std::mutex> lock(this->ContentCopyMutex);
+      this->ContentCopyStopRequested = true;
+    }
+    this->ContentCopyTaskCondition.notify_all();
+    for (std::vector<std::thread>::iterator threadIt = this->ContentCopyThreads.begin(); threadIt != this->ContentCopyThreads.end(); ++threadIt)
+    {
+      threadIt->join();
+    }
+    this->ContentCopyThreads.clear();
+    this->ContentCopyStopRequested = false;
+  }
+
+  /// Run tasks on the content copy thread pool and wait for all of them to complete.
+  /// The calling (main) thread processes tasks as well.
+  void RunContentCopyTasks(const std::vector< std::function<void()> >& tasks)
+  {
+    int numberOfThreads = std::min<int>(this->NumberOfProxyUpdateThreads, static_cast<int>(tasks.size()) - 1);
+    while (static_cast<int>(this->ContentCopyThreads.size()) < numberOfThreads)
+    {
+      this->ContentCopyThreads.push_back(std::thread(&vtkInternal::ProcessContentCopyTasks, this));
+    }
+    std::unique_lock<std::mutex> lock(this->ContentCopyMutex);
+    this->ContentCopyTasks = tasks;
+    this->NextContentCopyTask = 0;
+    this->NumberOfRemainingContentCopyTasks = tasks.size();
+    this->ContentCopyTaskCondition.notify_all();
+    this->RunNextContentCopyTasks(lock);
+    this->ContentCopyDoneCondition.wait(lock, [this] { return this->NumberOfRemainingContentCopyTasks == 0; });
+    this->ContentCopyTasks.clear();
+  }
+
+  /// Worker thread of the content copy thread pool
+  void ProcessContentCopyTasks()
+  {
+    std::unique_lock<std::mutex> lock(this->ContentCopyMutex);
+    while (true)
+    {
+      this->ContentCopyTaskCondition.wait(lock, [this]
+      {
+        return this->ContentCopyStopRequested || this->NextContentCopyTask < this->ContentCopyTasks.size();
+      });
+      if (this->ContentCopyStopRequested)
+      {
+        return;
+      }
+      this->RunNextContentCopyTasks(lock);
+    }
+  }
+
+  /// Run tasks until there are no more unassigned tasks. Lock must be held when called.
+  void RunNextContentCopyTasks(std::unique_lock<std::mutex>& lock)
+  {
+    while (this->NextContentCopyTask < this->ContentCopyTasks.size())
+    {
+      std::function<void()> task = this->ContentCopyTasks[this->NextContentCopyTask++];
+      lock.unlock();
+      task();
+      lock.lock();
+      if (--this->NumberOfRemainingContentCopyTasks == 0)
+      {
+        this->ContentCopyDoneCondition.notify_all();
+      }
+    }
+  }
+
+  /// Queue tasks for the background preparation thread. Tasks are run in the order they are added.
+  /// Nodes that the tasks use must be added to PreparationNodes.
+  void StartPreparationTasks(const std::vector<PreparationTask>& tasks)
+  {
+    if (!this->PreparationThread.joinable())
+    {
+      this->PreparationThread = std::thread(&vtkInternal::ProcessPreparationTasks, this);
+    }
+    {
+      std::lock_guard<std::mutex> lock(this->PreparationMutex);
+      this->PreparationTasks.insert(this->PreparationTasks.end(), tasks.begin(), tasks.end());
+    }
+    this->PreparationTaskCondition.notify_all();
+  }
+
+  /// Remove tasks that have not been started yet (all tasks or only those of targetNode), without waiting
+  /// for the running task. If no tasks are queued anymore then nodes that the tasks used are released,
+  /// except the nodes of the running task (nodes are released in the main thread, so that no node
+  /// is deleted in the worker thread).
+  void CancelPreparationTasks(vtkMRMLNode* targetNode = NULL)
+  {
+    bool queueEmpty = false;
+    vtkMRMLNode* runningSourceNode = NULL;
+    vtkMRMLNode* runningTargetNode = NULL;
+    {
+      std::lock_guard<std::mutex> lock(this->PreparationMutex);
+      for (std::deque<PreparationTask>::iterator taskIt = this->PreparationTasks.begin(); taskIt != this->PreparationTasks.end();)
+      {
+        if (targetNode == NULL || taskIt->TargetNode == targetNode)
+        {
+          taskIt = this->PreparationTasks.erase(taskIt);
+        }
+        else
+        {
+          ++taskIt;
+        }
+      }
+      queueEmpty = this->PreparationTasks.empty();
+      runningSourceNode = this->PreparationSourceNode;
+      runningTargetNode = this->PreparationTargetNode;
+    }
+    if (!queueEmpty)
+    {
+      return;
+    }
+    std::vector< vtkSmartPointer<vtkMRMLNode> > runningTaskNodes;
+    for (std::vector< vtkSmartPointer<vtkMRMLNode> >::iterator nodeIt = this->PreparationNodes.begin();
+      nodeIt != this->PreparationNodes.end(); ++nodeIt)
+    {
+      if ((nodeIt->GetPointer() == runningSourceNode || nodeIt->GetPointer() == runningTargetNode)
+        && std::find(runningTaskNodes.begin(), runningTaskNodes.end(), *nodeIt) == runningTaskNodes.end())
+      {
+        runningTaskNodes.push_back(*nodeIt);
+      }
+    }
+    this->PreparationNodes.swap(runningTaskNodes);
+  }
+
+  /// Wait for completion of the running task if it prepares content for targetNode
+  /// (and for sourceNode, if sourceNode is specified). Other tasks keep running.
+  void WaitForPreparationTask(vtkMRMLNode* targetNode, vtkMRMLNode* sourceNode = NULL)
+  {
+    std::unique_lock<std::mutex> lock(this->PreparationMutex);
+    this->PreparationDoneCondition.wait(lock, [this, targetNode, sourceNode]
+    {
+      return !this->PreparationInProgress || this->PreparationTargetNode != targetNode
+        || (sourceNode != NULL && this->PreparationSourceNode != sourceNode);
+    });
+  }
+
+  /// Worker thread that fills back buffers of proxy nodes
+  void ProcessPreparationTasks()
+  {
+    std::unique_lock<std::mutex> lock(this->PreparationMutex);
+    while (true)
+    {
+      this->PreparationTaskCondition.wait(lock, [this]
+      {
+        return this->PreparationStopRequested || !this->PreparationTasks.empty();
+      });
+      if (this->PreparationStopRequested)
+      {
+        return;
+      }
+      PreparationTask task = this->PreparationTasks.front();
+      this->PreparationTasks.pop_front();
+      this->PreparationInProgress = true;
+      this->PreparationSourceNode = task.SourceNode;
+      this->PreparationTargetNode = task.TargetNode;
+      lock.unlock();
+      task.Run();
+      lock.lock();
+      this->PreparationInProgress = false;
+      this->PreparationSourceNode = NULL;
+      this->PreparationTargetNode = NULL;
+      this->PreparationDoneCondition.notify_all();
+    }
+  }
+
+  /// Add browser node to the registry (if it is not registered yet)
+  void RegisterBrowserNode(vtkMRMLSequenceBrowserNode* browserNode)
+  {
+    if (std::find(this->BrowserNodes.begin(), this->BrowserNodes.end(), browserNode) == this->BrowserNodes.end())
+    {
+      this->BrowserNodes.push_back(browserNode);
+    }
+    this->OutdatedBrowserNodeSequences.insert(browserNode);
+    this->UpdateBrowserNodeActiveState(browserNode);
+  }
+
+  /// Remove browser node from the registry
+  void UnregisterBrowserNode(vtkMRMLSequenceBrowserNode* browserNode)
+  {
+    this->BrowserNodes.erase(std::remove(this->BrowserNodes.begin(), this->BrowserNodes.end(), browserNode), this->BrowserNodes.end());
+    this->ActiveBrowserNodes.erase(std::remove(this->ActiveBrowserNodes.begin(), this->ActiveBrowserNodes.end(), browserNode),
+      this->ActiveBrowserNodes.end());
+    // remove the browser node from the sequence index (it is not re-added because it is not registered anymore)
+    this->OutdatedBrowserNodeSequences.insert(browserNode);
+    this->UpdateSequenceBrowserNodes();
+  }
+
+  /// Add browser node to the active browser node list if it is playing or recording, remove it otherwise.
+  /// Returns true if the browser node is active.
+  bool UpdateBrowserNodeActiveState(vtkMRMLSequenceBrowserNode* browserNode)
+  {
+    bool active = browserNode->GetPlaybackActive() || browserNode->GetRecordingActive();
+    std::vector<vtkMRMLSequenceBrowserNode*>::iterator activeIt =
+      std::find(this->ActiveBrowserNodes.begin(), this->ActiveBrowserNodes.end(), browserNode);
+    if (active && activeIt == this->ActiveBrowserNodes.end())
+    {
+      this->ActiveBrowserNodes.push_back(browserNode);
+    }
+    else if (!active && activeIt != this->ActiveBrowserNodes.end())
+    {
+      this->ActiveBrowserNodes.erase(activeIt);
+    }
+    return active;
+  }
+
+  /// Update sequence to browser node index for browser nodes that had their synchronized sequences changed
+  void UpdateSequenceBrowserNodes()
+  {
+    for (std::set<vtkMRMLSequenceBrowserNode*>::iterator browserNodeIt = this->OutdatedBrowserNodeSequences.begin();
+      browserNodeIt != this->OutdatedBrowserNodeSequences.end(); ++browserNodeIt)
+    {
+      vtkMRMLSequenceBrowserNode* browserNode = *browserNodeIt;
+      // remove previous entries
+      std::vector<vtkMRMLSequenceNode*>& sequenceNodes = this->BrowserNodeSequences[browserNode];
+      for (std::vector<vtkMRMLSequenceNode*>::iterator sequenceNodeIt = sequenceNodes.begin(); sequenceNodeIt != sequenceNodes.end(); ++sequenceNodeIt)
+      {
+        std::map<vtkMRMLSequenceNode*, std::vector<vtkMRMLSequenceBrowserNode*> >::iterator sequenceBrowserNodesIt =
+          this->SequenceBrowserNodes.find(*sequenceNodeIt);
+        if (sequenceBrowserNodesIt == this->SequenceBrowserNodes.end())
+        {
+          // sequence node has been removed from the scene
+          continue;
+        }
+        std::vector<vtkMRMLSequenceBrowserNode*>& browserNodes = sequenceBrowserNodesIt->second;
+        browserNodes.erase(std::remove(browserNodes.begin(), browserNodes.end(), browserNode), browserNodes.end());
+        if (browserNodes.empty())
+        {
+          this->SequenceBrowserNodes.erase(sequenceBrowserNodesIt);
+        }
+      }
+      if (std::find(this->BrowserNodes.begin(), this->BrowserNodes.end(), browserNode) == this->BrowserNodes.end())
+      {
+        // browser node is not in the scene anymore
+        this->BrowserNodeSequences.erase(browserNode);
+        continue;
+      }
+      // add current entries
+      browserNode->GetSynchronizedSequenceNodes(sequenceNodes, true);
+      for (std::vector<vtkMRMLSequenceNode*>::iterator sequenceNodeIt = sequenceNodes.begin(); sequenceNodeIt != sequenceNodes.end(); ++sequenceNodeIt)
+      {
+        if (*sequenceNodeIt != NULL)
+        {
+          this->SequenceBrowserNodes[*sequenceNodeIt].push_back(browserNode);
+        }
+      }
+    }
+    this->OutdatedBrowserNodeSequences.clear();
+  }
+
+  /// Remove all entries from the browser node registry
+  void ClearBrowserNodeRegistry()
+  {
+    this->BrowserNodes.clear();
+    this->ActiveBrowserNodes.clear();
+    this->BrowserNodeSequences.clear();
+    this->SequenceBrowserNodes.clear();
+    this->OutdatedBrowserNodeSequences.clear();
+  }
+
+  /// Returns the latest modification time of the node and its bulk data object.
+  /// Bulk data (voxels, mesh, table) may be modified in-place without modifying the node.
+  static vtkMTimeType GetNodeContentMTime(vtkMRMLNode* node)
+  {
+    vtkMTimeType mtime = node->GetMTime();
+    vtkObject* content = NULL;
+    if (vtkMRMLVolumeNode::SafeDownCast(node))
+    {
+      content = vtkMRMLVolumeNode::SafeDownCast(node)->GetImageData();
+    }
+    else if (vtkMRMLModelNode::SafeDownCast(node))
+    {
+      content = vtkMRMLModelNode::SafeDownCast(node)->GetPolyData();
+    }
+    else if (vtkMRMLTableNode::SafeDownCast(node))
+    {
+      content = vtkMRMLTableNode::SafeDownCast(node)->GetTable();
+    }
+    else if (vtkMRMLTransformNode::SafeDownCast(node))
+    {
+      content = vtkMRMLTransformNode::SafeDownCast(node)->GetTransformToParent();
+    }
+    if (content != NULL)
+    {
+      mtime = std::max(mtime, content->GetMTime());
+    }
+    return mtime;
+  }
+
+  std::map<vtkMRMLNode*, AppliedDataNode> AppliedDataNodes;
+
+  // Browser nodes in the scene
+  std::vector<vtkMRMLSequenceBrowserNode*> BrowserNodes;
+  // Browser nodes that are currently playing or recording
+  std::vector<vtkMRMLSequenceBrowserNode*> ActiveBrowserNodes;
+  // Synchronized sequence nodes (including the master) of each browser node
+  std::map<vtkMRMLSequenceBrowserNode*, std::vector<vtkMRMLSequenceNode*> > BrowserNodeSequences;
+  // Browser nodes that each sequence node is synchronized in (reverse index of BrowserNodeSequences)
+  std::map<vtkMRMLSequenceNode*, std::vector<vtkMRMLSequenceBrowserNode*> > SequenceBrowserNodes;
+  // Browser nodes whose synchronized sequence node list changed since the index was last updated
+  std::set<vtkMRMLSequenceBrowserNode*> OutdatedBrowserNodeSequences;
+
+  std::list<RecordingFrame> RecordingQueue;
+  // Snapshots that are not used anymore, by node class name. Their buffers are reused for the next snapshot.
+  // Only accessed from the main thread.
+  std::map< std::string, vtkSmartPointer<vtkMRMLNode> > SpareRecordingSnapshots;
+  // Proxy nodes that have been recorded in the background already. Only accessed from the main thread.
+  std::set<vtkMRMLNode*> RecordedProxyNodes;
+  int RecordingQueueMaximumSize;
+  int RecordingQueuePeakSize;
+  int NumberOfDroppedRecordingFrames;
+  bool StopRequested;
+
+  std::mutex RecordingMutex;
+  std::condition_variable FrameQueuedCondition;
+  std::condition_variable FrameCompletedCondition;
+  std::thread RecordingThread;
+
+  int NumberOfProxyUpdateThreads;
+  std::vector< std::function<void()> > ContentCopyTasks;
+  size_t NextContentCopyTask;
+  size_t NumberOfRemainingContentCopyTasks;
+  bool ContentCopyStopRequested;
+  std::mutex ContentCopyMutex;
+  std::condition_variable ContentCopyTaskCondition;
+  std::condition_variable ContentCopyDoneCondition;
+  std::vector<std::thread> ContentCopyThreads;
+
+  bool PerformanceMetricsEnabled;
+  std::map<vtkMRMLSequenceBrowserNode*, BrowserMetrics> BrowserMetricsMap;
+  // Node copy durations for each node sequencer (identified by supported node class name)
+  std::map<std::string, SampleStatistics> NodeCopyMetrics;
+  // Number of recorded states waiting in the background recording queue, sampled at each UpdateAllProxyNodes call
+  SampleStatistics RecordingQueueSizeMetrics;
+
+  bool ProxyNodeDoubleBufferingEnabled;
+  // Browser nodes that may have back buffers prepared for their proxy nodes
+  std::set<vtkMRMLSequenceBrowserNode*> PreparedBrowserNodes;
+  // Proxy nodes of PreparedBrowserNodes that may have back buffers
+  std::set<vtkMRMLNode*> PreparedProxyNodes;
+  int NumberOfPrefetchedItems;
+  double PrefetchMemoryBudgetMB;
+  // Number of items that the last playback frame update advanced (used for predicting the next items)
+  std::map<vtkMRMLSequenceBrowserNode*, int> PlaybackSelectionIncrements;
+  std::deque<PreparationTask> PreparationTasks;
+  // Set while a task is running
+  bool PreparationInProgress;
+  // Source and target node of the running task
+  vtkMRMLNode* PreparationSourceNode;
+  vtkMRMLNode* PreparationTargetNode;
+  bool PreparationStopRequested;
+  std::mutex PreparationMutex;
+  std::condition_variable PreparationTaskCondition;
+  std::condition_variable PreparationDoneCondition;
+  std::thread PreparationThread;
+  // Source data nodes and proxy nodes used by the preparation tasks (kept alive until the tasks are completed or removed)
+  std::vector< vtkSmartPointer<vtkMRMLNode> > PreparationNodes;
+};
+
 //----------------------------------------------------------------------------
 vtkStandardNewMacro(vtkSlicerSequenceBrowserLogic);
 
@@ -56,11 +649,14 @@ vtkSlicerSequenceBrowserLogic::vtkSlicerSequenceBrowserLogic()
   : UpdateProxyNodesFromSequencesInProgress(false)
   , UpdateSequencesFromProxyNodesInProgress(false)
 {
+  this->Internal = new vtkInternal;
 }
 
 //----------------------------------------------------------------------------
 vtkSlicerSequenceBrowserLogic::~vtkSlicerSequenceBrowserLogic()
-{  
+{
+  delete this->Internal;
+  this->Internal = NULL;
 }
 
 //----------------------------------------------------------------------------
@@ -73,6 +669,7 @@ void vtkSlicerSequenceBrowserLogic::PrintSelf(ostream& os, vtkIndent indent)
 //---------------------------------------------------------------------------
 void vtkSlicerSequenceBrowserLogic::SetMRMLSceneInternal(vtkMRMLScene * newScene)
 {
+  this->Internal->ClearBrowserNodeRegistry();
   vtkNew<vtkIntArray> events;
   events->InsertNextValue(vtkMRMLScene::NodeAddedEvent);
   events->InsertNextValue(vtkMRMLScene::NodeRemovedEvent);
@@ -100,6 +697,19 @@ void vtkSlicerSequenceBrowserLogic::UpdateFromMRMLScene()
     return;
   }
   // TODO: probably we need to add observer to all vtkMRMLSequenceBrowserNode-type nodes
+
+  // Rebuild the browser node registry (node references may have been updated during batch processing)
+  this->Internal->ClearBrowserNodeRegistry();
+  std::vector< vtkMRMLNode* > browserNodes;
+  this->GetMRMLScene()->GetNodesByClass("vtkMRMLSequenceBrowserNode", browserNodes);
+  for (std::vector< vtkMRMLNode* >::iterator browserNodeIt = browserNodes.begin(); browserNodeIt != browserNodes.end(); ++browserNodeIt)
+  {
+    vtkMRMLSequenceBrowserNode* browserNode = vtkMRMLSequenceBrowserNode::SafeDownCast(*browserNodeIt);
+    if (browserNode != NULL)
+    {
+      this->Internal->RegisterBrowserNode(browserNode);
+    }
+  }
 }
 
 //---------------------------------------------------------------------------
@@ -117,7 +727,11 @@ void vtkSlicerSequenceBrowserLogic::OnMRMLSceneNodeAdded(vtkMRMLNode* node)
     vtkNew<vtkIntArray> events;
     events->InsertNextValue(vtkMRMLSequenceBrowserNode::ProxyNodeModifiedEvent);
     events->InsertNextValue(vtkCommand::ModifiedEvent);
+    events->InsertNextValue(vtkMRMLNode::ReferenceAddedEvent);
+    events->InsertNextValue(vtkMRMLNode::ReferenceModifiedEvent);
+    events->InsertNextValue(vtkMRMLNode::ReferenceRemovedEvent);
     vtkObserveMRMLNodeEventsMacro(node, events.GetPointer());
+    this->Internal->RegisterBrowserNode(vtkMRMLSequenceBrowserNode::SafeDownCast(node));
   }
 }
 
@@ -133,7 +747,29 @@ void vtkSlicerSequenceBrowserLogic::OnMRMLSceneNodeRemoved(vtkMRMLNode* node)
   {
     vtkDebugMacro("OnMRMLSceneNodeRemoved: Have a vtkMRMLSequenceBrowserNode node");
     vtkUnObserveMRMLNodeMacro(node);
-  } 
+    vtkMRMLSequenceBrowserNode* browserNode = vtkMRMLSequenceBrowserNode::SafeDownCast(node);
+    this->DiscardPreparedProxyNodeContent(browserNode);
+    this->Internal->UnregisterBrowserNode(browserNode);
+    this->Internal->PlaybackSelectionIncrements.erase(browserNode);
+    this->LastSequenceBrowserUpdateTimeSec.erase(browserNode);
+  }
+  else if (node->IsA("vtkMRMLSequenceNode"))
+  {
+    // Browser nodes remove their references to the sequence node, so they will be re-indexed anyway,
+    // but make sure the removed node cannot be found in the index in the meantime.
+    this->Internal->SequenceBrowserNodes.erase(vtkMRMLSequenceNode::SafeDownCast(node));
+  }
+  if (this->Internal->PreparedProxyNodes.erase(node) > 0)
+  {
+    // release back buffers of the proxy node
+    this->Internal->CancelPreparationTasks(node);
+    this->Internal->WaitForPreparationTask(node);
+    vtkMRMLNodeSequencer::GetInstance()->GetNodeSequencer(node)->DiscardPreparedNodeContent(node);
+  }
+  this->SharedDataProxyNodes.erase(node);
+  this->Internal->RecordedProxyNodes.erase(node);
+  this->Internal->AppliedDataNodes.erase(node);
+  this->Internal->BrowserMetricsMap.erase(vtkMRMLSequenceBrowserNode::SafeDownCast(node));
 }
 
 //---------------------------------------------------------------------------
@@ -147,16 +783,37 @@ void vtkSlicerSequenceBrowserLogic::UpdateAllProxyNodes()
     vtkErrorMacro("vtkSlicerSequenceBrowserLogic::UpdateAllProxyNodes failed: scene is invalid");
     return;
   }
-  std::vector< vtkMRMLNode* > browserNodes;
-  int numBrowserNodes = this->GetMRMLScene()->GetNodesByClass("vtkMRMLSequenceBrowserNode", browserNodes);
-  for (int i = 0; i < numBrowserNodes; i++)
+  if (this->Internal->PerformanceMetricsEnabled)
   {
-    vtkMRMLSequenceBrowserNode* browserNode = vtkMRMLSequenceBrowserNode::SafeDownCast(browserNodes[i]);
-    if (browserNode==NULL)
+    this->Internal->RecordingQueueSizeMetrics.AddSample(this->GetRecordingQueueSize());
+  }
+  this->FlushRecordingQueue();
+  // Only playing or recording browser nodes need update. A copy of the list is iterated through,
+  // because browser nodes may be started or stopped during proxy node updates.
+  std::vector< vtkMRMLSequenceBrowserNode* > activeBrowserNodes = this->Internal->ActiveBrowserNodes;
+  for (std::vector< vtkMRMLSequenceBrowserNode* >::iterator browserNodeIt = activeBrowserNodes.begin();
+    browserNodeIt != activeBrowserNodes.end(); ++browserNodeIt)
+  {
+    vtkMRMLSequenceBrowserNode* browserNode = *browserNodeIt;
+    if (std::find(this->Internal->ActiveBrowserNodes.begin(), this->Internal->ActiveBrowserNodes.end(), browserNode)
+      == this->Internal->ActiveBrowserNodes.end())
     {
-      vtkErrorMacro("Browser node is invalid");
+      // browser node has been stopped or removed since the update started
       continue;
     }
+    if (browserNode->GetRecordingActive()
+      && browserNode->GetRecordingSamplingMode() == vtkMRMLSequenceBrowserNode::SamplingFixedFrameRate)
+    {
+      // Sample proxy nodes on the recording clock (nothing is recorded if no sample is due yet)
+      if (browserNode->GetRecordingInBackground())
+      {
+        this->SaveProxyNodesStateInBackground(browserNode);
+      }
+      else
+      {
+        browserNode->SaveProxyNodesState();
+      }
+    }
     if (!browserNode->GetPlaybackActive())
     {
       this->LastSequenceBrowserUpdateTimeSec.erase(browserNode);
@@ -170,64 +827,196 @@ void vtkSlicerSequenceBrowserLogic::UpdateAllProxyNodes()
     }
     // play is already in progress
     double elapsedTimeSec = updateStartTimeSec - this->LastSequenceBrowserUpdateTimeSec[browserNode];
+    if (browserNode->IsPlaybackRealTime())
+    {
+      // Real-time playback: the item is selected by index value on the playback clock,
+      // therefore the number of items to jump depends on the sampling of the sequence.
+      this->LastSequenceBrowserUpdateTimeSec[browserNode] = updateStartTimeSec;
+      int previousItemNumber = browserNode->GetSelectedItemNumber();
+      int selectedItemNumber = browserNode->AdvancePlaybackClock(elapsedTimeSec);
+      int numberOfItems = browserNode->GetNumberOfItems();
+      if (previousItemNumber >= 0 && selectedItemNumber != previousItemNumber && numberOfItems > 0)
+      {
+        int selectionIncrement = ((selectedItemNumber - previousItemNumber) % numberOfItems + numberOfItems) % numberOfItems;
+        if (this->Internal->PerformanceMetricsEnabled)
+        {
+          vtkInternal::BrowserMetrics& metrics = this->Internal->BrowserMetricsMap[browserNode];
+          metrics.NumberOfPlaybackFrames++;
+          if (selectionIncrement > 1)
+          {
+            metrics.NumberOfSkippedPlaybackFrames += selectionIncrement - 1;
+          }
+        }
+        // Used for predicting the items of the next updates (see PrefetchProxyNodeContent)
+        this->Internal->PlaybackSelectionIncrements[browserNode] = selectionIncrement;
+      }
+      continue;
+    }
     // compute how many items we need to jump; if not enough time passed to jump at least to the next item
     // then we don't do anything (let the elapsed time cumulate)
     int selectionIncrement = floor(elapsedTimeSec * browserNode->GetPlaybackRateFps()+0.5); // floor with +0.5 is rounding
     if (selectionIncrement>0)
     {
-      this->LastSequenceBrowserUpdateTimeSec[browserNode] = updateStartTimeSec;
+      // Advance the frame clock by whole frame periods (instead of setting it to the current time),
+      // so that timer latency does not accumulate and the average playback rate stays exact.
+      // If playback fell behind by more than a frame period then the clock is reset to avoid a burst of updates.
+      double framePeriodSec = 1.0 / browserNode->GetPlaybackRateFps();
+      double frameTimeSec = this->LastSequenceBrowserUpdateTimeSec[browserNode] + selectionIncrement * framePeriodSec;
+      if (updateStartTimeSec - frameTimeSec > framePeriodSec)
+      {
+        frameTimeSec = updateStartTimeSec;
+      }
+      this->LastSequenceBrowserUpdateTimeSec[browserNode] = frameTimeSec;
+      if (this->Internal->PerformanceMetricsEnabled)
+      {
+        vtkInternal::BrowserMetrics& metrics = this->Internal->BrowserMetricsMap[browserNode];
+        metrics.NumberOfPlaybackFrames++;
+        if (selectionIncrement > 1)
+        {
+          // Items are skipped to keep up with the playback rate, or if skipping is disabled then playback is slowed down
+          if (browserNode->GetPlaybackItemSkippingEnabled())
+          {
+            metrics.NumberOfSkippedPlaybackFrames += selectionIncrement - 1;
+          }
+          else
+          {
+            metrics.NumberOfLatePlaybackFrames++;
+          }
+        }
+      }
       if (!browserNode->GetPlaybackItemSkippingEnabled())
       {
         selectionIncrement = 1;
       }
+      this->Internal->PlaybackSelectionIncrements[browserNode] = selectionIncrement;
       browserNode->SelectNextItem(selectionIncrement);
     }
   }
 }
 
 //---------------------------------------------------------------------------
-void vtkSlicerSequenceBrowserLogic::UpdateProxyNodesFromSequences(vtkMRMLSequenceBrowserNode* browserNode)
+double vtkSlicerSequenceBrowserLogic::GetNextUpdateTimeSec()
 {
-#ifdef ENABLE_PERFORMANCE_PROFILING
-  vtkNew<vtkTimerLog> timer;
-  timer->StartTimer();  
-#endif 
-
-  if (this->UpdateProxyNodesFromSequencesInProgress || this->UpdateSequencesFromProxyNodesInProgress)
-  {
-    // avoid infinite loops (caused by triggering a node update during a node update)
-    return;
-  }
-  if (browserNode==NULL)
-  {
-    vtkWarningMacro("vtkSlicerSequenceBrowserLogic::UpdateProxyNodesFromSequences failed: browserNode is invalid");
-    return;
-  }
-
-  if (browserNode->GetRecordingActive())
+  vtkMRMLScene* scene = this->GetMRMLScene();
+  if (scene == NULL)
   {
-    // don't update proxy nodes while recording (sequence is updated from proxy nodes)
-    return;
+    return -1.0;
   }
-  
-  if (browserNode->GetMasterSequenceNode() == NULL)
+  double currentTimeSec = vtkTimerLog::GetUniversalTime();
+  double nextUpdateTimeSec = -1.0;
+  if (this->GetRecordingQueueSize() > 0)
   {
-    browserNode->RemoveAllProxyNodes();
-    return;
+    // recorded states are waiting to be inserted into the sequences
+    nextUpdateTimeSec = currentTimeSec + RECORDING_QUEUE_FLUSH_PERIOD_SEC;
   }
-
-  vtkMRMLScene* scene=browserNode->GetScene();
-  if (scene==NULL)
+  // Playback and recording state is taken from the browser nodes (not from ActiveBrowserNodes), because this method
+  // may be called from an observer of a browser node that is invoked before the logic has updated ActiveBrowserNodes.
+  for (std::vector< vtkMRMLSequenceBrowserNode* >::iterator browserNodeIt = this->Internal->BrowserNodes.begin();
+    browserNodeIt != this->Internal->BrowserNodes.end(); ++browserNodeIt)
   {
-    vtkErrorMacro("vtkSlicerSequenceBrowserLogic::UpdateProxyNodesFromSequences failed: scene is invalid");
-    return;
-  }
+    vtkMRMLSequenceBrowserNode* browserNode = *browserNodeIt;
+    if (!browserNode->GetPlaybackActive() && !browserNode->GetRecordingActive())
+    {
+      continue;
+    }
+    double browserUpdateTimeSec = -1.0;
+    if (browserNode->GetRecordingActive())
+    {
+      if (browserNode->GetRecordingSamplingMode() == vtkMRMLSequenceBrowserNode::SamplingFixedFrameRate)
+      {
+        browserUpdateTimeSec = browserNode->GetNextRecordingSampleTimeSec();
+      }
+      else if (browserNode->GetRecordingInBackground())
+      {
+        // states may be queued any time, they have to be inserted into the sequences regularly
+        browserUpdateTimeSec = currentTimeSec + RECORDING_QUEUE_FLUSH_PERIOD_SEC;
+      }
+    }
+    else if (browserNode->GetPlaybackActive() && browserNode->IsPlaybackRealTime())
+    {
+      std::map< vtkMRMLSequenceBrowserNode*, double >::iterator lastUpdateTimeIt = this->LastSequenceBrowserUpdateTimeSec.find(browserNode);
+      if (lastUpdateTimeIt == this->LastSequenceBrowserUpdateTimeSec.end())
+      {
+        // playback has just been started
+        browserUpdateTimeSec = currentTimeSec;
+      }
+      else
+      {
+        // next item is due when the playback clock reaches its index value
+        double timeToNextItemSec = browserNode->GetPlaybackTimeToNextItemSec();
+        if (timeToNextItemSec >= 0)
+        {
+          browserUpdateTimeSec = lastUpdateTimeIt->second + timeToNextItemSec;
+        }
+      }
+    }
+    else if (browserNode->GetPlaybackActive() && browserNode->GetPlaybackRateFps() > 0)
+    {
+      std::map< vtkMRMLSequenceBrowserNode*, double >::iterator lastUpdateTimeIt = this->LastSequenceBrowserUpdateTimeSec.find(browserNode);
+      if (lastUpdateTimeIt == this->LastSequenceBrowserUpdateTimeSec.end())
+      {
+        // playback has just been started
+        browserUpdateTimeSec = currentTimeSec;
+      }
+      else
+      {
+        // next item is due one frame period after the previous one
+        browserUpdateTimeSec = lastUpdateTimeIt->second + 1.0 / browserNode->GetPlaybackRateFps();
+      }
+    }
+    if (browserUpdateTimeSec >= 0 && (nextUpdateTimeSec < 0 || browserUpdateTimeSec < nextUpdateTimeSec))
+    {
+      nextUpdateTimeSec = browserUpdateTimeSec;
+    }
+  }
+  return nextUpdateTimeSec;
+}
+
+//---------------------------------------------------------------------------
+void vtkSlicerSequenceBrowserLogic::UpdateProxyNodesFromSequences(vtkMRMLSequenceBrowserNode* browserNode)
+{
+#ifdef ENABLE_PERFORMANCE_PROFILING
+  vtkNew<vtkTimerLog> timer;
+  timer->StartTimer();  
+#endif 
+
+  if (this->UpdateProxyNodesFromSequencesInProgress || this->UpdateSequencesFromProxyNodesInProgress)
+  {
+    // avoid infinite loops (caused by triggering a node update during a node update)
+    return;
+  }
+  if (browserNode==NULL)
+  {
+    vtkWarningMacro("vtkSlicerSequenceBrowserLogic::UpdateProxyNodesFromSequences failed: browserNode is invalid");
+    return;
+  }
+
+  if (browserNode->GetRecordingActive())
+  {
+    // don't update proxy nodes while recording (sequence is updated from proxy nodes)
+    return;
+  }
+  
+  if (browserNode->GetMasterSequenceNode() == NULL)
+  {
+    browserNode->RemoveAllProxyNodes();
+    return;
+  }
+
+  vtkMRMLScene* scene=browserNode->GetScene();
+  if (scene==NULL)
+  {
+    vtkErrorMacro("vtkSlicerSequenceBrowserLogic::UpdateProxyNodesFromSequences failed: scene is invalid");
+    return;
+  }
 
   this->UpdateProxyNodesFromSequencesInProgress = true;
+  double metricsStartTimeSec = (this->Internal->PerformanceMetricsEnabled ? vtkTimerLog::GetUniversalTime() : 0.0);
   
   int selectedItemNumber=browserNode->GetSelectedItemNumber();
   std::string indexValue("0");
-  if (selectedItemNumber >= 0 && selectedItemNumber < browserNode->GetNumberOfItems())
+  bool masterItemSelected = (selectedItemNumber >= 0 && selectedItemNumber < browserNode->GetNumberOfItems());
+  if (masterItemSelected)
   {
     indexValue=browserNode->GetMasterSequenceNode()->GetNthIndexValue(selectedItemNumber);
   }
@@ -237,6 +1026,8 @@ void vtkSlicerSequenceBrowserLogic::UpdateProxyNodesFromSequences(vtkMRMLSequenc
   
   // Store the previous modified state of nodes to allow calling EndModify when all the nodes are updated (to prevent multiple renderings on partial update)
   std::vector< std::pair<vtkMRMLNode*, int> > nodeModifiedStates;
+  std::vector< std::pair<vtkWeakPointer<vtkMRMLNode>, vtkInternal::AppliedDataNode> > appliedDataNodes;
+  std::vector<vtkInternal::ProxyUpdate> proxyUpdates;
 
   for (std::vector< vtkMRMLSequenceNode* >::iterator sourceSequenceNodeIt=synchronizedSequenceNodes.begin(); sourceSequenceNodeIt!=synchronizedSequenceNodes.end(); ++sourceSequenceNodeIt)
   {
@@ -251,21 +1042,39 @@ void vtkSlicerSequenceBrowserLogic::UpdateProxyNodesFromSequences(vtkMRMLSequenc
       continue;
     }
 
+    // Item numbers are looked up in the mapping table of the browser node, which is only recomputed
+    // when a sequence is modified (therefore it does not require search in each sequence for each frame)
+    int exactItemNumber = -1;
+    int closestItemNumber = -1;
+    if (masterItemSelected)
+    {
+      exactItemNumber = browserNode->GetSynchronizedItemNumber(synchronizedSequenceNode, selectedItemNumber, true);
+      closestItemNumber = browserNode->GetSynchronizedItemNumber(synchronizedSequenceNode, selectedItemNumber, false);
+    }
+    else
+    {
+      exactItemNumber = synchronizedSequenceNode->GetItemNumberFromIndexValue(indexValue, true);
+      closestItemNumber = synchronizedSequenceNode->GetItemNumberFromIndexValue(indexValue, false);
+    }
+
     vtkMRMLNode* sourceDataNode = NULL;
+    int sourceItemNumber = -1;
     if (browserNode->GetSaveChanges(synchronizedSequenceNode))
     {
       // we want to save changes, therefore we have to make sure a data node is available for the current index
       if (synchronizedSequenceNode->GetNumberOfDataNodes() > 0)
       {
-        sourceDataNode = synchronizedSequenceNode->GetDataNodeAtValue(indexValue, true /*exact match*/);
-        if (sourceDataNode == NULL)
+        sourceItemNumber = exactItemNumber;
+        sourceDataNode = (exactItemNumber >= 0 ? synchronizedSequenceNode->GetNthDataNode(exactItemNumber) : NULL);
+        if (sourceDataNode == NULL && closestItemNumber >= 0)
         {
           // No source node is available for the current exact index.
           // Add a copy of the closest (previous) item into the sequence at the exact index.
-          sourceDataNode = synchronizedSequenceNode->GetDataNodeAtValue(indexValue, false /*closest match*/);
+          sourceDataNode = synchronizedSequenceNode->GetNthDataNode(closestItemNumber);
           if (sourceDataNode)
           {
             sourceDataNode = synchronizedSequenceNode->SetDataNodeAtValue(sourceDataNode, indexValue);
+            sourceItemNumber = synchronizedSequenceNode->GetItemNumberFromIndexValue(indexValue, true);
           }
         }
       }
@@ -277,13 +1086,15 @@ void vtkSlicerSequenceBrowserLogic::UpdateProxyNodesFromSequences(vtkMRMLSequenc
         if (sourceDataNode)
         {
           sourceDataNode = synchronizedSequenceNode->SetDataNodeAtValue(sourceDataNode, indexValue);
+          sourceItemNumber = 0;
         }
       }
     }
     else
     {
       // we just want to show a node, therefore we can just use closest data node
-      sourceDataNode = synchronizedSequenceNode->GetDataNodeAtValue(indexValue, false /*closest match*/);
+      sourceItemNumber = closestItemNumber;
+      sourceDataNode = (closestItemNumber >= 0 ? synchronizedSequenceNode->GetNthDataNode(closestItemNumber) : NULL);
     }
     if (sourceDataNode==NULL)
     {
@@ -317,25 +1128,149 @@ void vtkSlicerSequenceBrowserLogic::UpdateProxyNodesFromSequences(vtkMRMLSequenc
       continue;
     }
     
+    // TODO: if we really want to force non-mutable nodes in the sequence then we have to deep-copy, but that's slow.
+    // Make sure that by default/most of the time shallow-copy is used.
+    bool shallowCopy = browserNode->GetSaveChanges(synchronizedSequenceNode);
+    // While scrubbing, bulk data is shared with the sequence as a fast preview. When scrubbing is stopped
+    // the copy mode changes, therefore the full copy is made in the next update.
+    bool shareData = (!shallowCopy && (browserNode->GetShareData(synchronizedSequenceNode) || browserNode->GetScrubbingActive()));
+    vtkInternal::AppliedDataNode appliedDataNode;
+    appliedDataNode.DataNode = sourceDataNode;
+    appliedDataNode.DataNodeMTime = vtkInternal::GetNodeContentMTime(sourceDataNode);
+    appliedDataNode.CopyMode = (shareData ? vtkInternal::SharedCopy : (shallowCopy ? vtkInternal::ShallowCopy : vtkInternal::DeepCopy));
+
+    if (!newTargetProxyNodeWasCreated)
+    {
+      std::map<vtkMRMLNode*, vtkInternal::AppliedDataNode>::iterator appliedIt = this->Internal->AppliedDataNodes.find(targetProxyNode);
+      if (appliedIt != this->Internal->AppliedDataNodes.end()
+        && appliedIt->second.DataNode.GetPointer() == sourceDataNode
+        && appliedIt->second.DataNodeMTime == appliedDataNode.DataNodeMTime
+        && appliedIt->second.ProxyNodeMTime == vtkInternal::GetNodeContentMTime(targetProxyNode)
+        && appliedIt->second.CopyMode == appliedDataNode.CopyMode)
+      {
+        // The proxy node already contains this data node and none of them changed since then,
+        // copy (and node name update) is not needed.
+        continue;
+      }
+    }
+
+    vtkInternal::ProxyUpdate proxyUpdate;
+    proxyUpdate.SequenceNode = synchronizedSequenceNode;
+    proxyUpdate.SourceDataNode = sourceDataNode;
+    proxyUpdate.SourceItemNumber = sourceItemNumber;
+    proxyUpdate.ProxyNode = targetProxyNode;
+    proxyUpdate.ProxyNodeWasCreated = newTargetProxyNodeWasCreated;
+    proxyUpdate.Applied = appliedDataNode;
+    proxyUpdates.push_back(proxyUpdate);
+  }
+
+  // Back buffers that have been prepared in the background are swapped into the proxy nodes below.
+  // If the item that is displayed now is being prepared then the preparation is completed first,
+  // preparation of other items continues in the background.
+  for (std::vector<vtkInternal::ProxyUpdate>::iterator proxyUpdateIt = proxyUpdates.begin(); proxyUpdateIt != proxyUpdates.end(); ++proxyUpdateIt)
+  {
+    if (!proxyUpdateIt->ProxyNodeWasCreated && proxyUpdateIt->Applied.CopyMode == vtkInternal::DeepCopy)
+    {
+      this->Internal->WaitForPreparationTask(proxyUpdateIt->ProxyNode, proxyUpdateIt->SourceDataNode);
+    }
+  }
+
+  // Copy bulk data of proxy nodes concurrently. Only the content of data buffers is updated here, node
+  // properties and events are updated in the main thread below (CopyNode does not copy the bulk data again).
+  std::vector< std::function<void()> > contentCopyTasks;
+  std::vector<double> contentCopyTimesSec;
+  // Index of the proxy update that each content copy task belongs to
+  std::vector<size_t> contentCopyProxyUpdateIndices;
+  bool collectMetrics = this->Internal->PerformanceMetricsEnabled;
+  for (std::vector<vtkInternal::ProxyUpdate>::iterator proxyUpdateIt = proxyUpdates.begin(); proxyUpdateIt != proxyUpdates.end(); ++proxyUpdateIt)
+  {
+    if (proxyUpdateIt->ProxyNodeWasCreated || proxyUpdateIt->Applied.CopyMode != vtkInternal::DeepCopy)
+    {
+      continue;
+    }
+    vtkMRMLNodeSequencer::NodeSequencer* sequencer = vtkMRMLNodeSequencer::GetInstance()->GetNodeSequencer(proxyUpdateIt->ProxyNode);
+    vtkMRMLNode* sourceDataNode = proxyUpdateIt->SourceDataNode;
+    vtkMRMLNode* targetProxyNode = proxyUpdateIt->ProxyNode;
+    contentCopyProxyUpdateIndices.push_back(proxyUpdateIt - proxyUpdates.begin());
+    contentCopyTasks.push_back([sequencer, sourceDataNode, targetProxyNode]
+      {
+        sequencer->PrecopyNodeContent(sourceDataNode, targetProxyNode);
+      });
+  }
+  if (contentCopyTasks.size() > 1 && this->Internal->NumberOfProxyUpdateThreads > 0)
+  {
+    if (collectMetrics)
+    {
+      // Each task writes only its own element, so no locking is needed
+      contentCopyTimesSec.resize(contentCopyTasks.size(), 0.0);
+      for (size_t taskIndex = 0; taskIndex < contentCopyTasks.size(); ++taskIndex)
+      {
+        std::function<void()> copyTask = contentCopyTasks[taskIndex];
+        double* copyTimeSec = &contentCopyTimesSec[taskIndex];
+        contentCopyTasks[taskIndex] = [copyTask, copyTimeSec]
+          {
+            double startTimeSec = vtkTimerLog::GetUniversalTime();
+            copyTask();
+            *copyTimeSec = vtkTimerLog::GetUniversalTime() - startTimeSec;
+          };
+      }
+    }
+    this->Internal->RunContentCopyTasks(contentCopyTasks);
+  }
+  // Time spent with copying content of each proxy node in parallel
+  std::vector<double> precopyTimesSec(proxyUpdates.size(), 0.0);
+  for (size_t taskIndex = 0; taskIndex < contentCopyTimesSec.size(); ++taskIndex)
+  {
+    precopyTimesSec[contentCopyProxyUpdateIndices[taskIndex]] = contentCopyTimesSec[taskIndex];
+  }
+
+  for (std::vector<vtkInternal::ProxyUpdate>::iterator proxyUpdateIt = proxyUpdates.begin(); proxyUpdateIt != proxyUpdates.end(); ++proxyUpdateIt)
+  {
+    vtkMRMLSequenceNode* synchronizedSequenceNode = proxyUpdateIt->SequenceNode;
+    vtkMRMLNode* sourceDataNode = proxyUpdateIt->SourceDataNode;
+    int sourceItemNumber = proxyUpdateIt->SourceItemNumber;
+    vtkMRMLNode* targetProxyNode = proxyUpdateIt->ProxyNode;
+    bool newTargetProxyNodeWasCreated = proxyUpdateIt->ProxyNodeWasCreated;
+    bool shallowCopy = (proxyUpdateIt->Applied.CopyMode == vtkInternal::ShallowCopy);
+    bool shareData = (proxyUpdateIt->Applied.CopyMode == vtkInternal::SharedCopy);
+
     // Update the target node with the contents of the source node    
 
     // Mostly it is a shallow copy (for example for volumes, models)
     std::pair<vtkMRMLNode*, int> nodeModifiedState(targetProxyNode, targetProxyNode->StartModify());
     nodeModifiedStates.push_back(nodeModifiedState);
 
-    // Save node references of proxy node
-    // (otherwise parent transform, display node, etc. would be lost)
-    vtkSmartPointer<vtkMRMLNode> proxyOriginalReferenceStorage = vtkSmartPointer<vtkMRMLNode>::Take(targetProxyNode->NewInstance());
-    proxyOriginalReferenceStorage->CopyReferences(targetProxyNode);
     std::string proxyOriginalName = (targetProxyNode->GetName() ? targetProxyNode->GetName() : "");
 
-    // TODO: if we really want to force non-mutable nodes in the sequence then we have to deep-copy, but that's slow.
-    // Make sure that by default/most of the time shallow-copy is used.
-    bool shallowCopy = browserNode->GetSaveChanges(synchronizedSequenceNode);
-    vtkMRMLNodeSequencer::GetInstance()->GetNodeSequencer(targetProxyNode)->CopyNode(sourceDataNode, targetProxyNode, shallowCopy);
+    // Node references of the proxy node are kept (otherwise parent transform, display node, etc. would be lost)
+    vtkMRMLNodeSequencer::NodeSequencer* sequencer = vtkMRMLNodeSequencer::GetInstance()->GetNodeSequencer(targetProxyNode);
+    // Item attributes stored in the sequence node are set by ApplyNthItemAttributes below,
+    // they are not removed when the content of the data node is copied
+    sequencer->SetPreservedAttributeNames(targetProxyNode, synchronizedSequenceNode->GetItemAttributeNames());
+    double copyStartTimeSec = (collectMetrics ? vtkTimerLog::GetUniversalTime() : 0.0);
+    sequencer->CopyNodeContent(sourceDataNode, targetProxyNode, shallowCopy, shareData);
+    if (collectMetrics)
+    {
+      // Copy time includes content of this proxy node that was copied in parallel, before this call
+      double copyTimeSec = vtkTimerLog::GetUniversalTime() - copyStartTimeSec
+        + precopyTimesSec[proxyUpdateIt - proxyUpdates.begin()];
+      this->Internal->NodeCopyMetrics[sequencer->GetSupportedNodeClassName()].AddSample(copyTimeSec);
+    }
+    if (shareData && sequencer->IsNodeContentShared(targetProxyNode))
+    {
+      // Proxy node refers to the data in the sequence, a private copy is only made in MakeProxyNodeWritable
+      this->SharedDataProxyNodes.insert(targetProxyNode);
+    }
+    else
+    {
+      this->SharedDataProxyNodes.erase(targetProxyNode);
+    }
 
-    // Restore node references
-    targetProxyNode->CopyReferences(proxyOriginalReferenceStorage);
+    // Set per-item attributes that are stored in the sequence node (only changed values are updated)
+    if (!synchronizedSequenceNode->GetItemAttributeNames().empty())
+    {
+      synchronizedSequenceNode->ApplyNthItemAttributes(sourceItemNumber, targetProxyNode);
+    }
 
     if (targetProxyNode->GetSingletonTag())
     {
@@ -375,6 +1310,8 @@ void vtkSlicerSequenceBrowserLogic::UpdateProxyNodesFromSequences(vtkMRMLSequenc
         storableNode->AddDefaultStorageNode();
       }
     }
+
+    appliedDataNodes.push_back(std::make_pair(vtkWeakPointer<vtkMRMLNode>(targetProxyNode), proxyUpdateIt->Applied));
   }
 
   // Finalize modifications, all at once. These will fire the node modified events and update renderers.
@@ -383,14 +1320,62 @@ void vtkSlicerSequenceBrowserLogic::UpdateProxyNodesFromSequences(vtkMRMLSequenc
     (nodeModifiedStateIt->first)->EndModify(nodeModifiedStateIt->second);
   }
 
+  // Remember what each proxy node contains now (modification time is recorded after EndModify,
+  // so that any later change of the proxy node forces a copy at the next update)
+  for (std::vector< std::pair<vtkWeakPointer<vtkMRMLNode>, vtkInternal::AppliedDataNode> >::iterator appliedIt = appliedDataNodes.begin();
+    appliedIt != appliedDataNodes.end(); ++appliedIt)
+  {
+    vtkMRMLNode* proxyNode = appliedIt->first;
+    if (proxyNode == NULL || proxyNode->GetScene() == NULL)
+    {
+      continue;
+    }
+    appliedIt->second.ProxyNodeMTime = vtkInternal::GetNodeContentMTime(proxyNode);
+    this->Internal->AppliedDataNodes[proxyNode] = appliedIt->second;
+  }
+
   this->UpdateProxyNodesFromSequencesInProgress = false;
 
+  if (this->Internal->ProxyNodeDoubleBufferingEnabled && browserNode->GetPlaybackActive())
+  {
+    this->PrefetchProxyNodeContent();
+  }
+
+  if (this->Internal->PerformanceMetricsEnabled)
+  {
+    // Includes processing of modified events of the proxy nodes (e.g., rendering pipeline updates)
+    this->Internal->BrowserMetricsMap[browserNode].AddLatency(vtkTimerLog::GetUniversalTime() - metricsStartTimeSec);
+  }
+
 #ifdef ENABLE_PERFORMANCE_PROFILING
   timer->StopTimer();
   vtkInfoMacro("UpdateProxyNodesFromSequences: " << timer->GetElapsedTime() << "sec\n");
 #endif 
 }
 
+//---------------------------------------------------------------------------
+void vtkSlicerSequenceBrowserLogic::MakeProxyNodeWritable(vtkMRMLNode* proxyNode)
+{
+  if (proxyNode == NULL)
+  {
+    vtkErrorMacro("vtkSlicerSequenceBrowserLogic::MakeProxyNodeWritable failed: invalid proxy node");
+    return;
+  }
+  this->SharedDataProxyNodes.erase(proxyNode);
+  // Data may be shared with a sequence item (when playing) or with a recorded snapshot (when recording in the background)
+  vtkMRMLNodeSequencer::NodeSequencer* sequencer = vtkMRMLNodeSequencer::GetInstance()->GetNodeSequencer(proxyNode);
+  if (!sequencer->IsNodeContentShared(proxyNode))
+  {
+    // proxy node owns its data already (it has been detached, or data has been replaced since it was shared)
+    return;
+  }
+  // Replacing the data modifies the proxy node, which must not be saved into the sequence as a change
+  bool wasUpdateSequencesFromProxyNodesInProgress = this->UpdateSequencesFromProxyNodesInProgress;
+  this->UpdateSequencesFromProxyNodesInProgress = true;
+  sequencer->DetachNodeContent(proxyNode);
+  this->UpdateSequencesFromProxyNodesInProgress = wasUpdateSequencesFromProxyNodesInProgress;
+}
+
 //---------------------------------------------------------------------------
 void vtkSlicerSequenceBrowserLogic::UpdateSequencesFromProxyNodes(vtkMRMLSequenceBrowserNode* browserNode, vtkMRMLNode* proxyNode)
 {
@@ -399,6 +1384,12 @@ void vtkSlicerSequenceBrowserLogic::UpdateSequencesFromProxyNodes(vtkMRMLSequenc
     // this update is due to updating from sequence nodes
     return;
   }
+  if (proxyNode != NULL && this->SharedDataProxyNodes.find(proxyNode) != this->SharedDataProxyNodes.end())
+  {
+    // The proxy node has been modified, therefore it must not share data with the sequence anymore
+    // (otherwise further in-place modifications would change the sequence item, too)
+    this->MakeProxyNodeWritable(proxyNode);
+  }
   if (browserNode->GetPlaybackActive())
   {
     // don't accept node modifications while replaying
@@ -430,7 +1421,12 @@ void vtkSlicerSequenceBrowserLogic::UpdateSequencesFromProxyNodes(vtkMRMLSequenc
     // Record proxy node state into new sequence item
     // If we only record when the master node is modified, then skip if it was not the master node that was modified
     bool saveState = false;
-    if (browserNode->GetRecordMasterOnly())
+    if (browserNode->GetRecordingSamplingMode() == vtkMRMLSequenceBrowserNode::SamplingFixedFrameRate)
+    {
+      // proxy nodes are sampled by the recording clock in UpdateAllProxyNodes, independently from modifications
+      saveState = false;
+    }
+    else if (browserNode->GetRecordMasterOnly())
     {
       vtkMRMLNode* masterProxyNode = browserNode->GetProxyNode(masterNode);
       if (masterProxyNode != NULL && masterProxyNode->GetID() != NULL
@@ -447,7 +1443,14 @@ void vtkSlicerSequenceBrowserLogic::UpdateSequencesFromProxyNodes(vtkMRMLSequenc
     }
     if (saveState)
     {
-      browserNode->SaveProxyNodesState();
+      if (browserNode->GetRecordingInBackground())
+      {
+        this->SaveProxyNodesStateInBackground(browserNode);
+      }
+      else
+      {
+        browserNode->SaveProxyNodesState();
+      }
     }
   }
   else
@@ -534,8 +1537,28 @@ void vtkSlicerSequenceBrowserLogic::ProcessMRMLNodesEvents(vtkObject *caller, un
     vtkErrorMacro("Expected a vtkMRMLSequenceBrowserNode");
     return;
   }
-  if (event == vtkCommand::ModifiedEvent)
+  if (event == vtkMRMLNode::ReferenceAddedEvent
+    || event == vtkMRMLNode::ReferenceModifiedEvent
+    || event == vtkMRMLNode::ReferenceRemovedEvent)
   {
+    // Synchronized sequence nodes may have changed, update the sequence index when it is needed next time
+    this->Internal->OutdatedBrowserNodeSequences.insert(browserNode);
+  }
+  else if (event == vtkCommand::ModifiedEvent)
+  {
+    this->Internal->UpdateBrowserNodeActiveState(browserNode);
+    if (!browserNode->GetPlaybackActive())
+    {
+      // playback has been stopped, next playback will start from the current time
+      this->LastSequenceBrowserUpdateTimeSec.erase(browserNode);
+      this->Internal->PlaybackSelectionIncrements.erase(browserNode);
+      this->DiscardPreparedProxyNodeContent(browserNode);
+    }
+    if (!browserNode->GetRecordingActive())
+    {
+      // Recording may have been just stopped, make sure all recorded states are added to the sequences
+      this->FlushRecordingQueue(true);
+    }
     // Browser node modified (e.g., switched to next frame), update proxy nodes
     this->UpdateProxyNodesFromSequences(browserNode);
   }
@@ -617,20 +1640,20 @@ void vtkSlicerSequenceBrowserLogic::GetBrowserNodesForSequenceNode(vtkMRMLSequen
     return;
   }
   foundBrowserNodes->RemoveAllItems();
-  std::vector< vtkMRMLNode* > browserNodes;
-  this->GetMRMLScene()->GetNodesByClass("vtkMRMLSequenceBrowserNode", browserNodes);
-  for (std::vector< vtkMRMLNode* >::iterator browserNodeIt = browserNodes.begin(); browserNodeIt != browserNodes.end(); ++browserNodeIt)
+  this->Internal->UpdateSequenceBrowserNodes();
+  std::map<vtkMRMLSequenceNode*, std::vector<vtkMRMLSequenceBrowserNode*> >::iterator sequenceBrowserNodesIt =
+    this->Internal->SequenceBrowserNodes.find(sequenceNode);
+  if (sequenceBrowserNodesIt == this->Internal->SequenceBrowserNodes.end())
   {
-    vtkMRMLSequenceBrowserNode* browserNode = vtkMRMLSequenceBrowserNode::SafeDownCast(*browserNodeIt);
-    if (browserNode->IsSynchronizedSequenceNode(sequenceNode, true))
-    {
-      foundBrowserNodes->AddItem(browserNode);
-    }
-  }      
+    return;
+  }
+  for (std::vector< vtkMRMLSequenceBrowserNode* >::iterator browserNodeIt = sequenceBrowserNodesIt->second.begin();
+    browserNodeIt != sequenceBrowserNodesIt->second.end(); ++browserNodeIt)
+  {
+    foundBrowserNodes->AddItem(*browserNodeIt);
+  }
 }
 
- ;
-
 //---------------------------------------------------------------------------
 vtkMRMLSequenceBrowserNode* vtkSlicerSequenceBrowserLogic::GetFirstBrowserNodeForSequenceNode(vtkMRMLSequenceNode* sequenceNode)
 {
@@ -639,15 +1662,678 @@ vtkMRMLSequenceBrowserNode* vtkSlicerSequenceBrowserLogic::GetFirstBrowserNodeFo
     vtkErrorMacro("Scene is invalid");
     return NULL;
   }
-  std::vector< vtkMRMLNode* > browserNodes;
-  this->GetMRMLScene()->GetNodesByClass("vtkMRMLSequenceBrowserNode", browserNodes);
-  for (std::vector< vtkMRMLNode* >::iterator browserNodeIt = browserNodes.begin(); browserNodeIt != browserNodes.end(); ++browserNodeIt)
+  this->Internal->UpdateSequenceBrowserNodes();
+  std::map<vtkMRMLSequenceNode*, std::vector<vtkMRMLSequenceBrowserNode*> >::iterator sequenceBrowserNodesIt =
+    this->Internal->SequenceBrowserNodes.find(sequenceNode);
+  if (sequenceBrowserNodesIt == this->Internal->SequenceBrowserNodes.end() || sequenceBrowserNodesIt->second.empty())
   {
-    vtkMRMLSequenceBrowserNode* browserNode = vtkMRMLSequenceBrowserNode::SafeDownCast(*browserNodeIt);
-    if (browserNode->IsSynchronizedSequenceNode(sequenceNode, true))
+    return NULL;
+  }
+  return sequenceBrowserNodesIt->second.front();
+}
+
+//---------------------------------------------------------------------------
+void vtkSlicerSequenceBrowserLogic::SaveProxyNodesStateInBackground(vtkMRMLSequenceBrowserNode* browserNode)
+{
+  if (browserNode == NULL)
+  {
+    vtkErrorMacro("vtkSlicerSequenceBrowserLogic::SaveProxyNodesStateInBackground failed: invalid browser node");
+    return;
+  }
+
+  // Insert states that have been copied since the last call, to keep the queue short
+  this->FlushRecordingQueue();
+
+  std::vector< vtkMRMLSequenceNode* > sequenceNodes;
+  browserNode->GetSynchronizedSequenceNodes(sequenceNodes, true);
+  int numberOfRecordedNodes = 0;
+  for (std::vector< vtkMRMLSequenceNode* >::iterator it = sequenceNodes.begin(); it != sequenceNodes.end(); ++it)
+  {
+    if (browserNode->GetRecording(*it) && browserNode->GetProxyNode(*it) != NULL)
+    {
+      numberOfRecordedNodes++;
+    }
+  }
+  if (numberOfRecordedNodes == 0)
+  {
+    return;
+  }
+
+  vtkInternal::RecordingFrame frame;
+  if (!browserNode->GetNextRecordingIndexValue(frame.IndexValue))
+  {
+    return;
+  }
+  {
+    std::lock_guard<std::mutex> lock(this->Internal->RecordingMutex);
+    if (static_cast<int>(this->Internal->RecordingQueue.size()) >= this->Internal->RecordingQueueMaximumSize)
+    {
+      // All sequences of the browser are skipped at this time point, to keep them synchronized
+      this->Internal->NumberOfDroppedRecordingFrames++;
+      return;
+    }
+  }
+  frame.BrowserNode = browserNode;
+  for (std::vector< vtkMRMLSequenceNode* >::iterator it = sequenceNodes.begin(); it != sequenceNodes.end(); ++it)
+  {
+    vtkMRMLNode* proxyNode = browserNode->GetProxyNode(*it);
+    if (!browserNode->GetRecording(*it) || proxyNode == NULL)
+    {
+      continue;
+    }
+    vtkInternal::RecordedNode recordedNode;
+    recordedNode.SequenceNode = *it;
+    recordedNode.Sequencer = vtkMRMLNodeSequencer::GetInstance()->GetNodeSequencer(proxyNode);
+    if (proxyNode->GetAttribute("Sequences.BaseName") != NULL)
+    {
+      recordedNode.BaseName = proxyNode->GetAttribute("Sequences.BaseName");
+    }
+    else
+    {
+      recordedNode.BaseName = proxyNode->GetName() ? proxyNode->GetName() : "Data";
+    }
+    // Buffers of snapshots of previous frames are reused if possible
+    std::map< std::string, vtkSmartPointer<vtkMRMLNode> >::iterator spareSnapshotIt =
+      this->Internal->SpareRecordingSnapshots.find(proxyNode->GetClassName());
+    if (spareSnapshotIt != this->Internal->SpareRecordingSnapshots.end())
+    {
+      recordedNode.Snapshot = spareSnapshotIt->second;
+      this->Internal->SpareRecordingSnapshots.erase(spareSnapshotIt);
+    }
+    else
+    {
+      recordedNode.Snapshot = vtkSmartPointer<vtkMRMLNode>::Take(proxyNode->CreateNodeInstance());
+    }
+    // The snapshot shares bulk data with the proxy node, which is copied in the worker thread. Writers that modify
+    // proxy node data in-place must call MakeProxyNodeWritable first, which gives the proxy node its own copy.
+    // If the proxy node still shares data with the previous snapshot (data was not replaced but may have been
+    // modified in-place) or it is recorded for the first time then it is copied here, as in-place writers
+    // may not call MakeProxyNodeWritable.
+    bool copyNow = this->Internal->RecordedProxyNodes.insert(proxyNode).second
+      || recordedNode.Sequencer->IsNodeContentShared(proxyNode);
+    recordedNode.Sequencer->ShareNodeContent(proxyNode, recordedNode.Snapshot);
+    if (copyNow)
+    {
+      recordedNode.Sequencer->DetachNodeContent(recordedNode.Snapshot);
+    }
+    recordedNode.ContentShared = recordedNode.Sequencer->IsNodeContentShared(recordedNode.Snapshot);
+    // If there is a preallocated node then the worker thread copies the bulk data into it,
+    // otherwise the snapshot is inserted into the sequence
+    recordedNode.DataNode = (*it)->TakePreallocatedDataNode(proxyNode);
+    if (recordedNode.DataNode.GetPointer() == NULL)
+    {
+      recordedNode.DataNode = recordedNode.Snapshot;
+    }
+    frame.Nodes.push_back(recordedNode);
+  }
+
+  {
+    std::lock_guard<std::mutex> lock(this->Internal->RecordingMutex);
+    this->Internal->RecordingQueue.push_back(frame);
+    this->Internal->RecordingQueuePeakSize = std::max(this->Internal->RecordingQueuePeakSize,
+      static_cast<int>(this->Internal->RecordingQueue.size()));
+    this->Internal->StartRecordingThread();
+  }
+  this->Internal->FrameQueuedCondition.notify_one();
+}
+
+//---------------------------------------------------------------------------
+void vtkSlicerSequenceBrowserLogic::FlushRecordingQueue(bool wait /* =false */)
+{
+  // Completed frames are removed from the queue in order, so that items are inserted in recording order
+  std::list<vtkInternal::RecordingFrame> completedFrames;
+  {
+    std::unique_lock<std::mutex> lock(this->Internal->RecordingMutex);
+    if (this->Internal->RecordingQueue.empty())
+    {
+      return;
+    }
+    if (wait)
+    {
+      this->Internal->FrameCompletedCondition.wait(lock, [this]
+      {
+        return this->Internal->RecordingQueue.back().Completed;
+      });
+    }
+    std::list<vtkInternal::RecordingFrame>::iterator firstNotCompletedIt = std::find_if(
+      this->Internal->RecordingQueue.begin(), this->Internal->RecordingQueue.end(),
+      [](const vtkInternal::RecordingFrame& frame) { return !frame.Completed; });
+    completedFrames.splice(completedFrames.begin(), this->Internal->RecordingQueue,
+      this->Internal->RecordingQueue.begin(), firstNotCompletedIt);
+  }
+  if (completedFrames.empty())
+  {
+    return;
+  }
+
+  // Insert data nodes into sequences. Events are invoked only once per browser node.
+  bool wasUpdateSequencesFromProxyNodesInProgress = this->UpdateSequencesFromProxyNodesInProgress;
+  this->UpdateSequencesFromProxyNodesInProgress = true;
+  std::vector< std::pair<vtkMRMLSequenceBrowserNode*, int> > browserNodeModifiedStates;
+  for (std::list<vtkInternal::RecordingFrame>::iterator frameIt = completedFrames.begin(); frameIt != completedFrames.end(); ++frameIt)
+  {
+    vtkMRMLSequenceBrowserNode* browserNode = frameIt->BrowserNode;
+    if (browserNode == NULL)
+    {
+      // browser node has been deleted since the snapshot was taken
+      continue;
+    }
+    bool browserNodeFound = false;
+    for (std::vector< std::pair<vtkMRMLSequenceBrowserNode*, int> >::iterator browserIt = browserNodeModifiedStates.begin();
+      browserIt != browserNodeModifiedStates.end(); ++browserIt)
+    {
+      if (browserIt->first == browserNode)
+      {
+        browserNodeFound = true;
+        break;
+      }
+    }
+    if (!browserNodeFound)
+    {
+      browserNodeModifiedStates.push_back(std::make_pair(browserNode, browserNode->StartModify()));
+    }
+    for (std::vector<vtkInternal::RecordedNode>::iterator nodeIt = frameIt->Nodes.begin(); nodeIt != frameIt->Nodes.end(); ++nodeIt)
+    {
+      if (nodeIt->SequenceNode.GetPointer() == NULL || nodeIt->DataNode.GetPointer() == NULL)
+      {
+        continue;
+      }
+      if (nodeIt->DataNode.GetPointer() != nodeIt->Snapshot.GetPointer())
+      {
+        // Bulk data has been copied by the worker thread already, only node properties are copied here
+        nodeIt->Sequencer->CopyNode(nodeIt->Snapshot, nodeIt->DataNode, false);
+        this->Internal->SpareRecordingSnapshots[nodeIt->Snapshot->GetClassName()] = nodeIt->Snapshot;
+      }
+      else if (nodeIt->ContentShared)
+      {
+        // Swap in the copy that the worker thread made of the data shared with the proxy node
+        nodeIt->Sequencer->DetachNodeContent(nodeIt->Snapshot);
+        nodeIt->Sequencer->DiscardPreparedNodeContent(nodeIt->Snapshot);
+      }
+      // Same naming as in NodeSequencer::DeepCopyNodeToScene
+      nodeIt->DataNode->SetName(nodeIt->BaseName.c_str());
+      nodeIt->DataNode->SetAttribute("Sequences.BaseName", nodeIt->BaseName.c_str());
+      nodeIt->SequenceNode->SetDataNodeAtValueWithoutCopy(nodeIt->DataNode, frameIt->IndexValue);
+    }
+  }
+  for (std::vector< std::pair<vtkMRMLSequenceBrowserNode*, int> >::iterator browserIt = browserNodeModifiedStates.begin();
+    browserIt != browserNodeModifiedStates.end(); ++browserIt)
+  {
+    browserIt->first->Modified();
+    browserIt->first->SelectLastItem();
+    browserIt->first->EndModify(browserIt->second);
+  }
+  this->UpdateSequencesFromProxyNodesInProgress = wasUpdateSequencesFromProxyNodesInProgress;
+}
+
+//---------------------------------------------------------------------------
+void vtkSlicerSequenceBrowserLogic::SetRecordingQueueMaximumSize(int maximumSize)
+{
+  std::lock_guard<std::mutex> lock(this->Internal->RecordingMutex);
+  this->Internal->RecordingQueueMaximumSize = std::max(maximumSize, 1);
+}
+
+//---------------------------------------------------------------------------
+int vtkSlicerSequenceBrowserLogic::GetRecordingQueueMaximumSize()
+{
+  std::lock_guard<std::mutex> lock(this->Internal->RecordingMutex);
+  return this->Internal->RecordingQueueMaximumSize;
+}
+
+//---------------------------------------------------------------------------
+int vtkSlicerSequenceBrowserLogic::GetRecordingQueueSize()
+{
+  std::lock_guard<std::mutex> lock(this->Internal->RecordingMutex);
+  return static_cast<int>(this->Internal->RecordingQueue.size());
+}
+
+//---------------------------------------------------------------------------
+int vtkSlicerSequenceBrowserLogic::GetRecordingQueuePeakSize()
+{
+  std::lock_guard<std::mutex> lock(this->Internal->RecordingMutex);
+  return this->Internal->RecordingQueuePeakSize;
+}
+
+//---------------------------------------------------------------------------
+int vtkSlicerSequenceBrowserLogic::GetNumberOfDroppedRecordingFrames()
+{
+  std::lock_guard<std::mutex> lock(this->Internal->RecordingMutex);
+  return this->Internal->NumberOfDroppedRecordingFrames;
+}
+
+//---------------------------------------------------------------------------
+void vtkSlicerSequenceBrowserLogic::ResetRecordingQueueStatistics()
+{
+  std::lock_guard<std::mutex> lock(this->Internal->RecordingMutex);
+  this->Internal->RecordingQueuePeakSize = static_cast<int>(this->Internal->RecordingQueue.size());
+  this->Internal->NumberOfDroppedRecordingFrames = 0;
+}
+
+//---------------------------------------------------------------------------
+void vtkSlicerSequenceBrowserLogic::SetNumberOfProxyUpdateThreads(int numberOfThreads)
+{
+  numberOfThreads = std::max(numberOfThreads, 0);
+  if (numberOfThreads == this->Internal->NumberOfProxyUpdateThreads)
+  {
+    return;
+  }
+  // Threads are restarted on demand with the new thread count
+  this->Internal->StopContentCopyThreads();
+  this->Internal->NumberOfProxyUpdateThreads = numberOfThreads;
+  this->Modified();
+}
+
+//---------------------------------------------------------------------------
+int vtkSlicerSequenceBrowserLogic::GetNumberOfProxyUpdateThreads()
+{
+  return this->Internal->NumberOfProxyUpdateThreads;
+}
+
+//---------------------------------------------------------------------------
+void vtkSlicerSequenceBrowserLogic::SetPerformanceMetricsEnabled(bool enabled)
+{
+  if (this->Internal->PerformanceMetricsEnabled == enabled)
+  {
+    return;
+  }
+  this->Internal->PerformanceMetricsEnabled = enabled;
+  this->Modified();
+}
+
+//---------------------------------------------------------------------------
+bool vtkSlicerSequenceBrowserLogic::GetPerformanceMetricsEnabled()
+{
+  return this->Internal->PerformanceMetricsEnabled;
+}
+
+//---------------------------------------------------------------------------
+void vtkSlicerSequenceBrowserLogic::ResetPerformanceMetrics()
+{
+  this->Internal->BrowserMetricsMap.clear();
+  this->Internal->NodeCopyMetrics.clear();
+  this->Internal->RecordingQueueSizeMetrics = vtkInternal::SampleStatistics();
+  this->ResetRecordingQueueStatistics();
+}
+
+//---------------------------------------------------------------------------
+int vtkSlicerSequenceBrowserLogic::GetNumberOfProxyUpdateLatencyBins()
+{
+  return NUMBER_OF_LATENCY_HISTOGRAM_BINS;
+}
+
+//---------------------------------------------------------------------------
+double vtkSlicerSequenceBrowserLogic::GetProxyUpdateLatencyBinUpperLimitSec(int binIndex)
+{
+  if (binIndex < 0 || binIndex >= NUMBER_OF_LATENCY_HISTOGRAM_BINS)
+  {
+    vtkGenericWarningMacro("vtkSlicerSequenceBrowserLogic::GetProxyUpdateLatencyBinUpperLimitSec failed: invalid bin index " << binIndex);
+    return 0.0;
+  }
+  return LATENCY_HISTOGRAM_BIN_UPPER_LIMITS_SEC[binIndex];
+}
+
+//---------------------------------------------------------------------------
+bool vtkSlicerSequenceBrowserLogic::GetProxyUpdateLatencyHistogram(vtkMRMLSequenceBrowserNode* browserNode, vtkIntArray* binCounts)
+{
+  if (binCounts == NULL)
+  {
+    vtkErrorMacro("vtkSlicerSequenceBrowserLogic::GetProxyUpdateLatencyHistogram failed: invalid output array");
+    return false;
+  }
+  binCounts->Initialize();
+  std::map<vtkMRMLSequenceBrowserNode*, vtkInternal::BrowserMetrics>::iterator metricsIt = this->Internal->BrowserMetricsMap.find(browserNode);
+  if (metricsIt == this->Internal->BrowserMetricsMap.end())
+  {
+    return false;
+  }
+  binCounts->SetNumberOfValues(NUMBER_OF_LATENCY_HISTOGRAM_BINS);
+  for (int binIndex = 0; binIndex < NUMBER_OF_LATENCY_HISTOGRAM_BINS; binIndex++)
+  {
+    binCounts->SetValue(binIndex, metricsIt->second.LatencyHistogram[binIndex]);
+  }
+  return true;
+}
+
+//---------------------------------------------------------------------------
+double vtkSlicerSequenceBrowserLogic::GetMeanProxyUpdateLatencySec(vtkMRMLSequenceBrowserNode* browserNode)
+{
+  std::map<vtkMRMLSequenceBrowserNode*, vtkInternal::BrowserMetrics>::iterator metricsIt = this->Internal->BrowserMetricsMap.find(browserNode);
+  return (metricsIt != this->Internal->BrowserMetricsMap.end() ? metricsIt->second.Latency.GetMean() : 0.0);
+}
+
+//---------------------------------------------------------------------------
+double vtkSlicerSequenceBrowserLogic::GetMaximumProxyUpdateLatencySec(vtkMRMLSequenceBrowserNode* browserNode)
+{
+  std::map<vtkMRMLSequenceBrowserNode*, vtkInternal::BrowserMetrics>::iterator metricsIt = this->Internal->BrowserMetricsMap.find(browserNode);
+  return (metricsIt != this->Internal->BrowserMetricsMap.end() ? metricsIt->second.Latency.Maximum : 0.0);
+}
+
+//---------------------------------------------------------------------------
+int vtkSlicerSequenceBrowserLogic::GetNumberOfSkippedPlaybackFrames(vtkMRMLSequenceBrowserNode* browserNode)
+{
+  std::map<vtkMRMLSequenceBrowserNode*, vtkInternal::BrowserMetrics>::iterator metricsIt = this->Internal->BrowserMetricsMap.find(browserNode);
+  return (metricsIt != this->Internal->BrowserMetricsMap.end() ? metricsIt->second.NumberOfSkippedPlaybackFrames : 0);
+}
+
+//---------------------------------------------------------------------------
+int vtkSlicerSequenceBrowserLogic::GetNumberOfLatePlaybackFrames(vtkMRMLSequenceBrowserNode* browserNode)
+{
+  std::map<vtkMRMLSequenceBrowserNode*, vtkInternal::BrowserMetrics>::iterator metricsIt = this->Internal->BrowserMetricsMap.find(browserNode);
+  return (metricsIt != this->Internal->BrowserMetricsMap.end() ? metricsIt->second.NumberOfLatePlaybackFrames : 0);
+}
+
+//---------------------------------------------------------------------------
+double vtkSlicerSequenceBrowserLogic::GetMeanNodeCopyTimeSec(const std::string& nodeClassName)
+{
+  std::map<std::string, vtkInternal::SampleStatistics>::iterator metricsIt = this->Internal->NodeCopyMetrics.find(nodeClassName);
+  return (metricsIt != this->Internal->NodeCopyMetrics.end() ? metricsIt->second.GetMean() : 0.0);
+}
+
+//---------------------------------------------------------------------------
+int vtkSlicerSequenceBrowserLogic::GetNumberOfNodeCopies(const std::string& nodeClassName)
+{
+  std::map<std::string, vtkInternal::SampleStatistics>::iterator metricsIt = this->Internal->NodeCopyMetrics.find(nodeClassName);
+  return (metricsIt != this->Internal->NodeCopyMetrics.end() ? metricsIt->second.Count : 0);
+}
+
+//---------------------------------------------------------------------------
+void vtkSlicerSequenceBrowserLogic::WritePerformanceMetricsToTable(vtkMRMLTableNode* tableNode)
+{
+  if (tableNode == NULL)
+  {
+    vtkErrorMacro("vtkSlicerSequenceBrowserLogic::WritePerformanceMetricsToTable failed: invalid table node");
+    return;
+  }
+  vtkNew<vtkStringArray> sourceColumn;
+  sourceColumn->SetName("Source");
+  vtkNew<vtkStringArray> metricColumn;
+  metricColumn->SetName("Metric");
+  vtkNew<vtkDoubleArray> valueColumn;
+  valueColumn->SetName("Value");
+
+  for (std::map<vtkMRMLSequenceBrowserNode*, vtkInternal::BrowserMetrics>::iterator browserMetricsIt = this->Internal->BrowserMetricsMap.begin();
+    browserMetricsIt != this->Internal->BrowserMetricsMap.end(); ++browserMetricsIt)
+  {
+    std::string browserName = (browserMetricsIt->first->GetName() ? browserMetricsIt->first->GetName() : "");
+    const vtkInternal::BrowserMetrics& metrics = browserMetricsIt->second;
+    std::vector< std::pair<std::string, double> > values;
+    values.push_back(std::make_pair("ProxyUpdateCount", metrics.Latency.Count));
+    values.push_back(std::make_pair("ProxyUpdateLatencyMeanSec", metrics.Latency.GetMean()));
+    values.push_back(std::make_pair("ProxyUpdateLatencyMaxSec", metrics.Latency.Maximum));
+    for (int binIndex = 0; binIndex < NUMBER_OF_LATENCY_HISTOGRAM_BINS; binIndex++)
+    {
+      std::stringstream binName;
+      if (binIndex < NUMBER_OF_LATENCY_HISTOGRAM_BINS - 1)
+      {
+        binName << "ProxyUpdateLatencyUpTo" << LATENCY_HISTOGRAM_BIN_UPPER_LIMITS_SEC[binIndex] * 1000.0 << "ms";
+      }
+      else
+      {
+        binName << "ProxyUpdateLatencyAbove" << LATENCY_HISTOGRAM_BIN_UPPER_LIMITS_SEC[binIndex - 1] * 1000.0 << "ms";
+      }
+      values.push_back(std::make_pair(binName.str(), metrics.LatencyHistogram[binIndex]));
+    }
+    values.push_back(std::make_pair("PlaybackFrames", metrics.NumberOfPlaybackFrames));
+    values.push_back(std::make_pair("SkippedPlaybackFrames", metrics.NumberOfSkippedPlaybackFrames));
+    values.push_back(std::make_pair("LatePlaybackFrames", metrics.NumberOfLatePlaybackFrames));
+    values.push_back(std::make_pair("MissedRecordingSamples", browserMetricsIt->first->GetNumberOfMissedRecordingSamples()));
+    for (std::vector< std::pair<std::string, double> >::iterator valueIt = values.begin(); valueIt != values.end(); ++valueIt)
+    {
+      sourceColumn->InsertNextValue(browserName);
+      metricColumn->InsertNextValue(valueIt->first);
+      valueColumn->InsertNextValue(valueIt->second);
+    }
+  }
+
+  for (std::map<std::string, vtkInternal::SampleStatistics>::iterator copyMetricsIt = this->Internal->NodeCopyMetrics.begin();
+    copyMetricsIt != this->Internal->NodeCopyMetrics.end(); ++copyMetricsIt)
+  {
+    sourceColumn->InsertNextValue(copyMetricsIt->first);
+    metricColumn->InsertNextValue("CopyCount");
+    valueColumn->InsertNextValue(copyMetricsIt->second.Count);
+    sourceColumn->InsertNextValue(copyMetricsIt->first);
+    metricColumn->InsertNextValue("CopyTimeMeanSec");
+    valueColumn->InsertNextValue(copyMetricsIt->second.GetMean());
+    sourceColumn->InsertNextValue(copyMetricsIt->first);
+    metricColumn->InsertNextValue("CopyTimeMaxSec");
+    valueColumn->InsertNextValue(copyMetricsIt->second.Maximum);
+  }
+
+  std::vector< std::pair<std::string, double> > recordingValues;
+  recordingValues.push_back(std::make_pair("QueueSize", this->GetRecordingQueueSize()));
+  recordingValues.push_back(std::make_pair("QueueSizeMean", this->Internal->RecordingQueueSizeMetrics.GetMean()));
+  recordingValues.push_back(std::make_pair("QueueSizePeak", this->GetRecordingQueuePeakSize()));
+  recordingValues.push_back(std::make_pair("DroppedRecordingFrames", this->GetNumberOfDroppedRecordingFrames()));
+  for (std::vector< std::pair<std::string, double> >::iterator valueIt = recordingValues.begin(); valueIt != recordingValues.end(); ++valueIt)
+  {
+    sourceColumn->InsertNextValue("Recording");
+    metricColumn->InsertNextValue(valueIt->first);
+    valueColumn->InsertNextValue(valueIt->second);
+  }
+
+  vtkNew<vtkTable> table;
+  table->AddColumn(sourceColumn.GetPointer());
+  table->AddColumn(metricColumn.GetPointer());
+  table->AddColumn(valueColumn.GetPointer());
+  tableNode->SetAndObserveTable(table.GetPointer());
+}
+
+//---------------------------------------------------------------------------
+void vtkSlicerSequenceBrowserLogic::SetProxyNodeDoubleBufferingEnabled(bool enabled)
+{
+  if (this->Internal->ProxyNodeDoubleBufferingEnabled == enabled)
+  {
+    return;
+  }
+  if (!enabled)
+  {
+    // release all back buffers
+    std::set<vtkMRMLSequenceBrowserNode*> preparedBrowserNodes = this->Internal->PreparedBrowserNodes;
+    for (std::set<vtkMRMLSequenceBrowserNode*>::iterator browserNodeIt = preparedBrowserNodes.begin();
+      browserNodeIt != preparedBrowserNodes.end(); ++browserNodeIt)
+    {
+      this->DiscardPreparedProxyNodeContent(*browserNodeIt);
+    }
+  }
+  this->Internal->ProxyNodeDoubleBufferingEnabled = enabled;
+}
+
+//---------------------------------------------------------------------------
+bool vtkSlicerSequenceBrowserLogic::GetProxyNodeDoubleBufferingEnabled()
+{
+  return this->Internal->ProxyNodeDoubleBufferingEnabled;
+}
+
+//---------------------------------------------------------------------------
+void vtkSlicerSequenceBrowserLogic::SetNumberOfPrefetchedItems(int numberOfItems)
+{
+  this->Internal->NumberOfPrefetchedItems = std::max(numberOfItems, 1);
+}
+
+//---------------------------------------------------------------------------
+int vtkSlicerSequenceBrowserLogic::GetNumberOfPrefetchedItems()
+{
+  return this->Internal->NumberOfPrefetchedItems;
+}
+
+//---------------------------------------------------------------------------
+void vtkSlicerSequenceBrowserLogic::SetPrefetchMemoryBudgetMB(double budgetMB)
+{
+  this->Internal->PrefetchMemoryBudgetMB = std::max(budgetMB, 0.0);
+}
+
+//---------------------------------------------------------------------------
+double vtkSlicerSequenceBrowserLogic::GetPrefetchMemoryBudgetMB()
+{
+  return this->Internal->PrefetchMemoryBudgetMB;
+}
+
+//---------------------------------------------------------------------------
+void vtkSlicerSequenceBrowserLogic::PrefetchProxyNodeContent()
+{
+  // Preparation of all items is restarted, as the predicted items have changed.
+  // The running task is not waited for, it completes in the background.
+  this->Internal->CancelPreparationTasks();
+
+  // Proxy nodes of all playing browser nodes and data nodes of their predicted items
+  std::vector< vtkMRMLNode* > proxyNodes;
+  std::vector< vtkMRMLNodeSequencer::NodeSequencer* > sequencers;
+  std::vector< std::vector<vtkMRMLNode*> > proxyDataNodes;
+  size_t maximumNumberOfItems = 0;
+  for (std::vector< vtkMRMLSequenceBrowserNode* >::iterator browserNodeIt = this->Internal->ActiveBrowserNodes.begin();
+    browserNodeIt != this->Internal->ActiveBrowserNodes.end(); ++browserNodeIt)
+  {
+    vtkMRMLSequenceBrowserNode* browserNode = *browserNodeIt;
+    if (!browserNode->GetPlaybackActive() || browserNode->GetRecordingActive() || browserNode->GetMasterSequenceNode() == NULL)
+    {
+      continue;
+    }
+    int numberOfItems = browserNode->GetNumberOfItems();
+    if (numberOfItems == 0)
+    {
+      continue;
+    }
+
+    // Predict the items that SelectNextItem will select during playback. If items are skipped
+    // to keep up with the playback rate then the same number of items is expected to be skipped next time.
+    int selectionIncrement = 1;
+    std::map<vtkMRMLSequenceBrowserNode*, int>::iterator incrementIt = this->Internal->PlaybackSelectionIncrements.find(browserNode);
+    if (incrementIt != this->Internal->PlaybackSelectionIncrements.end() && browserNode->GetPlaybackItemSkippingEnabled())
+    {
+      selectionIncrement = std::max(incrementIt->second, 1);
+    }
+    std::vector<int> itemNumbers;
+    int itemNumber = browserNode->GetSelectedItemNumber();
+    for (int prefetchIndex = 0; prefetchIndex < this->Internal->NumberOfPrefetchedItems; prefetchIndex++)
+    {
+      itemNumber = (itemNumber < 0 ? 0 : itemNumber + selectionIncrement);
+      if (itemNumber >= numberOfItems)
+      {
+        if (!browserNode->GetPlaybackLooped())
+        {
+          // playback stops at the end of the sequence
+          break;
+        }
+        itemNumber = itemNumber % numberOfItems;
+      }
+      itemNumbers.push_back(itemNumber);
+    }
+    if (itemNumbers.empty())
+    {
+      continue;
+    }
+    maximumNumberOfItems = std::max(maximumNumberOfItems, itemNumbers.size());
+
+    std::vector< vtkMRMLSequenceNode* > synchronizedSequenceNodes;
+    browserNode->GetSynchronizedSequenceNodes(synchronizedSequenceNodes, true);
+    for (std::vector< vtkMRMLSequenceNode* >::iterator sequenceNodeIt = synchronizedSequenceNodes.begin();
+      sequenceNodeIt != synchronizedSequenceNodes.end(); ++sequenceNodeIt)
+    {
+      vtkMRMLSequenceNode* synchronizedSequenceNode = *sequenceNodeIt;
+      // Only deep-copied proxy nodes own their content, shallow-copied and shared proxy nodes are updated without copying
+      if (synchronizedSequenceNode == NULL
+        || !browserNode->GetPlayback(synchronizedSequenceNode)
+        || browserNode->GetSaveChanges(synchronizedSequenceNode)
+        || browserNode->GetShareData(synchronizedSequenceNode))
+      {
+        continue;
+      }
+      vtkMRMLNode* proxyNode = browserNode->GetProxyNode(synchronizedSequenceNode);
+      if (proxyNode == NULL)
+      {
+        continue;
+      }
+      std::vector<vtkMRMLNode*> dataNodes;
+      for (std::vector<int>::iterator itemNumberIt = itemNumbers.begin(); itemNumberIt != itemNumbers.end(); ++itemNumberIt)
+      {
+        int synchronizedItemNumber = browserNode->GetSynchronizedItemNumber(synchronizedSequenceNode, *itemNumberIt, false);
+        vtkMRMLNode* dataNode = (synchronizedItemNumber >= 0 ? synchronizedSequenceNode->GetNthDataNode(synchronizedItemNumber) : NULL);
+        if (dataNode != NULL && strcmp(proxyNode->GetClassName(), dataNode->GetClassName()) != 0)
+        {
+          dataNode = NULL;
+        }
+        dataNodes.push_back(dataNode);
+      }
+      vtkMRMLNodeSequencer::NodeSequencer* sequencer = vtkMRMLNodeSequencer::GetInstance()->GetNodeSequencer(proxyNode);
+      // Buffers of items that are not predicted anymore are reused
+      sequencer->RecyclePreparedNodeContent(proxyNode, dataNodes);
+      proxyNodes.push_back(proxyNode);
+      this->Internal->PreparedProxyNodes.insert(proxyNode);
+      sequencers.push_back(sequencer);
+      proxyDataNodes.push_back(dataNodes);
+    }
+    this->Internal->PreparedBrowserNodes.insert(browserNode);
+  }
+  if (proxyNodes.empty())
+  {
+    return;
+  }
+
+  // Prepare items in the order they will be displayed, until the memory budget is used up
+  std::vector< vtkMRMLNodeSequencer::NodeSequencer* > uniqueSequencers = sequencers;
+  std::sort(uniqueSequencers.begin(), uniqueSequencers.end());
+  uniqueSequencers.erase(std::unique(uniqueSequencers.begin(), uniqueSequencers.end()), uniqueSequencers.end());
+  unsigned long memoryBudgetKB = static_cast<unsigned long>(this->Internal->PrefetchMemoryBudgetMB * 1024.0);
+  std::vector<vtkInternal::PreparationTask> preparationTasks;
+  for (size_t prefetchIndex = 0; prefetchIndex < maximumNumberOfItems; prefetchIndex++)
+  {
+    for (size_t proxyIndex = 0; proxyIndex < proxyNodes.size(); proxyIndex++)
+    {
+      if (prefetchIndex >= proxyDataNodes[proxyIndex].size())
+      {
+        continue;
+      }
+      vtkMRMLNode* dataNode = proxyDataNodes[proxyIndex][prefetchIndex];
+      if (dataNode == NULL)
+      {
+        continue;
+      }
+      vtkMRMLNode* proxyNode = proxyNodes[proxyIndex];
+      vtkMRMLNodeSequencer::NodeSequencer* sequencer = sequencers[proxyIndex];
+      this->Internal->PreparationNodes.push_back(proxyNode);
+      this->Internal->PreparationNodes.push_back(dataNode);
+      vtkInternal::PreparationTask preparationTask;
+      preparationTask.SourceNode = dataNode;
+      preparationTask.TargetNode = proxyNode;
+      preparationTask.Run = [sequencer, dataNode, proxyNode, uniqueSequencers, memoryBudgetKB]
+        {
+          unsigned long usedMemoryKB = 0;
+          for (std::vector< vtkMRMLNodeSequencer::NodeSequencer* >::const_iterator sequencerIt = uniqueSequencers.begin();
+            sequencerIt != uniqueSequencers.end(); ++sequencerIt)
+          {
+            usedMemoryKB += (*sequencerIt)->GetPreparedNodeContentMemorySize();
+          }
+          if (usedMemoryKB > memoryBudgetKB)
+          {
+            return;
+          }
+          sequencer->PrepareNodeContent(dataNode, proxyNode);
+        };
+      preparationTasks.push_back(preparationTask);
+    }
+  }
+  this->Internal->StartPreparationTasks(preparationTasks);
+}
+
+//---------------------------------------------------------------------------
+void vtkSlicerSequenceBrowserLogic::DiscardPreparedProxyNodeContent(vtkMRMLSequenceBrowserNode* browserNode)
+{
+  if (this->Internal->PreparedBrowserNodes.erase(browserNode) == 0)
+  {
+    // no back buffers were prepared for this browser node
+    return;
+  }
+  std::vector< vtkMRMLNode* > proxyNodes;
+  browserNode->GetAllProxyNodes(proxyNodes);
+  for (std::vector< vtkMRMLNode* >::iterator proxyNodeIt = proxyNodes.begin(); proxyNodeIt != proxyNodes.end(); ++proxyNodeIt)
+  {
+    if (*proxyNodeIt != NULL)
     {
-      return browserNode;
+      // preparation of other browser nodes continues in the background
+      this->Internal->CancelPreparationTasks(*proxyNodeIt);
+      this->Internal->WaitForPreparationTask(*proxyNodeIt);
+      this->Internal->PreparedProxyNodes.erase(*proxyNodeIt);
+      vtkMRMLNodeSequencer::GetInstance()->GetNodeSequencer(*proxyNodeIt)->DiscardPreparedNodeContent(*proxyNodeIt);
     }
   }
-  return NULL;
 }
@@ -31,12 +31,15 @@
 
 // STD includes
 #include <cstdlib>
+#include <set>
 
 #include "vtkSlicerSequenceBrowserModuleLogicExport.h"
 #include "vtkMRMLSequenceBrowserNode.h" // Forward class declaration does not work with enum
 
+class vtkIntArray;
 class vtkMRMLNode;
 class vtkMRMLSequenceNode;
+class vtkMRMLTableNode;
 
 /// \ingroup Slicer_QtModules_ExtensionTemplate
 class VTK_SLICER_SEQUENCEBROWSER_MODULE_LOGIC_EXPORT vtkSlicerSequenceBrowserLogic :
@@ -48,12 +51,28 @@ public:
   vtkTypeMacro(vtkSlicerSequenceBrowserLogic, vtkSlicerModuleLogic);
   void PrintSelf(ostream& os, vtkIndent indent) override;
 
-  /// Refreshes the output of all the active browser nodes. Called regularly by a timer.
+  /// Refreshes the output of all the active browser nodes. Called by a timer at the time returned by GetNextUpdateTimeSec.
+  /// Also samples proxy nodes of browser nodes that record in fixed frame rate sampling mode
+  /// and inserts states recorded in the background into the sequences.
   void UpdateAllProxyNodes();
 
+  /// Get the time (in universal time, see vtkTimerLog::GetUniversalTime) when UpdateAllProxyNodes
+  /// should be called next: when the next item of a playing browser node is due, when the next
+  /// fixed frame rate recording sample is due, or when background recording queue has to be flushed.
+  /// Returns a negative value if no update is needed (no browser node is playing or recording).
+  double GetNextUpdateTimeSec();
+
   /// Updates the contents of all the proxy nodes (all the nodes copied from the master and synchronized sequences to the scene)
   void UpdateProxyNodesFromSequences(vtkMRMLSequenceBrowserNode* browserNode);
 
+  /// Make sure the proxy node owns its data, so that it can be modified in-place without changing the sequence.
+  /// Only has an effect if the proxy node shares data with a sequence (see vtkMRMLSequenceBrowserNode::SetShareData)
+  /// or with a state that is being recorded in the background (see vtkMRMLSequenceBrowserNode::SetRecordingInBackground),
+  /// in which case a private copy of the shared data is created.
+  /// Called automatically when a modification of a sharing proxy node is detected, but data may be modified
+  /// in-place without a node modified event, therefore it has to be called before such modifications.
+  void MakeProxyNodeWritable(vtkMRMLNode* proxyNode);
+
   /// Updates the sequence from a changed proxy node (if saving of state changes is allowed)
   void UpdateSequencesFromProxyNodes(vtkMRMLSequenceBrowserNode* browserNode, vtkMRMLNode* proxyNode);
 
@@ -87,6 +106,83 @@ public:
   /// use GetBrowserNodesForSequenceNode instead.
   vtkMRMLSequenceBrowserNode* GetFirstBrowserNodeForSequenceNode(vtkMRMLSequenceNode* sequenceNode);
 
+  /// Insert proxy node states that have been recorded in the background (see
+  /// vtkMRMLSequenceBrowserNode::SetRecordingInBackground) into the sequences.
+  /// Called regularly by UpdateAllProxyNodes.
+  /// \param wait If true then the method returns only after all queued states are inserted.
+  void FlushRecordingQueue(bool wait = false);
+
+  /// Maximum number of recorded states that may wait in the background recording queue.
+  /// If the queue is full then new states are not recorded (see GetNumberOfDroppedRecordingFrames).
+  void SetRecordingQueueMaximumSize(int maximumSize);
+  int GetRecordingQueueMaximumSize();
+
+  /// Number of recorded states that are currently waiting for being copied or inserted into sequences
+  int GetRecordingQueueSize();
+  /// Largest number of recorded states that were in the queue at the same time
+  int GetRecordingQueuePeakSize();
+  /// Number of states that were not recorded because the recording queue was full
+  int GetNumberOfDroppedRecordingFrames();
+  /// Reset peak queue size and number of dropped frames
+  void ResetRecordingQueueStatistics();
+
+  /// Number of worker threads that copy content of proxy nodes in parallel when multiple synchronized
+  /// sequences are replayed (the main thread copies content, too). Set to 0 to copy sequentially.
+  /// Only bulk data (such as voxels) is copied in worker threads, node modified events are always invoked in the main thread.
+  /// Default is 0 (content is copied sequentially). Using at most the number of processor cores minus one is recommended.
+  void SetNumberOfProxyUpdateThreads(int numberOfThreads);
+  int GetNumberOfProxyUpdateThreads();
+
+  /// Enable double buffering of proxy nodes during playback. After an item is displayed, the content of
+  /// the next items (see SetNumberOfPrefetchedItems) is copied into back buffers in a background thread
+  /// and when an item is due the back buffers are swapped into the proxy nodes (instead of copying
+  /// the content in the main thread). This removes copying from the frame update, as long as preparation
+  /// keeps up with the playback rate, but requires memory for additional copies of proxy node content
+  /// (see SetPrefetchMemoryBudgetMB). Only node types that implement
+  /// vtkMRMLNodeSequencer::NodeSequencer::PrepareNodeContent (such as volumes) are double-buffered.
+  /// Disabled by default.
+  void SetProxyNodeDoubleBufferingEnabled(bool enabled);
+  bool GetProxyNodeDoubleBufferingEnabled();
+  /// Number of upcoming items that are prepared in back buffers during playback, if double buffering is enabled.
+  /// Items are predicted from the current item, the number of items skipped at the last frame, and looping.
+  /// Default is 3.
+  void SetNumberOfPrefetchedItems(int numberOfItems);
+  int GetNumberOfPrefetchedItems();
+  /// Maximum memory used by back buffers of all proxy nodes (in megabytes). No more items are prepared
+  /// when the limit is reached (it may be exceeded by the size of one proxy node content). Default is 512MB.
+  void SetPrefetchMemoryBudgetMB(double budgetMB);
+  double GetPrefetchMemoryBudgetMB();
+
+  /// Enable collection of performance metrics (proxy update latency, node copy times, skipped playback frames,
+  /// recording queue size). Disabled by default. Collection has very low overhead, so it can be enabled
+  /// in any build for diagnosing playback or recording issues.
+  void SetPerformanceMetricsEnabled(bool enabled);
+  bool GetPerformanceMetricsEnabled();
+  /// Clear all collected performance metrics (including recording queue statistics)
+  void ResetPerformanceMetrics();
+
+  /// Number of bins in the proxy update latency histogram
+  static int GetNumberOfProxyUpdateLatencyBins();
+  /// Largest latency that is counted in the bin. The last bin collects all longer updates (its upper limit is infinity).
+  static double GetProxyUpdateLatencyBinUpperLimitSec(int binIndex);
+  /// Get number of proxy updates of the browser node in each latency bin.
+  /// Latency is the time spent in UpdateProxyNodesFromSequences, including processing of proxy node modified events.
+  /// Returns false if no metrics have been collected for the browser node.
+  bool GetProxyUpdateLatencyHistogram(vtkMRMLSequenceBrowserNode* browserNode, vtkIntArray* binCounts);
+  double GetMeanProxyUpdateLatencySec(vtkMRMLSequenceBrowserNode* browserNode);
+  double GetMaximumProxyUpdateLatencySec(vtkMRMLSequenceBrowserNode* browserNode);
+  /// Number of items that were not displayed during playback because playback could not keep up with the playback rate
+  int GetNumberOfSkippedPlaybackFrames(vtkMRMLSequenceBrowserNode* browserNode);
+  /// Number of items that were displayed later than scheduled (if item skipping is disabled then playback is slowed down instead)
+  int GetNumberOfLatePlaybackFrames(vtkMRMLSequenceBrowserNode* browserNode);
+  /// Time of copying a sequence item into a proxy node, for node sequencers identified by supported node class name
+  /// (see vtkMRMLNodeSequencer::NodeSequencer::GetSupportedNodeClassName).
+  double GetMeanNodeCopyTimeSec(const std::string& nodeClassName);
+  int GetNumberOfNodeCopies(const std::string& nodeClassName);
+  /// Write all collected performance metrics into a table node, one metric in each row
+  /// (columns: Source, Metric, Value).
+  void WritePerformanceMetricsToTable(vtkMRMLTableNode* tableNode);
+
 protected:
   vtkSlicerSequenceBrowserLogic();
   virtual ~vtkSlicerSequenceBrowserLogic();
@@ -101,11 +197,26 @@ protected:
 
   bool IsDataConnectorNode(vtkMRMLNode*);
 
+  /// Take a snapshot of proxy nodes and queue it for copying into the sequences in a background thread
+  void SaveProxyNodesStateInBackground(vtkMRMLSequenceBrowserNode* browserNode);
+
+  /// Start filling back buffers of proxy nodes of all playing browser nodes with the content
+  /// of the items that will be displayed next
+  void PrefetchProxyNodeContent();
+  /// Release back buffers of all proxy nodes of the browser node
+  void DiscardPreparedProxyNodeContent(vtkMRMLSequenceBrowserNode* browserNode);
+
   // Time of the last update of each browser node (in universal time)
   std::map< vtkMRMLSequenceBrowserNode*, double > LastSequenceBrowserUpdateTimeSec;
 
+  // Proxy nodes that currently share data with a sequence (data must be copied before in-place modification)
+  std::set< vtkMRMLNode* > SharedDataProxyNodes;
+
 private:
 
+  class vtkInternal;
+  vtkInternal* Internal;
+
   bool UpdateProxyNodesFromSequencesInProgress;
   bool UpdateSequencesFromProxyNodesInProgress;
 
@@ -44,6 +44,7 @@
 // STD includes
 #include <sstream>
 #include <algorithm> // for std::find
+#include <cmath>
 #include <regex>
 #if defined(_WIN32) && !defined(__CYGWIN__)
 #  define SNPRINTF _snprintf
@@ -66,7 +67,8 @@ struct vtkMRMLSequenceBrowserNode::SynchronizationProperties
     Playback(true),
     Recording(false), // to only show recording controls if it's explicitly asked by the user
     OverwriteProxyName(false), // make sure proxy node names are not accidentally overwritten
-    SaveChanges(false) // to prevent accidental sequence node changes by default
+    SaveChanges(false), // to prevent accidental sequence node changes by default
+    ShareData(false) // proxy nodes own their data by default, to prevent accidental sequence node changes
   {
   }
 
@@ -77,6 +79,7 @@ struct vtkMRMLSequenceBrowserNode::SynchronizationProperties
   bool Recording;
   bool OverwriteProxyName; // change proxy node name during replay (includes index value)
   bool SaveChanges; // save proxy node changes into the sequence
+  bool ShareData; // proxy node shares large data objects with the sequence, copied on write
 };
 
 void vtkMRMLSequenceBrowserNode::SynchronizationProperties::FromString( std::string str )
@@ -106,6 +109,10 @@ void vtkMRMLSequenceBrowserNode::SynchronizationProperties::FromString( std::str
       {
         this->SaveChanges=(!attValue.compare("true"));
       }
+      if (!attName.compare("shareData"))
+      {
+        this->ShareData=(!attValue.compare("true"));
+      }
     }
   }
 }
@@ -117,6 +124,7 @@ std::string vtkMRMLSequenceBrowserNode::SynchronizationProperties::ToString()
   ss << "recording" << " " << (this->Recording ? "true" : "false") << " ";
   ss << "overwriteProxyName" << " " << (this->OverwriteProxyName ? "true" : "false") << " ";
   ss << "saveChanges" << " " << (this->SaveChanges ? "true" : "false") << " ";
+  ss << "shareData" << " " << (this->ShareData ? "true" : "false") << " ";
   return ss.str();
 }
 
@@ -128,14 +136,27 @@ vtkMRMLSequenceBrowserNode::vtkMRMLSequenceBrowserNode()
 : PlaybackActive(false)
 , PlaybackRateFps(10.0)
 , PlaybackItemSkippingEnabled(true)
+, PlaybackRealTimeEnabled(false)
+, PlaybackSpeed(1.0)
 , PlaybackLooped(true)
 , SelectedItemNumber(-1)
+, PlaybackClockIndexValue(0.0)
+, ScrubbingActive(false)
 , RecordingActive(false)
 , RecordMasterOnly(false)
+, RecordingInBackground(false)
+, RecordingFramePoolSize(0)
 , RecordingSamplingMode(vtkMRMLSequenceBrowserNode::SamplingLimitedToPlaybackFrameRate)
+, RecordingClockStartTimeSec(0.0)
+, LastRecordingSampleIndex(0)
+, NumberOfRecordedSamples(0)
+, NumberOfMissedRecordingSamples(0)
+, RecordingSampleJitterSumSec(0.0)
+, RecordingSampleMaximumJitterSec(0.0)
 , IndexDisplayMode(vtkMRMLSequenceBrowserNode::IndexDisplayAsIndexValue)
 , IndexDisplayFormat("%.2f")
 , LastPostfixIndex(0)
+, SynchronizationLookupValid(false)
 {
   this->SetHideFromEditors(false);
   this->RecordingTimeOffsetSec = vtkTimerLog::GetUniversalTime();
@@ -157,10 +178,14 @@ void vtkMRMLSequenceBrowserNode::WriteXML(ostream& of, int nIndent)
   of << indent << " playbackActive=\"" << (this->PlaybackActive ? "true" : "false") << "\"";
   of << indent << " playbackRateFps=\"" << this->PlaybackRateFps << "\"";
   of << indent << " playbackItemSkippingEnabled=\"" << (this->PlaybackItemSkippingEnabled ? "true" : "false") << "\"";
+  of << indent << " playbackRealTimeEnabled=\"" << (this->PlaybackRealTimeEnabled ? "true" : "false") << "\"";
+  of << indent << " playbackSpeed=\"" << this->PlaybackSpeed << "\"";
   of << indent << " playbackLooped=\"" << (this->PlaybackLooped ? "true" : "false") << "\"";
   of << indent << " selectedItemNumber=\"" << this->SelectedItemNumber << "\"";
   of << indent << " recordingActive=\"" << (this->RecordingActive ? "true" : "false") << "\"";
   of << indent << " recordOnMasterModifiedOnly=\"" << (this->RecordMasterOnly ? "true" : "false") << "\"";
+  of << indent << " recordingInBackground=\"" << (this->RecordingInBackground ? "true" : "false") << "\"";
+  of << indent << " recordingFramePoolSize=\"" << this->RecordingFramePoolSize << "\"";
 
   std::string recordingSamplingModeString = this->GetRecordingSamplingModeAsString();
   if (!recordingSamplingModeString.empty())
@@ -239,6 +264,25 @@ void vtkMRMLSequenceBrowserNode::ReadXMLAttributes(const char** atts)
         this->SetPlaybackItemSkippingEnabled(0);
       }
     }
+    else if (!strcmp(attName, "playbackRealTimeEnabled"))
+    {
+      if (!strcmp(attValue, "true"))
+      {
+        this->SetPlaybackRealTimeEnabled(1);
+      }
+      else
+      {
+        this->SetPlaybackRealTimeEnabled(0);
+      }
+    }
+    else if (!strcmp(attName, "playbackSpeed"))
+    {
+      std::stringstream ss;
+      ss << attValue;
+      double playbackSpeed=1.0;
+      ss >> playbackSpeed;
+      this->SetPlaybackSpeed(playbackSpeed);
+    }
     else if (!strcmp(attName, "playbackLooped"))
     {
       if (!strcmp(attValue,"true"))
@@ -280,6 +324,18 @@ void vtkMRMLSequenceBrowserNode::ReadXMLAttributes(const char** atts)
         this->SetRecordMasterOnly(0);
       }
     }
+    else if (!strcmp(attName, "recordingInBackground"))
+    {
+      this->SetRecordingInBackground(!strcmp(attValue, "true"));
+    }
+    else if (!strcmp(attName, "recordingFramePoolSize"))
+    {
+      std::stringstream ss;
+      ss << attValue;
+      int recordingFramePoolSize = 0;
+      ss >> recordingFramePoolSize;
+      this->SetRecordingFramePoolSize(recordingFramePoolSize);
+    }
     else if (!strcmp(attName, "recordingSamplingMode"))
     {
       int recordingSamplingMode = this->GetRecordingSamplingModeFromString(attValue);
@@ -344,6 +400,7 @@ void vtkMRMLSequenceBrowserNode::ReadXMLAttributes(const char** atts)
       this->SynchronizationPropertiesMap[rolePostfix] = currSyncProps;  // Possibly overwriting the default, but that is ok
     }
   }
+  this->SynchronizationLookupValid = false;
   this->FixSequenceNodeReferenceRoleName();
 }
 
@@ -366,15 +423,22 @@ void vtkMRMLSequenceBrowserNode::Copy(vtkMRMLNode *anode)
   // Note: node references are copied by the superclass
   this->SynchronizationPostfixes = node->SynchronizationPostfixes;
   this->SynchronizationPropertiesMap = node->SynchronizationPropertiesMap;
+  this->SynchronizationLookupValid = false;
   this->RecordingTimeOffsetSec = node->RecordingTimeOffsetSec;
   this->LastSaveProxyNodesStateTimeSec = node->LastSaveProxyNodesStateTimeSec;
+  this->RecordingClockStartTimeSec = node->RecordingClockStartTimeSec;
+  this->LastRecordingSampleIndex = node->LastRecordingSampleIndex;
   this->LastPostfixIndex = node->LastPostfixIndex;
   this->SetHideFromEditors(node->GetHideFromEditors());
   this->SetPlaybackActive(node->GetPlaybackActive());
   this->SetPlaybackRateFps(node->GetPlaybackRateFps());
   this->SetPlaybackItemSkippingEnabled(node->GetPlaybackItemSkippingEnabled());
+  this->SetPlaybackRealTimeEnabled(node->GetPlaybackRealTimeEnabled());
+  this->SetPlaybackSpeed(node->GetPlaybackSpeed());
   this->SetPlaybackLooped(node->GetPlaybackLooped());
   this->SetRecordMasterOnly(node->GetRecordMasterOnly());
+  this->SetRecordingInBackground(node->GetRecordingInBackground());
+  this->SetRecordingFramePoolSize(node->GetRecordingFramePoolSize());
   this->SetRecordingSamplingMode(node->GetRecordingSamplingMode());
   this->SetIndexDisplayMode(node->GetIndexDisplayMode());
   this->SetIndexDisplayFormat(node->GetIndexDisplayFormat());
@@ -394,10 +458,15 @@ void vtkMRMLSequenceBrowserNode::PrintSelf(ostream& os, vtkIndent indent)
   os << indent << " Playback active: " << (this->PlaybackActive ? "true" : "false") << '\n';
   os << indent << " Playback rate (fps): " << this->PlaybackRateFps << '\n';
   os << indent << " Playback item skipping enabled: " << (this->PlaybackItemSkippingEnabled ? "true" : "false") << '\n';
+  os << indent << " Playback real-time enabled: " << (this->PlaybackRealTimeEnabled ? "true" : "false") << '\n';
+  os << indent << " Playback speed: " << this->PlaybackSpeed << '\n';
   os << indent << " Playback looped: " << (this->PlaybackLooped ? "true" : "false") << '\n';
   os << indent << " Selected item number: " << this->SelectedItemNumber << '\n';
+  os << indent << " Scrubbing active: " << (this->ScrubbingActive ? "true" : "false") << '\n';
   os << indent << " Recording active: " << (this->RecordingActive ? "true" : "false") << '\n';
   os << indent << " Recording on master modified only: " << (this->RecordMasterOnly ? "true" : "false") << '\n';
+  os << indent << " Recording in background: " << (this->RecordingInBackground ? "true" : "false") << '\n';
+  os << indent << " Recording frame pool size: " << this->RecordingFramePoolSize << '\n';
   os << indent << " Recording sampling mode: " << this->GetRecordingSamplingModeAsString() << "\n";
   os << indent << " Index display mode: " << this->GetIndexDisplayModeAsString() << "\n";
   os << indent << " Index display format: " << this->GetIndexDisplayFormat() << "\n";
@@ -445,6 +514,7 @@ void vtkMRMLSequenceBrowserNode::PrintSelf(ostream& os, vtkIndent indent)
         os << ", Recording: " << syncProps->Recording;
         os << ", OverwriteProxyName: " << syncProps->OverwriteProxyName;
         os << ", SaveChanges: " << syncProps->SaveChanges;
+        os << ", ShareData: " << syncProps->ShareData;
       }
       os << "\n";
     }
@@ -508,6 +578,7 @@ std::string vtkMRMLSequenceBrowserNode::SetAndObserveMasterSequenceNodeID(const
   // Move the new master's postfix to the front of the list
   std::vector< std::string >::iterator oldMasterPostfixPosition = std::find(this->SynchronizationPostfixes.begin(), this->SynchronizationPostfixes.end(), masterPostfix);
   iter_swap(oldMasterPostfixPosition, this->SynchronizationPostfixes.begin());
+  this->SynchronizationLookupValid = false;
   std::string rolePostfix = this->SynchronizationPostfixes.front();
   this->Modified();
   // Select the closest selected item index in the new master node
@@ -569,6 +640,7 @@ void vtkMRMLSequenceBrowserNode::RemoveAllSequenceNodes()
       if (rolePostfixInOriginalIt!=this->SynchronizationPostfixes.end())
       {
         this->SynchronizationPostfixes.erase(rolePostfixInOriginalIt);
+        this->SynchronizationLookupValid = false;
       }
       continue;
     }
@@ -586,16 +658,11 @@ std::string vtkMRMLSequenceBrowserNode::GetSynchronizationPostfixFromSequence(vt
     vtkErrorMacro("vtkMRMLSequenceBrowserNode::GetSynchronizationPostfixFromSequence failed: sequenceNode is invalid");
     return "";
   }
-  for (std::vector< std::string >::iterator rolePostfixIt=this->SynchronizationPostfixes.begin();
-    rolePostfixIt!=this->SynchronizationPostfixes.end(); ++rolePostfixIt)
+  if (sequenceNode->GetID() == NULL)
   {
-    std::string sequenceNodeRef=SEQUENCE_NODE_REFERENCE_ROLE_BASE+(*rolePostfixIt);
-    if (this->GetNodeReference(sequenceNodeRef.c_str())==sequenceNode)
-    {
-      return (*rolePostfixIt);
-    }
+    return "";
   }
-  return "";
+  return this->GetSynchronizationPostfixFromSequenceID(sequenceNode->GetID());
 }
 
 //----------------------------------------------------------------------------
@@ -606,16 +673,73 @@ std::string vtkMRMLSequenceBrowserNode::GetSynchronizationPostfixFromSequenceID(
     vtkErrorMacro("vtkMRMLSequenceBrowserNode::GetSynchronizationPostfixFromSequenceID failed: sequenceNodeID is invalid");
     return "";
   }
+  this->UpdateSynchronizationLookup();
+  std::unordered_map< std::string, int >::iterator lookupIt = this->SequenceNodeIDToLookupIndex.find(sequenceNodeID);
+  if (lookupIt == this->SequenceNodeIDToLookupIndex.end())
+  {
+    return "";
+  }
+  return this->SynchronizationLookupEntries[lookupIt->second].Postfix;
+}
+
+//----------------------------------------------------------------------------
+void vtkMRMLSequenceBrowserNode::UpdateSynchronizationLookup()
+{
+  if (this->SynchronizationLookupValid)
+  {
+    return;
+  }
+  this->SynchronizationLookupEntries.clear();
+  this->ItemMappingTables.clear();
+  this->SequenceNodeIDToLookupIndex.clear();
+  this->ProxyNodeIDToLookupIndex.clear();
+  this->ProxyNodes.clear();
   for (std::vector< std::string >::iterator rolePostfixIt = this->SynchronizationPostfixes.begin();
     rolePostfixIt != this->SynchronizationPostfixes.end(); ++rolePostfixIt)
   {
-    std::string sequenceNodeRef = SEQUENCE_NODE_REFERENCE_ROLE_BASE + (*rolePostfixIt);
-    if (strcmp(this->GetNodeReferenceID(sequenceNodeRef.c_str()), sequenceNodeID) == 0)
+    int lookupIndex = static_cast<int>(this->SynchronizationLookupEntries.size());
+    SynchronizationLookupEntry entry;
+    entry.Postfix = (*rolePostfixIt);
+    entry.SequenceNodeReferenceRole = SEQUENCE_NODE_REFERENCE_ROLE_BASE + (*rolePostfixIt);
+    entry.ProxyNodeReferenceRole = PROXY_NODE_REFERENCE_ROLE_BASE + (*rolePostfixIt);
+    std::map< std::string, SynchronizationProperties* >::iterator syncPropsIt = this->SynchronizationPropertiesMap.find(*rolePostfixIt);
+    entry.Properties = (syncPropsIt != this->SynchronizationPropertiesMap.end() ? syncPropsIt->second : NULL);
+    this->SynchronizationLookupEntries.push_back(entry);
+
+    const char* sequenceNodeID = this->GetNodeReferenceID(entry.SequenceNodeReferenceRole.c_str());
+    if (sequenceNodeID != NULL && this->SequenceNodeIDToLookupIndex.find(sequenceNodeID) == this->SequenceNodeIDToLookupIndex.end())
     {
-      return (*rolePostfixIt);
+      // if the same sequence is referenced multiple times then the first one is used
+      this->SequenceNodeIDToLookupIndex[sequenceNodeID] = lookupIndex;
+    }
+    const char* proxyNodeID = this->GetNodeReferenceID(entry.ProxyNodeReferenceRole.c_str());
+    if (proxyNodeID != NULL && this->ProxyNodeIDToLookupIndex.find(proxyNodeID) == this->ProxyNodeIDToLookupIndex.end())
+    {
+      this->ProxyNodeIDToLookupIndex[proxyNodeID] = lookupIndex;
+    }
+    vtkMRMLNode* proxyNode = this->GetNodeReference(entry.ProxyNodeReferenceRole.c_str());
+    if (proxyNode != NULL)
+    {
+      this->ProxyNodes.insert(proxyNode);
     }
   }
-  return "";
+  this->SynchronizationLookupValid = true;
+}
+
+//----------------------------------------------------------------------------
+vtkMRMLSequenceBrowserNode::SynchronizationProperties* vtkMRMLSequenceBrowserNode::GetSynchronizationProperties(vtkMRMLSequenceNode* sequenceNode)
+{
+  if (sequenceNode == NULL || sequenceNode->GetID() == NULL)
+  {
+    return NULL;
+  }
+  this->UpdateSynchronizationLookup();
+  std::unordered_map< std::string, int >::iterator lookupIt = this->SequenceNodeIDToLookupIndex.find(sequenceNode->GetID());
+  if (lookupIt == this->SequenceNodeIDToLookupIndex.end())
+  {
+    return NULL;
+  }
+  return this->SynchronizationLookupEntries[lookupIt->second].Properties;
 }
 
 //----------------------------------------------------------------------------
@@ -626,13 +750,17 @@ vtkMRMLNode* vtkMRMLSequenceBrowserNode::GetProxyNode(vtkMRMLSequenceNode* seque
     vtkErrorMacro("vtkMRMLSequenceBrowserNode::GetVirtualOutputNode failed: sequenceNode is invalid");
     return NULL;
   }
-  std::string rolePostfix=this->GetSynchronizationPostfixFromSequence(sequenceNode);
-  if (rolePostfix.empty())
+  if (sequenceNode->GetID() == NULL)
   {
     return NULL;
   }
-  std::string proxyNodeRef=PROXY_NODE_REFERENCE_ROLE_BASE+rolePostfix;
-  return this->GetNodeReference(proxyNodeRef.c_str());
+  this->UpdateSynchronizationLookup();
+  std::unordered_map< std::string, int >::iterator lookupIt = this->SequenceNodeIDToLookupIndex.find(sequenceNode->GetID());
+  if (lookupIt == this->SequenceNodeIDToLookupIndex.end())
+  {
+    return NULL;
+  }
+  return this->GetNodeReference(this->SynchronizationLookupEntries[lookupIt->second].ProxyNodeReferenceRole.c_str());
 }
 
 //----------------------------------------------------------------------------
@@ -691,6 +819,7 @@ vtkMRMLNode* vtkMRMLSequenceBrowserNode::AddProxyNode(vtkMRMLNode* sourceProxyNo
   {
     this->RemoveProxyNode(rolePostfix); // This will also remove the proxy node from the scene if necessary
     this->SetAndObserveNodeReferenceID(proxyNodeRef.c_str(), proxyNode->GetID(), vtkMRMLNodeSequencer::GetInstance()->GetNodeSequencer(proxyNode)->GetRecordingEvents());
+    this->SynchronizationLookupValid = false;
   }
 
   this->EndModify(oldModify);
@@ -740,17 +869,23 @@ bool vtkMRMLSequenceBrowserNode::IsProxyNode(const char* nodeId)
 //----------------------------------------------------------------------------
 bool vtkMRMLSequenceBrowserNode::IsProxyNodeID(const char* nodeId)
 {
-  std::vector< vtkMRMLNode* > nodesVector;
-  this->GetAllProxyNodes(nodesVector);
-  for (std::vector< vtkMRMLNode* >::iterator it = nodesVector.begin(); it != nodesVector.end(); ++it)
+  if (nodeId == NULL)
   {
-    if (strcmp((*it)->GetID(), nodeId)==0)
-    {
-      // found node
-      return true;
-    }
+    return false;
   }
-  return false;
+  this->UpdateSynchronizationLookup();
+  return this->ProxyNodeIDToLookupIndex.find(nodeId) != this->ProxyNodeIDToLookupIndex.end();
+}
+
+//----------------------------------------------------------------------------
+bool vtkMRMLSequenceBrowserNode::IsProxyNodePointer(vtkMRMLNode* node)
+{
+  if (node == NULL)
+  {
+    return false;
+  }
+  this->UpdateSynchronizationLookup();
+  return this->ProxyNodes.find(node) != this->ProxyNodes.end();
 }
 
 //----------------------------------------------------------------------------
@@ -766,6 +901,7 @@ void vtkMRMLSequenceBrowserNode::RemoveProxyNode(const std::string& postfix)
       this->Scene->RemoveNode(proxyNode);
     }
     this->RemoveNodeReferenceIDs(proxyNodeRef.c_str());
+    this->SynchronizationLookupValid = false;
   }
   this->EndModify(oldModify);
 }
@@ -795,26 +931,14 @@ bool vtkMRMLSequenceBrowserNode::IsSynchronizedSequenceNodeID(const char* nodeId
     vtkWarningMacro("vtkMRMLSequenceBrowserNode::IsSynchronizedSequenceNode nodeId is NULL");
     return false;
   }
-  for (std::vector< std::string >::iterator rolePostfixIt=this->SynchronizationPostfixes.begin();
-    rolePostfixIt!=this->SynchronizationPostfixes.end(); ++rolePostfixIt)
+  this->UpdateSynchronizationLookup();
+  std::unordered_map< std::string, int >::iterator lookupIt = this->SequenceNodeIDToLookupIndex.find(nodeId);
+  if (lookupIt == this->SequenceNodeIDToLookupIndex.end())
   {
-    if (!includeMasterNode && rolePostfixIt==this->SynchronizationPostfixes.begin())
-    {
-      // the first one is the master sequence node, don't consider as a synchronized sequence node
-      continue;
-    }
-    std::string sequenceNodeRef=SEQUENCE_NODE_REFERENCE_ROLE_BASE+(*rolePostfixIt);
-    const char* foundNodeId=this->GetNodeReferenceID(sequenceNodeRef.c_str());
-    if (foundNodeId==NULL)
-    {
-      continue;
-    }
-    if (strcmp(foundNodeId,nodeId)==0)
-    {
-      return true;
-    }
+    return false;
   }
-  return false;
+  // the first one is the master sequence node, don't consider as a synchronized sequence node
+  return includeMasterNode || lookupIt->second > 0;
 }
 
 //----------------------------------------------------------------------------
@@ -854,6 +978,7 @@ std::string vtkMRMLSequenceBrowserNode::AddSynchronizedSequenceNodeID(const char
   std::string sequenceNodeReferenceRole = SEQUENCE_NODE_REFERENCE_ROLE_BASE + rolePostfix;
   this->SetAndObserveNodeReferenceID(sequenceNodeReferenceRole.c_str(), synchronizedSequenceNodeId);
   this->SynchronizationPropertiesMap[ rolePostfix ] = new SynchronizationProperties();
+  this->SynchronizationLookupValid = false;
   this->EndModify(oldModify);
   return rolePostfix;
 }
@@ -890,6 +1015,7 @@ void vtkMRMLSequenceBrowserNode::RemoveSynchronizedSequenceNode(const char* node
       std::string rolePostfix=(*rolePostfixIt);
       bool oldModify=this->StartModify();
       this->SynchronizationPostfixes.erase(rolePostfixIt);
+      this->SynchronizationLookupValid = false;
       this->RemoveNodeReferenceIDs(sequenceNodeRef.c_str());
       this->RemoveProxyNode(rolePostfix);
       this->EndModify(oldModify);
@@ -959,7 +1085,8 @@ void vtkMRMLSequenceBrowserNode::GetSynchronizedSequenceNodes(vtkCollection* syn
 void vtkMRMLSequenceBrowserNode::SetRecordingActive(bool recording)
 {
   // Before activating the recording, set the initial timestamp to be correct
-  this->RecordingTimeOffsetSec = vtkTimerLog::GetUniversalTime();
+  double currentTime = vtkTimerLog::GetUniversalTime();
+  this->RecordingTimeOffsetSec = currentTime;
   int numberOfItems = this->GetNumberOfItems();
   if (numberOfItems>0
     && this->GetMasterSequenceNode()->GetIndexType()==vtkMRMLSequenceNode::NumericIndex)
@@ -970,6 +1097,28 @@ void vtkMRMLSequenceBrowserNode::SetRecordingActive(bool recording)
     timeString >> timeValue;
     this->RecordingTimeOffsetSec -= timeValue;
   }
+  if (recording && !this->RecordingActive)
+  {
+    // Restart the recording clock. The first sample is taken one period after the start,
+    // so that it does not overwrite the last item of the sequence.
+    this->RecordingClockStartTimeSec = currentTime;
+    this->LastRecordingSampleIndex = 0;
+    this->ResetRecordingSamplingStatistics();
+    if (this->RecordingFramePoolSize > 0)
+    {
+      this->PreallocateRecordingFrames(this->RecordingFramePoolSize);
+    }
+  }
+  else if (!recording && this->RecordingActive && this->RecordingFramePoolSize > 0)
+  {
+    // Release frames that have not been used
+    std::vector< vtkMRMLSequenceNode* > sequenceNodes;
+    this->GetSynchronizedSequenceNodes(sequenceNodes, true);
+    for (std::vector< vtkMRMLSequenceNode* >::iterator it = sequenceNodes.begin(); it != sequenceNodes.end(); ++it)
+    {
+      (*it)->RemoveAllPreallocatedDataNodes();
+    }
+  }
   if (this->RecordingActive!=recording)
   {
     this->RecordingActive = recording;
@@ -1043,6 +1192,174 @@ int vtkMRMLSequenceBrowserNode::SelectNextItem(int selectionIncrement/*=1*/)
   return selectedItemNumber;
 }
 
+//---------------------------------------------------------------------------
+bool vtkMRMLSequenceBrowserNode::IsPlaybackRealTime()
+{
+  if (!this->PlaybackRealTimeEnabled)
+  {
+    return false;
+  }
+  vtkMRMLSequenceNode* sequenceNode = this->GetMasterSequenceNode();
+  if (sequenceNode == NULL || sequenceNode->GetIndexType() != vtkMRMLSequenceNode::NumericIndex)
+  {
+    return false;
+  }
+  int numberOfItems = sequenceNode->GetNumberOfDataNodes();
+  if (numberOfItems < 2)
+  {
+    return false;
+  }
+  return sequenceNode->GetNthNumericIndexValue(numberOfItems - 1) > sequenceNode->GetNthNumericIndexValue(0);
+}
+
+//---------------------------------------------------------------------------
+double vtkMRMLSequenceBrowserNode::GetPlaybackClockEndIndexValue(vtkMRMLSequenceNode* sequenceNode)
+{
+  int numberOfItems = sequenceNode->GetNumberOfDataNodes();
+  double firstIndexValue = sequenceNode->GetNthNumericIndexValue(0);
+  double lastIndexValue = sequenceNode->GetNthNumericIndexValue(numberOfItems - 1);
+  return lastIndexValue + (lastIndexValue - firstIndexValue) / (numberOfItems - 1);
+}
+
+//---------------------------------------------------------------------------
+int vtkMRMLSequenceBrowserNode::AdvancePlaybackClock(double elapsedTimeSec)
+{
+  if (!this->IsPlaybackRealTime())
+  {
+    vtkErrorMacro("vtkMRMLSequenceBrowserNode::AdvancePlaybackClock failed: real-time playback is not applicable");
+    return this->GetSelectedItemNumber();
+  }
+  vtkMRMLSequenceNode* sequenceNode = this->GetMasterSequenceNode();
+  int numberOfItems = sequenceNode->GetNumberOfDataNodes();
+  double firstIndexValue = sequenceNode->GetNthNumericIndexValue(0);
+  int selectedItemNumber = this->GetSelectedItemNumber();
+  int browserNodeModify = this->StartModify(); // invoke modification event once all the modifications has been completed
+  if (selectedItemNumber < 0 || selectedItemNumber >= numberOfItems)
+  {
+    selectedItemNumber = 0;
+    this->PlaybackClockIndexValue = firstIndexValue;
+  }
+  else
+  {
+    if (sequenceNode->GetItemNumberFromNumericIndexValue(this->PlaybackClockIndexValue, false) != selectedItemNumber)
+    {
+      // selection has been changed since the last update, restart the clock from the selected item
+      this->PlaybackClockIndexValue = sequenceNode->GetNthNumericIndexValue(selectedItemNumber);
+    }
+    this->PlaybackClockIndexValue += elapsedTimeSec * this->PlaybackSpeed;
+    double endIndexValue = this->GetPlaybackClockEndIndexValue(sequenceNode);
+    if (this->PlaybackClockIndexValue >= endIndexValue)
+    {
+      if (this->GetPlaybackLooped())
+      {
+        // wrap around and keep playback going
+        this->PlaybackClockIndexValue = firstIndexValue + fmod(this->PlaybackClockIndexValue - firstIndexValue, endIndexValue - firstIndexValue);
+      }
+      else
+      {
+        this->SetPlaybackActive(false);
+        this->PlaybackClockIndexValue = firstIndexValue;
+      }
+    }
+    int clockItemNumber = sequenceNode->GetItemNumberFromNumericIndexValue(this->PlaybackClockIndexValue, false);
+    if (!this->GetPlaybackItemSkippingEnabled() && this->GetPlaybackActive())
+    {
+      // Do not skip items: hold the clock at the next item (playback slows down if updates cannot keep up)
+      int nextItemNumber = (selectedItemNumber + 1) % numberOfItems;
+      if (clockItemNumber != selectedItemNumber && clockItemNumber != nextItemNumber)
+      {
+        clockItemNumber = nextItemNumber;
+        this->PlaybackClockIndexValue = sequenceNode->GetNthNumericIndexValue(nextItemNumber);
+      }
+    }
+    selectedItemNumber = clockItemNumber;
+  }
+  this->SetSelectedItemNumber(selectedItemNumber);
+  this->EndModify(browserNodeModify);
+  return selectedItemNumber;
+}
+
+//---------------------------------------------------------------------------
+double vtkMRMLSequenceBrowserNode::GetPlaybackTimeToNextItemSec()
+{
+  if (!this->IsPlaybackRealTime() || this->PlaybackSpeed <= 0)
+  {
+    return -1.0;
+  }
+  vtkMRMLSequenceNode* sequenceNode = this->GetMasterSequenceNode();
+  int numberOfItems = sequenceNode->GetNumberOfDataNodes();
+  int selectedItemNumber = this->GetSelectedItemNumber();
+  if (selectedItemNumber < 0 || selectedItemNumber >= numberOfItems
+    || sequenceNode->GetItemNumberFromNumericIndexValue(this->PlaybackClockIndexValue, false) != selectedItemNumber)
+  {
+    // clock is restarted at the next update
+    return 0.0;
+  }
+  double nextIndexValue = (selectedItemNumber + 1 < numberOfItems)
+    ? sequenceNode->GetNthNumericIndexValue(selectedItemNumber + 1)
+    : this->GetPlaybackClockEndIndexValue(sequenceNode);
+  return std::max(0.0, (nextIndexValue - this->PlaybackClockIndexValue) / this->PlaybackSpeed);
+}
+
+//---------------------------------------------------------------------------
+int vtkMRMLSequenceBrowserNode::SelectNextGridItem(int axis, int selectionIncrement/*=1*/)
+{
+  vtkMRMLSequenceNode* sequenceNode = this->GetMasterSequenceNode();
+  if (sequenceNode == NULL || sequenceNode->GetIndexType() != vtkMRMLSequenceNode::GridIndex)
+  {
+    vtkErrorMacro("vtkMRMLSequenceBrowserNode::SelectNextGridItem failed: master sequence node does not have grid index");
+    return -1;
+  }
+  if (axis < 0 || axis > 1)
+  {
+    vtkErrorMacro("vtkMRMLSequenceBrowserNode::SelectNextGridItem failed: invalid axis " << axis);
+    return this->GetSelectedItemNumber();
+  }
+  int numberOfItems = this->GetNumberOfItems();
+  if (numberOfItems == 0)
+  {
+    // nothing to select
+    return -1;
+  }
+  int selectedItemNumber = this->GetSelectedItemNumber();
+  int gridPosition[2] = { 0, 0 };
+  if (selectedItemNumber < 0 || selectedItemNumber >= numberOfItems
+    || !vtkMRMLSequenceNode::GetGridPositionFromIndexValue(sequenceNode->GetNthIndexValue(selectedItemNumber), gridPosition[0], gridPosition[1]))
+  {
+    return this->SelectFirstItem();
+  }
+  if (selectionIncrement == 0)
+  {
+    return selectedItemNumber;
+  }
+
+  // Step along the axis until a non-empty grid position is found
+  int axisSize = sequenceNode->GetGridDimensions()[axis];
+  int step = (selectionIncrement > 0 ? 1 : -1);
+  int position = gridPosition[axis] + selectionIncrement;
+  for (int stepCount = 0; stepCount < axisSize; stepCount++, position += step)
+  {
+    if (position < 0 || position >= axisSize)
+    {
+      if (!this->GetPlaybackLooped())
+      {
+        // reached the boundary, keep the current item
+        break;
+      }
+      position = ((position % axisSize) + axisSize) % axisSize;
+    }
+    gridPosition[axis] = position;
+    int itemNumber = sequenceNode->GetItemNumberFromGridPosition(gridPosition[0], gridPosition[1]);
+    if (itemNumber >= 0)
+    {
+      selectedItemNumber = itemNumber;
+      break;
+    }
+  }
+  this->SetSelectedItemNumber(selectedItemNumber);
+  return selectedItemNumber;
+}
+
 //---------------------------------------------------------------------------
 int vtkMRMLSequenceBrowserNode::GetNumberOfItems()
 {
@@ -1061,7 +1378,7 @@ void vtkMRMLSequenceBrowserNode::ProcessMRMLEvents( vtkObject *caller, unsigned
   this->vtkMRMLNode::ProcessMRMLEvents( caller, event, callData );
 
   vtkMRMLNode* modifiedNode = vtkMRMLNode::SafeDownCast(caller);
-  if (modifiedNode == NULL || !this->IsProxyNode(modifiedNode->GetID()))
+  if (modifiedNode == NULL || !this->IsProxyNodePointer(modifiedNode))
   {
     // we are only interested in proxy node modified events
     return;
@@ -1070,7 +1387,24 @@ void vtkMRMLSequenceBrowserNode::ProcessMRMLEvents( vtkObject *caller, unsigned
 }
 
 //---------------------------------------------------------------------------
-void vtkMRMLSequenceBrowserNode::SaveProxyNodesState()
+void vtkMRMLSequenceBrowserNode::SetPlaybackRateFps(double playbackRateFps)
+{
+  if (playbackRateFps <= 0)
+  {
+    // fixed frame rate recording would record at every update
+    vtkErrorMacro("vtkMRMLSequenceBrowserNode::SetPlaybackRateFps failed: invalid rate " << playbackRateFps << ", it must be positive");
+    return;
+  }
+  if (this->PlaybackRateFps == playbackRateFps)
+  {
+    return;
+  }
+  this->PlaybackRateFps = playbackRateFps;
+  this->Modified();
+}
+
+//---------------------------------------------------------------------------
+bool vtkMRMLSequenceBrowserNode::GetNextRecordingIndexValue(std::string& indexValue)
 {
   std::stringstream currTime;
   bool continuousRecording = this->GetRecordingActive();
@@ -1079,13 +1413,36 @@ void vtkMRMLSequenceBrowserNode::SaveProxyNodesState()
     // Continuous recording.
     // To maintain syncing, we need to record for all sequences at every given timestamp.
     double currentTime = vtkTimerLog::GetUniversalTime();
+    if (this->RecordingSamplingMode == vtkMRMLSequenceBrowserNode::SamplingFixedFrameRate && this->GetPlaybackRateFps() > 0)
+    {
+      // Record the latest sample that is due on the recording clock
+      double samplingPeriodSec = 1.0 / this->GetPlaybackRateFps();
+      long long sampleIndex = static_cast<long long>(floor((currentTime - this->RecordingClockStartTimeSec) / samplingPeriodSec));
+      if (sampleIndex <= this->LastRecordingSampleIndex)
+      {
+        // next sample is not due yet
+        return false;
+      }
+      double sampleTime = this->RecordingClockStartTimeSec + sampleIndex * samplingPeriodSec;
+      double jitterSec = currentTime - sampleTime;
+      this->NumberOfMissedRecordingSamples += static_cast<int>(sampleIndex - this->LastRecordingSampleIndex - 1);
+      this->NumberOfRecordedSamples++;
+      this->RecordingSampleJitterSumSec += jitterSec;
+      this->RecordingSampleMaximumJitterSec = std::max(this->RecordingSampleMaximumJitterSec, jitterSec);
+      this->LastRecordingSampleIndex = sampleIndex;
+      this->LastSaveProxyNodesStateTimeSec = currentTime;
+      // Index value is computed from the scheduled time (not the actual time) to get uniformly sampled data
+      currTime << (sampleTime - this->RecordingTimeOffsetSec);
+      indexValue = currTime.str();
+      return true;
+    }
     double timeElapsedSinceLastSave = currentTime - this->LastSaveProxyNodesStateTimeSec;
     if (this->RecordingSamplingMode == vtkMRMLSequenceBrowserNode::SamplingLimitedToPlaybackFrameRate)
     {
       if (this->GetPlaybackRateFps() > 0 && (timeElapsedSinceLastSave < 1.0 / this->GetPlaybackRateFps()))
       {
         // this state is too close in time to the previous saved state, don't record it
-        return;
+        return false;
       }
     }
     this->LastSaveProxyNodesStateTimeSec = currentTime;
@@ -1106,6 +1463,18 @@ void vtkMRMLSequenceBrowserNode::SaveProxyNodesState()
     double playbackRateFps = this->GetPlaybackRateFps() != 0.0 ? this->GetPlaybackRateFps() : 1.0;
     currTime << lastItemTime + 1.0 / playbackRateFps;
   }
+  indexValue = currTime.str();
+  return true;
+}
+
+//---------------------------------------------------------------------------
+void vtkMRMLSequenceBrowserNode::SaveProxyNodesState()
+{
+  std::string indexValue;
+  if (!this->GetNextRecordingIndexValue(indexValue))
+  {
+    return;
+  }
 
   // Record into each sequence
   int wasModified = this->StartModify();
@@ -1117,7 +1486,7 @@ void vtkMRMLSequenceBrowserNode::SaveProxyNodesState()
     vtkMRMLSequenceNode* currSequenceNode = (*it);
     if (this->GetRecording(currSequenceNode))
     {
-      currSequenceNode->SetDataNodeAtValue(this->GetProxyNode(currSequenceNode), currTime.str().c_str());
+      currSequenceNode->SetDataNodeAtValue(this->GetProxyNode(currSequenceNode), indexValue);
       snapshotAdded = true;
     }
   }
@@ -1133,6 +1502,7 @@ void vtkMRMLSequenceBrowserNode::SaveProxyNodesState()
 void vtkMRMLSequenceBrowserNode::OnNodeReferenceAdded(vtkMRMLNodeReference* nodeReference)
 {
   vtkMRMLNode::OnNodeReferenceAdded(nodeReference);
+  this->SynchronizationLookupValid = false;
   if (std::string(nodeReference->GetReferenceRole()).find( PROXY_NODE_REFERENCE_ROLE_BASE ) != std::string::npos)
   {
     // Need to observe the correct events after scene loading
@@ -1142,6 +1512,20 @@ void vtkMRMLSequenceBrowserNode::OnNodeReferenceAdded(vtkMRMLNodeReference* node
   }
 }
 
+//---------------------------------------------------------------------------
+void vtkMRMLSequenceBrowserNode::OnNodeReferenceModified(vtkMRMLNodeReference* nodeReference)
+{
+  vtkMRMLNode::OnNodeReferenceModified(nodeReference);
+  this->SynchronizationLookupValid = false;
+}
+
+//---------------------------------------------------------------------------
+void vtkMRMLSequenceBrowserNode::OnNodeReferenceRemoved(vtkMRMLNodeReference* nodeReference)
+{
+  vtkMRMLNode::OnNodeReferenceRemoved(nodeReference);
+  this->SynchronizationLookupValid = false;
+}
+
 //---------------------------------------------------------------------------
 void vtkMRMLSequenceBrowserNode::FixSequenceNodeReferenceRoleName()
 {
@@ -1163,6 +1547,125 @@ void vtkMRMLSequenceBrowserNode::FixSequenceNodeReferenceRoleName()
   this->EndModify(oldModify);
 }
 
+//---------------------------------------------------------------------------
+// Find item numbers in a sequence for all index values of the master sequence.
+// Numeric index values are sorted in both sequences, therefore they are matched
+// in a single pass (merge join), with the same rules as vtkMRMLSequenceNode::GetItemNumberFromIndexValue.
+static void ComputeItemMapping(vtkMRMLSequenceNode* masterSequenceNode, vtkMRMLSequenceNode* sequenceNode,
+  std::vector<int>& exactItemNumbers, std::vector<int>& closestItemNumbers)
+{
+  int numberOfMasterItems = masterSequenceNode->GetNumberOfDataNodes();
+  int numberOfItems = sequenceNode->GetNumberOfDataNodes();
+  exactItemNumbers.assign(numberOfMasterItems, -1);
+  closestItemNumbers.assign(numberOfMasterItems, -1);
+  if (numberOfItems == 0)
+  {
+    return;
+  }
+
+  if (masterSequenceNode->GetIndexType() == vtkMRMLSequenceNode::NumericIndex
+    && sequenceNode->GetIndexType() == vtkMRMLSequenceNode::NumericIndex)
+  {
+    // Numeric index values are parsed already when items are added, no need to convert the index value strings
+    std::vector<double> masterIndexValues(numberOfMasterItems);
+    bool sorted = true;
+    for (int i = 0; i < numberOfMasterItems; i++)
+    {
+      masterIndexValues[i] = masterSequenceNode->GetNthNumericIndexValue(i);
+      sorted = sorted && (i == 0 || masterIndexValues[i - 1] <= masterIndexValues[i]);
+    }
+    std::vector<double> indexValues(numberOfItems);
+    for (int i = 0; i < numberOfItems; i++)
+    {
+      indexValues[i] = sequenceNode->GetNthNumericIndexValue(i);
+      sorted = sorted && (i == 0 || indexValues[i - 1] <= indexValues[i]);
+    }
+    if (sorted)
+    {
+      double tolerance = sequenceNode->GetNumericIndexValueTolerance();
+      // itemNumber is the last item that is not after the master index value (-1 if there is no such item)
+      int itemNumber = -1;
+      for (int masterItemNumber = 0; masterItemNumber < numberOfMasterItems; masterItemNumber++)
+      {
+        double masterIndexValue = masterIndexValues[masterItemNumber];
+        while (itemNumber + 1 < numberOfItems && indexValues[itemNumber + 1] <= masterIndexValue + tolerance)
+        {
+          itemNumber++;
+        }
+        if (itemNumber < 0)
+        {
+          // master index value is before the first item
+          closestItemNumbers[masterItemNumber] = 0;
+          continue;
+        }
+        closestItemNumbers[masterItemNumber] = itemNumber;
+        if (masterIndexValue - indexValues[itemNumber] <= tolerance)
+        {
+          exactItemNumbers[masterItemNumber] = itemNumber;
+        }
+      }
+      return;
+    }
+  }
+  else if (masterSequenceNode->GetIndexType() == vtkMRMLSequenceNode::TextIndex
+    && sequenceNode->GetIndexType() == vtkMRMLSequenceNode::TextIndex)
+  {
+    // Text index values are only matched exactly
+    std::unordered_map< std::string, int > itemNumbers;
+    for (int i = numberOfItems - 1; i >= 0; i--)
+    {
+      // if an index value occurs multiple times then the first item is used
+      itemNumbers[sequenceNode->GetNthIndexValue(i)] = i;
+    }
+    for (int masterItemNumber = 0; masterItemNumber < numberOfMasterItems; masterItemNumber++)
+    {
+      std::unordered_map< std::string, int >::iterator itemNumberIt = itemNumbers.find(masterSequenceNode->GetNthIndexValue(masterItemNumber));
+      if (itemNumberIt != itemNumbers.end())
+      {
+        exactItemNumbers[masterItemNumber] = itemNumberIt->second;
+        closestItemNumbers[masterItemNumber] = itemNumberIt->second;
+      }
+    }
+    return;
+  }
+
+  // Different index types, grid index, or unsorted items: look up each item
+  for (int masterItemNumber = 0; masterItemNumber < numberOfMasterItems; masterItemNumber++)
+  {
+    std::string indexValue = masterSequenceNode->GetNthIndexValue(masterItemNumber);
+    exactItemNumbers[masterItemNumber] = sequenceNode->GetItemNumberFromIndexValue(indexValue, true);
+    closestItemNumbers[masterItemNumber] = sequenceNode->GetItemNumberFromIndexValue(indexValue, false);
+  }
+}
+
+//---------------------------------------------------------------------------
+int vtkMRMLSequenceBrowserNode::GetSynchronizedItemNumber(vtkMRMLSequenceNode* sequenceNode, int masterItemNumber,
+  bool exactMatchRequired /* =true */)
+{
+  vtkMRMLSequenceNode* masterSequenceNode = this->GetMasterSequenceNode();
+  if (sequenceNode == NULL || sequenceNode->GetID() == NULL || masterSequenceNode == NULL
+    || masterItemNumber < 0 || masterItemNumber >= masterSequenceNode->GetNumberOfDataNodes())
+  {
+    return -1;
+  }
+  if (sequenceNode == masterSequenceNode)
+  {
+    return masterItemNumber;
+  }
+  ItemMappingTable& table = this->ItemMappingTables[sequenceNode->GetID()];
+  if (table.MasterSequenceNode != masterSequenceNode
+    || table.MasterSequenceMTime != masterSequenceNode->GetMTime()
+    || table.SequenceMTime != sequenceNode->GetMTime()
+    || static_cast<int>(table.ExactItemNumbers.size()) != masterSequenceNode->GetNumberOfDataNodes())
+  {
+    ComputeItemMapping(masterSequenceNode, sequenceNode, table.ExactItemNumbers, table.ClosestItemNumbers);
+    table.MasterSequenceNode = masterSequenceNode;
+    table.MasterSequenceMTime = masterSequenceNode->GetMTime();
+    table.SequenceMTime = sequenceNode->GetMTime();
+  }
+  return exactMatchRequired ? table.ExactItemNumbers[masterItemNumber] : table.ClosestItemNumbers[masterItemNumber];
+}
+
 //---------------------------------------------------------------------------
 vtkMRMLSequenceNode* vtkMRMLSequenceBrowserNode::GetSequenceNode(vtkMRMLNode* proxyNode)
 {
@@ -1171,19 +1674,18 @@ vtkMRMLSequenceNode* vtkMRMLSequenceBrowserNode::GetSequenceNode(vtkMRMLNode* pr
     vtkErrorMacro("vtkMRMLSequenceBrowserNode::GetSequenceNode failed: virtualOutputDataNode is invalid");
     return NULL;
   }
-  for (std::vector< std::string >::iterator rolePostfixIt = this->SynchronizationPostfixes.begin();
-    rolePostfixIt != this->SynchronizationPostfixes.end(); ++rolePostfixIt)
+  if (proxyNode->GetID() == NULL)
   {
-    std::string proxyNodeRef = PROXY_NODE_REFERENCE_ROLE_BASE + (*rolePostfixIt);
-    vtkMRMLNode* foundProxyNode = this->GetNodeReference(proxyNodeRef.c_str());
-    if (foundProxyNode == proxyNode)
-    {
-      std::string sequenceNodeReferenceRole = SEQUENCE_NODE_REFERENCE_ROLE_BASE + (*rolePostfixIt);
-      vtkMRMLSequenceNode* sequenceNode = vtkMRMLSequenceNode::SafeDownCast(this->GetNodeReference(sequenceNodeReferenceRole.c_str()));
-      return sequenceNode;
-    }
+    return NULL;
   }
-  return NULL;
+  this->UpdateSynchronizationLookup();
+  std::unordered_map< std::string, int >::iterator lookupIt = this->ProxyNodeIDToLookupIndex.find(proxyNode->GetID());
+  if (lookupIt == this->ProxyNodeIDToLookupIndex.end())
+  {
+    return NULL;
+  }
+  return vtkMRMLSequenceNode::SafeDownCast(this->GetNodeReference(
+    this->SynchronizationLookupEntries[lookupIt->second].SequenceNodeReferenceRole.c_str()));
 }
 
 //---------------------------------------------------------------------------
@@ -1208,9 +1710,8 @@ bool vtkMRMLSequenceBrowserNode::IsAnySequenceNodeRecording()
 //---------------------------------------------------------------------------
 bool vtkMRMLSequenceBrowserNode::GetRecording(vtkMRMLSequenceNode* sequenceNode)
 {
-  std::string rolePostfix = this->GetSynchronizationPostfixFromSequence(sequenceNode);
-  SynchronizationProperties* syncProps = this->SynchronizationPropertiesMap[ rolePostfix ];
-  if (rolePostfix=="" || syncProps==NULL)
+  SynchronizationProperties* syncProps = this->GetSynchronizationProperties(sequenceNode);
+  if (syncProps==NULL)
   {
     return false;
   }
@@ -1220,9 +1721,8 @@ bool vtkMRMLSequenceBrowserNode::GetRecording(vtkMRMLSequenceNode* sequenceNode)
 //---------------------------------------------------------------------------
 bool vtkMRMLSequenceBrowserNode::GetPlayback(vtkMRMLSequenceNode* sequenceNode)
 {
-  std::string rolePostfix = this->GetSynchronizationPostfixFromSequence(sequenceNode);
-  SynchronizationProperties* syncProps = this->SynchronizationPropertiesMap[ rolePostfix ];
-  if (rolePostfix=="" || syncProps==NULL)
+  SynchronizationProperties* syncProps = this->GetSynchronizationProperties(sequenceNode);
+  if (syncProps==NULL)
   {
     return false;
   }
@@ -1232,9 +1732,8 @@ bool vtkMRMLSequenceBrowserNode::GetPlayback(vtkMRMLSequenceNode* sequenceNode)
 //---------------------------------------------------------------------------
 bool vtkMRMLSequenceBrowserNode::GetOverwriteProxyName(vtkMRMLSequenceNode* sequenceNode)
 {
-  std::string rolePostfix = this->GetSynchronizationPostfixFromSequence(sequenceNode);
-  SynchronizationProperties* syncProps = this->SynchronizationPropertiesMap[ rolePostfix ];
-  if (rolePostfix=="" || syncProps==NULL)
+  SynchronizationProperties* syncProps = this->GetSynchronizationProperties(sequenceNode);
+  if (syncProps==NULL)
   {
     return false;
   }
@@ -1244,15 +1743,25 @@ bool vtkMRMLSequenceBrowserNode::GetOverwriteProxyName(vtkMRMLSequenceNode* sequ
 //---------------------------------------------------------------------------
 bool vtkMRMLSequenceBrowserNode::GetSaveChanges(vtkMRMLSequenceNode* sequenceNode)
 {
-  std::string rolePostfix = this->GetSynchronizationPostfixFromSequence(sequenceNode);
-  SynchronizationProperties* syncProps = this->SynchronizationPropertiesMap[ rolePostfix ];
-  if (rolePostfix=="" || syncProps==NULL)
+  SynchronizationProperties* syncProps = this->GetSynchronizationProperties(sequenceNode);
+  if (syncProps==NULL)
   {
     return false;
   }
   return syncProps->SaveChanges;
 }
 
+//---------------------------------------------------------------------------
+bool vtkMRMLSequenceBrowserNode::GetShareData(vtkMRMLSequenceNode* sequenceNode)
+{
+  SynchronizationProperties* syncProps = this->GetSynchronizationProperties(sequenceNode);
+  if (syncProps==NULL)
+  {
+    return false;
+  }
+  return syncProps->ShareData;
+}
+
 //---------------------------------------------------------------------------
 void vtkMRMLSequenceBrowserNode::SetRecording(vtkMRMLSequenceNode* sequenceNode, bool recording)
 {
@@ -1268,9 +1777,8 @@ void vtkMRMLSequenceBrowserNode::SetRecording(vtkMRMLSequenceNode* sequenceNode,
   bool modified = false;
   for (std::vector< vtkMRMLSequenceNode* >::iterator it = synchronizedSequenceNodes.begin(); it != synchronizedSequenceNodes.end(); ++it)
   {
-    std::string rolePostfix = this->GetSynchronizationPostfixFromSequence(*it);
-    SynchronizationProperties* syncProps = this->SynchronizationPropertiesMap[rolePostfix];
-    if (rolePostfix == "" || syncProps == NULL)
+    SynchronizationProperties* syncProps = this->GetSynchronizationProperties(*it);
+    if (syncProps == NULL)
     {
       continue;
     }
@@ -1301,9 +1809,8 @@ void vtkMRMLSequenceBrowserNode::SetPlayback(vtkMRMLSequenceNode* sequenceNode,
   bool modified = false;
   for (std::vector< vtkMRMLSequenceNode* >::iterator it = synchronizedSequenceNodes.begin(); it != synchronizedSequenceNodes.end(); ++it)
   {
-    std::string rolePostfix = this->GetSynchronizationPostfixFromSequence(*it);
-    SynchronizationProperties* syncProps = this->SynchronizationPropertiesMap[rolePostfix];
-    if (rolePostfix == "" || syncProps == NULL)
+    SynchronizationProperties* syncProps = this->GetSynchronizationProperties(*it);
+    if (syncProps == NULL)
     {
       continue;
     }
@@ -1334,9 +1841,8 @@ void vtkMRMLSequenceBrowserNode::SetOverwriteProxyName(vtkMRMLSequenceNode* sequ
   bool modified = false;
   for (std::vector< vtkMRMLSequenceNode* >::iterator it = synchronizedSequenceNodes.begin(); it != synchronizedSequenceNodes.end(); ++it)
   {
-    std::string rolePostfix = this->GetSynchronizationPostfixFromSequence(*it);
-    SynchronizationProperties* syncProps = this->SynchronizationPropertiesMap[rolePostfix];
-    if (rolePostfix == "" || syncProps == NULL)
+    SynchronizationProperties* syncProps = this->GetSynchronizationProperties(*it);
+    if (syncProps == NULL)
     {
       continue;
     }
@@ -1367,9 +1873,8 @@ void vtkMRMLSequenceBrowserNode::SetSaveChanges(vtkMRMLSequenceNode* sequenceNod
   bool modified = false;
   for (std::vector< vtkMRMLSequenceNode* >::iterator it = synchronizedSequenceNodes.begin(); it != synchronizedSequenceNodes.end(); ++it)
   {
-    std::string rolePostfix = this->GetSynchronizationPostfixFromSequence(*it);
-    SynchronizationProperties* syncProps = this->SynchronizationPropertiesMap[rolePostfix];
-    if (rolePostfix == "" || syncProps == NULL)
+    SynchronizationProperties* syncProps = this->GetSynchronizationProperties(*it);
+    if (syncProps == NULL)
     {
       continue;
     }
@@ -1385,6 +1890,38 @@ void vtkMRMLSequenceBrowserNode::SetSaveChanges(vtkMRMLSequenceNode* sequenceNod
   }
 }
 
+//---------------------------------------------------------------------------
+void vtkMRMLSequenceBrowserNode::SetShareData(vtkMRMLSequenceNode* sequenceNode, bool share)
+{
+  std::vector< vtkMRMLSequenceNode* > synchronizedSequenceNodes;
+  if (sequenceNode)
+  {
+    synchronizedSequenceNodes.push_back(sequenceNode);
+  }
+  else
+  {
+    this->GetSynchronizedSequenceNodes(synchronizedSequenceNodes, true);
+  }
+  bool modified = false;
+  for (std::vector< vtkMRMLSequenceNode* >::iterator it = synchronizedSequenceNodes.begin(); it != synchronizedSequenceNodes.end(); ++it)
+  {
+    SynchronizationProperties* syncProps = this->GetSynchronizationProperties(*it);
+    if (syncProps == NULL)
+    {
+      continue;
+    }
+    if (syncProps->ShareData != share)
+    {
+      syncProps->ShareData = share;
+      modified = true;
+    }
+  }
+  if (modified)
+  {
+    this->Modified();
+  }
+}
+
 //-----------------------------------------------------------
 void vtkMRMLSequenceBrowserNode::SetRecordingSamplingModeFromString(const char *recordingSamplingModeString)
 {
@@ -1405,6 +1942,7 @@ std::string vtkMRMLSequenceBrowserNode::GetRecordingSamplingModeAsString(int rec
   {
   case vtkMRMLSequenceBrowserNode::SamplingAll: return "all";
   case vtkMRMLSequenceBrowserNode::SamplingLimitedToPlaybackFrameRate: return "limitedToPlaybackFrameRate";
+  case vtkMRMLSequenceBrowserNode::SamplingFixedFrameRate: return "fixedFrameRate";
   default:
     return "";
   }
@@ -1561,3 +2099,49 @@ bool vtkMRMLSequenceBrowserNode::ValidateFormatString(std::string& validatedForm
   suffix = specifierMatch.suffix().str();
   return true;
 }
+
+//---------------------------------------------------------------------------
+void vtkMRMLSequenceBrowserNode::PreallocateRecordingFrames(int numberOfFrames)
+{
+  std::vector< vtkMRMLSequenceNode* > sequenceNodes;
+  this->GetSynchronizedSequenceNodes(sequenceNodes, true);
+  for (std::vector< vtkMRMLSequenceNode* >::iterator it = sequenceNodes.begin(); it != sequenceNodes.end(); ++it)
+  {
+    vtkMRMLNode* proxyNode = this->GetProxyNode(*it);
+    if (!this->GetRecording(*it) || proxyNode == NULL)
+    {
+      continue;
+    }
+    (*it)->RemoveAllPreallocatedDataNodes();
+    (*it)->PreallocateDataNodes(proxyNode, numberOfFrames);
+  }
+}
+
+//---------------------------------------------------------------------------
+double vtkMRMLSequenceBrowserNode::GetNextRecordingSampleTimeSec()
+{
+  if (this->GetPlaybackRateFps() <= 0)
+  {
+    return this->RecordingClockStartTimeSec;
+  }
+  return this->RecordingClockStartTimeSec + (this->LastRecordingSampleIndex + 1) / this->GetPlaybackRateFps();
+}
+
+//---------------------------------------------------------------------------
+double vtkMRMLSequenceBrowserNode::GetRecordingSampleMeanJitterSec()
+{
+  if (this->NumberOfRecordedSamples == 0)
+  {
+    return 0.0;
+  }
+  return this->RecordingSampleJitterSumSec / this->NumberOfRecordedSamples;
+}
+
+//---------------------------------------------------------------------------
+void vtkMRMLSequenceBrowserNode::ResetRecordingSamplingStatistics()
+{
+  this->NumberOfRecordedSamples = 0;
+  this->NumberOfMissedRecordingSamples = 0;
+  this->RecordingSampleJitterSumSec = 0.0;
+  this->RecordingSampleMaximumJitterSec = 0.0;
+}
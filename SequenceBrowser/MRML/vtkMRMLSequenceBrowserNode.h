@@ -30,6 +30,8 @@
 // STD includes
 #include <set>
 #include <map>
+#include <unordered_map>
+#include <unordered_set>
 
 #include "vtkSlicerSequenceBrowserModuleMRMLExport.h"
 
@@ -52,12 +54,16 @@ public:
   };
 
   /// Modes for determining recording frame rate.
-  // Enum is used so that in the future more modes can be added (e.g., fixed frame rate,
-  // fixed frame rate matching playback frame rate, etc).
+  /// - SamplingAll: record all proxy node changes
+  /// - SamplingLimitedToPlaybackFrameRate: record proxy node changes, but at most at playback frame rate
+  /// - SamplingFixedFrameRate: record all proxy nodes at playback frame rate, regardless of proxy node changes.
+  ///   Sampling is driven by a recording clock (see GetNextRecordingSampleTimeSec), index values are
+  ///   multiples of the sampling period.
   enum RecordingSamplingModeType
   {
     SamplingAll = 0,
     SamplingLimitedToPlaybackFrameRate,
+    SamplingFixedFrameRate,
     NumberOfRecordingSamplingModes // this line must be the last one
   };
 
@@ -124,20 +130,41 @@ public:
   vtkSetMacro(PlaybackActive, bool);
   vtkBooleanMacro(PlaybackActive, bool);
 
-  /// Get/Set playback rate in fps (frames per second)
+  /// Get/Set playback rate in fps (frames per second).
+  /// The rate is also used as recording rate in fixed frame rate recording, therefore it must be positive.
   vtkGetMacro(PlaybackRateFps, double);
-  vtkSetMacro(PlaybackRateFps, double);
+  void SetPlaybackRateFps(double playbackRateFps);
 
   /// Skipping items if necessary to reach requested playback rate. Enabled by default.
   vtkGetMacro(PlaybackItemSkippingEnabled, bool);
   vtkSetMacro(PlaybackItemSkippingEnabled, bool);
   vtkBooleanMacro(PlaybackItemSkippingEnabled, bool);
 
+  /// Real-time playback: items are selected based on their index value (time) instead of
+  /// their item number, therefore non-uniformly sampled sequences are played at their true speed.
+  /// Only applicable if the master sequence has numeric index. Disabled by default.
+  /// \sa IsPlaybackRealTime, AdvancePlaybackClock
+  vtkGetMacro(PlaybackRealTimeEnabled, bool);
+  vtkSetMacro(PlaybackRealTimeEnabled, bool);
+  vtkBooleanMacro(PlaybackRealTimeEnabled, bool);
+
+  /// Get/Set speed multiplier of real-time playback (1.0 = index values are played as seconds).
+  vtkGetMacro(PlaybackSpeed, double);
+  vtkSetClampMacro(PlaybackSpeed, double, 0.0, VTK_DOUBLE_MAX);
+
   /// Get/Set playback looping (restart from the first sequence node when reached the last one)
   vtkGetMacro(PlaybackLooped, bool);
   vtkSetMacro(PlaybackLooped, bool);
   vtkBooleanMacro(PlaybackLooped, bool);
 
+  /// Get/Set scrubbing state: the selected item is being changed interactively (e.g., by dragging a slider).
+  /// While scrubbing, proxy nodes may be updated with a fast preview (bulk data is shared with the sequence
+  /// instead of copied), the full update is performed when scrubbing is stopped.
+  /// This is a runtime state, it is not saved in the scene.
+  vtkGetMacro(ScrubbingActive, bool);
+  vtkSetMacro(ScrubbingActive, bool);
+  vtkBooleanMacro(ScrubbingActive, bool);
+
   /// Get/Set selected bundle index
   vtkGetMacro(SelectedItemNumber, int);
   vtkSetMacro(SelectedItemNumber, int);
@@ -152,6 +179,26 @@ public:
   vtkSetMacro(RecordMasterOnly, bool);
   vtkBooleanMacro(RecordMasterOnly, bool);
 
+  /// Get/set whether recorded proxy node states are copied into the sequences in a background thread.
+  /// If enabled then only a lightweight snapshot of proxy nodes is taken when a change is detected,
+  /// deep copying and inserting into the sequences is performed by vtkSlicerSequenceBrowserLogic later.
+  /// Disabled by default.
+  vtkGetMacro(RecordingInBackground, bool);
+  vtkSetMacro(RecordingInBackground, bool);
+  vtkBooleanMacro(RecordingInBackground, bool);
+
+  /// Get/set number of frames that are preallocated in each recorded sequence when recording is started.
+  /// Preallocated frames have the same type and data layout as the proxy node, therefore recording into them
+  /// requires no memory allocation. If more frames are recorded then new frames are allocated as usual
+  /// (see vtkMRMLSequenceNode::GetNumberOfPreallocatedDataNodeMisses). Unused frames are released
+  /// when recording is stopped. 0 (default) means no preallocation.
+  vtkGetMacro(RecordingFramePoolSize, int);
+  vtkSetMacro(RecordingFramePoolSize, int);
+
+  /// Preallocate frames in all recorded sequences, based on the current state of their proxy nodes.
+  /// Called automatically when recording is started if RecordingFramePoolSize is not 0.
+  void PreallocateRecordingFrames(int numberOfFrames);
+
   /// Set the recording sampling mode
   vtkSetMacro(RecordingSamplingMode, int);
   void SetRecordingSamplingModeFromString(const char *recordingSamplingModeString);
@@ -159,6 +206,20 @@ public:
   vtkGetMacro(RecordingSamplingMode, int);
   virtual std::string GetRecordingSamplingModeAsString();
 
+  /// Universal time of the next sample in fixed frame rate recording sampling mode
+  double GetNextRecordingSampleTimeSec();
+
+  /// Recording clock statistics, only updated in fixed frame rate recording sampling mode.
+  /// Jitter is the delay between the scheduled time of a sample and the time the proxy nodes were actually sampled.
+  /// A sample is missed if the recording clock was not checked during its sampling period
+  /// (for example, because the application was busy).
+  /// Statistics are reset when recording is started.
+  vtkGetMacro(NumberOfRecordedSamples, int);
+  vtkGetMacro(NumberOfMissedRecordingSamples, int);
+  vtkGetMacro(RecordingSampleMaximumJitterSec, double);
+  double GetRecordingSampleMeanJitterSec();
+  void ResetRecordingSamplingStatistics();
+
   /// Helper functions for converting between string and code representation of recording sampling modes
   static std::string GetRecordingSamplingModeAsString(int recordingSamplingMode);
   static int GetRecordingSamplingModeFromString(const std::string &recordingSamplingModeString);
@@ -182,6 +243,25 @@ public:
   /// Selects the next sequence item for display, returns current selected item number
   int SelectNextItem(int selectionIncrement=1);
 
+  /// Returns true if real-time playback is enabled and the master sequence allows it
+  /// (it has numeric index and its index values span a non-zero range).
+  bool IsPlaybackRealTime();
+
+  /// Advances the playback clock of real-time playback by elapsedTimeSec * PlaybackSpeed (in index units)
+  /// and selects the item at the playback clock's index value. Returns current selected item number.
+  /// If the selected item has been changed since the last call then the clock restarts from the selected item.
+  /// If the clock reaches the end of the sequence then it wraps around (if playback is looped) or playback is stopped.
+  int AdvancePlaybackClock(double elapsedTimeSec);
+
+  /// Returns time (in seconds) until the playback clock reaches the next item.
+  /// Returns -1 if real-time playback is not applicable or the clock is stopped.
+  double GetPlaybackTimeToNextItemSec();
+
+  /// Selects the next sequence item along a grid axis (0 = row, 1 = column), returns current selected item number.
+  /// Only applicable if the master sequence has grid index. Empty grid positions are skipped.
+  /// If playback is looped then selection wraps around at the grid boundary, otherwise it stops at the boundary.
+  int SelectNextGridItem(int axis, int selectionIncrement=1);
+
   /// Selects first sequence item for display, returns current selected item number
   int SelectFirstItem();
 
@@ -236,6 +316,13 @@ public:
   /// Get sequence node corresponding to a proxy node.
   vtkMRMLSequenceNode* GetSequenceNode(vtkMRMLNode* proxyNode);
 
+  /// Get the item number in a synchronized sequence that corresponds to an item of the master sequence.
+  /// If exact match is not required then the closest item is returned (see vtkMRMLSequenceNode::GetItemNumberFromIndexValue).
+  /// Item numbers are looked up from a mapping table that is computed for all master items at once
+  /// and recomputed only when the master or the synchronized sequence node is modified.
+  /// Returns -1 if no matching item is found.
+  int GetSynchronizedItemNumber(vtkMRMLSequenceNode* sequenceNode, int masterItemNumber, bool exactMatchRequired = true);
+
   void GetAllProxyNodes(std::vector< vtkMRMLNode* > &nodes);
   void GetAllProxyNodes(vtkCollection* nodes);
 
@@ -258,6 +345,10 @@ public:
   /// Returns true if the nodeId belongs to a proxy node managed by this browser node.
   bool IsProxyNodeID(const char* nodeId);
 
+  /// Returns true if the node is a proxy node managed by this browser node.
+  /// Uses a lookup table of proxy node pointers, therefore it is fast enough to be called for every node event.
+  bool IsProxyNodePointer(vtkMRMLNode* node);
+
   // TODO: Should these methods be protected? Probably the "world" shouldn't need to know about the postfixes.
   void RemoveProxyNode(const std::string& postfix);
 
@@ -277,12 +368,20 @@ public:
   /// However, if save changes enabled, proxy node changes are stored in the sequence, therefore users
   /// may accidentally change sequence node content by modifying proxy nodes.
   bool GetSaveChanges(vtkMRMLSequenceNode* sequenceNode);
+  /// Share large data objects (such as image data) between the sequence and the proxy node.
+  /// Only used if save changes is disabled. If enabled then data is not deep-copied into the proxy node
+  /// when an item is selected, but the proxy node refers to data stored in the sequence.
+  /// Shared proxy node data must be treated as read-only: before modifying proxy node data in-place,
+  /// vtkSlicerSequenceBrowserLogic::MakeProxyNodeWritable must be called, which creates a private copy
+  /// of the data (copy-on-write). The logic detaches the proxy node from the sequence when the proxy node is modified.
+  bool GetShareData(vtkMRMLSequenceNode* sequenceNode);
 
   /// Set the synchrnization properties for the given sequence/proxy tuple
   void SetRecording(vtkMRMLSequenceNode* sequenceNode, bool recording);
   void SetPlayback(vtkMRMLSequenceNode* sequenceNode, bool playback);
   void SetOverwriteProxyName(vtkMRMLSequenceNode* sequenceNode, bool overwrite);
   void SetSaveChanges(vtkMRMLSequenceNode* sequenceNode, bool save);
+  void SetShareData(vtkMRMLSequenceNode* sequenceNode, bool share);
 
   /// Process MRML node events for recording of the proxy nodes
   void ProcessMRMLEvents( vtkObject *caller, unsigned long event, void *callData ) override;
@@ -290,6 +389,11 @@ public:
   /// Save state of all proxy nodes that recording is enabled for
   virtual void SaveProxyNodesState();
 
+  /// Get the index value that the current state of proxy nodes should be recorded at.
+  /// Returns false if the state should not be recorded now (it is too close in time to the previously saved state).
+  /// If true is returned then the state is considered saved (time of last saved state is updated).
+  bool GetNextRecordingIndexValue(std::string& indexValue);
+
   /// Returns the formatted index value, formatted using the sprintf string provided by IndexDisplayFormat
   /// \sa SetIndexDisplayFormat() GetIndexDisplayFormat()
   std::string GetFormattedIndexValue(int index);
@@ -312,23 +416,53 @@ protected:
 
   /// Called whenever a new node reference is added
   virtual void OnNodeReferenceAdded(vtkMRMLNodeReference* nodeReference) override;
+  /// Called whenever a node reference is modified
+  virtual void OnNodeReferenceModified(vtkMRMLNodeReference* nodeReference) override;
+  /// Called whenever a node reference is removed
+  virtual void OnNodeReferenceRemoved(vtkMRMLNodeReference* nodeReference) override;
+
+  /// Rebuild lookup tables that map sequence and proxy node IDs to synchronization postfixes.
+  /// It is only performed if the lookup tables were invalidated by a change of postfixes or node references.
+  void UpdateSynchronizationLookup();
 
   std::string GenerateSynchronizationPostfix();
   std::string GetSynchronizationPostfixFromSequence(vtkMRMLSequenceNode* sequenceNode);
   std::string GetSynchronizationPostfixFromSequenceID(const char* sequenceNodeID);
 
+  /// Index value where the playback clock wraps around (or stops) after the last item.
+  /// The last item is displayed for the average item duration.
+  double GetPlaybackClockEndIndexValue(vtkMRMLSequenceNode* sequenceNode);
+
 protected:
   bool PlaybackActive;
   double PlaybackRateFps;
   bool PlaybackItemSkippingEnabled;
+  bool PlaybackRealTimeEnabled;
+  double PlaybackSpeed;
   bool PlaybackLooped;
   int SelectedItemNumber;
 
+  // Playback clock of real-time playback (in index units)
+  double PlaybackClockIndexValue;
+
+  bool ScrubbingActive;
+
   bool RecordingActive;
   double RecordingTimeOffsetSec; // difference between universal time and index value
   double LastSaveProxyNodesStateTimeSec;
   bool RecordMasterOnly;
+  bool RecordingInBackground;
+  int RecordingFramePoolSize;
   int RecordingSamplingMode;
+
+  // Recording clock of fixed frame rate sampling mode
+  double RecordingClockStartTimeSec;
+  long long LastRecordingSampleIndex;
+  int NumberOfRecordedSamples;
+  int NumberOfMissedRecordingSamples;
+  double RecordingSampleJitterSumSec;
+  double RecordingSampleMaximumJitterSec;
+
   int IndexDisplayMode;
   std::string IndexDisplayFormat;
 
@@ -339,9 +473,45 @@ protected:
   // Counter that is used for generating the unique (only for this class) proxy node postfix strings
   int LastPostfixIndex;
 
+  // Lookup tables are valid (see UpdateSynchronizationLookup)
+  bool SynchronizationLookupValid;
+
 private:
   struct SynchronizationProperties;
   std::map< std::string, SynchronizationProperties* > SynchronizationPropertiesMap;
+
+  /// Get synchronization properties of a sequence node. Returns NULL if the sequence node is not synchronized.
+  SynchronizationProperties* GetSynchronizationProperties(vtkMRMLSequenceNode* sequenceNode);
+
+  /// Precomputed information about each synchronization postfix
+  struct SynchronizationLookupEntry
+  {
+    std::string Postfix;
+    std::string SequenceNodeReferenceRole;
+    std::string ProxyNodeReferenceRole;
+    SynchronizationProperties* Properties;
+  };
+  /// Lookup entries in the same order as SynchronizationPostfixes (first is the master)
+  std::vector< SynchronizationLookupEntry > SynchronizationLookupEntries;
+  /// Map from sequence node ID to index in SynchronizationLookupEntries
+  std::unordered_map< std::string, int > SequenceNodeIDToLookupIndex;
+  /// Map from proxy node ID to index in SynchronizationLookupEntries
+  std::unordered_map< std::string, int > ProxyNodeIDToLookupIndex;
+  /// Set of all proxy node pointers
+  std::unordered_set< vtkMRMLNode* > ProxyNodes;
+
+  /// Item numbers in a synchronized sequence for each master sequence item (see GetSynchronizedItemNumber)
+  struct ItemMappingTable
+  {
+    ItemMappingTable() : MasterSequenceNode(NULL), MasterSequenceMTime(0), SequenceMTime(0) {}
+    vtkMRMLSequenceNode* MasterSequenceNode;
+    vtkMTimeType MasterSequenceMTime;
+    vtkMTimeType SequenceMTime;
+    std::vector< int > ExactItemNumbers;
+    std::vector< int > ClosestItemNumbers;
+  };
+  /// Map from synchronized sequence node ID to item mapping table
+  std::unordered_map< std::string, ItemMappingTable > ItemMappingTables;
 };
 
 #endif
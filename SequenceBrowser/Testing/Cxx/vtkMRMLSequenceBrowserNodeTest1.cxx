@@ -27,6 +27,10 @@
 
 // VTK includes
 #include <vtkNew.h>
+#include <vtkTimerLog.h>
+
+// STD includes
+#include <cmath>
 
 double valueForIndex(int i)
 {
@@ -102,5 +106,107 @@ int vtkMRMLSequenceBrowserNodeTest1(int argc, char* argv[])
     CHECK_STD_STRING(formattedIndexValue, expectedFormat);
   }
 
+  // Synchronized sequence and proxy node lookups
+  vtkNew<vtkMRMLSequenceNode> synchronizedSequenceNode;
+  scene->AddNode(synchronizedSequenceNode.GetPointer());
+  browserNode->AddSynchronizedSequenceNode(synchronizedSequenceNode.GetPointer());
+  CHECK_BOOL(browserNode->IsSynchronizedSequenceNode(synchronizedSequenceNode.GetPointer()), true);
+  CHECK_BOOL(browserNode->IsSynchronizedSequenceNode(sequenceNode.GetPointer()), false);
+  CHECK_BOOL(browserNode->IsSynchronizedSequenceNode(sequenceNode.GetPointer(), true), true);
+  vtkNew<vtkMRMLTransformNode> sourceProxyNode;
+  scene->AddNode(sourceProxyNode.GetPointer());
+  vtkMRMLNode* proxyNode = browserNode->AddProxyNode(sourceProxyNode.GetPointer(), synchronizedSequenceNode.GetPointer(), false);
+  CHECK_POINTER(proxyNode, sourceProxyNode.GetPointer());
+  CHECK_POINTER(browserNode->GetProxyNode(synchronizedSequenceNode.GetPointer()), sourceProxyNode.GetPointer());
+  CHECK_POINTER(browserNode->GetSequenceNode(sourceProxyNode.GetPointer()), synchronizedSequenceNode.GetPointer());
+  CHECK_BOOL(browserNode->IsProxyNode(sourceProxyNode->GetID()), true);
+  CHECK_BOOL(browserNode->IsProxyNodeID(sourceProxyNode->GetID()), true);
+  CHECK_BOOL(browserNode->IsProxyNodePointer(sourceProxyNode.GetPointer()), true);
+  CHECK_BOOL(browserNode->IsProxyNodePointer(synchronizedSequenceNode.GetPointer()), false);
+  browserNode->RemoveSynchronizedSequenceNode(synchronizedSequenceNode->GetID());
+  CHECK_BOOL(browserNode->IsSynchronizedSequenceNode(synchronizedSequenceNode.GetPointer()), false);
+  CHECK_BOOL(browserNode->IsProxyNode(sourceProxyNode->GetID()), false);
+  CHECK_BOOL(browserNode->IsProxyNodeID(sourceProxyNode->GetID()), false);
+  CHECK_BOOL(browserNode->IsProxyNodePointer(sourceProxyNode.GetPointer()), false);
+
+  // Master to synchronized item mapping must match index value lookup
+  vtkNew<vtkMRMLSequenceNode> sparseSequenceNode;
+  for (int i = 3; i < numberOfDataNodes; i += 2)
+  {
+    vtkNew<vtkMRMLTransformNode> transform;
+    sparseSequenceNode->SetDataNodeAtValue(transform.GetPointer(), vtkVariant(valueForIndex(i) + 0.5).ToString());
+  }
+  scene->AddNode(sparseSequenceNode.GetPointer());
+  sparseSequenceNode->SetNumericIndexValueTolerance(1.0);
+  browserNode->AddSynchronizedSequenceNode(sparseSequenceNode.GetPointer());
+  for (int i = 0; i < numberOfDataNodes; i++)
+  {
+    std::string indexValue = sequenceNode->GetNthIndexValue(i);
+    CHECK_INT(browserNode->GetSynchronizedItemNumber(sparseSequenceNode.GetPointer(), i, true),
+      sparseSequenceNode->GetItemNumberFromIndexValue(indexValue, true));
+    CHECK_INT(browserNode->GetSynchronizedItemNumber(sparseSequenceNode.GetPointer(), i, false),
+      sparseSequenceNode->GetItemNumberFromIndexValue(indexValue, false));
+  }
+  // Mapping is updated when the sequence is modified
+  sparseSequenceNode->RemoveDataNodeAtValue(sparseSequenceNode->GetNthIndexValue(0));
+  CHECK_INT(browserNode->GetSynchronizedItemNumber(sparseSequenceNode.GetPointer(), 3, true), -1);
+  CHECK_INT(browserNode->GetSynchronizedItemNumber(sparseSequenceNode.GetPointer(), 5, true), 0);
+  browserNode->RemoveSynchronizedSequenceNode(sparseSequenceNode->GetID());
+
+  // Fixed frame rate recording
+  CHECK_INT(vtkMRMLSequenceBrowserNode::GetRecordingSamplingModeFromString("fixedFrameRate"),
+    vtkMRMLSequenceBrowserNode::SamplingFixedFrameRate);
+  browserNode->SetRecordingSamplingMode(vtkMRMLSequenceBrowserNode::SamplingFixedFrameRate);
+  browserNode->SetPlaybackRateFps(0.001); // long sampling period, so that no sample is due during the test
+  // Non-positive rate is rejected, otherwise a sample would be recorded at every update
+  TESTING_OUTPUT_ASSERT_ERRORS_BEGIN();
+  browserNode->SetPlaybackRateFps(0.0);
+  TESTING_OUTPUT_ASSERT_ERRORS_END();
+  CHECK_DOUBLE(browserNode->GetPlaybackRateFps(), 0.001);
+  browserNode->SetRecordingActive(true);
+  std::string recordingIndexValue;
+  CHECK_BOOL(browserNode->GetNextRecordingIndexValue(recordingIndexValue), false);
+  CHECK_INT(browserNode->GetNumberOfRecordedSamples(), 0);
+  CHECK_INT(browserNode->GetNumberOfMissedRecordingSamples(), 0);
+  CHECK_BOOL(browserNode->GetNextRecordingSampleTimeSec() > vtkTimerLog::GetUniversalTime(), true);
+  browserNode->SetRecordingActive(false);
+
+  // Real-time playback of a non-uniformly sampled sequence
+  vtkNew<vtkMRMLSequenceNode> irregularSequenceNode;
+  const double irregularIndexValues[] = { 0.0, 0.1, 0.15, 1.0, 1.05 };
+  for (int i = 0; i < 5; i++)
+  {
+    vtkNew<vtkMRMLTransformNode> transform;
+    irregularSequenceNode->SetDataNodeAtValue(transform.GetPointer(), vtkVariant(irregularIndexValues[i]).ToString());
+  }
+  scene->AddNode(irregularSequenceNode.GetPointer());
+  CHECK_BOOL(irregularSequenceNode->GetNthNumericIndexValue(3) == 1.0, true);
+  CHECK_INT(irregularSequenceNode->GetItemNumberFromNumericIndexValue(0.5, true), -1);
+  CHECK_INT(irregularSequenceNode->GetItemNumberFromNumericIndexValue(0.5, false), 2);
+  CHECK_INT(irregularSequenceNode->GetItemNumberFromNumericIndexValue(1.0005, true), 3);
+
+  vtkNew<vtkMRMLSequenceBrowserNode> realTimeBrowserNode;
+  scene->AddNode(realTimeBrowserNode.GetPointer());
+  realTimeBrowserNode->SetAndObserveMasterSequenceNodeID(irregularSequenceNode->GetID());
+  CHECK_BOOL(realTimeBrowserNode->IsPlaybackRealTime(), false);
+  realTimeBrowserNode->SetPlaybackRealTimeEnabled(true);
+  CHECK_BOOL(realTimeBrowserNode->IsPlaybackRealTime(), true);
+  realTimeBrowserNode->SetSelectedItemNumber(0);
+  realTimeBrowserNode->SetPlaybackActive(true);
+  CHECK_INT(realTimeBrowserNode->AdvancePlaybackClock(0.12), 1);
+  CHECK_INT(realTimeBrowserNode->AdvancePlaybackClock(0.5), 2);
+  realTimeBrowserNode->SetPlaybackSpeed(2.0);
+  CHECK_INT(realTimeBrowserNode->AdvancePlaybackClock(0.2), 3);
+  CHECK_BOOL(fabs(realTimeBrowserNode->GetPlaybackTimeToNextItemSec() - 0.015) < 1e-6, true);
+  // Clock wraps around after the last item is displayed for the average item duration
+  CHECK_INT(realTimeBrowserNode->AdvancePlaybackClock(0.2), 1);
+  // Clock restarts from the item that is selected externally
+  realTimeBrowserNode->SetSelectedItemNumber(3);
+  CHECK_INT(realTimeBrowserNode->AdvancePlaybackClock(0.01), 3);
+  // Playback stops at the end if not looped
+  realTimeBrowserNode->SetPlaybackLooped(false);
+  CHECK_INT(realTimeBrowserNode->AdvancePlaybackClock(1.0), 0);
+  CHECK_BOOL(realTimeBrowserNode->GetPlaybackActive(), false);
+
   return 0;
 }
@@ -0,0 +1,555 @@
+/*==============================================================================
+
+  Program: 3D Slicer
+
+  Portions (c) Copyright Brigham and Women's Hospital (BWH) All Rights Reserved.
+
+  See COPYRIGHT.txt
+  or http://www.slicer.org/copyright/copyright.txt for details.
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+==============================================================================*/
+
+// Sequence includes
+#include "vtkMRMLSequenceBrowserNode.h"
+#include "vtkMRMLSequenceNode.h"
+#include "vtkSlicerSequenceBrowserLogic.h"
+
+// MRML includes
+#include "vtkMRMLCoreTestingMacros.h"
+#include "vtkMRMLScalarVolumeNode.h"
+#include "vtkMRMLScene.h"
+#include "vtkMRMLSegmentationNode.h"
+
+// SegmentationCore includes
+#include <vtkOrientedImageData.h>
+#include <vtkSegment.h>
+#include <vtkSegmentation.h>
+#include <vtkSegmentationConverter.h>
+
+// VTK includes
+#include <vtkCallbackCommand.h>
+#include <vtkCollection.h>
+#include <vtkDataArray.h>
+#include <vtkImageData.h>
+#include <vtkIntArray.h>
+#include <vtkNew.h>
+#include <vtkPointData.h>
+#include <vtkPolyData.h>
+#include <vtkVariant.h>
+#include <vtksys/SystemTools.hxx>
+
+namespace
+{
+
+//-----------------------------------------------------------------------------
+vtkDataArray* GetVoxelArray(vtkMRMLNode* volumeNode)
+{
+  vtkMRMLScalarVolumeNode* scalarVolumeNode = vtkMRMLScalarVolumeNode::SafeDownCast(volumeNode);
+  if (scalarVolumeNode == NULL || scalarVolumeNode->GetImageData() == NULL)
+  {
+    return NULL;
+  }
+  return scalarVolumeNode->GetImageData()->GetPointData()->GetScalars();
+}
+
+//-----------------------------------------------------------------------------
+// Add a sequence of small volumes to the scene. Voxels of the volume at index value i are filled with i+1.
+vtkMRMLSequenceNode* AddVolumeSequence(vtkMRMLScene* scene, int numberOfItems)
+{
+  vtkNew<vtkMRMLSequenceNode> sequenceNode;
+  scene->AddNode(sequenceNode.GetPointer());
+  for (int i = 0; i < numberOfItems; i++)
+  {
+    vtkNew<vtkImageData> imageData;
+    imageData->SetDimensions(4, 4, 4);
+    imageData->AllocateScalars(VTK_UNSIGNED_CHAR, 1);
+    imageData->GetPointData()->GetScalars()->FillComponent(0, i + 1);
+    vtkNew<vtkMRMLScalarVolumeNode> volumeNode;
+    volumeNode->SetAndObserveImageData(imageData.GetPointer());
+    sequenceNode->SetDataNodeAtValue(volumeNode.GetPointer(), vtkVariant(i).ToString());
+  }
+  return sequenceNode.GetPointer(); // the scene keeps a reference
+}
+
+//-----------------------------------------------------------------------------
+// Add a sequence of segmentations to the scene. Each item contains one segment with a binary labelmap master representation.
+vtkMRMLSequenceNode* AddSegmentationSequence(vtkMRMLScene* scene, int numberOfItems)
+{
+  vtkNew<vtkMRMLSequenceNode> sequenceNode;
+  scene->AddNode(sequenceNode.GetPointer());
+  for (int i = 0; i < numberOfItems; i++)
+  {
+    vtkNew<vtkOrientedImageData> labelmap;
+    labelmap->SetDimensions(4, 4, 4);
+    labelmap->AllocateScalars(VTK_UNSIGNED_CHAR, 1);
+    labelmap->GetPointData()->GetScalars()->FillComponent(0, i % 2);
+    vtkNew<vtkSegment> segment;
+    segment->AddRepresentation(vtkSegmentationConverter::GetSegmentationBinaryLabelmapRepresentationName(), labelmap.GetPointer());
+    vtkNew<vtkMRMLSegmentationNode> segmentationNode;
+    segmentationNode->GetSegmentation()->SetMasterRepresentationName(
+      vtkSegmentationConverter::GetSegmentationBinaryLabelmapRepresentationName());
+    segmentationNode->GetSegmentation()->AddSegment(segment.GetPointer(), "Segment");
+    sequenceNode->SetDataNodeAtValue(segmentationNode.GetPointer(), vtkVariant(i).ToString());
+  }
+  return sequenceNode.GetPointer(); // the scene keeps a reference
+}
+
+//-----------------------------------------------------------------------------
+int testShareData()
+{
+  vtkNew<vtkMRMLScene> scene;
+  vtkNew<vtkSlicerSequenceBrowserLogic> logic;
+  logic->SetMRMLScene(scene.GetPointer());
+
+  vtkMRMLSequenceNode* sequenceNode = AddVolumeSequence(scene.GetPointer(), 2);
+  vtkMRMLSequenceBrowserNode* browserNode = vtkMRMLSequenceBrowserNode::SafeDownCast(
+    scene->AddNewNodeByClass("vtkMRMLSequenceBrowserNode"));
+  browserNode->SetAndObserveMasterSequenceNodeID(sequenceNode->GetID());
+  browserNode->SetSaveChanges(sequenceNode, false);
+  browserNode->SetShareData(sequenceNode, true);
+  browserNode->SetSelectedItemNumber(0);
+  logic->UpdateProxyNodesFromSequences(browserNode);
+  vtkMRMLNode* proxyNode = browserNode->GetProxyNode(sequenceNode);
+  CHECK_NOT_NULL(proxyNode);
+  CHECK_NOT_NULL(GetVoxelArray(proxyNode));
+
+  // Proxy node refers to the voxels of the sequence item
+  CHECK_POINTER(GetVoxelArray(proxyNode), GetVoxelArray(sequenceNode->GetNthDataNode(0)));
+
+  // After the proxy node is made writable it has its own copy of the voxels
+  logic->MakeProxyNodeWritable(proxyNode);
+  CHECK_POINTER_DIFFERENT(GetVoxelArray(proxyNode), GetVoxelArray(sequenceNode->GetNthDataNode(0)));
+  CHECK_DOUBLE(GetVoxelArray(proxyNode)->GetTuple1(0), 1.0);
+  GetVoxelArray(proxyNode)->SetTuple1(0, 100.0);
+  CHECK_DOUBLE(GetVoxelArray(sequenceNode->GetNthDataNode(0))->GetTuple1(0), 1.0);
+
+  // Proxy node is detached from the sequence when it is modified
+  browserNode->SetSelectedItemNumber(1);
+  CHECK_POINTER(GetVoxelArray(proxyNode), GetVoxelArray(sequenceNode->GetNthDataNode(1)));
+  proxyNode->Modified();
+  CHECK_POINTER_DIFFERENT(GetVoxelArray(proxyNode), GetVoxelArray(sequenceNode->GetNthDataNode(1)));
+  CHECK_DOUBLE(GetVoxelArray(proxyNode)->GetTuple1(0), 2.0);
+
+  // Proxy node that owns its data already is not detached again
+  vtkDataArray* detachedVoxelArray = GetVoxelArray(proxyNode);
+  proxyNode->SetAttribute("TestAttribute", "1");
+  logic->MakeProxyNodeWritable(proxyNode);
+  CHECK_POINTER(GetVoxelArray(proxyNode), detachedVoxelArray);
+
+  // Proxy node whose image has been replaced is not detached
+  browserNode->SetSelectedItemNumber(0);
+  CHECK_POINTER(GetVoxelArray(proxyNode), GetVoxelArray(sequenceNode->GetNthDataNode(0)));
+  vtkMRMLVolumeNode* proxyVolumeNode = vtkMRMLVolumeNode::SafeDownCast(proxyNode);
+  vtkNew<vtkImageData> replacedImageData;
+  replacedImageData->DeepCopy(proxyVolumeNode->GetImageData());
+  proxyVolumeNode->SetAndObserveImageData(replacedImageData.GetPointer());
+  CHECK_POINTER(proxyVolumeNode->GetImageData(), replacedImageData.GetPointer());
+
+  return EXIT_SUCCESS;
+}
+
+//-----------------------------------------------------------------------------
+int testSkipUnchangedProxyNodeUpdate()
+{
+  vtkNew<vtkMRMLScene> scene;
+  vtkNew<vtkSlicerSequenceBrowserLogic> logic;
+  logic->SetMRMLScene(scene.GetPointer());
+
+  vtkMRMLSequenceNode* sequenceNode = AddVolumeSequence(scene.GetPointer(), 2);
+  vtkMRMLSequenceBrowserNode* browserNode = vtkMRMLSequenceBrowserNode::SafeDownCast(
+    scene->AddNewNodeByClass("vtkMRMLSequenceBrowserNode"));
+  browserNode->SetAndObserveMasterSequenceNodeID(sequenceNode->GetID());
+  browserNode->SetSaveChanges(sequenceNode, false);
+  browserNode->SetSelectedItemNumber(0);
+  logic->UpdateProxyNodesFromSequences(browserNode);
+  vtkMRMLNode* proxyNode = browserNode->GetProxyNode(sequenceNode);
+  CHECK_NOT_NULL(proxyNode);
+
+  // Nothing changed, proxy node is not updated
+  vtkMTimeType proxyNodeMTime = proxyNode->GetMTime();
+  logic->UpdateProxyNodesFromSequences(browserNode);
+  CHECK_BOOL(proxyNode->GetMTime() == proxyNodeMTime, true);
+
+  // Data node changed, proxy node is updated
+  sequenceNode->GetNthDataNode(0)->Modified();
+  logic->UpdateProxyNodesFromSequences(browserNode);
+  CHECK_BOOL(proxyNode->GetMTime() > proxyNodeMTime, true);
+
+  // Proxy node changed, content of the data node is copied again
+  GetVoxelArray(proxyNode)->FillComponent(0, 100.0);
+  proxyNode->Modified();
+  logic->UpdateProxyNodesFromSequences(browserNode);
+  CHECK_DOUBLE(GetVoxelArray(proxyNode)->GetTuple1(0), 1.0);
+
+  // Voxels of the proxy node changed in-place (the node itself is not modified), content is copied again
+  GetVoxelArray(proxyNode)->FillComponent(0, 100.0);
+  GetVoxelArray(proxyNode)->Modified();
+  logic->UpdateProxyNodesFromSequences(browserNode);
+  CHECK_DOUBLE(GetVoxelArray(proxyNode)->GetTuple1(0), 1.0);
+
+  // Voxels of the data node changed in-place, proxy node is updated
+  GetVoxelArray(sequenceNode->GetNthDataNode(0))->FillComponent(0, 50.0);
+  GetVoxelArray(sequenceNode->GetNthDataNode(0))->Modified();
+  logic->UpdateProxyNodesFromSequences(browserNode);
+  CHECK_DOUBLE(GetVoxelArray(proxyNode)->GetTuple1(0), 50.0);
+
+  return EXIT_SUCCESS;
+}
+
+//-----------------------------------------------------------------------------
+int testBrowserNodeRegistry()
+{
+  vtkNew<vtkMRMLScene> scene;
+  vtkNew<vtkSlicerSequenceBrowserLogic> logic;
+  logic->SetMRMLScene(scene.GetPointer());
+
+  vtkMRMLSequenceNode* sharedSequenceNode = AddVolumeSequence(scene.GetPointer(), 2);
+  vtkMRMLSequenceNode* masterSequenceNode = AddVolumeSequence(scene.GetPointer(), 2);
+  vtkMRMLSequenceBrowserNode* browserNode1 = vtkMRMLSequenceBrowserNode::SafeDownCast(
+    scene->AddNewNodeByClass("vtkMRMLSequenceBrowserNode"));
+  browserNode1->SetAndObserveMasterSequenceNodeID(sharedSequenceNode->GetID());
+  vtkMRMLSequenceBrowserNode* browserNode2 = vtkMRMLSequenceBrowserNode::SafeDownCast(
+    scene->AddNewNodeByClass("vtkMRMLSequenceBrowserNode"));
+  browserNode2->SetAndObserveMasterSequenceNodeID(masterSequenceNode->GetID());
+  browserNode2->AddSynchronizedSequenceNode(sharedSequenceNode);
+
+  vtkNew<vtkCollection> foundBrowserNodes;
+  logic->GetBrowserNodesForSequenceNode(sharedSequenceNode, foundBrowserNodes.GetPointer());
+  CHECK_INT(foundBrowserNodes->GetNumberOfItems(), 2);
+  CHECK_POINTER(logic->GetFirstBrowserNodeForSequenceNode(masterSequenceNode), browserNode2);
+
+  // Removed browser node is not found anymore
+  scene->RemoveNode(browserNode1);
+  logic->GetBrowserNodesForSequenceNode(sharedSequenceNode, foundBrowserNodes.GetPointer());
+  CHECK_INT(foundBrowserNodes->GetNumberOfItems(), 1);
+  CHECK_POINTER(logic->GetFirstBrowserNodeForSequenceNode(sharedSequenceNode), browserNode2);
+
+  // Sequence node that is removed from the browser node is not found anymore
+  browserNode2->RemoveSynchronizedSequenceNode(sharedSequenceNode->GetID());
+  logic->GetBrowserNodesForSequenceNode(sharedSequenceNode, foundBrowserNodes.GetPointer());
+  CHECK_INT(foundBrowserNodes->GetNumberOfItems(), 0);
+  CHECK_NULL(logic->GetFirstBrowserNodeForSequenceNode(sharedSequenceNode));
+
+  // Removed sequence node is not found anymore
+  vtkSmartPointer<vtkMRMLSequenceNode> removedSequenceNode = masterSequenceNode;
+  scene->RemoveNode(masterSequenceNode);
+  logic->GetBrowserNodesForSequenceNode(removedSequenceNode, foundBrowserNodes.GetPointer());
+  CHECK_INT(foundBrowserNodes->GetNumberOfItems(), 0);
+  CHECK_NULL(logic->GetFirstBrowserNodeForSequenceNode(removedSequenceNode));
+
+  return EXIT_SUCCESS;
+}
+
+//-----------------------------------------------------------------------------
+int testPerformanceMetrics()
+{
+  vtkNew<vtkMRMLScene> scene;
+  vtkNew<vtkSlicerSequenceBrowserLogic> logic;
+  logic->SetMRMLScene(scene.GetPointer());
+  // Content of the proxy nodes is copied in parallel
+  logic->SetNumberOfProxyUpdateThreads(2);
+
+  vtkMRMLSequenceNode* sequenceNode1 = AddVolumeSequence(scene.GetPointer(), 2);
+  vtkMRMLSequenceNode* sequenceNode2 = AddVolumeSequence(scene.GetPointer(), 2);
+  vtkMRMLSequenceBrowserNode* browserNode = vtkMRMLSequenceBrowserNode::SafeDownCast(
+    scene->AddNewNodeByClass("vtkMRMLSequenceBrowserNode"));
+  browserNode->SetAndObserveMasterSequenceNodeID(sequenceNode1->GetID());
+  browserNode->AddSynchronizedSequenceNode(sequenceNode2);
+  browserNode->SetSaveChanges(sequenceNode1, false);
+  browserNode->SetSaveChanges(sequenceNode2, false);
+  browserNode->SetSelectedItemNumber(0);
+  logic->UpdateProxyNodesFromSequences(browserNode);
+  CHECK_NOT_NULL(browserNode->GetProxyNode(sequenceNode1));
+  CHECK_NOT_NULL(browserNode->GetProxyNode(sequenceNode2));
+
+  logic->SetPerformanceMetricsEnabled(true);
+  logic->ResetPerformanceMetrics();
+  browserNode->SetSelectedItemNumber(1);
+  browserNode->SetSelectedItemNumber(0);
+
+  // Each proxy node update is counted separately
+  CHECK_INT(logic->GetNumberOfNodeCopies("vtkMRMLScalarVolumeNode"), 4);
+  CHECK_BOOL(logic->GetMeanNodeCopyTimeSec("vtkMRMLScalarVolumeNode") >= 0.0, true);
+  CHECK_DOUBLE(GetVoxelArray(browserNode->GetProxyNode(sequenceNode2))->GetTuple1(0), 1.0);
+
+  vtkNew<vtkIntArray> latencyBinCounts;
+  CHECK_BOOL(logic->GetProxyUpdateLatencyHistogram(browserNode, latencyBinCounts.GetPointer()), true);
+  CHECK_INT(latencyBinCounts->GetNumberOfValues(), vtkSlicerSequenceBrowserLogic::GetNumberOfProxyUpdateLatencyBins());
+  int numberOfProxyUpdates = 0;
+  for (int binIndex = 0; binIndex < latencyBinCounts->GetNumberOfValues(); binIndex++)
+  {
+    numberOfProxyUpdates += latencyBinCounts->GetValue(binIndex);
+  }
+  CHECK_BOOL(numberOfProxyUpdates >= 2, true);
+
+  // No metrics are collected when disabled
+  logic->SetPerformanceMetricsEnabled(false);
+  logic->ResetPerformanceMetrics();
+  browserNode->SetSelectedItemNumber(1);
+  CHECK_INT(logic->GetNumberOfNodeCopies("vtkMRMLScalarVolumeNode"), 0);
+
+  return EXIT_SUCCESS;
+}
+
+//-----------------------------------------------------------------------------
+struct NextUpdateTimeObserverData
+{
+  vtkSlicerSequenceBrowserLogic* Logic;
+  double NextUpdateTimeSec;
+};
+
+//-----------------------------------------------------------------------------
+void GetNextUpdateTimeCallback(vtkObject* vtkNotUsed(caller), unsigned long vtkNotUsed(eid), void* clientData, void* vtkNotUsed(callData))
+{
+  NextUpdateTimeObserverData* data = reinterpret_cast<NextUpdateTimeObserverData*>(clientData);
+  data->NextUpdateTimeSec = data->Logic->GetNextUpdateTimeSec();
+}
+
+//-----------------------------------------------------------------------------
+int testNextUpdateTime()
+{
+  vtkNew<vtkMRMLScene> scene;
+  vtkNew<vtkSlicerSequenceBrowserLogic> logic;
+  logic->SetMRMLScene(scene.GetPointer());
+
+  vtkMRMLSequenceNode* sequenceNode = AddVolumeSequence(scene.GetPointer(), 2);
+  vtkMRMLSequenceBrowserNode* browserNode = vtkMRMLSequenceBrowserNode::SafeDownCast(
+    scene->AddNewNodeByClass("vtkMRMLSequenceBrowserNode"));
+  browserNode->SetAndObserveMasterSequenceNodeID(sequenceNode->GetID());
+  CHECK_BOOL(logic->GetNextUpdateTimeSec() < 0, true);
+
+  // Observer of the browser node is notified before the logic (higher priority),
+  // next update must be scheduled nevertheless
+  NextUpdateTimeObserverData observerData;
+  observerData.Logic = logic.GetPointer();
+  observerData.NextUpdateTimeSec = -1.0;
+  vtkNew<vtkCallbackCommand> callback;
+  callback->SetCallback(GetNextUpdateTimeCallback);
+  callback->SetClientData(&observerData);
+  browserNode->AddObserver(vtkCommand::ModifiedEvent, callback.GetPointer(), 10.0);
+
+  browserNode->SetPlaybackRateFps(10.0);
+  browserNode->SetPlaybackActive(true);
+  CHECK_BOOL(observerData.NextUpdateTimeSec >= 0, true);
+  CHECK_BOOL(logic->GetNextUpdateTimeSec() >= 0, true);
+
+  browserNode->SetPlaybackActive(false);
+  CHECK_BOOL(observerData.NextUpdateTimeSec < 0, true);
+  CHECK_BOOL(logic->GetNextUpdateTimeSec() < 0, true);
+
+  browserNode->RemoveObserver(callback.GetPointer());
+  return EXIT_SUCCESS;
+}
+
+//-----------------------------------------------------------------------------
+int testRecordingInBackground(int recordingFramePoolSize)
+{
+  vtkNew<vtkMRMLScene> scene;
+  vtkNew<vtkSlicerSequenceBrowserLogic> logic;
+  logic->SetMRMLScene(scene.GetPointer());
+
+  vtkMRMLSequenceNode* sequenceNode = AddVolumeSequence(scene.GetPointer(), 1);
+  vtkMRMLSequenceBrowserNode* browserNode = vtkMRMLSequenceBrowserNode::SafeDownCast(
+    scene->AddNewNodeByClass("vtkMRMLSequenceBrowserNode"));
+  browserNode->SetAndObserveMasterSequenceNodeID(sequenceNode->GetID());
+  browserNode->SetSelectedItemNumber(0);
+  logic->UpdateProxyNodesFromSequences(browserNode);
+  vtkMRMLNode* proxyNode = browserNode->GetProxyNode(sequenceNode);
+  CHECK_NOT_NULL(proxyNode);
+
+  browserNode->SetRecording(sequenceNode, true);
+  browserNode->SetRecordingInBackground(true);
+  browserNode->SetRecordingFramePoolSize(recordingFramePoolSize);
+  browserNode->SetRecordingActive(true);
+  const int numberOfRecordedFrames = 4;
+  for (int frameIndex = 0; frameIndex < numberOfRecordedFrames; frameIndex++)
+  {
+    // Make sure index values of frames are different
+    vtksys::SystemTools::Delay(20);
+    GetVoxelArray(proxyNode)->FillComponent(0, 100 + frameIndex);
+    logic->UpdateSequencesFromProxyNodes(browserNode, proxyNode);
+    // Proxy node is modified in-place right after the snapshot is taken, this must not change the recorded frame
+    GetVoxelArray(proxyNode)->FillComponent(0, 0);
+  }
+  browserNode->SetRecordingActive(false);
+  logic->FlushRecordingQueue(true);
+
+  CHECK_INT(sequenceNode->GetNumberOfDataNodes(), 1 + numberOfRecordedFrames);
+  for (int frameIndex = 0; frameIndex < numberOfRecordedFrames; frameIndex++)
+  {
+    vtkDataArray* recordedVoxels = GetVoxelArray(sequenceNode->GetNthDataNode(1 + frameIndex));
+    CHECK_NOT_NULL(recordedVoxels);
+    CHECK_DOUBLE(recordedVoxels->GetRange(0)[0], 100.0 + frameIndex);
+    CHECK_DOUBLE(recordedVoxels->GetRange(0)[1], 100.0 + frameIndex);
+  }
+
+  return EXIT_SUCCESS;
+}
+
+//-----------------------------------------------------------------------------
+// Proxy node image is replaced at each frame (as done by most data sources). Recorded snapshots share the image
+// with the proxy node and are copied in the background. Recorded items must not be affected by later edits
+// of the proxy node, if in-place edits are preceded by MakeProxyNodeWritable.
+int testRecordingSnapshotIndependence(int recordingFramePoolSize)
+{
+  vtkNew<vtkMRMLScene> scene;
+  vtkNew<vtkSlicerSequenceBrowserLogic> logic;
+  logic->SetMRMLScene(scene.GetPointer());
+
+  vtkMRMLSequenceNode* sequenceNode = AddVolumeSequence(scene.GetPointer(), 1);
+  vtkMRMLSequenceBrowserNode* browserNode = vtkMRMLSequenceBrowserNode::SafeDownCast(
+    scene->AddNewNodeByClass("vtkMRMLSequenceBrowserNode"));
+  browserNode->SetAndObserveMasterSequenceNodeID(sequenceNode->GetID());
+  browserNode->SetSelectedItemNumber(0);
+  logic->UpdateProxyNodesFromSequences(browserNode);
+  vtkMRMLScalarVolumeNode* proxyNode = vtkMRMLScalarVolumeNode::SafeDownCast(browserNode->GetProxyNode(sequenceNode));
+  CHECK_NOT_NULL(proxyNode);
+
+  browserNode->SetRecording(sequenceNode, true);
+  browserNode->SetRecordingInBackground(true);
+  browserNode->SetRecordingFramePoolSize(recordingFramePoolSize);
+  // Proxy node modification events record the frames, at most one per playback period
+  browserNode->SetRecordingSamplingMode(vtkMRMLSequenceBrowserNode::SamplingLimitedToPlaybackFrameRate);
+  browserNode->SetPlaybackRateFps(10.0);
+  browserNode->SetRecordingActive(true);
+  const int numberOfRecordedFrames = 4;
+  for (int frameIndex = 0; frameIndex < numberOfRecordedFrames; frameIndex++)
+  {
+    vtksys::SystemTools::Delay(150);
+    vtkNew<vtkImageData> imageData;
+    imageData->SetDimensions(4, 4, 4);
+    imageData->AllocateScalars(VTK_UNSIGNED_CHAR, 1);
+    imageData->GetPointData()->GetScalars()->FillComponent(0, 100 + frameIndex);
+    proxyNode->SetAndObserveImageData(imageData.GetPointer());
+    // Proxy node gets its own copy of the voxels before it is modified in-place,
+    // the voxels that are recorded remain unchanged
+    vtkDataArray* recordedVoxels = GetVoxelArray(proxyNode);
+    logic->MakeProxyNodeWritable(proxyNode);
+    CHECK_POINTER_DIFFERENT(GetVoxelArray(proxyNode), recordedVoxels);
+    CHECK_DOUBLE(GetVoxelArray(proxyNode)->GetRange(0)[0], 100.0 + frameIndex);
+    GetVoxelArray(proxyNode)->FillComponent(0, 0);
+  }
+  browserNode->SetRecordingActive(false);
+  logic->FlushRecordingQueue(true);
+
+  CHECK_INT(sequenceNode->GetNumberOfDataNodes(), 1 + numberOfRecordedFrames);
+  for (int frameIndex = 0; frameIndex < numberOfRecordedFrames; frameIndex++)
+  {
+    vtkDataArray* recordedVoxels = GetVoxelArray(sequenceNode->GetNthDataNode(1 + frameIndex));
+    CHECK_NOT_NULL(recordedVoxels);
+    CHECK_POINTER_DIFFERENT(recordedVoxels, GetVoxelArray(proxyNode));
+    CHECK_DOUBLE(recordedVoxels->GetRange(0)[0], 100.0 + frameIndex);
+    CHECK_DOUBLE(recordedVoxels->GetRange(0)[1], 100.0 + frameIndex);
+  }
+
+  // Editing the proxy node after recording does not change the recorded items
+  logic->MakeProxyNodeWritable(proxyNode);
+  GetVoxelArray(proxyNode)->FillComponent(0, 200);
+  vtkDataArray* lastRecordedVoxels = GetVoxelArray(sequenceNode->GetNthDataNode(numberOfRecordedFrames));
+  CHECK_DOUBLE(lastRecordedVoxels->GetRange(0)[1], 100.0 + numberOfRecordedFrames - 1);
+
+  return EXIT_SUCCESS;
+}
+
+//-----------------------------------------------------------------------------
+// Derived representations that are computed for the proxy node (by the display pipeline) are reused when
+// the same item is shown again, even if more items are played than the number of items that used to be cached.
+int testDerivedRepresentationCache()
+{
+  vtkNew<vtkMRMLScene> scene;
+  vtkNew<vtkSlicerSequenceBrowserLogic> logic;
+  logic->SetMRMLScene(scene.GetPointer());
+
+  const int numberOfItems = 40;
+  vtkMRMLSequenceNode* sequenceNode = AddSegmentationSequence(scene.GetPointer(), numberOfItems);
+  vtkMRMLSequenceBrowserNode* browserNode = vtkMRMLSequenceBrowserNode::SafeDownCast(
+    scene->AddNewNodeByClass("vtkMRMLSequenceBrowserNode"));
+  browserNode->SetAndObserveMasterSequenceNodeID(sequenceNode->GetID());
+  browserNode->SetSelectedItemNumber(0);
+  logic->UpdateProxyNodesFromSequences(browserNode);
+  vtkMRMLSegmentationNode* proxyNode = vtkMRMLSegmentationNode::SafeDownCast(browserNode->GetProxyNode(sequenceNode));
+  CHECK_NOT_NULL(proxyNode);
+
+  const std::string closedSurfaceName = vtkSegmentationConverter::GetSegmentationClosedSurfaceRepresentationName();
+  std::vector< vtkSmartPointer<vtkDataObject> > computedRepresentations;
+  // First pass: compute the derived representation of each item (as the display pipeline would do)
+  for (int itemNumber = 0; itemNumber < numberOfItems; itemNumber++)
+  {
+    browserNode->SetSelectedItemNumber(itemNumber);
+    logic->UpdateProxyNodesFromSequences(browserNode);
+    vtkSegment* proxySegment = proxyNode->GetSegmentation()->GetSegment("Segment");
+    CHECK_NOT_NULL(proxySegment);
+    CHECK_NULL(proxySegment->GetRepresentation(closedSurfaceName));
+    vtkNew<vtkPolyData> closedSurface;
+    proxySegment->AddRepresentation(closedSurfaceName, closedSurface.GetPointer());
+    computedRepresentations.push_back(closedSurface.GetPointer());
+  }
+  // Second pass: representations are taken from the cache
+  for (int itemNumber = 0; itemNumber < numberOfItems; itemNumber++)
+  {
+    browserNode->SetSelectedItemNumber(itemNumber);
+    logic->UpdateProxyNodesFromSequences(browserNode);
+    vtkSegment* proxySegment = proxyNode->GetSegmentation()->GetSegment("Segment");
+    CHECK_NOT_NULL(proxySegment);
+    CHECK_POINTER(proxySegment->GetRepresentation(closedSurfaceName), computedRepresentations[itemNumber].GetPointer());
+  }
+  // Sequence items are not modified by the cache
+  vtkMRMLSegmentationNode* itemNode = vtkMRMLSegmentationNode::SafeDownCast(sequenceNode->GetNthDataNode(0));
+  CHECK_NULL(itemNode->GetSegmentation()->GetSegment("Segment")->GetRepresentation(closedSurfaceName));
+
+  return EXIT_SUCCESS;
+}
+
+} // end of anonymous namespace
+
+//-----------------------------------------------------------------------------
+int vtkSlicerSequenceBrowserLogicTest1(int, char*[])
+{
+  if (testShareData() != EXIT_SUCCESS)
+  {
+    return EXIT_FAILURE;
+  }
+  if (testSkipUnchangedProxyNodeUpdate() != EXIT_SUCCESS)
+  {
+    return EXIT_FAILURE;
+  }
+  if (testBrowserNodeRegistry() != EXIT_SUCCESS)
+  {
+    return EXIT_FAILURE;
+  }
+  if (testPerformanceMetrics() != EXIT_SUCCESS)
+  {
+    return EXIT_FAILURE;
+  }
+  if (testNextUpdateTime() != EXIT_SUCCESS)
+  {
+    return EXIT_FAILURE;
+  }
+  if (testDerivedRepresentationCache() != EXIT_SUCCESS)
+  {
+    return EXIT_FAILURE;
+  }
+  if (testRecordingInBackground(0) != EXIT_SUCCESS)
+  {
+    return EXIT_FAILURE;
+  }
+  if (testRecordingInBackground(8) != EXIT_SUCCESS)
+  {
+    return EXIT_FAILURE;
+  }
+  if (testRecordingSnapshotIndependence(0) != EXIT_SUCCESS)
+  {
+    return EXIT_FAILURE;
+  }
+  if (testRecordingSnapshotIndependence(8) != EXIT_SUCCESS)
+  {
+    return EXIT_FAILURE;
+  }
+  return EXIT_SUCCESS;
+}
@@ -223,6 +223,32 @@ void qMRMLSequenceBrowserPlayWidget::onVcrPlayPause()
   d->SequenceBrowserNode->SetPlaybackActive(!d->SequenceBrowserNode->GetPlaybackActive());
 }
 
+//-----------------------------------------------------------------------------
+void qMRMLSequenceBrowserPlayWidget::onGridPreviousRow()
+{
+  Q_D(qMRMLSequenceBrowserPlayWidget);
+  vtkMRMLSequenceNode* sequenceNode = d->SequenceBrowserNode.GetPointer() ? d->SequenceBrowserNode->GetMasterSequenceNode() : NULL;
+  if (sequenceNode == NULL || sequenceNode->GetIndexType() != vtkMRMLSequenceNode::GridIndex)
+  {
+    // rows are only defined for grid index
+    return;
+  }
+  d->SequenceBrowserNode->SelectNextGridItem(0, -1);
+}
+
+//-----------------------------------------------------------------------------
+void qMRMLSequenceBrowserPlayWidget::onGridNextRow()
+{
+  Q_D(qMRMLSequenceBrowserPlayWidget);
+  vtkMRMLSequenceNode* sequenceNode = d->SequenceBrowserNode.GetPointer() ? d->SequenceBrowserNode->GetMasterSequenceNode() : NULL;
+  if (sequenceNode == NULL || sequenceNode->GetIndexType() != vtkMRMLSequenceNode::GridIndex)
+  {
+    // rows are only defined for grid index
+    return;
+  }
+  d->SequenceBrowserNode->SelectNextGridItem(0, 1);
+}
+
 //-----------------------------------------------------------------------------
 void qMRMLSequenceBrowserPlayWidget::onRecordSnapshot()
 {
@@ -326,3 +352,15 @@ void qMRMLSequenceBrowserPlayWidget::setNextFrameShortcut(QString keySequence)
   QObject::connect(new QShortcut(QKeySequence(keySequence), this), SIGNAL(activated()), SLOT(onVcrNext()));
   d->pushButton_VcrNext->setToolTip(d->pushButton_VcrNext->toolTip() + " (" + keySequence + ")");
 }
+
+//-----------------------------------------------------------------------------
+void qMRMLSequenceBrowserPlayWidget::setPreviousRowShortcut(QString keySequence)
+{
+  QObject::connect(new QShortcut(QKeySequence(keySequence), this), SIGNAL(activated()), SLOT(onGridPreviousRow()));
+}
+
+//-----------------------------------------------------------------------------
+void qMRMLSequenceBrowserPlayWidget::setNextRowShortcut(QString keySequence)
+{
+  QObject::connect(new QShortcut(QKeySequence(keySequence), this), SIGNAL(activated()), SLOT(onGridNextRow()));
+}
@@ -58,6 +58,14 @@ public:
   /// Add a keyboard shortcut for next frame button
   void setNextFrameShortcut(QString keySequence);
 
+  /// Add a keyboard shortcut for selecting the item in the previous grid row
+  /// (only has an effect if the master sequence has grid index)
+  void setPreviousRowShortcut(QString keySequence);
+
+  /// Add a keyboard shortcut for selecting the item in the next grid row
+  /// (only has an effect if the master sequence has grid index)
+  void setNextRowShortcut(QString keySequence);
+
 public slots:
   void setMRMLSequenceBrowserNode(vtkMRMLSequenceBrowserNode* browserNode);
   void setMRMLSequenceBrowserNode(vtkMRMLNode* browserNode);
@@ -71,6 +79,8 @@ public slots:
   void onVcrLast();
   void onVcrPlayPause();
   void onRecordSnapshot();
+  void onGridPreviousRow();
+  void onGridNextRow();
 
 protected slots:
   void updateWidgetFromMRML();
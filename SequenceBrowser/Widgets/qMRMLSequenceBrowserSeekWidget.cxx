@@ -26,6 +26,7 @@
 // Qt includes
 #include <QDebug>
 #include <QFontDatabase>
+#include <QTimer>
 
 //-----------------------------------------------------------------------------
 /// \ingroup Slicer_QtModules_Markups
@@ -38,8 +39,19 @@ protected:
 public:
   qMRMLSequenceBrowserSeekWidgetPrivate(qMRMLSequenceBrowserSeekWidget& object);
   void init();
+  /// Stop scrubbing preview in the browser node (the full item is shown),
+  /// if the preview was started by this widget
+  void stopScrubbing();
 
   vtkWeakPointer<vtkMRMLSequenceBrowserNode> SequenceBrowserNode;
+
+  bool ScrubbingEnabled;
+  bool ScrubbingPreviewEnabled;
+  /// Set if scrubbing preview was activated in the browser node by this widget
+  bool ScrubbingPreviewSet;
+  /// Latest item number requested by dragging the slider, selected when the event queue is processed
+  int PendingItemNumber;
+  QTimer PendingSeekTimer;
 };
 
 //-----------------------------------------------------------------------------
@@ -48,6 +60,10 @@ public:
 //-----------------------------------------------------------------------------
 qMRMLSequenceBrowserSeekWidgetPrivate::qMRMLSequenceBrowserSeekWidgetPrivate(qMRMLSequenceBrowserSeekWidget& object)
   : q_ptr(&object)
+  , ScrubbingEnabled(true)
+  , ScrubbingPreviewEnabled(false)
+  , ScrubbingPreviewSet(false)
+  , PendingItemNumber(-1)
 {
 }
 
@@ -57,10 +73,27 @@ void qMRMLSequenceBrowserSeekWidgetPrivate::init()
   Q_Q(qMRMLSequenceBrowserSeekWidget);
   this->setupUi(q);
   this->label_IndexValue->setFont(QFontDatabase::systemFont(QFontDatabase::FixedFont));
-  QObject::connect(this->slider_IndexValue, SIGNAL(valueChanged(int)), q, SLOT(setSelectedItemNumber(int)));
+  QObject::connect(this->slider_IndexValue, SIGNAL(valueChanged(int)), q, SLOT(onSliderValueChanged(int)));
+  QObject::connect(this->slider_IndexValue, SIGNAL(sliderPressed()), q, SLOT(onSliderPressed()));
+  QObject::connect(this->slider_IndexValue, SIGNAL(sliderReleased()), q, SLOT(onSliderReleased()));
+  // Zero interval: the seek is performed after all pending slider move events are processed
+  this->PendingSeekTimer.setSingleShot(true);
+  this->PendingSeekTimer.setInterval(0);
+  QObject::connect(&this->PendingSeekTimer, SIGNAL(timeout()), q, SLOT(applyPendingSeek()));
   q->updateWidgetFromMRML();
 }
 
+//-----------------------------------------------------------------------------
+void qMRMLSequenceBrowserSeekWidgetPrivate::stopScrubbing()
+{
+  this->PendingSeekTimer.stop();
+  if (this->ScrubbingPreviewSet && this->SequenceBrowserNode != NULL)
+  {
+    this->SequenceBrowserNode->SetScrubbingActive(false);
+  }
+  this->ScrubbingPreviewSet = false;
+}
+
 //-----------------------------------------------------------------------------
 // qMRMLSequenceBrowserSeekWidget methods
 
@@ -76,6 +109,8 @@ qMRMLSequenceBrowserSeekWidget::qMRMLSequenceBrowserSeekWidget(QWidget *newParen
 //-----------------------------------------------------------------------------
 qMRMLSequenceBrowserSeekWidget::~qMRMLSequenceBrowserSeekWidget()
 {
+  Q_D(qMRMLSequenceBrowserSeekWidget);
+  d->stopScrubbing();
 }
 
 //-----------------------------------------------------------------------------
@@ -89,6 +124,11 @@ void qMRMLSequenceBrowserSeekWidget::setMRMLSequenceBrowserNode(vtkMRMLSequenceB
 {
   Q_D(qMRMLSequenceBrowserSeekWidget);
 
+  if (browserNode != d->SequenceBrowserNode.GetPointer())
+  {
+    d->stopScrubbing();
+  }
+
   qvtkReconnect(d->SequenceBrowserNode, browserNode, vtkMRMLSequenceBrowserNode::IndexDisplayFormatModifiedEvent,
     this, SLOT(onIndexDisplayFormatModified()));
   qvtkReconnect(d->SequenceBrowserNode, browserNode, vtkCommand::ModifiedEvent,
@@ -121,6 +161,93 @@ void qMRMLSequenceBrowserSeekWidget::setSelectedItemNumber(int itemNumber)
   d->SequenceBrowserNode->SetSelectedItemNumber(selectedItemNumber);
 }
 
+//-----------------------------------------------------------------------------
+bool qMRMLSequenceBrowserSeekWidget::scrubbingEnabled() const
+{
+  Q_D(const qMRMLSequenceBrowserSeekWidget);
+  return d->ScrubbingEnabled;
+}
+
+//-----------------------------------------------------------------------------
+void qMRMLSequenceBrowserSeekWidget::setScrubbingEnabled(bool enabled)
+{
+  Q_D(qMRMLSequenceBrowserSeekWidget);
+  d->ScrubbingEnabled = enabled;
+}
+
+//-----------------------------------------------------------------------------
+bool qMRMLSequenceBrowserSeekWidget::scrubbingPreviewEnabled() const
+{
+  Q_D(const qMRMLSequenceBrowserSeekWidget);
+  return d->ScrubbingPreviewEnabled;
+}
+
+//-----------------------------------------------------------------------------
+void qMRMLSequenceBrowserSeekWidget::setScrubbingPreviewEnabled(bool enabled)
+{
+  Q_D(qMRMLSequenceBrowserSeekWidget);
+  d->ScrubbingPreviewEnabled = enabled;
+}
+
+//-----------------------------------------------------------------------------
+void qMRMLSequenceBrowserSeekWidget::onSliderValueChanged(int itemNumber)
+{
+  Q_D(qMRMLSequenceBrowserSeekWidget);
+  if (!d->ScrubbingEnabled || !d->slider_IndexValue->isSliderDown())
+  {
+    this->setSelectedItemNumber(itemNumber);
+    return;
+  }
+  // Coalesce seeks while dragging: only the latest position is selected
+  d->PendingItemNumber = itemNumber;
+  if (!d->PendingSeekTimer.isActive())
+  {
+    d->PendingSeekTimer.start();
+  }
+}
+
+//-----------------------------------------------------------------------------
+void qMRMLSequenceBrowserSeekWidget::onSliderPressed()
+{
+  Q_D(qMRMLSequenceBrowserSeekWidget);
+  if (d->ScrubbingEnabled && d->ScrubbingPreviewEnabled && d->SequenceBrowserNode != NULL)
+  {
+    d->SequenceBrowserNode->SetScrubbingActive(true);
+    d->ScrubbingPreviewSet = true;
+  }
+}
+
+//-----------------------------------------------------------------------------
+void qMRMLSequenceBrowserSeekWidget::onSliderReleased()
+{
+  Q_D(qMRMLSequenceBrowserSeekWidget);
+  d->PendingSeekTimer.stop();
+  if (d->SequenceBrowserNode == NULL)
+  {
+    return;
+  }
+  // Select the final position and show the full item in one update
+  int wasModified = d->SequenceBrowserNode->StartModify();
+  if (d->ScrubbingPreviewSet)
+  {
+    d->SequenceBrowserNode->SetScrubbingActive(false);
+    d->ScrubbingPreviewSet = false;
+  }
+  this->setSelectedItemNumber(d->slider_IndexValue->value());
+  d->SequenceBrowserNode->EndModify(wasModified);
+}
+
+//-----------------------------------------------------------------------------
+void qMRMLSequenceBrowserSeekWidget::applyPendingSeek()
+{
+  Q_D(qMRMLSequenceBrowserSeekWidget);
+  if (d->SequenceBrowserNode == NULL)
+  {
+    return;
+  }
+  this->setSelectedItemNumber(d->PendingItemNumber);
+}
+
 //-----------------------------------------------------------------------------
 void qMRMLSequenceBrowserSeekWidget::onIndexDisplayFormatModified()
 {
@@ -191,7 +318,11 @@ void qMRMLSequenceBrowserSeekWidget::updateWidgetFromMRML()
     d->label_IndexUnit->setText(indexUnit);
 
     d->label_IndexValue->setFixedWidth(std::max(fontMetrics.width(indexValue), d->label_IndexValue->width()));
-    d->slider_IndexValue->setValue(selectedItemNumber);
+    if (!d->slider_IndexValue->isSliderDown())
+    {
+      // While dragging, the slider is ahead of the selected item, do not move it back
+      d->slider_IndexValue->setValue(selectedItemNumber);
+    }
   }
   else
   {
@@ -48,14 +48,27 @@ public:
   /// This allows fine-tuning of parameters such as page step.
   Q_INVOKABLE QSlider* slider() const;
 
+  /// Scrubbing: while the slider is dragged, only the latest requested item is selected
+  /// (intermediate positions are skipped if proxy node update cannot keep up with the mouse). Enabled by default.
+  Q_INVOKABLE bool scrubbingEnabled() const;
+  /// Show a fast preview while dragging the slider (see vtkMRMLSequenceBrowserNode::SetScrubbingActive)
+  /// and the full item when the slider is released. Disabled by default.
+  Q_INVOKABLE bool scrubbingPreviewEnabled() const;
+
 public slots:
   void setMRMLSequenceBrowserNode(vtkMRMLNode* browserNode);
   void setMRMLSequenceBrowserNode(vtkMRMLSequenceBrowserNode* browserNode);
   void setSelectedItemNumber(int itemNumber);
+  void setScrubbingEnabled(bool enabled);
+  void setScrubbingPreviewEnabled(bool enabled);
 
 protected slots:
   void onIndexDisplayFormatModified();
   void updateWidgetFromMRML();
+  void onSliderValueChanged(int itemNumber);
+  void onSliderPressed();
+  void onSliderReleased();
+  void applyPendingSeek();
 
 protected:
   QScopedPointer<qMRMLSequenceBrowserSeekWidgetPrivate> d_ptr;
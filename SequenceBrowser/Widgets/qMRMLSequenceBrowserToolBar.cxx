@@ -88,6 +88,8 @@ void qMRMLSequenceBrowserToolBarPrivate::init()
   this->SequenceBrowserPlayWidget->setPlayPauseShortcut("Ctrl+Shift+Down");
   this->SequenceBrowserPlayWidget->setPreviousFrameShortcut("Ctrl+Shift+Left");
   this->SequenceBrowserPlayWidget->setNextFrameShortcut("Ctrl+Shift+Right");
+  this->SequenceBrowserPlayWidget->setPreviousRowShortcut("Ctrl+Shift+PgUp");
+  this->SequenceBrowserPlayWidget->setNextRowShortcut("Ctrl+Shift+PgDown");
 
   QObject::connect( this->SequenceBrowserNodeSelector, SIGNAL(currentNodeChanged(vtkMRMLNode*)), this->SequenceBrowserPlayWidget, SLOT(setMRMLSequenceBrowserNode(vtkMRMLNode*)) );
   QObject::connect( this->SequenceBrowserNodeSelector, SIGNAL(currentNodeChanged(vtkMRMLNode*)), this->SequenceBrowserSeekWidget, SLOT(setMRMLSequenceBrowserNode(vtkMRMLNode*)) );
@@ -37,7 +37,13 @@
 
 #include "vtkMRMLSequenceBrowserNode.h"
 
-static const double UPDATE_VIRTUAL_OUTPUT_NODES_PERIOD_SEC = 0.020; // refresh output with a maximum of 50FPS
+// VTK includes
+#include <vtkCommand.h>
+#include <vtkTimerLog.h>
+
+// STD includes
+#include <algorithm>
+#include <cmath>
 
 //-----------------------------------------------------------------------------
 #if (QT_VERSION < QT_VERSION_CHECK(5, 0, 0))
@@ -56,7 +62,10 @@ public:
 
   qSlicerSequenceBrowserModulePrivate();
   virtual ~qSlicerSequenceBrowserModulePrivate();
+  /// Single-shot timer that fires when the next proxy node update is due (see vtkSlicerSequenceBrowserLogic::GetNextUpdateTimeSec).
+  /// It is not running when no browser node is playing or recording.
   QTimer UpdateAllVirtualOutputNodesTimer;
+  bool UpdateAllVirtualOutputNodesInProgress;
   qMRMLSequenceBrowserToolBar* ToolBar;
   bool SequenceBrowserModuleOwnsToolBar;
   bool AutoShowToolBar;
@@ -67,7 +76,8 @@ public:
 
 //-----------------------------------------------------------------------------
 qSlicerSequenceBrowserModulePrivate::qSlicerSequenceBrowserModulePrivate()
-: SequenceBrowserModuleOwnsToolBar(true)
+: UpdateAllVirtualOutputNodesInProgress(false)
+, SequenceBrowserModuleOwnsToolBar(true)
 , AutoShowToolBar(true)
 {
   this->ToolBar = new qMRMLSequenceBrowserToolBar;
@@ -137,6 +147,10 @@ qSlicerSequenceBrowserModule::qSlicerSequenceBrowserModule(QObject* _parent)
   Q_D(qSlicerSequenceBrowserModule);
 
   d->UpdateAllVirtualOutputNodesTimer.setSingleShot(true);
+#if (QT_VERSION >= QT_VERSION_CHECK(5, 0, 0))
+  // Default coarse timer may fire up to 5% of the interval late, which would make playback rate inaccurate
+  d->UpdateAllVirtualOutputNodesTimer.setTimerType(Qt::PreciseTimer);
+#endif
   connect(&d->UpdateAllVirtualOutputNodesTimer, SIGNAL(timeout()), this, SLOT(updateAllVirtualOutputNodes()));
 
   vtkMRMLScene* scene = qSlicerCoreApplication::application()->mrmlScene();
@@ -217,6 +231,15 @@ void qSlicerSequenceBrowserModule::setMRMLScene(vtkMRMLScene* scene)
   this->qvtkReconnect(oldScene, scene, vtkMRMLScene::NodeRemovedEvent, this, SLOT(onNodeRemovedEvent(vtkObject*,vtkObject*)));
 
   d->ToolBar->setMRMLScene(scene);
+
+  // Observe browser nodes that are already in the scene
+  std::vector< vtkMRMLNode* > browserNodes;
+  scene->GetNodesByClass("vtkMRMLSequenceBrowserNode", browserNodes);
+  for (std::vector< vtkMRMLNode* >::iterator browserNodeIt = browserNodes.begin(); browserNodeIt != browserNodes.end(); ++browserNodeIt)
+    {
+    this->qvtkReconnect(*browserNodeIt, vtkCommand::ModifiedEvent, this, SLOT(scheduleNextUpdate()));
+    }
+  this->scheduleNextUpdate();
 }
 
 //-----------------------------------------------------------------------------
@@ -240,11 +263,9 @@ void qSlicerSequenceBrowserModule::onNodeAddedEvent(vtkObject*, vtkObject* node)
   vtkMRMLSequenceBrowserNode* sequenceBrowserNode = vtkMRMLSequenceBrowserNode::SafeDownCast(node);
   if (sequenceBrowserNode)
     {
-    // If the timer is not active, so it should be turned on
-    if (!d->UpdateAllVirtualOutputNodesTimer.isActive())
-      {
-      d->UpdateAllVirtualOutputNodesTimer.start(UPDATE_VIRTUAL_OUTPUT_NODES_PERIOD_SEC*1000.0);
-      }
+    // Playback or recording may be started any time, by modifying the browser node
+    this->qvtkReconnect(sequenceBrowserNode, vtkCommand::ModifiedEvent, this, SLOT(scheduleNextUpdate()));
+    this->scheduleNextUpdate();
     }
 }
 
@@ -256,19 +277,9 @@ void qSlicerSequenceBrowserModule::onNodeRemovedEvent(vtkObject*, vtkObject* nod
   vtkMRMLSequenceBrowserNode* sequenceBrowserNode = vtkMRMLSequenceBrowserNode::SafeDownCast(node);
   if (sequenceBrowserNode)
     {
-    // Check if there is any other sequence browser node left in the Scene
-    vtkMRMLScene* scene = qSlicerCoreApplication::application()->mrmlScene();
-    if (scene)
-      {
-      vtkMRMLNode* node;
-      node = this->mrmlScene()->GetFirstNodeByClass("vtkMRMLSequenceBrowserNode");
-      if (!node)
-        {
-        // The last sequence browser was removed, so
-        // turn off timer refresh and stop any pending timers
-        d->UpdateAllVirtualOutputNodesTimer.stop();
-        }
-      }
+    this->qvtkDisconnect(sequenceBrowserNode, vtkCommand::ModifiedEvent, this, SLOT(scheduleNextUpdate()));
+    // If no other browser node is playing or recording then the timer is stopped
+    this->scheduleNextUpdate();
     }
 }
 
@@ -286,9 +297,11 @@ void qSlicerSequenceBrowserModule::updateAllVirtualOutputNodes()
     {
       application->pauseRender();
     }
-    // update proxies then request another singleShot timer
+    // update proxies then schedule the next update
+    d->UpdateAllVirtualOutputNodesInProgress = true;
     sequenceBrowserLogic->UpdateAllProxyNodes();
-    d->UpdateAllVirtualOutputNodesTimer.start(UPDATE_VIRTUAL_OUTPUT_NODES_PERIOD_SEC*1000.0);
+    d->UpdateAllVirtualOutputNodesInProgress = false;
+    this->scheduleNextUpdate();
     if (application)
     {
       application->resumeRender();
@@ -296,6 +309,29 @@ void qSlicerSequenceBrowserModule::updateAllVirtualOutputNodes()
   }
 }
 
+//-----------------------------------------------------------------------------
+void qSlicerSequenceBrowserModule::scheduleNextUpdate()
+{
+  Q_D(qSlicerSequenceBrowserModule);
+  if (d->UpdateAllVirtualOutputNodesInProgress)
+  {
+    // browser nodes are modified during update, the next update is scheduled when the update is completed
+    return;
+  }
+  vtkSlicerSequenceBrowserLogic* sequenceBrowserLogic = vtkSlicerSequenceBrowserLogic::SafeDownCast(this->logic());
+  double nextUpdateTimeSec = (sequenceBrowserLogic ? sequenceBrowserLogic->GetNextUpdateTimeSec() : -1.0);
+  if (nextUpdateTimeSec < 0)
+  {
+    // nothing is playing or recording, no need to wake up
+    d->UpdateAllVirtualOutputNodesTimer.stop();
+    return;
+  }
+  // Round up, so that the timer does not fire before the update is due
+  double delaySec = nextUpdateTimeSec - vtkTimerLog::GetUniversalTime();
+  int delayMsec = std::max(0, static_cast<int>(ceil(delaySec * 1000.0)));
+  d->UpdateAllVirtualOutputNodesTimer.start(delayMsec);
+}
+
 //-----------------------------------------------------------------------------
 qMRMLSequenceBrowserToolBar* qSlicerSequenceBrowserModule::toolBar()
 {
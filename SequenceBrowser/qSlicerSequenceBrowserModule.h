@@ -97,6 +97,9 @@ public slots:
   void onNodeAddedEvent(vtkObject*, vtkObject*);
   void onNodeRemovedEvent(vtkObject*, vtkObject*);
   void updateAllVirtualOutputNodes();
+  /// Start the update timer so that it fires when the next update is due, or stop it if no update is needed.
+  /// Called when a browser node is added, removed, or modified (e.g., playback or recording is started).
+  void scheduleNextUpdate();
 
   void setToolBarActiveBrowserNode(vtkMRMLSequenceBrowserNode* browserNode);
 
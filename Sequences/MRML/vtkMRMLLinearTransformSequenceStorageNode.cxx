@@ -34,6 +34,9 @@ or http://www.slicer.org/copyright/copyright.txt for details.
 static const int MAX_LINE_LENGTH = 1000;
 static std::string SEQMETA_FIELD_FRAME_FIELD_PREFIX = "Seq_Frame";
 static std::string SEQMETA_FIELD_IMG_STATUS = "ImageStatus";
+static std::string SEQMETA_FIELD_STATUS_POSTFIX = "Status";
+// Per-frame transform status is stored in this item attribute of transform sequences
+static std::string TRANSFORM_STATUS_ATTRIBUTE_NAME = "Sequences.TransformStatus";
 
 // Constants for creating nodes
 static const char NODE_BASE_NAME_SEPARATOR[] = "-";
@@ -107,6 +110,8 @@ int vtkMRMLLinearTransformSequenceStorageNode::ReadSequenceFileTransforms(const
   // The nodes are not added immediately to the scene to allow them properly named, using the timestamp index value.
   // Maps the frame number to a vector of transform nodes that belong to that frame.
   std::map<int, std::vector<vtkMRMLLinearTransformNode*> > importedTransformNodes;
+  // Status of each transform (name ending with "Transform") in each frame
+  std::map<int, std::map<std::string, std::string> > importedTransformStatuses;
 
   // It contains the largest frame number. It will be used to iterate through all the frame numbers from 0 to lastFrameNumber
   int lastFrameNumber = -1;
@@ -224,6 +229,15 @@ int vtkMRMLLinearTransformSequenceStorageNode::ReadSequenceFileTransforms(const
       currentTransform->SetName(frameFieldName.c_str());
       importedTransformNodes[frameNumber].push_back(currentTransform);
     }
+    else if (frameFieldName.find("Transform") != std::string::npos
+      && frameFieldName.length() > SEQMETA_FIELD_STATUS_POSTFIX.length()
+      && frameFieldName.compare(frameFieldName.length() - SEQMETA_FIELD_STATUS_POSTFIX.length(),
+      SEQMETA_FIELD_STATUS_POSTFIX.length(), SEQMETA_FIELD_STATUS_POSTFIX) == 0)
+    {
+      // CustomTransformStatus => status of CustomTransform
+      std::string transformFieldName = frameFieldName.substr(0, frameFieldName.length() - SEQMETA_FIELD_STATUS_POSTFIX.length());
+      importedTransformStatuses[frameNumber][transformFieldName] = value;
+    }
 
     if (frameFieldName.compare("Timestamp") == 0)
     {
@@ -261,6 +275,7 @@ int vtkMRMLLinearTransformSequenceStorageNode::ReadSequenceFileTransforms(const
       continue;
     }
     std::string paramValueString = frameNumberToIndexValueMap[currentFrameNumber];
+    std::map<std::string, std::string>& transformStatusesForCurrentFrame = importedTransformStatuses[currentFrameNumber];
     for (std::vector<vtkMRMLLinearTransformNode*>::iterator transformIt = transformsForCurrentFrame->second.begin(); transformIt != transformsForCurrentFrame->second.end(); ++transformIt)
     {
       vtkMRMLLinearTransformNode* transform = (*transformIt);
@@ -299,6 +314,8 @@ int vtkMRMLLinearTransformSequenceStorageNode::ReadSequenceFileTransforms(const
         // Save transform name to Sequences.Source attribute so that modules can
         // find a transform by matching the original the transform name.
         transformsSequenceNode->SetAttribute("Sequences.Source", transformName.c_str());
+        // Transform status is stored compactly in the item attribute store instead of in each transform node
+        transformsSequenceNode->AddItemAttributeName(TRANSFORM_STATUS_ATTRIBUTE_NAME);
 
         transformSequenceNodes[transform->GetName()] = transformsSequenceNode;
       }
@@ -307,6 +324,11 @@ int vtkMRMLLinearTransformSequenceStorageNode::ReadSequenceFileTransforms(const
         transformsSequenceNode = transformSequenceNodes[transform->GetName()];
       }
       transform->SetHideFromEditors(false);
+      std::map<std::string, std::string>::iterator transformStatusIt = transformStatusesForCurrentFrame.find(transform->GetName());
+      if (transformStatusIt != transformStatusesForCurrentFrame.end())
+      {
+        transform->SetAttribute(TRANSFORM_STATUS_ATTRIBUTE_NAME.c_str(), transformStatusIt->second.c_str());
+      }
       // Generating a unique name is important because that will be used to generate the filename by default
       std::ostringstream nameStr;
       nameStr << transform->GetName() << "_" << std::setw(4) << std::setfill('0') << currentFrameNumber << std::ends;
@@ -444,13 +466,16 @@ bool vtkMRMLLinearTransformSequenceStorageNode::WriteSequenceMetafileTransforms(
 
       std::string transformValue = "1 0 0 0 0 1 0 0 0 0 1 0 0 0 0 1"; // Identity
       std::string transformStatus = "INVALID";
-      vtkMRMLTransformNode* transformNode = vtkMRMLTransformNode::SafeDownCast(currSequenceNode->GetDataNodeAtValue(indexValue.c_str()));
+      int itemNumber = currSequenceNode->GetItemNumberFromIndexValue(indexValue);
+      vtkMRMLTransformNode* transformNode = (itemNumber >= 0 ? vtkMRMLTransformNode::SafeDownCast(currSequenceNode->GetNthDataNode(itemNumber)) : NULL);
       if (transformNode != NULL && transformNode->IsLinear())
       {
         vtkNew<vtkMatrix4x4> matrix;
         transformNode->GetMatrixTransformToParent(matrix.GetPointer());
         transformValue = vtkAddonMathUtilities::ToString(matrix.GetPointer());
-        transformStatus = "OK";
+        // Keep the status that was read from file (a transform may be stored with INVALID status)
+        const char* storedTransformStatus = currSequenceNode->GetNthItemAttribute(itemNumber, TRANSFORM_STATUS_ATTRIBUTE_NAME);
+        transformStatus = (storedTransformStatus != NULL ? storedTransformStatus : "OK");
       }
 
       headerOutStream << SEQMETA_FIELD_FRAME_FIELD_PREFIX << std::setw(4) << frameNumber << std::setw(0);
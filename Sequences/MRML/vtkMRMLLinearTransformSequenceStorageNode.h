@@ -56,6 +56,7 @@ class VTK_SLICER_SEQUENCES_MODULE_MRML_EXPORT vtkMRMLLinearTransformSequenceStor
   /// Read all the fields in the metaimage file header.
   /// If sequence nodes are passed in createdNodes then they will be reused. New sequence nodes will be created if there are more transforms
   /// in the sequence metafile than pointers in createdNodes. The caller is responsible for deleting all nodes in createdNodes.
+  /// Per-frame transform status (OK, INVALID, ...) is stored in the "Sequences.TransformStatus" item attribute.
   /// Return number of created transform nodes.
   static int ReadSequenceFileTransforms(const std::string& fileName, vtkMRMLScene *scene,
     std::deque< vtkSmartPointer<vtkMRMLSequenceNode> > &createdNodes, std::map< int, std::string >& frameNumberToIndexValueMap,
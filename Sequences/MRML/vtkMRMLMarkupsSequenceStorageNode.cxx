@@ -0,0 +1,459 @@
+/*=auto=========================================================================
+
+Portions (c) Copyright 2005 Brigham and Women's Hospital (BWH) All Rights Reserved.
+
+See COPYRIGHT.txt
+or http://www.slicer.org/copyright/copyright.txt for details.
+
+=========================================================================auto=*/
+
+// STD includes
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <map>
+#include <sstream>
+#include <vector>
+
+#include "vtkMRMLMarkupsSequenceStorageNode.h"
+
+#include "vtkMRMLMarkupsFiducialNode.h"
+#include "vtkMRMLSequenceNode.h"
+
+#include "vtkObjectFactory.h"
+#include "vtkSmartPointer.h"
+#include "vtkStringArray.h"
+
+// Constants for reading and writing markups sequence files
+static const char MARKUPS_SEQUENCE_FILE_HEADER[] = "# Markups sequence file version = 1";
+static const char MARKUPS_SEQUENCE_CLASS_NAME_FIELD[] = "# className = ";
+static const char MARKUPS_SEQUENCE_ITEM_TAG[] = "item";
+static const char MARKUPS_SEQUENCE_MARKUP_TAG[] = "markup";
+static const char MARKUPS_SEQUENCE_ATTRIBUTE_TAG[] = "attribute";
+static const char MARKUPS_SEQUENCE_SEPARATOR = ',';
+// item, indexValue, name, locked, labelFormat
+static const int MARKUPS_SEQUENCE_NUMBER_OF_ITEM_FIELDS = 5;
+// markup, id, label, description, associatedNodeID, selected, locked, visibility, orientationWXYZ (4), numberOfPoints
+static const int MARKUPS_SEQUENCE_NUMBER_OF_MARKUP_FIELDS = 12;
+// attribute, name, value
+static const int MARKUPS_SEQUENCE_NUMBER_OF_ATTRIBUTE_FIELDS = 3;
+
+//----------------------------------------------------------------------------
+vtkMRMLNodeNewMacro(vtkMRMLMarkupsSequenceStorageNode);
+
+//----------------------------------------------------------------------------
+vtkMRMLMarkupsSequenceStorageNode::vtkMRMLMarkupsSequenceStorageNode()
+{
+}
+
+//----------------------------------------------------------------------------
+vtkMRMLMarkupsSequenceStorageNode::~vtkMRMLMarkupsSequenceStorageNode()
+{
+}
+
+//----------------------------------------------------------------------------
+bool vtkMRMLMarkupsSequenceStorageNode::CanReadInReferenceNode(vtkMRMLNode *refNode)
+{
+  vtkMRMLSequenceNode* sequenceNode = vtkMRMLSequenceNode::SafeDownCast(refNode);
+  if (sequenceNode == NULL)
+  {
+    return false;
+  }
+  if (sequenceNode->GetNumberOfDataNodes() == 0)
+  {
+    // Empty sequence, it will contain markups after reading
+    return true;
+  }
+  // All items are of the same class
+  vtkMRMLNode* dataNode = sequenceNode->GetNthDataNode(0);
+  return dataNode != NULL && dataNode->IsA("vtkMRMLMarkupsNode");
+}
+
+//----------------------------------------------------------------------------
+/// Escape characters that would break the line and field structure of the file
+static std::string EncodeField(const std::string& value)
+{
+  std::string encoded;
+  for (std::string::const_iterator it = value.begin(); it != value.end(); ++it)
+  {
+    switch (*it)
+    {
+    case '%': encoded += "%25"; break;
+    case ',': encoded += "%2C"; break;
+    case '\n': encoded += "%0A"; break;
+    case '\r': encoded += "%0D"; break;
+    default: encoded += *it;
+    }
+  }
+  return encoded;
+}
+
+//----------------------------------------------------------------------------
+static std::string DecodeField(const std::string& value)
+{
+  std::string decoded;
+  for (size_t i = 0; i < value.size(); i++)
+  {
+    if (value[i] == '%' && i + 2 < value.size())
+    {
+      decoded += static_cast<char>(strtol(value.substr(i + 1, 2).c_str(), NULL, 16));
+      i += 2;
+    }
+    else
+    {
+      decoded += value[i];
+    }
+  }
+  return decoded;
+}
+
+//----------------------------------------------------------------------------
+static void SplitFields(const std::string& line, std::vector<std::string>& fields)
+{
+  fields.clear();
+  std::stringstream lineStream(line);
+  std::string field;
+  while (std::getline(lineStream, field, MARKUPS_SEQUENCE_SEPARATOR))
+  {
+    fields.push_back(DecodeField(field));
+  }
+  if (!line.empty() && line[line.size() - 1] == MARKUPS_SEQUENCE_SEPARATOR)
+  {
+    // getline does not report the last field if it is empty
+    fields.push_back("");
+  }
+}
+
+//----------------------------------------------------------------------------
+int vtkMRMLMarkupsSequenceStorageNode::ReadDataInternal(vtkMRMLNode* refNode)
+{
+  if (!this->CanReadInReferenceNode(refNode))
+  {
+    return 0;
+  }
+
+  vtkMRMLSequenceNode* seqNode = vtkMRMLSequenceNode::SafeDownCast(refNode);
+  if (!seqNode)
+  {
+    vtkErrorMacro("ReadDataInternal: not a Sequence node.");
+    return 0;
+  }
+
+  std::string fullName = this->GetFullNameFromFileName();
+  if (fullName == std::string(""))
+  {
+    vtkErrorMacro("ReadData: File name not specified");
+    return 0;
+  }
+
+  std::ifstream inStream(fullName.c_str(), std::ios_base::binary);
+  if (!inStream.is_open())
+  {
+    vtkErrorMacro("vtkMRMLMarkupsSequenceStorageNode::ReadDataInternal failed: cannot open file " << fullName);
+    return 0;
+  }
+
+  std::string line;
+  if (!std::getline(inStream, line) || line.compare(0, strlen(MARKUPS_SEQUENCE_FILE_HEADER), MARKUPS_SEQUENCE_FILE_HEADER) != 0)
+  {
+    vtkErrorMacro("vtkMRMLMarkupsSequenceStorageNode::ReadDataInternal failed: " << fullName << " is not a markups sequence file");
+    return 0;
+  }
+
+  int wasModifying = seqNode->StartModify();
+
+  // RemoveAllDataNodes clears the item attribute store, which is read from the scene file (not from this file)
+  // before the data is read. Values are saved by index value and restored for the items that are read,
+  // unless the file specifies the attribute for the item.
+  std::vector<std::string> itemAttributeNames = seqNode->GetItemAttributeNames();
+  std::map< std::string, std::map<std::string, std::string> > itemAttributes;
+  for (int itemIndex = 0; itemIndex < seqNode->GetNumberOfDataNodes(); itemIndex++)
+  {
+    for (std::vector<std::string>::iterator nameIt = itemAttributeNames.begin(); nameIt != itemAttributeNames.end(); ++nameIt)
+    {
+      const char* value = seqNode->GetNthItemAttribute(itemIndex, *nameIt);
+      if (value != NULL)
+      {
+        itemAttributes[seqNode->GetNthIndexValue(itemIndex)][*nameIt] = value;
+      }
+    }
+  }
+  seqNode->RemoveAllDataNodes();
+  // Attributes of the read nodes that have an item attribute column are moved into the store by SetDataNodeAtValue
+  for (std::vector<std::string>::iterator nameIt = itemAttributeNames.begin(); nameIt != itemAttributeNames.end(); ++nameIt)
+  {
+    seqNode->AddItemAttributeName(*nameIt);
+  }
+
+  // Items are added to the sequence when the next item starts or the file ends,
+  // because SetDataNodeAtValue stores a copy of the node.
+  vtkSmartPointer<vtkMRMLMarkupsNode> itemNode;
+  std::string itemIndexValue;
+  std::vector<std::string> fields;
+  bool success = true;
+  while (std::getline(inStream, line))
+  {
+    if (!line.empty() && line[line.size() - 1] == '\r')
+    {
+      line.erase(line.size() - 1);
+    }
+    if (line.empty())
+    {
+      continue;
+    }
+    if (line.compare(0, strlen(MARKUPS_SEQUENCE_CLASS_NAME_FIELD), MARKUPS_SEQUENCE_CLASS_NAME_FIELD) == 0)
+    {
+      std::string className = line.substr(strlen(MARKUPS_SEQUENCE_CLASS_NAME_FIELD));
+      if (className != "vtkMRMLMarkupsFiducialNode")
+      {
+        vtkErrorMacro("vtkMRMLMarkupsSequenceStorageNode::ReadDataInternal failed: unsupported node class " << className);
+        success = false;
+        break;
+      }
+      continue;
+    }
+    if (line[0] == '#')
+    {
+      // comment
+      continue;
+    }
+    SplitFields(line, fields);
+    if (fields[0] == MARKUPS_SEQUENCE_ITEM_TAG)
+    {
+      if (fields.size() < MARKUPS_SEQUENCE_NUMBER_OF_ITEM_FIELDS)
+      {
+        vtkErrorMacro("vtkMRMLMarkupsSequenceStorageNode::ReadDataInternal failed: invalid item line: " << line);
+        success = false;
+        break;
+      }
+      if (itemNode.GetPointer() != NULL)
+      {
+        seqNode->SetDataNodeAtValue(itemNode, itemIndexValue);
+      }
+      itemNode = vtkSmartPointer<vtkMRMLMarkupsFiducialNode>::New();
+      itemIndexValue = fields[1];
+      itemNode->SetName(fields[2].c_str());
+      itemNode->SetLocked(atoi(fields[3].c_str()));
+      itemNode->SetMarkupLabelFormat(fields[4]);
+    }
+    else if (fields[0] == MARKUPS_SEQUENCE_MARKUP_TAG)
+    {
+      int numberOfPoints = (fields.size() >= MARKUPS_SEQUENCE_NUMBER_OF_MARKUP_FIELDS ? atoi(fields[11].c_str()) : -1);
+      if (itemNode.GetPointer() == NULL || numberOfPoints < 0
+        || fields.size() != static_cast<size_t>(MARKUPS_SEQUENCE_NUMBER_OF_MARKUP_FIELDS + numberOfPoints * 3))
+      {
+        vtkErrorMacro("vtkMRMLMarkupsSequenceStorageNode::ReadDataInternal failed: invalid markup line: " << line);
+        success = false;
+        break;
+      }
+      Markup markup;
+      itemNode->InitMarkup(&markup);
+      markup.ID = fields[1];
+      markup.Label = fields[2];
+      markup.Description = fields[3];
+      markup.AssociatedNodeID = fields[4];
+      markup.Selected = (atoi(fields[5].c_str()) != 0);
+      markup.Locked = (atoi(fields[6].c_str()) != 0);
+      markup.Visibility = (atoi(fields[7].c_str()) != 0);
+      for (int i = 0; i < 4; i++)
+      {
+        markup.OrientationWXYZ[i] = atof(fields[8 + i].c_str());
+      }
+      markup.points.clear();
+      for (int pointIndex = 0; pointIndex < numberOfPoints; pointIndex++)
+      {
+        int fieldIndex = MARKUPS_SEQUENCE_NUMBER_OF_MARKUP_FIELDS + pointIndex * 3;
+        markup.points.push_back(vtkVector3d(atof(fields[fieldIndex].c_str()),
+          atof(fields[fieldIndex + 1].c_str()), atof(fields[fieldIndex + 2].c_str())));
+      }
+      itemNode->AddMarkup(markup);
+    }
+    else if (fields[0] == MARKUPS_SEQUENCE_ATTRIBUTE_TAG)
+    {
+      if (itemNode.GetPointer() == NULL || fields.size() != MARKUPS_SEQUENCE_NUMBER_OF_ATTRIBUTE_FIELDS)
+      {
+        vtkErrorMacro("vtkMRMLMarkupsSequenceStorageNode::ReadDataInternal failed: invalid attribute line: " << line);
+        success = false;
+        break;
+      }
+      itemNode->SetAttribute(fields[1].c_str(), fields[2].c_str());
+    }
+    else
+    {
+      vtkWarningMacro("vtkMRMLMarkupsSequenceStorageNode::ReadDataInternal: ignored unknown line: " << line);
+    }
+  }
+  if (success && itemNode.GetPointer() != NULL)
+  {
+    seqNode->SetDataNodeAtValue(itemNode, itemIndexValue);
+  }
+  for (int itemIndex = 0; itemIndex < seqNode->GetNumberOfDataNodes(); itemIndex++)
+  {
+    std::map< std::string, std::map<std::string, std::string> >::iterator itemIt = itemAttributes.find(seqNode->GetNthIndexValue(itemIndex));
+    if (itemIt == itemAttributes.end())
+    {
+      continue;
+    }
+    for (std::map<std::string, std::string>::iterator attributeIt = itemIt->second.begin(); attributeIt != itemIt->second.end(); ++attributeIt)
+    {
+      if (seqNode->GetNthItemAttribute(itemIndex, attributeIt->first) == NULL)
+      {
+        seqNode->SetNthItemAttribute(itemIndex, attributeIt->first, attributeIt->second.c_str());
+      }
+    }
+  }
+  seqNode->EndModify(wasModifying);
+
+  return success ? 1 : 0;
+}
+
+//----------------------------------------------------------------------------
+bool vtkMRMLMarkupsSequenceStorageNode::CanWriteFromReferenceNode(vtkMRMLNode *refNode)
+{
+  vtkMRMLSequenceNode* sequenceNode = vtkMRMLSequenceNode::SafeDownCast(refNode);
+  if (sequenceNode == NULL)
+  {
+    vtkErrorMacro("vtkMRMLMarkupsSequenceStorageNode::CanWriteFromReferenceNode: input is not a sequence node");
+    return false;
+  }
+  int numberOfDataNodes = sequenceNode->GetNumberOfDataNodes();
+  for (int itemIndex = 0; itemIndex < numberOfDataNodes; itemIndex++)
+  {
+    vtkMRMLNode* dataNode = sequenceNode->GetNthDataNode(itemIndex);
+    // Other markups types may have additional properties that are not stored in this file format
+    if (dataNode == NULL || strcmp(dataNode->GetClassName(), "vtkMRMLMarkupsFiducialNode") != 0)
+    {
+      vtkDebugMacro("vtkMRMLMarkupsSequenceStorageNode::CanWriteFromReferenceNode: only markups fiducial nodes can be written (item " << itemIndex << ")");
+      return false;
+    }
+  }
+  return true;
+}
+
+//----------------------------------------------------------------------------
+int vtkMRMLMarkupsSequenceStorageNode::WriteDataInternal(vtkMRMLNode *refNode)
+{
+  vtkMRMLSequenceNode* sequenceNode = vtkMRMLSequenceNode::SafeDownCast(refNode);
+  if (sequenceNode == NULL)
+  {
+    vtkErrorMacro(<< "vtkMRMLMarkupsSequenceStorageNode::WriteDataInternal: Do not recognize node type " << refNode->GetClassName());
+    return 0;
+  }
+
+  std::string fullName = this->GetFullNameFromFileName();
+  if (fullName == std::string(""))
+  {
+    vtkErrorMacro("WriteData: File name not specified");
+    return 0;
+  }
+
+  std::ofstream outStream(fullName.c_str(), std::ios_base::binary);
+  if (!outStream.is_open())
+  {
+    vtkErrorMacro("vtkMRMLMarkupsSequenceStorageNode::WriteDataInternal failed: cannot open file " << fullName);
+    return 0;
+  }
+  outStream << std::setprecision(17);
+  outStream << MARKUPS_SEQUENCE_FILE_HEADER << std::endl;
+  outStream << MARKUPS_SEQUENCE_CLASS_NAME_FIELD << "vtkMRMLMarkupsFiducialNode" << std::endl;
+  outStream << "# columns = item,indexValue,name,locked,labelFormat" << std::endl;
+  outStream << "# columns = attribute,name,value" << std::endl;
+  outStream << "# columns = markup,id,label,description,associatedNodeID,selected,locked,visibility,"
+    << "orientationW,orientationX,orientationY,orientationZ,numberOfPoints,x,y,z..." << std::endl;
+
+  const char sep = MARKUPS_SEQUENCE_SEPARATOR;
+  int numberOfDataNodes = sequenceNode->GetNumberOfDataNodes();
+  for (int itemIndex = 0; itemIndex < numberOfDataNodes; itemIndex++)
+  {
+    vtkMRMLMarkupsNode* markupsNode = vtkMRMLMarkupsNode::SafeDownCast(sequenceNode->GetNthDataNode(itemIndex));
+    if (markupsNode == NULL)
+    {
+      vtkErrorMacro("vtkMRMLMarkupsSequenceStorageNode::WriteDataInternal failed: item " << itemIndex << " is not a markups node");
+      return 0;
+    }
+    outStream << MARKUPS_SEQUENCE_ITEM_TAG
+      << sep << EncodeField(sequenceNode->GetNthIndexValue(itemIndex))
+      << sep << EncodeField(markupsNode->GetName() ? markupsNode->GetName() : "")
+      << sep << markupsNode->GetLocked()
+      << sep << EncodeField(markupsNode->GetMarkupLabelFormat())
+      << std::endl;
+    // MRML node attributes of the item and item attributes that are stored in the sequence node
+    std::map<std::string, std::string> attributes;
+    std::vector<std::string> attributeNames = markupsNode->GetAttributeNames();
+    for (std::vector<std::string>::iterator nameIt = attributeNames.begin(); nameIt != attributeNames.end(); ++nameIt)
+    {
+      attributes[*nameIt] = markupsNode->GetAttribute(nameIt->c_str());
+    }
+    const std::vector<std::string>& itemAttributeNames = sequenceNode->GetItemAttributeNames();
+    for (std::vector<std::string>::const_iterator nameIt = itemAttributeNames.begin(); nameIt != itemAttributeNames.end(); ++nameIt)
+    {
+      const char* value = sequenceNode->GetNthItemAttribute(itemIndex, *nameIt);
+      if (value != NULL)
+      {
+        attributes[*nameIt] = value;
+      }
+    }
+    for (std::map<std::string, std::string>::iterator attributeIt = attributes.begin(); attributeIt != attributes.end(); ++attributeIt)
+    {
+      outStream << MARKUPS_SEQUENCE_ATTRIBUTE_TAG
+        << sep << EncodeField(attributeIt->first)
+        << sep << EncodeField(attributeIt->second)
+        << std::endl;
+    }
+    int numberOfMarkups = markupsNode->GetNumberOfMarkups();
+    for (int markupIndex = 0; markupIndex < numberOfMarkups; markupIndex++)
+    {
+      Markup* markup = markupsNode->GetNthMarkup(markupIndex);
+      if (markup == NULL)
+      {
+        continue;
+      }
+      outStream << MARKUPS_SEQUENCE_MARKUP_TAG
+        << sep << EncodeField(markup->ID)
+        << sep << EncodeField(markup->Label)
+        << sep << EncodeField(markup->Description)
+        << sep << EncodeField(markup->AssociatedNodeID)
+        << sep << (markup->Selected ? 1 : 0)
+        << sep << (markup->Locked ? 1 : 0)
+        << sep << (markup->Visibility ? 1 : 0);
+      for (int i = 0; i < 4; i++)
+      {
+        outStream << sep << markup->OrientationWXYZ[i];
+      }
+      outStream << sep << markup->points.size();
+      for (std::vector<vtkVector3d>::iterator pointIt = markup->points.begin(); pointIt != markup->points.end(); ++pointIt)
+      {
+        outStream << sep << pointIt->GetX() << sep << pointIt->GetY() << sep << pointIt->GetZ();
+      }
+      outStream << std::endl;
+    }
+  }
+  outStream.close();
+  if (outStream.fail())
+  {
+    vtkErrorMacro("vtkMRMLMarkupsSequenceStorageNode::WriteDataInternal failed: error while writing " << fullName);
+    return 0;
+  }
+
+  this->StageWriteData(refNode);
+  return 1;
+}
+
+//----------------------------------------------------------------------------
+void vtkMRMLMarkupsSequenceStorageNode::InitializeSupportedReadFileTypes()
+{
+  this->SupportedReadFileTypes->InsertNextValue("Markups fiducial sequence (.seq.mkp.csv)");
+}
+
+//----------------------------------------------------------------------------
+void vtkMRMLMarkupsSequenceStorageNode::InitializeSupportedWriteFileTypes()
+{
+  this->SupportedWriteFileTypes->InsertNextValue("Markups fiducial sequence (.seq.mkp.csv)");
+}
+
+//----------------------------------------------------------------------------
+const char* vtkMRMLMarkupsSequenceStorageNode::GetDefaultWriteFileExtension()
+{
+  return "seq.mkp.csv";
+}
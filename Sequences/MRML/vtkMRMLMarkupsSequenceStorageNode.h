@@ -0,0 +1,71 @@
+/*=auto=========================================================================
+
+  Portions (c) Copyright 2005 Brigham and Women's Hospital (BWH) All Rights Reserved.
+
+  See COPYRIGHT.txt
+  or http://www.slicer.org/copyright/copyright.txt for details.
+
+=========================================================================auto=*/
+///  vtkMRMLMarkupsSequenceStorageNode - MRML node that can read/write
+///  a Sequence node containing markups fiducial lists in a single text file
+///
+/// All items are written into one file, one line per item and one line per markup,
+/// which is much more compact and faster to read and write than storing each item
+/// in a separate markups file.
+/// Stored item properties: name, locked state, markup label format, and for each markup:
+/// ID, label, description, associated node ID, states, orientation, and point positions.
+/// MRML node attributes of items and item attributes of the sequence (see vtkMRMLSequenceNode::SetNthItemAttribute)
+/// are stored as one line per attribute. When read into a sequence that has item attribute columns already
+/// (e.g., read from the scene file), attributes of these columns are put into the item attribute store.
+
+#ifndef __vtkMRMLMarkupsSequenceStorageNode_h
+#define __vtkMRMLMarkupsSequenceStorageNode_h
+
+#include "vtkSlicerSequencesModuleMRMLExport.h"
+
+#include "vtkMRMLStorageNode.h"
+
+/// \ingroup Slicer_QtModules_Sequences
+class VTK_SLICER_SEQUENCES_MODULE_MRML_EXPORT vtkMRMLMarkupsSequenceStorageNode : public vtkMRMLStorageNode
+{
+  public:
+
+  static vtkMRMLMarkupsSequenceStorageNode *New();
+  vtkTypeMacro(vtkMRMLMarkupsSequenceStorageNode,vtkMRMLStorageNode);
+
+  virtual vtkMRMLNode* CreateNodeInstance() override;
+
+  ///
+  /// Get node XML tag name (like Storage, Model)
+  virtual const char* GetNodeTagName() override {return "MarkupsSequenceStorage";};
+
+  /// Return true if the node can be read in.
+  /// Only empty sequences and sequences that contain markups nodes are supported.
+  virtual bool CanReadInReferenceNode(vtkMRMLNode *refNode) override;
+
+  /// Return true if the node can be written by using thie writer.
+  /// Only sequences that contain markups fiducial nodes are supported.
+  virtual bool CanWriteFromReferenceNode(vtkMRMLNode* refNode) override;
+  virtual int WriteDataInternal(vtkMRMLNode *refNode) override;
+
+  ///
+  /// Return a default file extension for writting
+  virtual const char* GetDefaultWriteFileExtension() override;
+
+protected:
+  vtkMRMLMarkupsSequenceStorageNode();
+  ~vtkMRMLMarkupsSequenceStorageNode();
+  vtkMRMLMarkupsSequenceStorageNode(const vtkMRMLMarkupsSequenceStorageNode&);
+  void operator=(const vtkMRMLMarkupsSequenceStorageNode&);
+
+  /// Does the actual reading. Returns 1 on success, 0 otherwise.
+  virtual int ReadDataInternal(vtkMRMLNode* refNode) override;
+
+  /// Initialize all the supported write file types
+  virtual void InitializeSupportedReadFileTypes() override;
+
+  /// Initialize all the supported write file types
+  virtual void InitializeSupportedWriteFileTypes() override;
+};
+
+#endif
@@ -35,6 +35,7 @@
 #include <vtkMRMLSliceCompositeNode.h>
 #include <vtkMRMLSliceNode.h>
 #include <vtkMRMLSegmentationNode.h>
+#include <vtkMRMLLinearTransformNode.h>
 #include <vtkMRMLTransformNode.h>
 #include <vtkMRMLVectorVolumeDisplayNode.h>
 #include <vtkMRMLViewNode.h>
@@ -43,9 +44,19 @@
 #include <vtkMRMLROINode.h>
 #include <vtkMRMLTextNode.h>
 #include <vtkMRMLVolumePropertyNode.h>
+#include <vtkCellArray.h>
+#include <vtkCellData.h>
 #include <vtkNew.h>
 #include <vtkObjectFactory.h>
+#include <vtkOrientedImageData.h>
+#include <vtkPointData.h>
+#include <vtkPoints.h>
 #include <vtkPolyData.h>
+#include <vtkSegment.h>
+
+// STD includes
+#include <algorithm>
+#include <cstring>
 
 // Sequence MRML includes
 #include <vtkMRMLSequenceNode.h>
@@ -58,6 +69,9 @@ vtkMRMLNodeSequencer::NodeSequencer::NodeSequencer()
   this->RecordingEvents->InsertNextValue(vtkCommand::ModifiedEvent);
   this->SupportedNodeClassName = "vtkMRMLNode";
   this->DefaultSequenceStorageNodeClassName = "vtkMRMLSequenceStorageNode";
+  this->OwnedDataObjectsCleanupSize = 0;
+  this->SharedDataObjectsCleanupSize = 0;
+  this->CopyPreservesNodeReferences = false;
 }
 
 vtkMRMLNodeSequencer::NodeSequencer::~NodeSequencer()
@@ -105,7 +119,57 @@ void vtkMRMLNodeSequencer::NodeSequencer::CopyNode(vtkMRMLNode* source, vtkMRMLN
   target->CopyWithSingleModifiedEvent(source);
 }
 
-vtkMRMLNode* vtkMRMLNodeSequencer::NodeSequencer::DeepCopyNodeToScene(vtkMRMLNode* source, vtkMRMLScene* scene)
+void vtkMRMLNodeSequencer::NodeSequencer::CopyNodeContent(vtkMRMLNode* source, vtkMRMLNode* target,
+  bool shallowCopy /* =false */, bool shareContent /* =false */)
+{
+  vtkMRMLNode* referenceStorageNode = NULL;
+  if (!this->CopyPreservesNodeReferences)
+  {
+    vtkSmartPointer<vtkMRMLNode>& storageNode = this->ReferenceStorageNodes[target->GetClassName()];
+    if (storageNode.GetPointer() == NULL)
+    {
+      storageNode = vtkSmartPointer<vtkMRMLNode>::Take(target->NewInstance());
+    }
+    referenceStorageNode = storageNode;
+    referenceStorageNode->CopyReferences(target);
+  }
+  if (shareContent)
+  {
+    this->ShareNodeContent(source, target);
+  }
+  else
+  {
+    this->CopyNode(source, target, shallowCopy);
+  }
+  if (referenceStorageNode)
+  {
+    target->CopyReferences(referenceStorageNode);
+    // Do not keep referenced node IDs in the storage node until the next copy
+    referenceStorageNode->RemoveNodeReferenceIDs(NULL);
+  }
+}
+
+bool vtkMRMLNodeSequencer::NodeSequencer::GetCopyPreservesNodeReferences()
+{
+  return this->CopyPreservesNodeReferences;
+}
+
+void vtkMRMLNodeSequencer::NodeSequencer::ShareNodeContent(vtkMRMLNode* source, vtkMRMLNode* target)
+{
+  this->CopyNode(source, target, false);
+}
+
+void vtkMRMLNodeSequencer::NodeSequencer::DetachNodeContent(vtkMRMLNode* vtkNotUsed(target))
+{
+}
+
+bool vtkMRMLNodeSequencer::NodeSequencer::IsNodeContentShared(vtkMRMLNode* vtkNotUsed(target))
+{
+  return false;
+}
+
+vtkMRMLNode* vtkMRMLNodeSequencer::NodeSequencer::DeepCopyNodeToScene(vtkMRMLNode* source, vtkMRMLScene* scene,
+  vtkMRMLNode* preallocatedTarget /* =NULL */)
 {
   if (source == NULL)
   {
@@ -123,8 +187,15 @@ vtkMRMLNode* vtkMRMLNodeSequencer::NodeSequencer::DeepCopyNodeToScene(vtkMRMLNod
   }
   std::string newNodeName = baseName;
 
-  vtkSmartPointer<vtkMRMLNode> target = vtkSmartPointer<vtkMRMLNode>::Take(source->CreateNodeInstance());
+  vtkSmartPointer<vtkMRMLNode> target = preallocatedTarget;
+  if (target.GetPointer() == NULL)
+  {
+    target = vtkSmartPointer<vtkMRMLNode>::Take(source->CreateNodeInstance());
+  }
   this->CopyNode(source, target, false);
+  // Sequence items are not updated by copying, therefore they are not kept in the owned data object registry
+  // (a preallocated target was registered when it was preallocated)
+  this->SetOwnedDataObject(target, NULL);
 
   // Generating unique node names is slow, and makes adding many nodes to a sequence too slow
   // We will instead ensure that all file names for storable nodes are unique when saving
@@ -135,6 +206,78 @@ vtkMRMLNode* vtkMRMLNodeSequencer::NodeSequencer::DeepCopyNodeToScene(vtkMRMLNod
   return addedTargetNode;
 }
 
+void vtkMRMLNodeSequencer::NodeSequencer::ShareIdenticalContent(vtkMRMLNode* vtkNotUsed(node), vtkMRMLNode* vtkNotUsed(referenceNode))
+{
+}
+
+bool vtkMRMLNodeSequencer::NodeSequencer::PrecopyNodeContent(vtkMRMLNode* vtkNotUsed(source), vtkMRMLNode* vtkNotUsed(target))
+{
+  return false;
+}
+
+bool vtkMRMLNodeSequencer::NodeSequencer::PrepareNodeContent(vtkMRMLNode* vtkNotUsed(source), vtkMRMLNode* vtkNotUsed(target))
+{
+  return false;
+}
+
+void vtkMRMLNodeSequencer::NodeSequencer::RecyclePreparedNodeContent(vtkMRMLNode* target, const std::vector<vtkMRMLNode*>& keptSources)
+{
+  std::lock_guard<std::mutex> lock(this->OwnedDataObjectsMutex);
+  std::map< vtkMRMLNode*, std::vector<PreparedDataObject> >::iterator preparedIt = this->PreparedDataObjects.find(target);
+  if (preparedIt == this->PreparedDataObjects.end())
+  {
+    return;
+  }
+  bool spareFound = false;
+  std::vector<PreparedDataObject>& preparedDataObjects = preparedIt->second;
+  for (std::vector<PreparedDataObject>::iterator preparedDataObjectIt = preparedDataObjects.begin();
+    preparedDataObjectIt != preparedDataObjects.end();)
+  {
+    if (preparedDataObjectIt->InProgress
+      || std::find(keptSources.begin(), keptSources.end(), preparedDataObjectIt->SourceNode) != keptSources.end())
+    {
+      ++preparedDataObjectIt;
+      continue;
+    }
+    if (spareFound || preparedDataObjectIt->DataObject.GetPointer() == NULL)
+    {
+      // one spare buffer is enough, as buffers are recycled at each update
+      preparedDataObjectIt = preparedDataObjects.erase(preparedDataObjectIt);
+      continue;
+    }
+    preparedDataObjectIt->SourceNode = NULL;
+    preparedDataObjectIt->SourceDataObject = NULL;
+    spareFound = true;
+    ++preparedDataObjectIt;
+  }
+}
+
+void vtkMRMLNodeSequencer::NodeSequencer::DiscardPreparedNodeContent(vtkMRMLNode* target)
+{
+  std::lock_guard<std::mutex> lock(this->OwnedDataObjectsMutex);
+  this->PreparedDataObjects.erase(target);
+}
+
+unsigned long vtkMRMLNodeSequencer::NodeSequencer::GetPreparedNodeContentMemorySize()
+{
+  std::lock_guard<std::mutex> lock(this->OwnedDataObjectsMutex);
+  unsigned long memorySizeKB = 0;
+  for (std::map< vtkMRMLNode*, std::vector<PreparedDataObject> >::iterator preparedIt = this->PreparedDataObjects.begin();
+    preparedIt != this->PreparedDataObjects.end(); ++preparedIt)
+  {
+    for (std::vector<PreparedDataObject>::iterator preparedDataObjectIt = preparedIt->second.begin();
+      preparedDataObjectIt != preparedIt->second.end(); ++preparedDataObjectIt)
+    {
+      vtkDataObject* dataObject = vtkDataObject::SafeDownCast(preparedDataObjectIt->DataObject);
+      if (dataObject)
+      {
+        memorySizeKB += dataObject->GetActualMemorySize();
+      }
+    }
+  }
+  return memorySizeKB;
+}
+
 void vtkMRMLNodeSequencer::NodeSequencer::AddDefaultDisplayNodes(vtkMRMLNode* node)
 {
   vtkMRMLDisplayableNode* displayableNode = vtkMRMLDisplayableNode::SafeDownCast(node);
@@ -166,53 +309,951 @@ void vtkMRMLNodeSequencer::NodeSequencer::AddDefaultSequenceStorageNode(vtkMRMLS
     return;
   }
 
-  vtkMRMLNode* storageNode = scene->AddNewNodeByClass(this->DefaultSequenceStorageNodeClassName);
-  if (storageNode == NULL)
+  vtkMRMLNode* storageNode = scene->AddNewNodeByClass(this->DefaultSequenceStorageNodeClassName);
+  if (storageNode == NULL)
+  {
+    return;
+  }
+  node->SetAndObserveStorageNodeID(storageNode->GetID());
+}
+
+std::string vtkMRMLNodeSequencer::NodeSequencer::GetDefaultSequenceStorageNodeClassName()
+{
+  return this->DefaultSequenceStorageNodeClassName;
+}
+
+void vtkMRMLNodeSequencer::NodeSequencer::CopyNodeAttributes(vtkMRMLNode* source, vtkMRMLNode* target)
+{
+  std::vector< std::string > preservedAttributeNames;
+  {
+    std::lock_guard<std::mutex> lock(this->OwnedDataObjectsMutex);
+    std::map< vtkMRMLNode*, PreservedAttributes >::iterator preservedIt = this->PreservedAttributeNames.find(target);
+    if (preservedIt != this->PreservedAttributeNames.end() && preservedIt->second.TargetNode.GetPointer() == target)
+    {
+      preservedAttributeNames = preservedIt->second.AttributeNames;
+    }
+  }
+  std::vector< std::string > existingAttributeNames = target->GetAttributeNames();
+  // Remove attributes that do not exist in the source anymore
+  for (std::vector< std::string >::iterator attributeNamesIt = existingAttributeNames.begin();
+    attributeNamesIt != existingAttributeNames.end(); ++attributeNamesIt)
+  {
+    if (source->GetAttribute(attributeNamesIt->c_str()) == nullptr
+      && std::find(preservedAttributeNames.begin(), preservedAttributeNames.end(), *attributeNamesIt) == preservedAttributeNames.end())
+    {
+      target->RemoveAttribute(attributeNamesIt->c_str());
+    }
+  }
+  // Add new attributes and update values that have been changed
+  std::vector< std::string > newAttributeNames = source->GetAttributeNames();
+  for (std::vector< std::string >::iterator attributeNamesIt = newAttributeNames.begin();
+    attributeNamesIt != newAttributeNames.end(); ++attributeNamesIt)
+  {
+    if (std::find(preservedAttributeNames.begin(), preservedAttributeNames.end(), *attributeNamesIt) != preservedAttributeNames.end())
+    {
+      continue;
+    }
+    const char* sourceValue = source->GetAttribute(attributeNamesIt->c_str());
+    const char* targetValue = target->GetAttribute(attributeNamesIt->c_str());
+    if (targetValue == nullptr || strcmp(sourceValue, targetValue) != 0)
+    {
+      target->SetAttribute(attributeNamesIt->c_str(), sourceValue);
+    }
+  }
+}
+
+void vtkMRMLNodeSequencer::NodeSequencer::SetPreservedAttributeNames(vtkMRMLNode* target, const std::vector<std::string>& attributeNames)
+{
+  std::lock_guard<std::mutex> lock(this->OwnedDataObjectsMutex);
+  // Remove entries of deleted target nodes
+  for (std::map< vtkMRMLNode*, PreservedAttributes >::iterator preservedIt = this->PreservedAttributeNames.begin();
+    preservedIt != this->PreservedAttributeNames.end();)
+  {
+    if (preservedIt->second.TargetNode.GetPointer() == NULL)
+    {
+      this->PreservedAttributeNames.erase(preservedIt++);
+    }
+    else
+    {
+      ++preservedIt;
+    }
+  }
+  if (attributeNames.empty())
+  {
+    this->PreservedAttributeNames.erase(target);
+    return;
+  }
+  PreservedAttributes& preserved = this->PreservedAttributeNames[target];
+  preserved.TargetNode = target;
+  preserved.AttributeNames = attributeNames;
+}
+
+void vtkMRMLNodeSequencer::NodeSequencer::SetOwnedDataObject(vtkMRMLNode* target, vtkObject* dataObject)
+{
+  std::lock_guard<std::mutex> lock(this->OwnedDataObjectsMutex);
+  // Remove entries of target nodes or data objects that have been deleted since.
+  // Only done when the map size doubled, so that registering many nodes does not have quadratic cost.
+  if (this->OwnedDataObjects.size() >= 2 * this->OwnedDataObjectsCleanupSize)
+  {
+    for (std::map< vtkMRMLNode*, OwnedDataObject >::iterator ownedIt = this->OwnedDataObjects.begin();
+      ownedIt != this->OwnedDataObjects.end();)
+    {
+      if (ownedIt->second.TargetNode.GetPointer() == NULL || ownedIt->second.DataObject.GetPointer() == NULL)
+      {
+        this->OwnedDataObjects.erase(ownedIt++);
+      }
+      else
+      {
+        ++ownedIt;
+      }
+    }
+    this->OwnedDataObjectsCleanupSize = std::max<size_t>(this->OwnedDataObjects.size(), 16);
+  }
+  if (dataObject == NULL)
+  {
+    this->OwnedDataObjects.erase(target);
+    return;
+  }
+  OwnedDataObject& owned = this->OwnedDataObjects[target];
+  owned.TargetNode = target;
+  owned.DataObject = dataObject;
+}
+
+bool vtkMRMLNodeSequencer::NodeSequencer::IsOwnedDataObject(vtkMRMLNode* target, vtkObject* dataObject)
+{
+  if (dataObject == NULL)
+  {
+    return false;
+  }
+  std::lock_guard<std::mutex> lock(this->OwnedDataObjectsMutex);
+  std::map< vtkMRMLNode*, OwnedDataObject >::iterator ownedIt = this->OwnedDataObjects.find(target);
+  if (ownedIt == this->OwnedDataObjects.end())
+  {
+    return false;
+  }
+  // If the registered node has been deleted then the entry is obsolete, even if target is allocated at the same address
+  return ownedIt->second.TargetNode.GetPointer() == target && ownedIt->second.DataObject.GetPointer() == dataObject;
+}
+
+void vtkMRMLNodeSequencer::NodeSequencer::SetSharedDataObject(vtkMRMLNode* target, vtkObject* dataObject)
+{
+  std::lock_guard<std::mutex> lock(this->OwnedDataObjectsMutex);
+  // Remove entries of target nodes or data objects that have been deleted since (only when the map size doubled,
+  // as every recorded snapshot is registered)
+  if (this->SharedDataObjects.size() >= 2 * this->SharedDataObjectsCleanupSize)
+  {
+    for (std::map< vtkMRMLNode*, OwnedDataObject >::iterator sharedIt = this->SharedDataObjects.begin();
+      sharedIt != this->SharedDataObjects.end();)
+    {
+      if (sharedIt->second.TargetNode.GetPointer() == NULL || sharedIt->second.DataObject.GetPointer() == NULL)
+      {
+        this->SharedDataObjects.erase(sharedIt++);
+      }
+      else
+      {
+        ++sharedIt;
+      }
+    }
+    this->SharedDataObjectsCleanupSize = std::max<size_t>(this->SharedDataObjects.size(), 16);
+  }
+  if (dataObject == NULL)
+  {
+    this->SharedDataObjects.erase(target);
+    return;
+  }
+  OwnedDataObject& shared = this->SharedDataObjects[target];
+  shared.TargetNode = target;
+  shared.DataObject = dataObject;
+}
+
+bool vtkMRMLNodeSequencer::NodeSequencer::IsSharedDataObject(vtkMRMLNode* target, vtkObject* dataObject)
+{
+  if (dataObject == NULL)
+  {
+    return false;
+  }
+  std::lock_guard<std::mutex> lock(this->OwnedDataObjectsMutex);
+  std::map< vtkMRMLNode*, OwnedDataObject >::iterator sharedIt = this->SharedDataObjects.find(target);
+  if (sharedIt == this->SharedDataObjects.end())
+  {
+    return false;
+  }
+  return sharedIt->second.TargetNode.GetPointer() == target && sharedIt->second.DataObject.GetPointer() == dataObject;
+}
+
+void vtkMRMLNodeSequencer::NodeSequencer::SetPrecopiedDataObject(vtkMRMLNode* target, vtkObject* sourceDataObject)
+{
+  std::lock_guard<std::mutex> lock(this->OwnedDataObjectsMutex);
+  this->PrecopiedDataObjects[target] = std::make_pair(sourceDataObject, sourceDataObject->GetMTime());
+}
+
+bool vtkMRMLNodeSequencer::NodeSequencer::TakePrecopiedDataObject(vtkMRMLNode* target, vtkObject* sourceDataObject)
+{
+  std::lock_guard<std::mutex> lock(this->OwnedDataObjectsMutex);
+  std::map< vtkMRMLNode*, std::pair<vtkObject*, vtkMTimeType> >::iterator precopiedIt = this->PrecopiedDataObjects.find(target);
+  if (precopiedIt == this->PrecopiedDataObjects.end())
+  {
+    return false;
+  }
+  bool precopied = (sourceDataObject != NULL
+    && precopiedIt->second.first == sourceDataObject
+    && precopiedIt->second.second == sourceDataObject->GetMTime());
+  this->PrecopiedDataObjects.erase(precopiedIt);
+  return precopied;
+}
+
+bool vtkMRMLNodeSequencer::NodeSequencer::BeginPrepareDataObject(vtkMRMLNode* target, vtkMRMLNode* source,
+  vtkObject* sourceDataObject, vtkSmartPointer<vtkObject>& dataObject)
+{
+  std::lock_guard<std::mutex> lock(this->OwnedDataObjectsMutex);
+  std::vector<PreparedDataObject>& preparedDataObjects = this->PreparedDataObjects[target];
+  std::vector<PreparedDataObject>::iterator spareIt = preparedDataObjects.end();
+  for (std::vector<PreparedDataObject>::iterator preparedDataObjectIt = preparedDataObjects.begin();
+    preparedDataObjectIt != preparedDataObjects.end(); ++preparedDataObjectIt)
+  {
+    if (preparedDataObjectIt->SourceNode == source)
+    {
+      if (preparedDataObjectIt->InProgress
+        || (preparedDataObjectIt->SourceDataObject == sourceDataObject && preparedDataObjectIt->SourceMTime == sourceDataObject->GetMTime()))
+      {
+        // prepared or being prepared already
+        return false;
+      }
+      // source has been modified since it was prepared, prepare it again in the same buffer
+      spareIt = preparedDataObjectIt;
+      break;
+    }
+    if (preparedDataObjectIt->SourceNode == NULL && !preparedDataObjectIt->InProgress && spareIt == preparedDataObjects.end())
+    {
+      spareIt = preparedDataObjectIt;
+    }
+  }
+  if (spareIt == preparedDataObjects.end())
+  {
+    spareIt = preparedDataObjects.insert(preparedDataObjects.end(), PreparedDataObject());
+  }
+  dataObject = spareIt->DataObject;
+  spareIt->DataObject = NULL;
+  spareIt->SourceNode = source;
+  spareIt->SourceDataObject = NULL;
+  spareIt->InProgress = true;
+  return true;
+}
+
+void vtkMRMLNodeSequencer::NodeSequencer::EndPrepareDataObject(vtkMRMLNode* target, vtkMRMLNode* source, vtkObject* dataObject,
+  vtkObject* sourceDataObject, vtkMTimeType sourceMTime)
+{
+  std::lock_guard<std::mutex> lock(this->OwnedDataObjectsMutex);
+  std::vector<PreparedDataObject>& preparedDataObjects = this->PreparedDataObjects[target];
+  for (std::vector<PreparedDataObject>::iterator preparedDataObjectIt = preparedDataObjects.begin();
+    preparedDataObjectIt != preparedDataObjects.end(); ++preparedDataObjectIt)
+  {
+    if (preparedDataObjectIt->InProgress && preparedDataObjectIt->SourceNode == source)
+    {
+      preparedDataObjectIt->DataObject = dataObject;
+      preparedDataObjectIt->SourceDataObject = (dataObject != NULL ? sourceDataObject : NULL);
+      preparedDataObjectIt->SourceMTime = sourceMTime;
+      preparedDataObjectIt->InProgress = false;
+      return;
+    }
+  }
+}
+
+vtkSmartPointer<vtkObject> vtkMRMLNodeSequencer::NodeSequencer::TakePreparedDataObject(vtkMRMLNode* target, vtkObject* sourceDataObject)
+{
+  std::lock_guard<std::mutex> lock(this->OwnedDataObjectsMutex);
+  std::map< vtkMRMLNode*, std::vector<PreparedDataObject> >::iterator preparedIt = this->PreparedDataObjects.find(target);
+  if (preparedIt == this->PreparedDataObjects.end() || sourceDataObject == NULL)
+  {
+    return NULL;
+  }
+  std::vector<PreparedDataObject>& preparedDataObjects = preparedIt->second;
+  for (std::vector<PreparedDataObject>::iterator preparedDataObjectIt = preparedDataObjects.begin();
+    preparedDataObjectIt != preparedDataObjects.end(); ++preparedDataObjectIt)
+  {
+    if (!preparedDataObjectIt->InProgress
+      && preparedDataObjectIt->SourceDataObject == sourceDataObject
+      && preparedDataObjectIt->SourceMTime == sourceDataObject->GetMTime())
+    {
+      vtkSmartPointer<vtkObject> dataObject = preparedDataObjectIt->DataObject;
+      preparedDataObjects.erase(preparedDataObjectIt);
+      return dataObject;
+    }
+  }
+  return NULL;
+}
+
+bool vtkMRMLNodeSequencer::NodeSequencer::HasPreparedDataObject(vtkMRMLNode* target, vtkObject* sourceDataObject)
+{
+  std::lock_guard<std::mutex> lock(this->OwnedDataObjectsMutex);
+  std::map< vtkMRMLNode*, std::vector<PreparedDataObject> >::iterator preparedIt = this->PreparedDataObjects.find(target);
+  if (preparedIt == this->PreparedDataObjects.end() || sourceDataObject == NULL)
+  {
+    return false;
+  }
+  for (std::vector<PreparedDataObject>::iterator preparedDataObjectIt = preparedIt->second.begin();
+    preparedDataObjectIt != preparedIt->second.end(); ++preparedDataObjectIt)
+  {
+    if (!preparedDataObjectIt->InProgress
+      && preparedDataObjectIt->SourceDataObject == sourceDataObject
+      && preparedDataObjectIt->SourceMTime == sourceDataObject->GetMTime())
+    {
+      return true;
+    }
+  }
+  return false;
+}
+
+void vtkMRMLNodeSequencer::NodeSequencer::SetBackBufferDataObject(vtkMRMLNode* target, vtkObject* dataObject)
+{
+  std::lock_guard<std::mutex> lock(this->OwnedDataObjectsMutex);
+  std::map< vtkMRMLNode*, std::vector<PreparedDataObject> >::iterator preparedIt = this->PreparedDataObjects.find(target);
+  if (preparedIt == this->PreparedDataObjects.end())
+  {
+    // back buffers are not used for this node
+    return;
+  }
+  for (std::vector<PreparedDataObject>::iterator preparedDataObjectIt = preparedIt->second.begin();
+    preparedDataObjectIt != preparedIt->second.end(); ++preparedDataObjectIt)
+  {
+    if (preparedDataObjectIt->SourceNode == NULL && !preparedDataObjectIt->InProgress)
+    {
+      // there is a spare back buffer already
+      return;
+    }
+  }
+  PreparedDataObject spare;
+  spare.DataObject = dataObject;
+  preparedIt->second.push_back(spare);
+}
+
+//----------------------------------------------------------------------------
+// Helper functions for copying data into existing buffers.
+// These allow updating a node with the content of another node without
+// reallocating memory, if the layout of the data (type, size, number of components) is the same.
+
+//----------------------------------------------------------------------------
+// Data objects that are shared between multiple nodes (see ShareIdenticalContent).
+// These are never modified in-place, but they may be referenced by any sequence item.
+// Proxy nodes may be modified by other modules, therefore they receive copies of these objects. The registry
+// records which shared object each copy was made from, so that unchanged content is not copied again.
+// Each sequencer that shares data objects keeps its own registry.
+class ImmutableDataObjectRegistry
+{
+public:
+  ImmutableDataObjectRegistry() : CleanupSize(0), CopiesCleanupSize(0) {}
+
+  void Add(vtkObject* dataObject)
+  {
+    std::lock_guard<std::mutex> lock(this->Mutex);
+    // Remove entries of data objects that have been deleted since (only when the map size doubled)
+    if (this->DataObjects.size() >= 2 * this->CleanupSize)
+    {
+      for (std::map< vtkObject*, vtkWeakPointer<vtkObject> >::iterator immutableIt = this->DataObjects.begin();
+        immutableIt != this->DataObjects.end();)
+      {
+        if (immutableIt->second.GetPointer() == NULL)
+        {
+          this->DataObjects.erase(immutableIt++);
+        }
+        else
+        {
+          ++immutableIt;
+        }
+      }
+      this->CleanupSize = std::max<size_t>(this->DataObjects.size(), 16);
+    }
+    this->DataObjects[dataObject] = dataObject;
+  }
+
+  bool Contains(vtkObject* dataObject)
+  {
+    std::lock_guard<std::mutex> lock(this->Mutex);
+    std::map< vtkObject*, vtkWeakPointer<vtkObject> >::iterator immutableIt = this->DataObjects.find(dataObject);
+    if (immutableIt == this->DataObjects.end())
+    {
+      return false;
+    }
+    // If the weak pointer is NULL then a new object has been allocated at the same address
+    return immutableIt->second.GetPointer() == dataObject;
+  }
+
+  /// Record that the content of copy has been copied from the shared data object.
+  /// copyMTime is the modification time of copy after copying, later modifications of copy invalidate the record.
+  void SetCopySource(vtkObject* copy, vtkObject* dataObject, vtkMTimeType copyMTime)
+  {
+    std::lock_guard<std::mutex> lock(this->Mutex);
+    // Remove entries of copies that have been deleted since (only when the map size doubled)
+    if (this->Copies.size() >= 2 * this->CopiesCleanupSize)
+    {
+      for (std::map< vtkObject*, CopyInfo >::iterator copyIt = this->Copies.begin(); copyIt != this->Copies.end();)
+      {
+        if (copyIt->second.Copy.GetPointer() == NULL)
+        {
+          this->Copies.erase(copyIt++);
+        }
+        else
+        {
+          ++copyIt;
+        }
+      }
+      this->CopiesCleanupSize = std::max<size_t>(this->Copies.size(), 16);
+    }
+    CopyInfo& copyInfo = this->Copies[copy];
+    copyInfo.Copy = copy;
+    copyInfo.Source = dataObject;
+    copyInfo.CopyMTime = copyMTime;
+  }
+
+  /// Returns true if copy has been copied from the shared data object and has not been modified since.
+  bool IsUnmodifiedCopy(vtkObject* copy, vtkObject* dataObject, vtkMTimeType copyMTime)
+  {
+    std::lock_guard<std::mutex> lock(this->Mutex);
+    std::map< vtkObject*, CopyInfo >::iterator copyIt = this->Copies.find(copy);
+    if (copyIt == this->Copies.end())
+    {
+      return false;
+    }
+    // Weak pointers are NULL if a new object has been allocated at the same address
+    return copyIt->second.Copy.GetPointer() == copy && copyIt->second.Source.GetPointer() == dataObject
+      && copyIt->second.CopyMTime == copyMTime;
+  }
+
+protected:
+  struct CopyInfo
+  {
+    CopyInfo() : CopyMTime(0) {}
+    vtkWeakPointer<vtkObject> Copy;
+    vtkWeakPointer<vtkObject> Source;
+    vtkMTimeType CopyMTime;
+  };
+
+  std::map< vtkObject*, vtkWeakPointer<vtkObject> > DataObjects;
+  // Number of entries after deleted objects were last removed from the map
+  size_t CleanupSize;
+  std::map< vtkObject*, CopyInfo > Copies;
+  size_t CopiesCleanupSize;
+  std::mutex Mutex;
+};
+
+//----------------------------------------------------------------------------
+// Returns false if immutableDataObjects is NULL (no data objects are shared)
+static bool IsImmutableDataObject(ImmutableDataObjectRegistry* immutableDataObjects, vtkObject* dataObject)
+{
+  return immutableDataObjects != NULL && immutableDataObjects->Contains(dataObject);
+}
+
+//----------------------------------------------------------------------------
+static bool IsSameArrayLayout(vtkDataArray* source, vtkDataArray* target)
+{
+  if (source == NULL || target == NULL)
+  {
+    return false;
+  }
+  if (!source->HasStandardMemoryLayout() || !target->HasStandardMemoryLayout())
+  {
+    return false;
+  }
+  return source->GetDataType() == target->GetDataType()
+    && source->GetNumberOfComponents() == target->GetNumberOfComponents()
+    && source->GetNumberOfTuples() == target->GetNumberOfTuples();
+}
+
+//----------------------------------------------------------------------------
+static bool IsSameArrayContent(vtkDataArray* array1, vtkDataArray* array2)
+{
+  if (!IsSameArrayLayout(array1, array2))
+  {
+    return false;
+  }
+  vtkIdType numberOfValues = array1->GetNumberOfTuples() * array1->GetNumberOfComponents();
+  if (numberOfValues == 0)
+  {
+    return true;
+  }
+  // Compare a few values spread over the whole array first, so that different content
+  // is usually rejected without comparing the complete arrays
+  const int numberOfSamples = 16;
+  const char* values1 = static_cast<const char*>(array1->GetVoidPointer(0));
+  const char* values2 = static_cast<const char*>(array2->GetVoidPointer(0));
+  int valueSize = array1->GetDataTypeSize();
+  for (int sampleIndex = 0; sampleIndex < numberOfSamples; ++sampleIndex)
+  {
+    vtkIdType valueIndex = (numberOfValues - 1) * sampleIndex / (numberOfSamples - 1);
+    if (memcmp(values1 + valueIndex * valueSize, values2 + valueIndex * valueSize, valueSize) != 0)
+    {
+      return false;
+    }
+  }
+  return memcmp(values1, values2, numberOfValues * valueSize) == 0;
+}
+
+//----------------------------------------------------------------------------
+// If copyValues is false then only the array metadata is updated (values have been copied already).
+static void CopyArrayValues(vtkDataArray* source, vtkDataArray* target, bool copyValues = true)
+{
+  if (source == target)
+  {
+    return;
+  }
+  vtkIdType numberOfValues = source->GetNumberOfTuples() * source->GetNumberOfComponents();
+  if (copyValues && numberOfValues > 0)
+  {
+    memcpy(target->GetVoidPointer(0), source->GetVoidPointer(0), numberOfValues * source->GetDataTypeSize());
+  }
+  target->SetName(source->GetName());
+  target->Modified();
+}
+
+//----------------------------------------------------------------------------
+static bool IsSameDataSetAttributesLayout(vtkDataSetAttributes* source, vtkDataSetAttributes* target)
+{
+  if (source->GetNumberOfArrays() != target->GetNumberOfArrays())
+  {
+    return false;
+  }
+  int sourceAttributeIndices[vtkDataSetAttributes::NUM_ATTRIBUTES];
+  int targetAttributeIndices[vtkDataSetAttributes::NUM_ATTRIBUTES];
+  source->GetAttributeIndices(sourceAttributeIndices);
+  target->GetAttributeIndices(targetAttributeIndices);
+  if (!std::equal(sourceAttributeIndices, sourceAttributeIndices + vtkDataSetAttributes::NUM_ATTRIBUTES, targetAttributeIndices))
+  {
+    return false;
+  }
+  for (int arrayIndex = 0; arrayIndex < source->GetNumberOfArrays(); ++arrayIndex)
+  {
+    // GetArray returns NULL for non-numeric arrays (such as string arrays), which cannot be reused
+    vtkDataArray* sourceArray = source->GetArray(arrayIndex);
+    vtkDataArray* targetArray = target->GetArray(arrayIndex);
+    if (!IsSameArrayLayout(sourceArray, targetArray))
+    {
+      return false;
+    }
+    const char* sourceArrayName = sourceArray->GetName();
+    const char* targetArrayName = targetArray->GetName();
+    if ((sourceArrayName == NULL) != (targetArrayName == NULL)
+      || (sourceArrayName != NULL && strcmp(sourceArrayName, targetArrayName) != 0))
+    {
+      return false;
+    }
+  }
+  return true;
+}
+
+//----------------------------------------------------------------------------
+// Target arrays are never shared, as target may be modified in-place.
+// Copying of arrays that are shared between nodes is skipped if target already has the same content.
+static void CopyDataSetAttributesValues(vtkDataSetAttributes* source, vtkDataSetAttributes* target,
+  ImmutableDataObjectRegistry* immutableDataObjects, bool copyValues = true)
+{
+  for (int arrayIndex = 0; arrayIndex < source->GetNumberOfArrays(); ++arrayIndex)
+  {
+    vtkDataArray* sourceArray = source->GetArray(arrayIndex);
+    vtkDataArray* targetArray = target->GetArray(arrayIndex);
+    if (sourceArray == targetArray)
+    {
+      continue;
+    }
+    bool sourceShared = IsImmutableDataObject(immutableDataObjects, sourceArray);
+    if (sourceShared && immutableDataObjects->IsUnmodifiedCopy(targetArray, sourceArray, targetArray->GetMTime()))
+    {
+      continue;
+    }
+    CopyArrayValues(sourceArray, targetArray, copyValues);
+    if (sourceShared && copyValues)
+    {
+      immutableDataObjects->SetCopySource(targetArray, sourceArray, targetArray->GetMTime());
+    }
+  }
+}
+
+//----------------------------------------------------------------------------
+// Returns true if all array values can be copied by CopyDataSetAttributesRawValues (no array is shared).
+static bool CanCopyDataSetAttributesRawValues(vtkDataSetAttributes* source, vtkDataSetAttributes* target,
+  ImmutableDataObjectRegistry* immutableDataObjects)
+{
+  for (int arrayIndex = 0; arrayIndex < source->GetNumberOfArrays(); ++arrayIndex)
+  {
+    vtkDataArray* sourceArray = source->GetArray(arrayIndex);
+    vtkDataArray* targetArray = target->GetArray(arrayIndex);
+    if (sourceArray == targetArray
+      || IsImmutableDataObject(immutableDataObjects, sourceArray) || IsImmutableDataObject(immutableDataObjects, targetArray))
+    {
+      return false;
+    }
+  }
+  return true;
+}
+
+//----------------------------------------------------------------------------
+// Copy array values without modifying the arrays in any other way (no metadata update, no Modified call),
+// so that it can be done in a worker thread.
+static void CopyDataSetAttributesRawValues(vtkDataSetAttributes* source, vtkDataSetAttributes* target)
+{
+  for (int arrayIndex = 0; arrayIndex < source->GetNumberOfArrays(); ++arrayIndex)
+  {
+    vtkDataArray* sourceArray = source->GetArray(arrayIndex);
+    vtkDataArray* targetArray = target->GetArray(arrayIndex);
+    vtkIdType numberOfValues = sourceArray->GetNumberOfTuples() * sourceArray->GetNumberOfComponents();
+    if (numberOfValues > 0)
+    {
+      memcpy(targetArray->GetVoidPointer(0), sourceArray->GetVoidPointer(0), numberOfValues * sourceArray->GetDataTypeSize());
+    }
+  }
+}
+
+//----------------------------------------------------------------------------
+static bool IsSameImageDataLayout(vtkImageData* source, vtkImageData* target)
+{
+  if (source == NULL || target == NULL)
+  {
+    return false;
+  }
+  int sourceExtent[6] = { 0, -1, 0, -1, 0, -1 };
+  int targetExtent[6] = { 0, -1, 0, -1, 0, -1 };
+  source->GetExtent(sourceExtent);
+  target->GetExtent(targetExtent);
+  if (!std::equal(sourceExtent, sourceExtent + 6, targetExtent))
+  {
+    return false;
+  }
+  return IsSameDataSetAttributesLayout(source->GetPointData(), target->GetPointData())
+    && IsSameDataSetAttributesLayout(source->GetCellData(), target->GetCellData());
+}
+
+//----------------------------------------------------------------------------
+// Returns false and leaves target unchanged if extent or arrays of the images are different.
+// If copyValues is false then voxel values are not copied, only geometry and array metadata are updated
+// (used after the values have been copied by CopyImageDataValuesIntoExistingBuffers).
+static bool CopyImageDataIntoExistingBuffers(vtkImageData* source, vtkImageData* target, bool copyValues = true)
+{
+  if (!IsSameImageDataLayout(source, target))
+  {
+    return false;
+  }
+  target->SetOrigin(source->GetOrigin());
+  target->SetSpacing(source->GetSpacing());
+  // image data arrays are not shared between nodes
+  CopyDataSetAttributesValues(source->GetPointData(), target->GetPointData(), NULL, copyValues);
+  CopyDataSetAttributesValues(source->GetCellData(), target->GetCellData(), NULL, copyValues);
+  target->Modified();
+  return true;
+}
+
+//----------------------------------------------------------------------------
+// Copy voxel values only, without invoking any events (may be called from a worker thread).
+// Returns false and leaves target unchanged if extent or arrays of the images are different.
+static bool CopyImageDataValuesIntoExistingBuffers(vtkImageData* source, vtkImageData* target)
+{
+  if (!IsSameImageDataLayout(source, target)
+    || !CanCopyDataSetAttributesRawValues(source->GetPointData(), target->GetPointData(), NULL)
+    || !CanCopyDataSetAttributesRawValues(source->GetCellData(), target->GetCellData(), NULL))
+  {
+    return false;
+  }
+  CopyDataSetAttributesRawValues(source->GetPointData(), target->GetPointData());
+  CopyDataSetAttributesRawValues(source->GetCellData(), target->GetCellData());
+  return true;
+}
+
+//----------------------------------------------------------------------------
+// Fill buffer with the content of source, reusing the buffer's arrays if it has the same layout
+// (allocates a new buffer otherwise). buffer is not used by any node, so no events are observed.
+static void PrepareImageData(vtkImageData* source, vtkSmartPointer<vtkImageData>& buffer)
+{
+  if (buffer.GetPointer() != NULL && CopyImageDataValuesIntoExistingBuffers(source, buffer))
+  {
+    buffer->SetOrigin(source->GetOrigin());
+    buffer->SetSpacing(source->GetSpacing());
+    return;
+  }
+  buffer = vtkSmartPointer<vtkImageData>::Take(source->NewInstance());
+  buffer->DeepCopy(source);
+}
+
+//----------------------------------------------------------------------------
+// Cell array index: 0 = verts, 1 = lines, 2 = polys, 3 = strips
+static vtkCellArray* GetCellArray(vtkPolyData* polyData, int cellArrayIndex)
+{
+  switch (cellArrayIndex)
+  {
+    case 0: return polyData->GetVerts();
+    case 1: return polyData->GetLines();
+    case 2: return polyData->GetPolys();
+    case 3: return polyData->GetStrips();
+  }
+  return NULL;
+}
+
+//----------------------------------------------------------------------------
+static void SetCellArray(vtkPolyData* polyData, int cellArrayIndex, vtkCellArray* cells)
+{
+  switch (cellArrayIndex)
+  {
+    case 0: polyData->SetVerts(cells); break;
+    case 1: polyData->SetLines(cells); break;
+    case 2: polyData->SetPolys(cells); break;
+    case 3: polyData->SetStrips(cells); break;
+  }
+}
+
+//----------------------------------------------------------------------------
+static const int NUMBER_OF_CELL_ARRAYS = 4;
+
+//----------------------------------------------------------------------------
+static bool IsSameCellArrayContent(vtkCellArray* cells1, vtkCellArray* cells2)
+{
+  if (cells1 == cells2)
+  {
+    return true;
+  }
+  if (cells1 == NULL || cells2 == NULL || cells1->GetNumberOfCells() != cells2->GetNumberOfCells())
+  {
+    return false;
+  }
+  return IsSameArrayContent(cells1->GetData(), cells2->GetData());
+}
+
+//----------------------------------------------------------------------------
+// Cells may be modified through the cell array or directly through its connectivity array
+static vtkMTimeType GetCellArrayContentMTime(vtkCellArray* cells)
+{
+  return std::max(cells->GetMTime(), cells->GetData()->GetMTime());
+}
+
+//----------------------------------------------------------------------------
+// Returns false and leaves target unchanged if number of points, cells or arrays of the meshes are different.
+// Cells and arrays that are shared between nodes (registered in immutableDataObjects) are not copied again
+// if target has an unmodified copy of them already.
+static bool CopyPolyDataIntoExistingBuffers(vtkPolyData* source, vtkPolyData* target, ImmutableDataObjectRegistry* immutableDataObjects)
+{
+  if (source == NULL || target == NULL || source->GetPoints() == NULL || target->GetPoints() == NULL)
+  {
+    return false;
+  }
+  if (!IsSameArrayLayout(source->GetPoints()->GetData(), target->GetPoints()->GetData()))
+  {
+    return false;
+  }
+  if (source->GetNumberOfVerts() != target->GetNumberOfVerts()
+    || source->GetNumberOfLines() != target->GetNumberOfLines()
+    || source->GetNumberOfPolys() != target->GetNumberOfPolys()
+    || source->GetNumberOfStrips() != target->GetNumberOfStrips())
+  {
+    return false;
+  }
+  if (!IsSameDataSetAttributesLayout(source->GetPointData(), target->GetPointData())
+    || !IsSameDataSetAttributesLayout(source->GetCellData(), target->GetCellData()))
+  {
+    return false;
+  }
+  CopyArrayValues(source->GetPoints()->GetData(), target->GetPoints()->GetData());
+  target->GetPoints()->Modified();
+  bool topologyChanged = false;
+  for (int cellArrayIndex = 0; cellArrayIndex < NUMBER_OF_CELL_ARRAYS; ++cellArrayIndex)
+  {
+    vtkCellArray* sourceCells = GetCellArray(source, cellArrayIndex);
+    vtkCellArray* targetCells = GetCellArray(target, cellArrayIndex);
+    if (sourceCells == targetCells)
+    {
+      // shared topology, nothing to copy
+      continue;
+    }
+    bool sourceShared = IsImmutableDataObject(immutableDataObjects, sourceCells);
+    if (sourceShared && immutableDataObjects->IsUnmodifiedCopy(targetCells, sourceCells, GetCellArrayContentMTime(targetCells)))
+    {
+      // topology shared between sequence items, target has it already
+      continue;
+    }
+    // Cell arrays reuse their storage if the size is unchanged
+    targetCells->DeepCopy(sourceCells);
+    if (sourceShared)
+    {
+      immutableDataObjects->SetCopySource(targetCells, sourceCells, GetCellArrayContentMTime(targetCells));
+    }
+    topologyChanged = true;
+  }
+  if (topologyChanged)
+  {
+    // Random-access cell structures (built on demand) may be outdated now
+    target->DeleteCells();
+  }
+  CopyDataSetAttributesValues(source->GetPointData(), target->GetPointData(), immutableDataObjects);
+  CopyDataSetAttributesValues(source->GetCellData(), target->GetCellData(), immutableDataObjects);
+  target->Modified();
+  return true;
+}
+
+//----------------------------------------------------------------------------
+// Replace arrays in attributes by the array of the same name in referenceAttributes if their content is the same.
+// Arrays that are shared already are not compared again.
+static void ShareIdenticalArrays(vtkDataSetAttributes* attributes, vtkDataSetAttributes* referenceAttributes,
+  ImmutableDataObjectRegistry* immutableDataObjects)
+{
+  for (int arrayIndex = 0; arrayIndex < attributes->GetNumberOfArrays(); ++arrayIndex)
+  {
+    vtkDataArray* array = attributes->GetArray(arrayIndex);
+    if (array == NULL || array->GetName() == NULL || immutableDataObjects->Contains(array))
+    {
+      continue;
+    }
+    vtkDataArray* referenceArray = referenceAttributes->GetArray(array->GetName());
+    if (referenceArray != NULL && referenceArray != array && IsSameArrayContent(array, referenceArray))
+    {
+      // AddArray replaces the existing array of the same name
+      immutableDataObjects->Add(referenceArray);
+      attributes->AddArray(referenceArray);
+    }
+  }
+}
+
+//----------------------------------------------------------------------------
+
+/// Common base of volume node sequencers, implements copying and sharing of image data.
+/// Subclasses only specify the supported node classes and default display nodes.
+class VolumeNodeSequencer : public vtkMRMLNodeSequencer::NodeSequencer
+{
+public:
+  virtual void ShareNodeContent(vtkMRMLNode* source, vtkMRMLNode* target)
+  {
+    int oldModified = target->StartModify();
+    vtkMRMLVolumeNode* targetVolumeNode = vtkMRMLVolumeNode::SafeDownCast(target);
+    vtkMRMLVolumeNode* sourceVolumeNode = vtkMRMLVolumeNode::SafeDownCast(source);
+    this->CopyNodeAttributes(source, target);
+    vtkSmartPointer<vtkMatrix4x4> ijkToRasmatrix = vtkSmartPointer<vtkMatrix4x4>::New();
+    sourceVolumeNode->GetIJKToRASMatrix(ijkToRasmatrix);
+    targetVolumeNode->SetIJKToRASMatrix(ijkToRasmatrix);
+    // Use a separate image data object, so that replacing arrays or changing geometry
+    // in the target does not affect the source, but share the voxel arrays.
+    vtkSmartPointer<vtkImageData> targetImageData;
+    if (sourceVolumeNode->GetImageData() != NULL)
+    {
+      targetImageData = vtkSmartPointer<vtkImageData>::Take(sourceVolumeNode->GetImageData()->NewInstance());
+      targetImageData->ShallowCopy(sourceVolumeNode->GetImageData());
+      // Voxels of the source must not be overwritten in-place anymore, as the target refers to them
+      this->SetOwnedDataObject(source, NULL);
+      this->SetSharedDataObject(source, sourceVolumeNode->GetImageData());
+    }
+    this->SetSharedDataObject(target, targetImageData);
+    targetVolumeNode->SetAndObserveImageData(targetImageData);
+    target->EndModify(oldModified);
+  }
+
+  virtual void DetachNodeContent(vtkMRMLNode* target)
+  {
+    if (!this->IsNodeContentShared(target))
+    {
+      // target owns its image data already (it has been detached or the image has been replaced)
+      return;
+    }
+    vtkMRMLVolumeNode* targetVolumeNode = vtkMRMLVolumeNode::SafeDownCast(target);
+    // Use the copy made by PrepareNodeContent(target, target) if the shared image has not changed since then
+    vtkSmartPointer<vtkImageData> detachedImageData = vtkImageData::SafeDownCast(
+      this->TakePreparedDataObject(target, targetVolumeNode->GetImageData()));
+    if (detachedImageData.GetPointer() == NULL)
+    {
+      detachedImageData = vtkSmartPointer<vtkImageData>::Take(targetVolumeNode->GetImageData()->NewInstance());
+      detachedImageData->DeepCopy(targetVolumeNode->GetImageData());
+    }
+    this->SetSharedDataObject(target, NULL);
+    targetVolumeNode->SetAndObserveImageData(detachedImageData);
+    this->SetOwnedDataObject(target, detachedImageData);
+  }
+
+  virtual bool IsNodeContentShared(vtkMRMLNode* target)
+  {
+    vtkMRMLVolumeNode* targetVolumeNode = vtkMRMLVolumeNode::SafeDownCast(target);
+    return targetVolumeNode != NULL && this->IsSharedDataObject(target, targetVolumeNode->GetImageData());
+  }
+
+  virtual void CopyNode(vtkMRMLNode* source, vtkMRMLNode* target, bool shallowCopy /* =false */)
+  {
+    int oldModified = target->StartModify();
+    vtkMRMLVolumeNode* targetVolumeNode = vtkMRMLVolumeNode::SafeDownCast(target);
+    vtkMRMLVolumeNode* sourceVolumeNode = vtkMRMLVolumeNode::SafeDownCast(source);
+    this->CopyNodeAttributes(source, target);
+    // targetVolumeNode->SetAndObserveTransformNodeID is not called, as we want to keep the currently applied transform
+    vtkSmartPointer<vtkMatrix4x4> ijkToRasmatrix = vtkSmartPointer<vtkMatrix4x4>::New();
+    sourceVolumeNode->GetIJKToRASMatrix(ijkToRasmatrix);
+    targetVolumeNode->SetIJKToRASMatrix(ijkToRasmatrix);
+    vtkSmartPointer<vtkImageData> targetImageData = sourceVolumeNode->GetImageData();
+    if (!shallowCopy && targetImageData.GetPointer() != NULL)
+    {
+      // Swap in the back buffer if it has been filled with this image by PrepareNodeContent
+      vtkSmartPointer<vtkImageData> preparedImageData = vtkImageData::SafeDownCast(
+        this->TakePreparedDataObject(target, sourceVolumeNode->GetImageData()));
+      if (preparedImageData.GetPointer() != NULL)
+      {
+        this->TakePrecopiedDataObject(target, NULL);
+        vtkSmartPointer<vtkImageData> previousImageData = targetVolumeNode->GetImageData();
+        bool previousImageDataOwned = this->IsOwnedDataObject(target, previousImageData);
+        this->SetOwnedDataObject(target, preparedImageData);
+        targetVolumeNode->SetAndObserveImageData(preparedImageData);
+        if (previousImageDataOwned)
+        {
+          // previous image is not used anymore, its buffers can be reused for preparing the next item
+          this->SetBackBufferDataObject(target, previousImageData);
+        }
+        target->EndModify(oldModified);
+        return;
+      }
+      // Copy into the current image buffer of the target if it is not shared and has the same layout
+      // (voxel values may have been copied already by PrecopyNodeContent)
+      bool valuesPrecopied = this->TakePrecopiedDataObject(target, sourceVolumeNode->GetImageData());
+      if (this->IsOwnedDataObject(target, targetVolumeNode->GetImageData())
+        && CopyImageDataIntoExistingBuffers(sourceVolumeNode->GetImageData(), targetVolumeNode->GetImageData(), !valuesPrecopied))
+      {
+        target->InvokeCustomModifiedEvent(vtkMRMLVolumeNode::ImageDataModifiedEvent);
+        target->EndModify(oldModified);
+        return;
+      }
+      targetImageData = vtkSmartPointer<vtkImageData>::Take(sourceVolumeNode->GetImageData()->NewInstance());
+      targetImageData->DeepCopy(sourceVolumeNode->GetImageData());
+      this->SetOwnedDataObject(target, targetImageData);
+    }
+    targetVolumeNode->SetAndObserveImageData(targetImageData); // invokes vtkMRMLVolumeNode::ImageDataModifiedEvent, which is not masked by StartModify
+    target->EndModify(oldModified);
+  }
+
+  virtual bool PrecopyNodeContent(vtkMRMLNode* source, vtkMRMLNode* target)
   {
-    return;
+    vtkMRMLVolumeNode* targetVolumeNode = vtkMRMLVolumeNode::SafeDownCast(target);
+    vtkMRMLVolumeNode* sourceVolumeNode = vtkMRMLVolumeNode::SafeDownCast(source);
+    if (sourceVolumeNode == NULL || targetVolumeNode == NULL
+      || this->HasPreparedDataObject(target, sourceVolumeNode->GetImageData())
+      || !this->IsOwnedDataObject(target, targetVolumeNode->GetImageData())
+      || !CopyImageDataValuesIntoExistingBuffers(sourceVolumeNode->GetImageData(), targetVolumeNode->GetImageData()))
+    {
+      return false;
+    }
+    this->SetPrecopiedDataObject(target, sourceVolumeNode->GetImageData());
+    return true;
   }
-  node->SetAndObserveStorageNodeID(storageNode->GetID());
-}
-
-std::string vtkMRMLNodeSequencer::NodeSequencer::GetDefaultSequenceStorageNodeClassName()
-{
-  return this->DefaultSequenceStorageNodeClassName;
-}
 
-void vtkMRMLNodeSequencer::NodeSequencer::CopyNodeAttributes(vtkMRMLNode* source, vtkMRMLNode* target)
-{
-  std::vector< std::string > existingAttributeNames = target->GetAttributeNames();
-  // Update existing attributes (update value or remove)
-  for (std::vector< std::string >::iterator attributeNamesIt = existingAttributeNames.begin();
-    attributeNamesIt != existingAttributeNames.end(); ++attributeNamesIt)
+  virtual bool PrepareNodeContent(vtkMRMLNode* source, vtkMRMLNode* target)
   {
-    if (source->GetAttribute(attributeNamesIt->c_str()))
-    {
-      // Attribute exists already, update value
-      target->SetAttribute(attributeNamesIt->c_str(), source->GetAttribute(attributeNamesIt->c_str()));
-    }
-    else
+    vtkMRMLVolumeNode* sourceVolumeNode = vtkMRMLVolumeNode::SafeDownCast(source);
+    if (sourceVolumeNode == NULL || sourceVolumeNode->GetImageData() == NULL || target == NULL)
     {
-      // Attribute does not exist anymore, remove it
-      target->RemoveAttribute(attributeNamesIt->c_str());
+      return false;
     }
-  }
-  // Add new attributes (skip those that existed before)
-  std::vector< std::string > newAttributeNames = source->GetAttributeNames();
-  for (std::vector< std::string >::iterator attributeNamesIt = newAttributeNames.begin();
-    attributeNamesIt != newAttributeNames.end(); ++attributeNamesIt)
-  {
-    if (target->GetAttribute(attributeNamesIt->c_str()) == nullptr)
+    vtkSmartPointer<vtkObject> backBuffer;
+    if (!this->BeginPrepareDataObject(target, source, sourceVolumeNode->GetImageData(), backBuffer))
     {
-      // New attribute, set it
-      target->SetAttribute(attributeNamesIt->c_str(), source->GetAttribute(attributeNamesIt->c_str()));
+      // prepared already
+      return true;
     }
+    vtkSmartPointer<vtkImageData> preparedImageData = vtkImageData::SafeDownCast(backBuffer);
+    vtkMTimeType sourceMTime = sourceVolumeNode->GetImageData()->GetMTime();
+    PrepareImageData(sourceVolumeNode->GetImageData(), preparedImageData);
+    this->EndPrepareDataObject(target, source, preparedImageData, sourceVolumeNode->GetImageData(), sourceMTime);
+    return true;
   }
-}
+};
 
 //----------------------------------------------------------------------------
 
-class ScalarVolumeNodeSequencer : public vtkMRMLNodeSequencer::NodeSequencer
+class ScalarVolumeNodeSequencer : public VolumeNodeSequencer
 {
 public:
   ScalarVolumeNodeSequencer()
@@ -225,26 +1266,7 @@ public:
     this->SupportedNodeParentClassNames.push_back("vtkMRMLStorableNode");
     this->SupportedNodeParentClassNames.push_back("vtkMRMLNode");
     this->DefaultSequenceStorageNodeClassName = "vtkMRMLVolumeSequenceStorageNode";
-  }
-
-  virtual void CopyNode(vtkMRMLNode* source, vtkMRMLNode* target, bool shallowCopy /* =false */)
-  {
-    int oldModified = target->StartModify();
-    vtkMRMLVolumeNode* targetVolumeNode = vtkMRMLVolumeNode::SafeDownCast(target);
-    vtkMRMLVolumeNode* sourceVolumeNode = vtkMRMLVolumeNode::SafeDownCast(source);
-    this->CopyNodeAttributes(source, target);
-    // targetScalarVolumeNode->SetAndObserveTransformNodeID is not called, as we want to keep the currently applied transform
-    vtkSmartPointer<vtkMatrix4x4> ijkToRasmatrix = vtkSmartPointer<vtkMatrix4x4>::New();
-    sourceVolumeNode->GetIJKToRASMatrix(ijkToRasmatrix);
-    targetVolumeNode->SetIJKToRASMatrix(ijkToRasmatrix);
-    vtkSmartPointer<vtkImageData> targetImageData = sourceVolumeNode->GetImageData();
-    if (!shallowCopy && targetImageData.GetPointer()!=NULL)
-    {
-      targetImageData = vtkSmartPointer<vtkImageData>::Take(sourceVolumeNode->GetImageData()->NewInstance());
-      targetImageData->DeepCopy(sourceVolumeNode->GetImageData());
-    }
-    targetVolumeNode->SetAndObserveImageData(targetImageData); // invokes vtkMRMLVolumeNode::ImageDataModifiedEvent, which is not masked by StartModify
-    target->EndModify(oldModified);
+    this->CopyPreservesNodeReferences = true;
   }
 
   virtual void AddDefaultDisplayNodes(vtkMRMLNode* node)
@@ -274,7 +1296,7 @@ public:
 
 //----------------------------------------------------------------------------
 
-class VectorVolumeNodeSequencer : public vtkMRMLNodeSequencer::NodeSequencer
+class VectorVolumeNodeSequencer : public VolumeNodeSequencer
 {
 public:
   VectorVolumeNodeSequencer()
@@ -286,26 +1308,7 @@ public:
     this->SupportedNodeParentClassNames.push_back("vtkMRMLTransformableNode");
     this->SupportedNodeParentClassNames.push_back("vtkMRMLStorableNode");
     this->SupportedNodeParentClassNames.push_back("vtkMRMLNode");
-  }
-
-  virtual void CopyNode(vtkMRMLNode* source, vtkMRMLNode* target, bool shallowCopy /* =false */)
-  {
-    int oldModified = target->StartModify();
-    vtkMRMLVolumeNode* targetVolumeNode = vtkMRMLVolumeNode::SafeDownCast(target);
-    vtkMRMLVolumeNode* sourceVolumeNode = vtkMRMLVolumeNode::SafeDownCast(source);
-    this->CopyNodeAttributes(source, target);
-    // targetScalarVolumeNode->SetAndObserveTransformNodeID is not called, as we want to keep the currently applied transform
-    vtkSmartPointer<vtkMatrix4x4> ijkToRasmatrix = vtkSmartPointer<vtkMatrix4x4>::New();
-    sourceVolumeNode->GetIJKToRASMatrix(ijkToRasmatrix);
-    targetVolumeNode->SetIJKToRASMatrix(ijkToRasmatrix);
-    vtkSmartPointer<vtkImageData> targetImageData = sourceVolumeNode->GetImageData();
-    if (!shallowCopy && targetImageData.GetPointer() != NULL)
-    {
-      targetImageData = vtkSmartPointer<vtkImageData>::Take(sourceVolumeNode->GetImageData()->NewInstance());
-      targetImageData->DeepCopy(sourceVolumeNode->GetImageData());
-    }
-    targetVolumeNode->SetAndObserveImageData(targetImageData); // invokes vtkMRMLVolumeNode::ImageDataModifiedEvent, which is not masked by StartModify
-    target->EndModify(oldModified);
+    this->CopyPreservesNodeReferences = true;
   }
 
   virtual void AddDefaultDisplayNodes(vtkMRMLNode* node)
@@ -346,25 +1349,380 @@ public:
     this->SupportedNodeParentClassNames.push_back("vtkMRMLTransformableNode");
     this->SupportedNodeParentClassNames.push_back("vtkMRMLStorableNode");
     this->SupportedNodeParentClassNames.push_back("vtkMRMLNode");
+    this->CopyPreservesNodeReferences = true;
   }
 
   virtual void CopyNode(vtkMRMLNode* source, vtkMRMLNode* target, bool shallowCopy /* =false */)
   {
+    // Representations that have been computed in the target (typically by the display pipeline of the proxy node)
+    // are kept in the cache, so that they don't need to be computed again next time the same item is copied.
+    this->StoreDerivedRepresentationsInCache(target);
+
     int oldModified = target->StartModify();
     vtkMRMLSegmentationNode* targetSegmentationNode = vtkMRMLSegmentationNode::SafeDownCast(target);
     vtkMRMLSegmentationNode* sourceSegmentationNode = vtkMRMLSegmentationNode::SafeDownCast(source);
     this->CopyNodeAttributes(source, target);
-    // targetScalarVolumeNode->SetAndObserveTransformNodeID is not called, as we want to keep the currently applied transform
+    // targetVolumeNode->SetAndObserveTransformNodeID is not called, as we want to keep the currently applied transform
     vtkSmartPointer<vtkSegmentation> targetSegmentation = sourceSegmentationNode->GetSegmentation();
     if (!shallowCopy && targetSegmentation.GetPointer() != NULL)
     {
+      // Copy into the current master representation buffers of the target if they are not shared and have the same layout
+      if (this->IsOwnedDataObject(target, targetSegmentationNode->GetSegmentation())
+        && this->CopySegmentationIntoExistingBuffers(sourceSegmentationNode->GetSegmentation(), targetSegmentationNode->GetSegmentation()))
+      {
+        this->AddCachedDerivedRepresentations(sourceSegmentationNode, targetSegmentationNode);
+        target->Modified();
+        target->EndModify(oldModified);
+        return;
+      }
       targetSegmentation = vtkSmartPointer<vtkSegmentation>::Take(sourceSegmentationNode->GetSegmentation()->NewInstance());
       targetSegmentation->DeepCopy(sourceSegmentationNode->GetSegmentation());
+      this->SetOwnedDataObject(target, targetSegmentation);
     }
     targetSegmentationNode->SetAndObserveSegmentation(targetSegmentation);
+    if (!shallowCopy)
+    {
+      this->AddCachedDerivedRepresentations(sourceSegmentationNode, targetSegmentationNode);
+    }
     target->EndModify(oldModified);
   }
 
+protected:
+  /// Derived representations computed for a sequence item.
+  /// Sequence items are not modified, representations are only stored in this cache.
+  struct DerivedRepresentationCacheEntry
+  {
+    DerivedRepresentationCacheEntry() : SourceMasterRepresentationTime(0), TargetMasterRepresentationTime(0), MemorySizeKB(0) {}
+    vtkWeakPointer<vtkMRMLSegmentationNode> SourceNode;
+    // Node that the source was last copied into, its derived representations are stored
+    // in this entry when the node is copied into again.
+    vtkWeakPointer<vtkMRMLNode> TargetNode;
+    // Modification time of master representations right after copying,
+    // used for detecting if the target or source has been modified since then.
+    vtkMTimeType SourceMasterRepresentationTime;
+    vtkMTimeType TargetMasterRepresentationTime;
+    // Derived representations by segment ID and representation name
+    std::map< std::string, std::map< std::string, vtkSmartPointer<vtkDataObject> > > Representations;
+    // Memory used by Representations (in kibibytes)
+    unsigned long MemorySizeKB;
+  };
+
+  /// Returns the latest modification time of master representations of all segments
+  static vtkMTimeType GetMasterRepresentationTime(vtkSegmentation* segmentation)
+  {
+    vtkMTimeType masterRepresentationTime = 0;
+    if (segmentation == NULL)
+    {
+      return masterRepresentationTime;
+    }
+    std::string masterRepresentationName = segmentation->GetMasterRepresentationName();
+    std::vector< std::string > segmentIds;
+    segmentation->GetSegmentIDs(segmentIds);
+    for (std::vector< std::string >::iterator segmentIdIt = segmentIds.begin(); segmentIdIt != segmentIds.end(); ++segmentIdIt)
+    {
+      vtkDataObject* masterRepresentation = segmentation->GetSegment(*segmentIdIt)->GetRepresentation(masterRepresentationName);
+      if (masterRepresentation && masterRepresentation->GetMTime() > masterRepresentationTime)
+      {
+        masterRepresentationTime = masterRepresentation->GetMTime();
+      }
+    }
+    return masterRepresentationTime;
+  }
+
+  /// Store representations that exist in the target but not in the item that it was copied from.
+  /// Representation objects are not copied but shared: derived representations are replaced
+  /// (not modified in-place) when the master representation changes.
+  void StoreDerivedRepresentationsInCache(vtkMRMLNode* target)
+  {
+    std::lock_guard<std::mutex> lock(this->DerivedRepresentationCacheMutex);
+    for (std::list<DerivedRepresentationCacheEntry>::iterator entryIt = this->DerivedRepresentationCache.begin();
+      entryIt != this->DerivedRepresentationCache.end(); ++entryIt)
+    {
+      if (entryIt->TargetNode.GetPointer() != target)
+      {
+        continue;
+      }
+      entryIt->TargetNode = NULL;
+      vtkMRMLSegmentationNode* targetSegmentationNode = vtkMRMLSegmentationNode::SafeDownCast(target);
+      vtkMRMLSegmentationNode* sourceSegmentationNode = entryIt->SourceNode;
+      if (targetSegmentationNode == NULL || sourceSegmentationNode == NULL)
+      {
+        continue;
+      }
+      vtkSegmentation* targetSegmentation = targetSegmentationNode->GetSegmentation();
+      vtkSegmentation* sourceSegmentation = sourceSegmentationNode->GetSegmentation();
+      if (targetSegmentation == NULL || sourceSegmentation == NULL || targetSegmentation == sourceSegmentation)
+      {
+        continue;
+      }
+      if (GetMasterRepresentationTime(targetSegmentation) != entryIt->TargetMasterRepresentationTime
+        || GetMasterRepresentationTime(sourceSegmentation) != entryIt->SourceMasterRepresentationTime)
+      {
+        // segmentation has been edited since it was copied, derived representations may not match the source anymore
+        entryIt->Representations.clear();
+        entryIt->MemorySizeKB = 0;
+        continue;
+      }
+      std::string masterRepresentationName = sourceSegmentation->GetMasterRepresentationName();
+      if (masterRepresentationName != std::string(targetSegmentation->GetMasterRepresentationName()))
+      {
+        continue;
+      }
+      std::vector< std::string > segmentIds;
+      sourceSegmentation->GetSegmentIDs(segmentIds);
+      for (std::vector< std::string >::iterator segmentIdIt = segmentIds.begin(); segmentIdIt != segmentIds.end(); ++segmentIdIt)
+      {
+        vtkSegment* sourceSegment = sourceSegmentation->GetSegment(*segmentIdIt);
+        vtkSegment* targetSegment = targetSegmentation->GetSegment(*segmentIdIt);
+        if (targetSegment == NULL)
+        {
+          continue;
+        }
+        std::vector< std::string > targetRepresentationNames;
+        targetSegment->GetContainedRepresentationNames(targetRepresentationNames);
+        for (std::vector< std::string >::iterator nameIt = targetRepresentationNames.begin(); nameIt != targetRepresentationNames.end(); ++nameIt)
+        {
+          if (*nameIt == masterRepresentationName || sourceSegment->GetRepresentation(*nameIt) != NULL)
+          {
+            continue;
+          }
+          entryIt->Representations[*segmentIdIt][*nameIt] = targetSegment->GetRepresentation(*nameIt);
+        }
+      }
+      entryIt->MemorySizeKB = GetRepresentationsMemorySize(entryIt->Representations);
+    }
+    this->RemoveDerivedRepresentationCacheEntriesOverBudget();
+  }
+
+  /// Memory used by all representations (in kibibytes)
+  static unsigned long GetRepresentationsMemorySize(
+    const std::map< std::string, std::map< std::string, vtkSmartPointer<vtkDataObject> > >& representations)
+  {
+    unsigned long memorySizeKB = 0;
+    for (std::map< std::string, std::map< std::string, vtkSmartPointer<vtkDataObject> > >::const_iterator segmentIt = representations.begin();
+      segmentIt != representations.end(); ++segmentIt)
+    {
+      for (std::map< std::string, vtkSmartPointer<vtkDataObject> >::const_iterator representationIt = segmentIt->second.begin();
+        representationIt != segmentIt->second.end(); ++representationIt)
+      {
+        if (representationIt->second.GetPointer() != NULL)
+        {
+          memorySizeKB += representationIt->second->GetActualMemorySize();
+        }
+      }
+    }
+    return memorySizeKB;
+  }
+
+  /// Drop entries of deleted items, and least recently used entries that do not fit in the memory budget.
+  /// The most recently used entry is always kept. Caller must lock DerivedRepresentationCacheMutex.
+  void RemoveDerivedRepresentationCacheEntriesOverBudget()
+  {
+    unsigned long memorySizeKB = 0;
+    for (std::list<DerivedRepresentationCacheEntry>::iterator cacheIt = this->DerivedRepresentationCache.begin();
+      cacheIt != this->DerivedRepresentationCache.end(); )
+    {
+      memorySizeKB += cacheIt->MemorySizeKB;
+      if (cacheIt->SourceNode.GetPointer() == NULL
+        || (cacheIt != this->DerivedRepresentationCache.begin() && memorySizeKB > DERIVED_REPRESENTATION_CACHE_MEMORY_BUDGET_KB))
+      {
+        memorySizeKB -= cacheIt->MemorySizeKB;
+        cacheIt = this->DerivedRepresentationCache.erase(cacheIt);
+      }
+      else
+      {
+        ++cacheIt;
+      }
+    }
+  }
+
+  /// Add cached derived representations of the source item to the target
+  /// and remember the target so that representations computed later are stored as well.
+  void AddCachedDerivedRepresentations(vtkMRMLSegmentationNode* source, vtkMRMLSegmentationNode* target)
+  {
+    vtkSegmentation* sourceSegmentation = source->GetSegmentation();
+    vtkSegmentation* targetSegmentation = target->GetSegmentation();
+    if (sourceSegmentation == NULL || targetSegmentation == NULL || sourceSegmentation == targetSegmentation)
+    {
+      return;
+    }
+    std::lock_guard<std::mutex> lock(this->DerivedRepresentationCacheMutex);
+    vtkMTimeType sourceMasterRepresentationTime = GetMasterRepresentationTime(sourceSegmentation);
+    std::list<DerivedRepresentationCacheEntry>::iterator entryIt = this->DerivedRepresentationCache.begin();
+    for (; entryIt != this->DerivedRepresentationCache.end(); ++entryIt)
+    {
+      if (entryIt->SourceNode.GetPointer() == source)
+      {
+        break;
+      }
+    }
+    if (entryIt == this->DerivedRepresentationCache.end())
+    {
+      this->DerivedRepresentationCache.push_front(DerivedRepresentationCacheEntry());
+      entryIt = this->DerivedRepresentationCache.begin();
+      entryIt->SourceNode = source;
+    }
+    else
+    {
+      // Most recently used entries are kept at the front
+      this->DerivedRepresentationCache.splice(this->DerivedRepresentationCache.begin(), this->DerivedRepresentationCache, entryIt);
+      if (entryIt->SourceMasterRepresentationTime != sourceMasterRepresentationTime)
+      {
+        // item has been edited since the representations were stored
+        entryIt->Representations.clear();
+        entryIt->MemorySizeKB = 0;
+      }
+    }
+
+    std::string masterRepresentationName = targetSegmentation->GetMasterRepresentationName();
+    for (std::map< std::string, std::map< std::string, vtkSmartPointer<vtkDataObject> > >::iterator segmentIt = entryIt->Representations.begin();
+      segmentIt != entryIt->Representations.end(); ++segmentIt)
+    {
+      vtkSegment* targetSegment = targetSegmentation->GetSegment(segmentIt->first);
+      if (targetSegment == NULL)
+      {
+        continue;
+      }
+      for (std::map< std::string, vtkSmartPointer<vtkDataObject> >::iterator representationIt = segmentIt->second.begin();
+        representationIt != segmentIt->second.end(); ++representationIt)
+      {
+        if (representationIt->first == masterRepresentationName || targetSegment->GetRepresentation(representationIt->first) != NULL)
+        {
+          continue;
+        }
+        targetSegment->AddRepresentation(representationIt->first, representationIt->second);
+      }
+    }
+
+    entryIt->TargetNode = target;
+    entryIt->SourceMasterRepresentationTime = sourceMasterRepresentationTime;
+    entryIt->TargetMasterRepresentationTime = GetMasterRepresentationTime(targetSegmentation);
+
+    this->RemoveDerivedRepresentationCacheEntriesOverBudget();
+  }
+
+  /// Copy master representations into the existing buffers of the target segmentation.
+  /// Returns false and leaves the target unchanged if segments or master representation layouts are different.
+  /// Non-master representations are shared with the source (they are replaced, not modified, when the master changes).
+  bool CopySegmentationIntoExistingBuffers(vtkSegmentation* source, vtkSegmentation* target)
+  {
+    if (source == NULL || target == NULL)
+    {
+      return false;
+    }
+    std::string masterRepresentationName = source->GetMasterRepresentationName();
+    if (masterRepresentationName != std::string(target->GetMasterRepresentationName()))
+    {
+      return false;
+    }
+    std::vector< std::string > sourceSegmentIds;
+    std::vector< std::string > targetSegmentIds;
+    source->GetSegmentIDs(sourceSegmentIds);
+    target->GetSegmentIDs(targetSegmentIds);
+    if (sourceSegmentIds != targetSegmentIds)
+    {
+      return false;
+    }
+    // Check if all master representations can be copied before modifying anything
+    for (std::vector< std::string >::iterator segmentIdIt = sourceSegmentIds.begin(); segmentIdIt != sourceSegmentIds.end(); ++segmentIdIt)
+    {
+      vtkDataObject* sourceMaster = source->GetSegment(*segmentIdIt)->GetRepresentation(masterRepresentationName);
+      vtkDataObject* targetMaster = target->GetSegment(*segmentIdIt)->GetRepresentation(masterRepresentationName);
+      if (sourceMaster == NULL || targetMaster == NULL || strcmp(sourceMaster->GetClassName(), targetMaster->GetClassName()) != 0)
+      {
+        return false;
+      }
+      vtkImageData* sourceImage = vtkImageData::SafeDownCast(sourceMaster);
+      vtkImageData* targetImage = vtkImageData::SafeDownCast(targetMaster);
+      vtkPolyData* sourcePolyData = vtkPolyData::SafeDownCast(sourceMaster);
+      vtkPolyData* targetPolyData = vtkPolyData::SafeDownCast(targetMaster);
+      if (sourceImage && targetImage)
+      {
+        if (!IsSameDataSetAttributesLayout(sourceImage->GetPointData(), targetImage->GetPointData())
+          || !std::equal(sourceImage->GetExtent(), sourceImage->GetExtent() + 6, targetImage->GetExtent()))
+        {
+          return false;
+        }
+      }
+      else if (!sourcePolyData || !targetPolyData)
+      {
+        // unknown representation type
+        return false;
+      }
+    }
+
+    for (std::vector< std::string >::iterator segmentIdIt = sourceSegmentIds.begin(); segmentIdIt != sourceSegmentIds.end(); ++segmentIdIt)
+    {
+      vtkSegment* sourceSegment = source->GetSegment(*segmentIdIt);
+      vtkSegment* targetSegment = target->GetSegment(*segmentIdIt);
+
+      // Remove derived representations, they will be taken from the source after the master is updated
+      std::vector< std::string > targetRepresentationNames;
+      targetSegment->GetContainedRepresentationNames(targetRepresentationNames);
+      for (std::vector< std::string >::iterator nameIt = targetRepresentationNames.begin(); nameIt != targetRepresentationNames.end(); ++nameIt)
+      {
+        if (*nameIt != masterRepresentationName)
+        {
+          targetSegment->RemoveRepresentation(*nameIt);
+        }
+      }
+
+      vtkDataObject* sourceMaster = sourceSegment->GetRepresentation(masterRepresentationName);
+      vtkDataObject* targetMaster = targetSegment->GetRepresentation(masterRepresentationName);
+      vtkOrientedImageData* targetOrientedImage = vtkOrientedImageData::SafeDownCast(targetMaster);
+      if (targetOrientedImage)
+      {
+        targetOrientedImage->CopyDirections(sourceMaster);
+      }
+      if (!CopyImageDataIntoExistingBuffers(vtkImageData::SafeDownCast(sourceMaster), vtkImageData::SafeDownCast(targetMaster))
+        && !CopyPolyDataIntoExistingBuffers(vtkPolyData::SafeDownCast(sourceMaster), vtkPolyData::SafeDownCast(targetMaster), NULL))
+      {
+        // Mesh topology is different, the mesh has to be reallocated
+        targetMaster->DeepCopy(sourceMaster);
+      }
+
+      std::vector< std::string > sourceRepresentationNames;
+      sourceSegment->GetContainedRepresentationNames(sourceRepresentationNames);
+      for (std::vector< std::string >::iterator nameIt = sourceRepresentationNames.begin(); nameIt != sourceRepresentationNames.end(); ++nameIt)
+      {
+        if (*nameIt == masterRepresentationName)
+        {
+          continue;
+        }
+        // Cached derived representation, share it instead of copying
+        targetSegment->AddRepresentation(*nameIt, sourceSegment->GetRepresentation(*nameIt));
+      }
+
+      targetSegment->SetName(sourceSegment->GetName());
+      targetSegment->SetColor(sourceSegment->GetColor());
+      std::map< std::string, std::string > sourceTags;
+      std::map< std::string, std::string > targetTags;
+      sourceSegment->GetTags(sourceTags);
+      targetSegment->GetTags(targetTags);
+      for (std::map< std::string, std::string >::iterator tagIt = targetTags.begin(); tagIt != targetTags.end(); ++tagIt)
+      {
+        if (sourceTags.find(tagIt->first) == sourceTags.end())
+        {
+          targetSegment->RemoveTag(tagIt->first);
+        }
+      }
+      for (std::map< std::string, std::string >::iterator tagIt = sourceTags.begin(); tagIt != sourceTags.end(); ++tagIt)
+      {
+        targetSegment->SetTag(tagIt->first, tagIt->second);
+      }
+    }
+    target->Modified();
+    return true;
+  }
+
+  // Maximum memory used by cached derived representations (in kibibytes).
+  // All items of a typical sequence fit, so that looped playback does not compute representations again.
+  static const unsigned long DERIVED_REPRESENTATION_CACHE_MEMORY_BUDGET_KB = 1024 * 1024;
+
+  // Derived representations of recently copied items, most recently used first
+  std::list<DerivedRepresentationCacheEntry> DerivedRepresentationCache;
+  std::mutex DerivedRepresentationCacheMutex;
+
 };
 //----------------------------------------------------------------------------
 
@@ -380,6 +1738,9 @@ public:
     this->SupportedNodeParentClassNames.push_back("vtkMRMLStorableNode");
     this->SupportedNodeParentClassNames.push_back("vtkMRMLNode");
     this->DefaultSequenceStorageNodeClassName = "vtkMRMLLinearTransformSequenceStorageNode";
+    this->Matrix = vtkSmartPointer<vtkMatrix4x4>::New();
+    this->PreviousMatrix = vtkSmartPointer<vtkMatrix4x4>::New();
+    this->CopyPreservesNodeReferences = true;
   }
 
   virtual void CopyNode(vtkMRMLNode* source, vtkMRMLNode* target, bool shallowCopy /* =false */)
@@ -388,6 +1749,41 @@ public:
     vtkMRMLTransformNode* targetTransformNode = vtkMRMLTransformNode::SafeDownCast(target);
     vtkMRMLTransformNode* sourceTransformNode = vtkMRMLTransformNode::SafeDownCast(source);
     this->CopyNodeAttributes(source, target);
+
+    // Fast path for linear transforms: copy the matrix elements into the existing transform of the target,
+    // no transform objects are allocated. A matrix cannot be modified by the sequence and proxy node at the same time,
+    // so there is no need to share the transform object in shallow copy mode.
+    vtkMRMLLinearTransformNode* targetLinearTransformNode = vtkMRMLLinearTransformNode::SafeDownCast(target);
+    if (targetLinearTransformNode && vtkMRMLLinearTransformNode::SafeDownCast(source) && sourceTransformNode->IsLinear()
+      && targetLinearTransformNode->GetTransformToParent() != NULL)
+    {
+      {
+        // the temporary matrices are shared by all threads that copy transforms
+        std::lock_guard<std::recursive_mutex> lock(this->MatrixMutex);
+        sourceTransformNode->GetMatrixTransformToParent(this->Matrix);
+        targetLinearTransformNode->GetMatrixTransformToParent(this->PreviousMatrix);
+        bool matrixChanged = false;
+        for (int row = 0; row < 4 && !matrixChanged; row++)
+        {
+          for (int column = 0; column < 4; column++)
+          {
+            if (this->Matrix->GetElement(row, column) != this->PreviousMatrix->GetElement(row, column))
+            {
+              matrixChanged = true;
+              break;
+            }
+          }
+        }
+        if (matrixChanged)
+        {
+          // invokes a single TransformModifiedEvent
+          targetLinearTransformNode->SetMatrixTransformToParent(this->Matrix);
+        }
+      }
+      target->EndModify(oldModified);
+      return;
+    }
+
     vtkAbstractTransform* sourceTransform;
     bool setAsTransformToParent = vtkMRMLTransformNode::IsAbstractTransformComputedFromInverse(sourceTransformNode->GetTransformFromParent());
     if (setAsTransformToParent)
@@ -426,6 +1822,11 @@ public:
     // don't create display nodes for transforms by default
   }
 
+protected:
+  // Temporary matrices for copying linear transforms, allocated only once
+  vtkSmartPointer<vtkMatrix4x4> Matrix;
+  vtkSmartPointer<vtkMatrix4x4> PreviousMatrix;
+  std::recursive_mutex MatrixMutex;
 };
 
 //----------------------------------------------------------------------------
@@ -441,6 +1842,7 @@ public:
     this->SupportedNodeParentClassNames.push_back("vtkMRMLTransformableNode");
     this->SupportedNodeParentClassNames.push_back("vtkMRMLStorableNode");
     this->SupportedNodeParentClassNames.push_back("vtkMRMLNode");
+    this->CopyPreservesNodeReferences = true;
   }
 
   virtual void CopyNode(vtkMRMLNode* source, vtkMRMLNode* target, bool shallowCopy /* =false */)
@@ -452,13 +1854,65 @@ public:
     vtkSmartPointer<vtkPolyData> targetPolyData = sourceModelNode->GetPolyData();
     if (!shallowCopy && targetPolyData.GetPointer()!=NULL)
     {
+      // Copy into the current mesh buffers of the target if they are not shared and have the same layout
+      if (this->IsOwnedDataObject(target, targetModelNode->GetPolyData())
+        && CopyPolyDataIntoExistingBuffers(sourceModelNode->GetPolyData(), targetModelNode->GetPolyData(), &this->ImmutableDataObjects))
+      {
+        target->InvokeCustomModifiedEvent(vtkMRMLModelNode::PolyDataModifiedEvent);
+        target->EndModify(oldModified);
+        return;
+      }
+      // Target gets its own copy of topology shared between sequence items, as it may be modified in-place
+      // (e.g., the proxy node by other modules)
       targetPolyData = vtkSmartPointer<vtkPolyData>::Take(sourceModelNode->GetPolyData()->NewInstance());
       targetPolyData->DeepCopy(sourceModelNode->GetPolyData());
+      this->SetOwnedDataObject(target, targetPolyData);
     }
     targetModelNode->SetAndObservePolyData(targetPolyData);
     target->EndModify(oldModified);
   }
 
+  virtual void ShareIdenticalContent(vtkMRMLNode* node, vtkMRMLNode* referenceNode)
+  {
+    vtkMRMLModelNode* modelNode = vtkMRMLModelNode::SafeDownCast(node);
+    vtkMRMLModelNode* referenceModelNode = vtkMRMLModelNode::SafeDownCast(referenceNode);
+    if (modelNode == NULL || referenceModelNode == NULL)
+    {
+      return;
+    }
+    vtkPolyData* polyData = modelNode->GetPolyData();
+    vtkPolyData* referencePolyData = referenceModelNode->GetPolyData();
+    if (polyData == NULL || referencePolyData == NULL || polyData == referencePolyData)
+    {
+      return;
+    }
+    // Points are not shared, as they usually change between items (deforming mesh)
+    bool topologyChanged = false;
+    for (int cellArrayIndex = 0; cellArrayIndex < NUMBER_OF_CELL_ARRAYS; ++cellArrayIndex)
+    {
+      vtkCellArray* cells = GetCellArray(polyData, cellArrayIndex);
+      vtkCellArray* referenceCells = GetCellArray(referencePolyData, cellArrayIndex);
+      if (cells == referenceCells || cells->GetNumberOfCells() == 0 || this->ImmutableDataObjects.Contains(cells)
+        || !IsSameCellArrayContent(cells, referenceCells))
+      {
+        continue;
+      }
+      this->ImmutableDataObjects.Add(referenceCells);
+      SetCellArray(polyData, cellArrayIndex, referenceCells);
+      topologyChanged = true;
+    }
+    if (topologyChanged)
+    {
+      polyData->DeleteCells();
+    }
+    ShareIdenticalArrays(polyData->GetPointData(), referencePolyData->GetPointData(), &this->ImmutableDataObjects);
+    ShareIdenticalArrays(polyData->GetCellData(), referencePolyData->GetCellData(), &this->ImmutableDataObjects);
+  }
+
+protected:
+  // Cells and arrays that are shared between model nodes (see ShareIdenticalContent)
+  ImmutableDataObjectRegistry ImmutableDataObjects;
+
 };
 
 //----------------------------------------------------------------------------
@@ -470,6 +1924,7 @@ public:
   {
     this->SupportedNodeClassName = "vtkMRMLSliceCompositeNode";
     this->SupportedNodeParentClassNames.push_back("vtkMRMLNode");
+    this->CopyPreservesNodeReferences = true;
   }
   virtual void CopyNode(vtkMRMLNode* source, vtkMRMLNode* target, bool vtkNotUsed(shallowCopy) /* =false */)
   {
@@ -512,6 +1967,7 @@ public:
   {
     this->RecordingEvents->InsertNextValue(vtkMRMLMarkupsNode::PointModifiedEvent);
     this->SupportedNodeClassName = "vtkMRMLMarkupsNode";
+    this->DefaultSequenceStorageNodeClassName = "vtkMRMLMarkupsSequenceStorageNode";
     this->SupportedNodeParentClassNames.push_back("vtkMRMLDisplayableNode");
     this->SupportedNodeParentClassNames.push_back("vtkMRMLTransformableNode");
     this->SupportedNodeParentClassNames.push_back("vtkMRMLStorableNode");
@@ -525,10 +1981,105 @@ public:
     int oldModified = target->StartModify();
     vtkMRMLMarkupsNode* targetMarkupsNode = vtkMRMLMarkupsNode::SafeDownCast(target);
     vtkMRMLMarkupsNode* sourceMarkupsNode = vtkMRMLMarkupsNode::SafeDownCast(source);
+    if (this->IsSameMarkupsStructure(sourceMarkupsNode, targetMarkupsNode))
+    {
+      // Only point positions and states differ (typical when replaying a tracked point list),
+      // update them in-place instead of rebuilding the whole markup list.
+      this->CopyNodeAttributes(source, target);
+      std::vector<int> modifiedMarkupIndices;
+      this->CopyMarkupPointsAndStates(sourceMarkupsNode, targetMarkupsNode, modifiedMarkupIndices);
+      if (!modifiedMarkupIndices.empty())
+      {
+        target->Modified();
+      }
+      target->EndModify(oldModified);
+      // Same notification as vtkMRMLMarkupsNode setters: one event per modified markup, with its index as call data
+      for (std::vector<int>::iterator markupIndexIt = modifiedMarkupIndices.begin(); markupIndexIt != modifiedMarkupIndices.end(); ++markupIndexIt)
+      {
+        int markupIndex = *markupIndexIt;
+        target->InvokeCustomModifiedEvent(vtkMRMLMarkupsNode::PointModifiedEvent, (void*)&markupIndex);
+      }
+      return;
+    }
     targetMarkupsNode->Copy(sourceMarkupsNode);
     target->EndModify(oldModified);
   }
 
+protected:
+
+  /// Returns true if source and target only differ in point positions and point states
+  bool IsSameMarkupsStructure(vtkMRMLMarkupsNode* source, vtkMRMLMarkupsNode* target)
+  {
+    if (source == NULL || target == NULL
+      || strcmp(source->GetClassName(), target->GetClassName()) != 0
+      || source->GetLocked() != target->GetLocked()
+      || source->GetMarkupLabelFormat() != target->GetMarkupLabelFormat())
+    {
+      return false;
+    }
+    int numberOfMarkups = source->GetNumberOfMarkups();
+    if (target->GetNumberOfMarkups() != numberOfMarkups)
+    {
+      return false;
+    }
+    for (int markupIndex = 0; markupIndex < numberOfMarkups; markupIndex++)
+    {
+      Markup* sourceMarkup = source->GetNthMarkup(markupIndex);
+      Markup* targetMarkup = target->GetNthMarkup(markupIndex);
+      if (sourceMarkup == NULL || targetMarkup == NULL
+        || sourceMarkup->points.size() != targetMarkup->points.size()
+        || sourceMarkup->ID != targetMarkup->ID
+        || sourceMarkup->Label != targetMarkup->Label
+        || sourceMarkup->Description != targetMarkup->Description
+        || sourceMarkup->AssociatedNodeID != targetMarkup->AssociatedNodeID)
+      {
+        return false;
+      }
+    }
+    return true;
+  }
+
+  /// Copy point positions, orientations, and selected/locked/visibility states.
+  /// Source and target must have the same structure (see IsSameMarkupsStructure).
+  /// Indices of markups that have any of their values changed are returned in modifiedMarkupIndices.
+  void CopyMarkupPointsAndStates(vtkMRMLMarkupsNode* source, vtkMRMLMarkupsNode* target, std::vector<int>& modifiedMarkupIndices)
+  {
+    modifiedMarkupIndices.clear();
+    int numberOfMarkups = source->GetNumberOfMarkups();
+    for (int markupIndex = 0; markupIndex < numberOfMarkups; markupIndex++)
+    {
+      bool modified = false;
+      Markup* sourceMarkup = source->GetNthMarkup(markupIndex);
+      Markup* targetMarkup = target->GetNthMarkup(markupIndex);
+      if (sourceMarkup->points != targetMarkup->points)
+      {
+        targetMarkup->points = sourceMarkup->points;
+        modified = true;
+      }
+      for (int i = 0; i < 4; i++)
+      {
+        if (targetMarkup->OrientationWXYZ[i] != sourceMarkup->OrientationWXYZ[i])
+        {
+          targetMarkup->OrientationWXYZ[i] = sourceMarkup->OrientationWXYZ[i];
+          modified = true;
+        }
+      }
+      if (targetMarkup->Selected != sourceMarkup->Selected
+        || targetMarkup->Locked != sourceMarkup->Locked
+        || targetMarkup->Visibility != sourceMarkup->Visibility)
+      {
+        targetMarkup->Selected = sourceMarkup->Selected;
+        targetMarkup->Locked = sourceMarkup->Locked;
+        targetMarkup->Visibility = sourceMarkup->Visibility;
+        modified = true;
+      }
+      if (modified)
+      {
+        modifiedMarkupIndices.push_back(markupIndex);
+      }
+    }
+  }
+
 };
 
 //----------------------------------------------------------------------------
@@ -542,6 +2093,7 @@ public:
     this->SupportedNodeParentClassNames.push_back("vtkMRMLTransformableNode");
     this->SupportedNodeParentClassNames.push_back("vtkMRMLStorableNode");
     this->SupportedNodeParentClassNames.push_back("vtkMRMLNode");
+    this->CopyPreservesNodeReferences = true;
   }
 
   virtual void CopyNode(vtkMRMLNode* source, vtkMRMLNode* target, bool vtkNotUsed(shallowCopy) /* =false */)
@@ -574,6 +2126,7 @@ public:
     this->SupportedNodeClassName = "vtkMRMLSliceNode";
     this->SupportedNodeParentClassNames.push_back("vtkMRMLAbstractViewNode");
     this->SupportedNodeParentClassNames.push_back("vtkMRMLNode");
+    this->CopyPreservesNodeReferences = true;
   }
 
   virtual void CopyNode(vtkMRMLNode* source, vtkMRMLNode* target, bool vtkNotUsed(shallowCopy) /* =false */)
@@ -616,6 +2169,7 @@ public:
     this->SupportedNodeClassName = "vtkMRMLViewNode";
     this->SupportedNodeParentClassNames.push_back("vtkMRMLAbstractViewNode");
     this->SupportedNodeParentClassNames.push_back("vtkMRMLNode");
+    this->CopyPreservesNodeReferences = true;
   }
 
   virtual void CopyNode(vtkMRMLNode* source, vtkMRMLNode* target, bool vtkNotUsed(shallowCopy) /* =false */)
@@ -654,11 +2208,20 @@ public:
     vtkMRMLDoubleArrayNode* targetDoubleArrayNode = vtkMRMLDoubleArrayNode::SafeDownCast(target);
     vtkMRMLDoubleArrayNode* sourceDoubleArrayNode = vtkMRMLDoubleArrayNode::SafeDownCast(source);
     targetDoubleArrayNode->CopyWithoutModifiedEvent(sourceDoubleArrayNode); // Copies the attributes, etc.
-    vtkDoubleArray* targetDoubleArray = sourceDoubleArrayNode->GetArray();
-    if (!shallowCopy && targetDoubleArray!=NULL)
+    vtkSmartPointer<vtkDoubleArray> targetDoubleArray = sourceDoubleArrayNode->GetArray();
+    if (!shallowCopy && targetDoubleArray.GetPointer()!=NULL)
     {
-      targetDoubleArray = sourceDoubleArrayNode->GetArray()->NewInstance();
+      if (this->IsOwnedDataObject(target, targetDoubleArrayNode->GetArray()))
+      {
+        // DeepCopy only reallocates memory if the number of values is increased
+        targetDoubleArrayNode->GetArray()->DeepCopy(sourceDoubleArrayNode->GetArray());
+        target->Modified();
+        target->EndModify(oldModified);
+        return;
+      }
+      targetDoubleArray = vtkSmartPointer<vtkDoubleArray>::Take(sourceDoubleArrayNode->GetArray()->NewInstance());
       targetDoubleArray->DeepCopy(sourceDoubleArrayNode->GetArray());
+      this->SetOwnedDataObject(target, targetDoubleArray);
     }
     targetDoubleArrayNode->SetArray(targetDoubleArray);
     target->EndModify(oldModified);
@@ -854,23 +2417,42 @@ void vtkMRMLNodeSequencer::RegisterNodeSequencer(NodeSequencer* sequencer)
     }
     this->SupportedNodeClassNames.push_back((*sequencerIt)->GetSupportedNodeClassName());
   }
+
+  // The new sequencer may be more specific for some node classes than the previously found ones
+  this->NodeSequencerCache.clear();
+  this->Modified();
 }
 
 //-----------------------------------------------------------
 vtkMRMLNodeSequencer::NodeSequencer* vtkMRMLNodeSequencer::GetNodeSequencer(vtkMRMLNode* node)
 {
+  if (node == NULL)
+  {
+    // default sequencer
+    return this->NodeSequencers.back();
+  }
+
+  std::string nodeClassName = node->GetClassName();
+  std::unordered_map< std::string, NodeSequencer* >::iterator cachedSequencerIt = this->NodeSequencerCache.find(nodeClassName);
+  if (cachedSequencerIt != this->NodeSequencerCache.end())
+  {
+    return cachedSequencerIt->second;
+  }
+
+  // default sequencer
+  NodeSequencer* foundSequencer = this->NodeSequencers.back();
   for (std::list< NodeSequencer* >::iterator sequencerIt = this->NodeSequencers.begin();
     sequencerIt != this->NodeSequencers.end(); ++sequencerIt)
   {
     if ((*sequencerIt)->IsNodeSupported(node))
     {
       // found suitable sequencer
-      return (*sequencerIt);
+      foundSequencer = (*sequencerIt);
+      break;
     }
   }
-
-  // default sequencer
-  return this->NodeSequencers.back();
+  this->NodeSequencerCache[nodeClassName] = foundSequencer;
+  return foundSequencer;
 }
 
 //-----------------------------------------------------------
@@ -22,8 +22,13 @@
 #include <vtkObject.h>
 #include <vtkSingleton.h>
 #include <vtkSmartPointer.h>
+#include <vtkWeakPointer.h>
 
 #include <list>
+#include <map>
+#include <mutex>
+#include <string>
+#include <unordered_map>
 #include <vector>
 
 #include "vtkSlicerSequencesModuleMRMLExport.h"
@@ -52,7 +57,71 @@ public:
     NodeSequencer();
     virtual ~NodeSequencer();
     virtual void CopyNode(vtkMRMLNode* source, vtkMRMLNode* target, bool shallowCopy = false);
-    virtual vtkMRMLNode* DeepCopyNodeToScene(vtkMRMLNode* source, vtkMRMLScene* scene);
+    /// Update target with the content of source (using ShareNodeContent if shareContent is true, CopyNode otherwise)
+    /// without changing node references of the target (display, storage, parent transform, etc. nodes are kept).
+    /// If CopyNode and ShareNodeContent of the sequencer do not modify node references (see GetCopyPreservesNodeReferences)
+    /// then nothing else is done, otherwise references are saved and restored using a reference storage node
+    /// that is reused between calls. Must be called from the main thread.
+    void CopyNodeContent(vtkMRMLNode* source, vtkMRMLNode* target, bool shallowCopy = false, bool shareContent = false);
+    /// Returns true if CopyNode and ShareNodeContent leave the node references of the target unchanged.
+    bool GetCopyPreservesNodeReferences();
+    /// Make target refer to the content of source without allowing changes of the target to modify the source.
+    /// Large data objects (such as image data) may be shared between source and target. Before target content is
+    /// modified in-place, DetachNodeContent must be called to make the target own its content (copy-on-write).
+    /// The source is marked as sharing its content, too: the sequencer does not overwrite its data in-place anymore,
+    /// and DetachNodeContent(source) must be called before the source content is modified in-place.
+    /// Default implementation performs a deep copy.
+    virtual void ShareNodeContent(vtkMRMLNode* source, vtkMRMLNode* target);
+    /// Replace data shared by ShareNodeContent with a private copy.
+    /// Does nothing if target does not share data anymore (see IsNodeContentShared).
+    /// If PrepareNodeContent(target, target) has been called since the content was shared (e.g., in a worker thread)
+    /// then the prepared copy is swapped in instead of copying the shared data again.
+    /// Default implementation does nothing (default ShareNodeContent does not share any data).
+    virtual void DetachNodeContent(vtkMRMLNode* target);
+    /// Returns true if target still refers to data that was shared with it by ShareNodeContent
+    /// (it has not been detached or replaced since then).
+    /// Default implementation returns false (default ShareNodeContent does not share any data).
+    virtual bool IsNodeContentShared(vtkMRMLNode* target);
+    /// Add a deep copy of the source node to the scene.
+    /// If preallocatedTarget is specified (it must not be in a scene yet) then the source is copied into it,
+    /// reusing its data buffers if possible, instead of allocating a new node.
+    virtual vtkMRMLNode* DeepCopyNodeToScene(vtkMRMLNode* source, vtkMRMLScene* scene, vtkMRMLNode* preallocatedTarget = NULL);
+    /// Reduce memory usage by making node refer to data objects of referenceNode that have identical content
+    /// (for example, mesh connectivity in a sequence of deforming models).
+    /// Shared data objects are not modified in-place by the sequencer, and CopyNode copies them instead of referencing them
+    /// (proxy nodes may be modified in-place by other modules). Data objects of node that are shared already
+    /// are not compared again, therefore node can be compared to multiple reference nodes (e.g., both neighbor items).
+    /// Default implementation does nothing.
+    virtual void ShareIdenticalContent(vtkMRMLNode* node, vtkMRMLNode* referenceNode);
+    /// Copy bulk data (such as voxel values) of source into the data buffers that target already owns,
+    /// without modifying any other property of target and without invoking any events.
+    /// Content of different target nodes may be copied concurrently, from worker threads.
+    /// If it returns true then the next CopyNode(source, target, false) call completes the update
+    /// of target without copying the bulk data again.
+    /// Default implementation does nothing and returns false.
+    virtual bool PrecopyNodeContent(vtkMRMLNode* source, vtkMRMLNode* target);
+    /// Copy the content of source into a back buffer of target (a data object that target does not use yet),
+    /// without modifying target and without invoking any events. May be called from a worker thread.
+    /// Content of multiple sources (e.g., upcoming items of a sequence) may be prepared for the same target.
+    /// If it returns true then the next CopyNode(source, target, false) call swaps the back buffer into
+    /// target instead of copying (as long as the source content has not been modified since then),
+    /// so that target switches to the new content at once. The replaced data object is kept as
+    /// spare back buffer, which is reused for preparing the next item.
+    /// Returns true without copying if the content of source is prepared already.
+    /// Default implementation does nothing and returns false.
+    virtual bool PrepareNodeContent(vtkMRMLNode* source, vtkMRMLNode* target);
+    /// Make back buffers of target that contain the content of other sources than keptSources spare
+    /// (their memory is reused by the next PrepareNodeContent calls).
+    void RecyclePreparedNodeContent(vtkMRMLNode* target, const std::vector<vtkMRMLNode*>& keptSources);
+    /// Release back buffers that were created for target by PrepareNodeContent.
+    /// Must not be called while PrepareNodeContent is in progress for the same target.
+    void DiscardPreparedNodeContent(vtkMRMLNode* target);
+    /// Memory used by back buffers of all target nodes of this sequencer (in kibibytes)
+    unsigned long GetPreparedNodeContentMemorySize();
+    /// Set names of node attributes of target that are not removed or changed when content is copied into target
+    /// (e.g., item attributes that are stored in the sequence node and are set in the proxy node separately).
+    /// Empty list removes target from the registry.
+    void SetPreservedAttributeNames(vtkMRMLNode* target, const std::vector<std::string>& attributeNames);
     virtual vtkIntArray* GetRecordingEvents();
     virtual std::string GetSupportedNodeClassName();
     virtual bool IsNodeSupported(vtkMRMLNode* node);
@@ -63,7 +132,93 @@ public:
 
   protected:
     void CopyNodeAttributes(vtkMRMLNode* source, vtkMRMLNode* target);
-    
+
+    /// Remember that the data object was created by this sequencer for the target node and it is not
+    /// referenced by any other node, therefore its buffers may be overwritten when the next item is copied.
+    /// If dataObject is NULL then the target is removed from the registry.
+    void SetOwnedDataObject(vtkMRMLNode* target, vtkObject* dataObject);
+    /// Returns true if the data object was created by this sequencer for the target node (see SetOwnedDataObject).
+    bool IsOwnedDataObject(vtkMRMLNode* target, vtkObject* dataObject);
+    /// Remember that the data object of the target node refers to data of another node (see ShareNodeContent).
+    /// If dataObject is NULL then the target is removed from the registry.
+    void SetSharedDataObject(vtkMRMLNode* target, vtkObject* dataObject);
+    /// Returns true if the data object was shared with the target node by ShareNodeContent (see SetSharedDataObject).
+    bool IsSharedDataObject(vtkMRMLNode* target, vtkObject* dataObject);
+
+    /// Remember that the content of the source data object has been copied into target by PrecopyNodeContent.
+    void SetPrecopiedDataObject(vtkMRMLNode* target, vtkObject* sourceDataObject);
+    /// Returns true if the current content of the source data object has been copied into target
+    /// by PrecopyNodeContent. The information is cleared, as it is only valid for one CopyNode call.
+    bool TakePrecopiedDataObject(vtkMRMLNode* target, vtkObject* sourceDataObject);
+
+    /// Get a spare back buffer of target for preparing the content of source in PrepareNodeContent.
+    /// Returns false if the current content of sourceDataObject is prepared (or being prepared) already.
+    /// If true is returned then EndPrepareDataObject must be called.
+    /// dataObject is set to NULL if there is no spare back buffer.
+    bool BeginPrepareDataObject(vtkMRMLNode* target, vtkMRMLNode* source, vtkObject* sourceDataObject,
+      vtkSmartPointer<vtkObject>& dataObject);
+    /// Store the back buffer that has been filled with content of sourceDataObject (at sourceMTime).
+    void EndPrepareDataObject(vtkMRMLNode* target, vtkMRMLNode* source, vtkObject* dataObject,
+      vtkObject* sourceDataObject, vtkMTimeType sourceMTime);
+    /// Returns the back buffer of target that contains the current content of sourceDataObject (NULL if there is none).
+    /// The caller takes over the data object.
+    vtkSmartPointer<vtkObject> TakePreparedDataObject(vtkMRMLNode* target, vtkObject* sourceDataObject);
+    /// Returns true if a back buffer of target contains the current content of sourceDataObject.
+    bool HasPreparedDataObject(vtkMRMLNode* target, vtkObject* sourceDataObject);
+    /// Keep a data object that target does not use anymore as spare back buffer
+    /// (if back buffers are used for target and it has no spare back buffer yet).
+    void SetBackBufferDataObject(vtkMRMLNode* target, vtkObject* dataObject);
+
+    /// Data object that was allocated by this sequencer for a target node (see SetOwnedDataObject)
+    struct OwnedDataObject
+    {
+      // Used for detecting that the target node has been deleted (and maybe another node was allocated at the same address)
+      vtkWeakPointer<vtkMRMLNode> TargetNode;
+      vtkWeakPointer<vtkObject> DataObject;
+    };
+    // Data objects that were allocated by this sequencer for a target node.
+    // Only nodes that are updated repeatedly (proxy nodes and preallocated sequence items) are registered.
+    std::map< vtkMRMLNode*, OwnedDataObject > OwnedDataObjects;
+    // Data objects that refer to data of other nodes (set by ShareNodeContent, until the target is detached)
+    std::map< vtkMRMLNode*, OwnedDataObject > SharedDataObjects;
+    // Number of OwnedDataObjects entries after deleted objects were last removed from the map.
+    size_t OwnedDataObjectsCleanupSize;
+    // Number of SharedDataObjects entries after deleted objects were last removed from the map.
+    size_t SharedDataObjectsCleanupSize;
+    // Nodes may be copied in a background thread (e.g., while recording), therefore
+    // access to OwnedDataObjects (and PrecopiedDataObjects) is serialized.
+    std::mutex OwnedDataObjectsMutex;
+    /// Node attributes of a target node that CopyNodeAttributes leaves unchanged (see SetPreservedAttributeNames)
+    struct PreservedAttributes
+    {
+      vtkWeakPointer<vtkMRMLNode> TargetNode;
+      std::vector<std::string> AttributeNames;
+    };
+    // Access is serialized by OwnedDataObjectsMutex
+    std::map< vtkMRMLNode*, PreservedAttributes > PreservedAttributeNames;
+    // Source data object (and its modified time) that was copied into the target by PrecopyNodeContent.
+    std::map< vtkMRMLNode*, std::pair<vtkObject*, vtkMTimeType> > PrecopiedDataObjects;
+
+    /// Back buffer of a target node (see PrepareNodeContent)
+    struct PreparedDataObject
+    {
+      PreparedDataObject() : SourceNode(NULL), SourceDataObject(NULL), SourceMTime(0), InProgress(false) {}
+      vtkSmartPointer<vtkObject> DataObject;
+      // Source node and data object (and its modified time) that DataObject contains, NULL for spare buffers
+      vtkMRMLNode* SourceNode;
+      vtkObject* SourceDataObject;
+      vtkMTimeType SourceMTime;
+      // Set while a worker thread fills DataObject (DataObject is NULL meanwhile)
+      bool InProgress;
+    };
+    std::map< vtkMRMLNode*, std::vector<PreparedDataObject> > PreparedDataObjects;
+
+    // Node sequencers that copy only specific properties and data objects (instead of calling vtkMRMLNode::Copy)
+    // leave node references unchanged. They set this to true so that references are not saved and restored.
+    bool CopyPreservesNodeReferences;
+    // Nodes used for temporarily storing node references in CopyNodeContent (one for each node class)
+    std::map< std::string, vtkSmartPointer<vtkMRMLNode> > ReferenceStorageNodes;
+
     vtkSmartPointer< vtkIntArray > RecordingEvents;
     // Name of the MRML node class that this sequencer supports.
     // It may be an abstract class.
@@ -87,6 +242,9 @@ public:
   /// Return the singleton instance with no reference counting.
   static vtkMRMLNodeSequencer* GetInstance();
 
+  /// Get the most specific sequencer that supports the node.
+  /// Result is cached for each node class, therefore calling this method frequently is not costly.
+  /// The cache is not protected by a lock, therefore this method must only be called from the main thread.
   NodeSequencer* GetNodeSequencer(vtkMRMLNode* node);
 
   /// Registers a new node sequencer.
@@ -112,6 +270,10 @@ protected:
   /// Cached list of supported node class names, except generic vtkMRMLNode.
   std::vector< std::string > SupportedNodeClassNames;
 
+  /// Cached sequencer for each node class name that has been looked up already.
+  /// Cleared when a new sequencer is registered.
+  std::unordered_map< std::string, NodeSequencer* > NodeSequencerCache;
+
 private:
 
   vtkMRMLNodeSequencer(const vtkMRMLNodeSequencer&);
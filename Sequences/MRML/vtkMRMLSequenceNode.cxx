@@ -35,6 +35,9 @@
 #include <vtkTimerLog.h>
 
 // STD includes
+#include <algorithm>
+#include <cstdlib>
+#include <limits>
 #include <sstream>
 
 #define SAFE_CHAR_POINTER(unsafeString) ( unsafeString==NULL?"":unsafeString )
@@ -54,15 +57,21 @@
 vtkMRMLNodeNewMacro(vtkMRMLSequenceNode);
 vtkCxxSetVariableInDataAndStorageNodeMacro(IndexName, const std::string&);
 vtkCxxSetVariableInDataAndStorageNodeMacro(IndexUnit, const std::string&);
-vtkCxxSetVariableInDataAndStorageNodeMacro(IndexType, int);
 vtkCxxSetVariableInDataAndStorageNodeMacro(NumericIndexValueTolerance, double);
 
 //----------------------------------------------------------------------------
 vtkMRMLSequenceNode::vtkMRMLSequenceNode()
 : IndexType(vtkMRMLSequenceNode::NumericIndex)
 , NumericIndexValueTolerance(0.001)
+, ShareItemContent(false)
 , SequenceScene(0)
+, DataNodePreallocationEnabled(false)
+, NumberOfPreallocatedDataNodeMisses(0)
+, CachedNodeSequencer(NULL)
+, CachedNodeSequencerTime(0)
 {
+  this->GridDimensions[0] = 0;
+  this->GridDimensions[1] = 0;
   this->SetIndexName("time");
   this->SetIndexUnit("s");
   this->HideFromEditorsOff();
@@ -80,6 +89,10 @@ vtkMRMLSequenceNode::~vtkMRMLSequenceNode()
 void vtkMRMLSequenceNode::RemoveAllDataNodes()
 {
   this->IndexEntries.clear();
+  this->ItemAttributeNames.clear();
+  this->ItemAttributeValues.clear();
+  this->ItemAttributeValueIds.clear();
+  this->UpdateGridItemNumbers();
   this->SequenceScene->Delete();
   this->SequenceScene=vtkMRMLScene::New();
   this->Modified();
@@ -102,6 +115,44 @@ void vtkMRMLSequenceNode::WriteXML(ostream& of, int nIndent)
 
   of << indent << " numericIndexValueTolerance=\"" << this->NumericIndexValueTolerance << "\"";
 
+  if (this->IndexType == vtkMRMLSequenceNode::GridIndex)
+  {
+    of << indent << " gridDimensions=\"" << this->GridDimensions[0] << " " << this->GridDimensions[1] << "\"";
+  }
+
+  if (this->ShareItemContent)
+  {
+    of << indent << " shareItemContent=\"true\"";
+  }
+
+  if (!this->ItemAttributeNames.empty())
+  {
+    // Item attributes: list of names, list of distinct values, and value indices of each item
+    of << indent << " itemAttributeNames=\"";
+    for (std::vector< std::string >::iterator nameIt = this->ItemAttributeNames.begin(); nameIt != this->ItemAttributeNames.end(); ++nameIt)
+    {
+      of << (nameIt != this->ItemAttributeNames.begin() ? ";" : "") << vtkMRMLNode::URLEncodeString(nameIt->c_str());
+    }
+    of << "\"";
+    of << indent << " itemAttributeValues=\"";
+    for (std::vector< std::string >::iterator valueIt = this->ItemAttributeValues.begin(); valueIt != this->ItemAttributeValues.end(); ++valueIt)
+    {
+      of << (valueIt != this->ItemAttributeValues.begin() ? ";" : "") << vtkMRMLNode::URLEncodeString(valueIt->c_str());
+    }
+    of << "\"";
+    of << indent << " itemAttributeValueIds=\"";
+    for (std::deque< IndexEntryType >::iterator indexIt = this->IndexEntries.begin(); indexIt != this->IndexEntries.end(); ++indexIt)
+    {
+      of << (indexIt != this->IndexEntries.begin() ? ";" : "");
+      for (size_t columnIndex = 0; columnIndex < this->ItemAttributeNames.size(); columnIndex++)
+      {
+        of << (columnIndex > 0 ? " " : "")
+          << (columnIndex < indexIt->AttributeValueIds.size() ? indexIt->AttributeValueIds[columnIndex] : -1);
+      }
+    }
+    of << "\"";
+  }
+
   of << indent << " indexValues=\"";
   for(std::deque< IndexEntryType >::iterator indexIt=this->IndexEntries.begin(); indexIt!=this->IndexEntries.end(); ++indexIt)
   {
@@ -140,6 +191,10 @@ void vtkMRMLSequenceNode::ReadXMLAttributes(const char** atts)
   // Read all MRML node attributes from two arrays of names and values
   const char* attName;
   const char* attValue;
+  // Item attributes can only be read after index values are read
+  std::string itemAttributeNames;
+  std::string itemAttributeValues;
+  std::string itemAttributeValueIds;
   while (*atts != NULL)
   {
     attName = *(atts++);
@@ -170,10 +225,90 @@ void vtkMRMLSequenceNode::ReadXMLAttributes(const char** atts)
       ss >> numericIndexValueTolerance;
       this->SetNumericIndexValueTolerance(numericIndexValueTolerance);
     }
+    else if (!strcmp(attName, "gridDimensions"))
+    {
+      std::stringstream ss;
+      ss << attValue;
+      int gridDimensions[2] = { 0, 0 };
+      ss >> gridDimensions[0] >> gridDimensions[1];
+      this->SetGridDimensions(gridDimensions[0], gridDimensions[1]);
+    }
+    else if (!strcmp(attName, "shareItemContent"))
+    {
+      this->SetShareItemContent(!strcmp(attValue, "true"));
+    }
     else if (!strcmp(attName, "indexValues"))
     {
       ReadIndexValues(attValue);
     }
+    else if (!strcmp(attName, "itemAttributeNames"))
+    {
+      itemAttributeNames = attValue;
+    }
+    else if (!strcmp(attName, "itemAttributeValues"))
+    {
+      itemAttributeValues = attValue;
+    }
+    else if (!strcmp(attName, "itemAttributeValueIds"))
+    {
+      itemAttributeValueIds = attValue;
+    }
+  }
+  this->ReadItemAttributes(itemAttributeNames, itemAttributeValues, itemAttributeValueIds);
+}
+
+//----------------------------------------------------------------------------
+void vtkMRMLSequenceNode::ReadItemAttributes(const std::string& namesText, const std::string& valuesText, const std::string& valueIdsText)
+{
+  this->ItemAttributeNames.clear();
+  this->ItemAttributeValues.clear();
+  this->ItemAttributeValueIds.clear();
+  for (std::deque< IndexEntryType >::iterator indexIt = this->IndexEntries.begin(); indexIt != this->IndexEntries.end(); ++indexIt)
+  {
+    indexIt->AttributeValueIds.clear();
+  }
+  if (namesText.empty())
+  {
+    return;
+  }
+
+  std::stringstream namesStream(namesText);
+  std::string name;
+  while (std::getline(namesStream, name, ';'))
+  {
+    this->ItemAttributeNames.push_back(vtkMRMLNode::URLDecodeString(name.c_str()));
+  }
+  std::stringstream valuesStream(valuesText);
+  std::string value;
+  while (std::getline(valuesStream, value, ';'))
+  {
+    this->ItemAttributeValueIds[vtkMRMLNode::URLDecodeString(value.c_str())] = static_cast<int>(this->ItemAttributeValues.size());
+    this->ItemAttributeValues.push_back(vtkMRMLNode::URLDecodeString(value.c_str()));
+  }
+  if (!valuesText.empty() && valuesText[valuesText.size() - 1] == ';')
+  {
+    // getline does not report the last value if it is empty
+    this->ItemAttributeValueIds[""] = static_cast<int>(this->ItemAttributeValues.size());
+    this->ItemAttributeValues.push_back("");
+  }
+
+  std::stringstream valueIdsStream(valueIdsText);
+  std::string itemValueIds;
+  int numberOfValues = static_cast<int>(this->ItemAttributeValues.size());
+  for (std::deque< IndexEntryType >::iterator indexIt = this->IndexEntries.begin();
+    indexIt != this->IndexEntries.end() && std::getline(valueIdsStream, itemValueIds, ';'); ++indexIt)
+  {
+    std::stringstream itemValueIdsStream(itemValueIds);
+    int valueId = -1;
+    while (itemValueIdsStream >> valueId)
+    {
+      if (valueId >= numberOfValues)
+      {
+        vtkErrorMacro("vtkMRMLSequenceNode::ReadItemAttributes: invalid item attribute value index " << valueId);
+        valueId = -1;
+      }
+      indexIt->AttributeValueIds.push_back(valueId);
+    }
   }
 }
 
@@ -200,6 +335,7 @@ void vtkMRMLSequenceNode::ReadIndexValues(const std::string& indexText)
 
       IndexEntryType indexEntry;
       indexEntry.IndexValue=indexValue;
+      indexEntry.NumericIndexValue=atof(indexValue.c_str());
       // The nodes are not read yet, so we can only store the node ID and get the pointer to the node later (in UpdateScene())
       indexEntry.DataNodeID=nodeId;
       indexEntry.DataNode=NULL;
@@ -210,6 +346,7 @@ void vtkMRMLSequenceNode::ReadIndexValues(const std::string& indexText)
 
   if (modified)
   {
+    this->UpdateGridItemNumbers();
     this->Modified();
   }
 }
@@ -228,6 +365,11 @@ void vtkMRMLSequenceNode::Copy(vtkMRMLNode *anode)
   this->SetIndexUnit(snode->GetIndexUnit());
   this->SetIndexType(snode->GetIndexType());
   this->SetNumericIndexValueTolerance(snode->GetNumericIndexValueTolerance());
+  this->SetGridDimensions(snode->GetGridDimensions()[0], snode->GetGridDimensions()[1]);
+  this->SetShareItemContent(snode->GetShareItemContent());
+  this->ItemAttributeNames = snode->ItemAttributeNames;
+  this->ItemAttributeValues = snode->ItemAttributeValues;
+  this->ItemAttributeValueIds = snode->ItemAttributeValueIds;
 
   // Clear nodes: RemoveAllNodes is not a public method, so it's simpler to just delete and recreate the scene
   this->SequenceScene->Delete();
@@ -241,7 +383,7 @@ void vtkMRMLSequenceNode::Copy(vtkMRMLNode *anode)
       vtkErrorMacro("Invalid node in vtkMRMLSequenceNode");
       continue;
     }
-    vtkMRMLNodeSequencer::GetInstance()->GetNodeSequencer(node)->DeepCopyNodeToScene(node, this->SequenceScene);
+    this->GetNodeSequencer(node)->DeepCopyNodeToScene(node, this->SequenceScene);
   }
 
   this->IndexEntries.clear();
@@ -249,6 +391,8 @@ void vtkMRMLSequenceNode::Copy(vtkMRMLNode *anode)
   {
     IndexEntryType seqItem;
     seqItem.IndexValue=sourceIndexIt->IndexValue;
+    seqItem.NumericIndexValue=sourceIndexIt->NumericIndexValue;
+    seqItem.AttributeValueIds = sourceIndexIt->AttributeValueIds;
     seqItem.DataNode = NULL;
     if (sourceIndexIt->DataNode!=NULL)
     {
@@ -266,6 +410,7 @@ void vtkMRMLSequenceNode::Copy(vtkMRMLNode *anode)
     }
     this->IndexEntries.push_back(seqItem);
   }
+  this->UpdateGridItemNumbers();
   this->Modified();
   this->StorableModifiedTime.Modified();
 
@@ -281,13 +426,19 @@ void vtkMRMLSequenceNode::CopySequenceIndex(vtkMRMLNode *anode)
   this->SetIndexUnit(snode->GetIndexUnit());
   this->SetIndexType(snode->GetIndexType());
   this->SetNumericIndexValueTolerance(snode->GetNumericIndexValueTolerance());
+  this->SetGridDimensions(snode->GetGridDimensions()[0], snode->GetGridDimensions()[1]);
   if (this->IndexEntries.size() > 0 || snode->IndexEntries.size() > 0)
   {
+    this->ItemAttributeNames = snode->ItemAttributeNames;
+    this->ItemAttributeValues = snode->ItemAttributeValues;
+    this->ItemAttributeValueIds = snode->ItemAttributeValueIds;
     this->IndexEntries.clear();
     for (std::deque< IndexEntryType >::iterator sourceIndexIt = snode->IndexEntries.begin(); sourceIndexIt != snode->IndexEntries.end(); ++sourceIndexIt)
     {
       IndexEntryType seqItem;
       seqItem.IndexValue = sourceIndexIt->IndexValue;
+      seqItem.NumericIndexValue = sourceIndexIt->NumericIndexValue;
+      seqItem.AttributeValueIds = sourceIndexIt->AttributeValueIds;
       if (sourceIndexIt->DataNode != NULL)
       {
         seqItem.DataNodeID = sourceIndexIt->DataNode->GetID();
@@ -299,6 +450,7 @@ void vtkMRMLSequenceNode::CopySequenceIndex(vtkMRMLNode *anode)
       seqItem.DataNode = NULL;
       this->IndexEntries.push_back(seqItem);
     }
+    this->UpdateGridItemNumbers();
     this->Modified();
   }
   this->EndModify(wasModified);
@@ -316,6 +468,12 @@ void vtkMRMLSequenceNode::PrintSelf(ostream& os, vtkIndent indent)
 
   os << indent << "numericIndexValueTolerance: " << this->NumericIndexValueTolerance << "\n";
 
+  if (this->IndexType == vtkMRMLSequenceNode::GridIndex)
+  {
+    os << indent << "gridDimensions: " << this->GridDimensions[0] << " " << this->GridDimensions[1] << "\n";
+  }
+  os << indent << "shareItemContent: " << (this->ShareItemContent ? "true" : "false") << "\n";
+
   os << indent << "indexValues: ";
   if (this->IndexEntries.empty())
   {
@@ -348,7 +506,7 @@ bool vtkMRMLSequenceNode::UpdateDataNodeAtValue(vtkMRMLNode* node, const std::st
     return false;
   }
   std::string originalName = (nodeToBeUpdated->GetName() ? nodeToBeUpdated->GetName() : "");
-  vtkMRMLNodeSequencer::GetInstance()->GetNodeSequencer(node)->CopyNode(node, nodeToBeUpdated, shallowCopy);
+  this->GetNodeSequencer(node)->CopyNode(node, nodeToBeUpdated, shallowCopy);
   if (!originalName.empty())
   {
     // Restore original name to prevent changing of node name in the sequence node
@@ -367,9 +525,9 @@ int vtkMRMLSequenceNode::GetInsertPosition(const std::string& indexValue)
   int insertPosition = this->IndexEntries.size();
   if (this->IndexType == vtkMRMLSequenceNode::NumericIndex && !this->IndexEntries.empty())
   {
-    int itemNumber = this->GetItemNumberFromIndexValue(indexValue, false);
     double numericIndexValue = atof(indexValue.c_str());
-    double foundNumericIndexValue = atof(this->IndexEntries[itemNumber].IndexValue.c_str());
+    int itemNumber = this->GetItemNumberFromNumericIndexValue(numericIndexValue, false);
+    double foundNumericIndexValue = this->IndexEntries[itemNumber].NumericIndexValue;
     if (numericIndexValue < foundNumericIndexValue) // Deals with case of index value being smaller than any in the sequence and numeric tolerances
     {
       insertPosition = itemNumber;
@@ -379,20 +537,133 @@ int vtkMRMLSequenceNode::GetInsertPosition(const std::string& indexValue)
       insertPosition = itemNumber + 1;
     }
   }
+  else if (this->IndexType == vtkMRMLSequenceNode::GridIndex)
+  {
+    // Items are sorted in row-major order, insert before the next non-empty grid position
+    int row = 0;
+    int column = 0;
+    if (vtkMRMLSequenceNode::GetGridPositionFromIndexValue(indexValue, row, column))
+    {
+      insertPosition = this->GetNumberOfGridItemsUpToPosition(row, column);
+    }
+  }
   return insertPosition;
 }
 
 //----------------------------------------------------------------------------
 vtkMRMLNode* vtkMRMLSequenceNode::SetDataNodeAtValue(vtkMRMLNode* node, const std::string& indexValue)
+{
+  return this->SetDataNodeAtValueInternal(node, indexValue, true);
+}
+
+//----------------------------------------------------------------------------
+vtkMRMLNode* vtkMRMLSequenceNode::SetDataNodeAtValueWithoutCopy(vtkMRMLNode* node, const std::string& indexValue)
+{
+  if (node != NULL && node->GetScene() != NULL)
+  {
+    vtkErrorMacro("vtkMRMLSequenceNode::SetDataNodeAtValueWithoutCopy failed, node must not be in a scene");
+    return NULL;
+  }
+  return this->SetDataNodeAtValueInternal(node, indexValue, false);
+}
+
+//----------------------------------------------------------------------------
+void vtkMRMLSequenceNode::PreallocateDataNodes(vtkMRMLNode* templateNode, int numberOfNodes)
+{
+  if (templateNode == NULL)
+  {
+    vtkErrorMacro("vtkMRMLSequenceNode::PreallocateDataNodes failed, invalid template node");
+    return;
+  }
+  this->DataNodePreallocationEnabled = true;
+  this->NumberOfPreallocatedDataNodeMisses = 0;
+  vtkMRMLNodeSequencer::NodeSequencer* sequencer = this->GetNodeSequencer(templateNode);
+  for (int i = 0; i < numberOfNodes; i++)
+  {
+    vtkSmartPointer<vtkMRMLNode> preallocatedNode = vtkSmartPointer<vtkMRMLNode>::Take(templateNode->CreateNodeInstance());
+    // deep copy allocates data buffers that the sequencer can reuse when the node is filled
+    sequencer->CopyNode(templateNode, preallocatedNode, false);
+    this->PreallocatedDataNodes.push_back(preallocatedNode);
+  }
+}
+
+//----------------------------------------------------------------------------
+void vtkMRMLSequenceNode::RemoveAllPreallocatedDataNodes()
+{
+  this->PreallocatedDataNodes.clear();
+  this->DataNodePreallocationEnabled = false;
+}
+
+//----------------------------------------------------------------------------
+vtkSmartPointer<vtkMRMLNode> vtkMRMLSequenceNode::TakePreallocatedDataNode(vtkMRMLNode* node)
+{
+  if (node == NULL)
+  {
+    return NULL;
+  }
+  for (std::deque< vtkSmartPointer<vtkMRMLNode> >::iterator preallocatedIt = this->PreallocatedDataNodes.begin();
+    preallocatedIt != this->PreallocatedDataNodes.end(); ++preallocatedIt)
+  {
+    if (strcmp((*preallocatedIt)->GetClassName(), node->GetClassName()) == 0)
+    {
+      vtkSmartPointer<vtkMRMLNode> preallocatedNode = *preallocatedIt;
+      this->PreallocatedDataNodes.erase(preallocatedIt);
+      return preallocatedNode;
+    }
+  }
+  if (this->DataNodePreallocationEnabled)
+  {
+    if (this->NumberOfPreallocatedDataNodeMisses == 0)
+    {
+      vtkWarningMacro("vtkMRMLSequenceNode::TakePreallocatedDataNode: no preallocated " << node->GetClassName()
+        << " node is available in sequence " << (this->GetName() ? this->GetName() : "") << ", new nodes are allocated");
+    }
+    this->NumberOfPreallocatedDataNodeMisses++;
+  }
+  return NULL;
+}
+
+//----------------------------------------------------------------------------
+int vtkMRMLSequenceNode::GetNumberOfPreallocatedDataNodes()
+{
+  return static_cast<int>(this->PreallocatedDataNodes.size());
+}
+
+//----------------------------------------------------------------------------
+vtkMRMLNode* vtkMRMLSequenceNode::SetDataNodeAtValueInternal(vtkMRMLNode* node, const std::string& indexValue, bool copy)
 {
   if (node == NULL)
   {
     vtkErrorMacro("vtkMRMLSequenceNode::SetDataNodeAtValue failed, invalid node");
     return NULL;
   }
+  int gridRow = 0;
+  int gridColumn = 0;
+  if (this->IndexType == vtkMRMLSequenceNode::GridIndex)
+  {
+    if (!vtkMRMLSequenceNode::GetGridPositionFromIndexValue(indexValue, gridRow, gridColumn))
+    {
+      vtkErrorMacro("vtkMRMLSequenceNode::SetDataNodeAtValue failed, invalid grid index value: " << indexValue);
+      return NULL;
+    }
+    this->ExpandGridDimensions(gridRow, gridColumn);
+  }
 
-  // Add a copy of the node to the sequence's scene
-  vtkMRMLNode* newNode = vtkMRMLNodeSequencer::GetInstance()->GetNodeSequencer(node)->DeepCopyNodeToScene(node, this->SequenceScene);
+  // Add the node (or a copy of the node) to the sequence's scene
+  vtkMRMLNode* newNode = NULL;
+  if (copy)
+  {
+    vtkSmartPointer<vtkMRMLNode> preallocatedNode;
+    if (this->DataNodePreallocationEnabled)
+    {
+      preallocatedNode = this->TakePreallocatedDataNode(node);
+    }
+    newNode = this->GetNodeSequencer(node)->DeepCopyNodeToScene(node, this->SequenceScene, preallocatedNode);
+  }
+  else
+  {
+    newNode = this->SequenceScene->AddNode(node);
+  }
   int seqItemIndex = this->GetItemNumberFromIndexValue(indexValue);
   if (seqItemIndex<0)
   {
@@ -401,10 +672,58 @@ vtkMRMLNode* vtkMRMLSequenceNode::SetDataNodeAtValue(vtkMRMLNode* node, const st
     // Create new item
     IndexEntryType seqItem;
     seqItem.IndexValue = indexValue;
+    if (this->IndexType == vtkMRMLSequenceNode::GridIndex)
+    {
+      // Store index value in canonical form
+      seqItem.IndexValue = vtkMRMLSequenceNode::GetGridIndexValue(gridRow, gridColumn);
+    }
+    seqItem.NumericIndexValue = atof(seqItem.IndexValue.c_str());
     this->IndexEntries.insert(this->IndexEntries.begin() + seqItemIndex, seqItem);
+    if (this->IndexType == vtkMRMLSequenceNode::GridIndex)
+    {
+      if (seqItemIndex == static_cast<int>(this->IndexEntries.size()) - 1)
+      {
+        // Appended item, item numbers of other positions are not changed
+        this->GridItemNumbers[this->GetGridItemKey(gridRow, gridColumn)] = seqItemIndex;
+      }
+      else
+      {
+        this->UpdateGridItemNumbers();
+      }
+    }
   }
   this->IndexEntries[seqItemIndex].DataNode = newNode;
   this->IndexEntries[seqItemIndex].DataNodeID.clear();
+  if (newNode != NULL && !this->ItemAttributeNames.empty())
+  {
+    // Node attributes that have an item attribute column are stored in the compact item attribute store
+    for (size_t columnIndex = 0; columnIndex < this->ItemAttributeNames.size(); columnIndex++)
+    {
+      std::string name = this->ItemAttributeNames[columnIndex];
+      const char* value = newNode->GetAttribute(name.c_str());
+      if (value == NULL)
+      {
+        continue;
+      }
+      this->SetNthItemAttribute(seqItemIndex, name, std::string(value).c_str());
+      newNode->RemoveAttribute(name.c_str());
+    }
+  }
+  if (this->ShareItemContent && newNode != NULL)
+  {
+    // Store data that is the same as in the neighbor items only once. Both the previous and the next item
+    // are used as reference, as an item may be inserted between items that have different content.
+    int referenceItemIndices[2] = { seqItemIndex - 1, seqItemIndex + 1 };
+    for (int i = 0; i < 2; i++)
+    {
+      int referenceItemIndex = referenceItemIndices[i];
+      if (referenceItemIndex >= 0 && referenceItemIndex < static_cast<int>(this->IndexEntries.size())
+        && this->IndexEntries[referenceItemIndex].DataNode != NULL)
+      {
+        this->GetNodeSequencer(newNode)->ShareIdenticalContent(newNode, this->IndexEntries[referenceItemIndex].DataNode);
+      }
+    }
+  }
   this->Modified();
   this->StorableModifiedTime.Modified();
   return newNode;
@@ -422,6 +741,7 @@ void vtkMRMLSequenceNode::RemoveDataNodeAtValue(const std::string& indexValue)
   // TODO: remove associated nodes as well (such as storage node)?
   this->SequenceScene->RemoveNode(this->IndexEntries[seqItemIndex].DataNode);
   this->IndexEntries.erase(this->IndexEntries.begin()+seqItemIndex);
+  this->UpdateGridItemNumbers();
   this->Modified();
   this->StorableModifiedTime.Modified();
 }
@@ -435,60 +755,32 @@ int vtkMRMLSequenceNode::GetItemNumberFromIndexValue(const std::string& indexVal
     return -1;
   }
 
-  // Binary search will be faster for numeric index
-  if (this->IndexType == NumericIndex)
+  // Grid index items are found by direct lookup
+  if (this->IndexType == GridIndex)
   {
-    int lowerBound = 0;
-    int upperBound = numberOfSeqItems-1;
-
-    // Deal with index values not within the range of index values in the Sequence
-    double numericIndexValue = atof(indexValue.c_str());
-    double lowerNumericIndexValue = atof(this->IndexEntries[lowerBound].IndexValue.c_str());
-    double upperNumericIndexValue = atof(this->IndexEntries[upperBound].IndexValue.c_str());
-    if (numericIndexValue <= lowerNumericIndexValue + this->NumericIndexValueTolerance)
+    int row = 0;
+    int column = 0;
+    if (!vtkMRMLSequenceNode::GetGridPositionFromIndexValue(indexValue, row, column))
     {
-      if (numericIndexValue < lowerNumericIndexValue - this->NumericIndexValueTolerance && exactMatchRequired)
-      {
-        return -1;
-      }
-      else
-      {
-        return lowerBound;
-      }
+      return -1;
     }
-    if (numericIndexValue >= upperNumericIndexValue - this->NumericIndexValueTolerance)
+    int itemNumber = this->GetItemNumberFromGridPosition(row, column);
+    if (itemNumber >= 0 || exactMatchRequired)
     {
-      if (numericIndexValue > upperNumericIndexValue + this->NumericIndexValueTolerance && exactMatchRequired)
-      {
-        return -1;
-      }
-      else
-      {
-        return upperBound;
-      }
+      return itemNumber;
     }
+    // Use the closest item at or before the requested position (in row-major order)
+    int numberOfItemsUpToPosition = this->GetNumberOfGridItemsUpToPosition(row, column);
+    return (numberOfItemsUpToPosition > 0 ? numberOfItemsUpToPosition - 1 : 0);
+  }
 
-    while (upperBound - lowerBound > 1)
-    {
-      // Note that if middle is equal to either lowerBound or upperBound then upperBound - lowerBound <= 1
-      int middle = int((lowerBound + upperBound)/2);
-      double middleNumericIndexValue = atof(this->IndexEntries[middle].IndexValue.c_str());
-      if (fabs(numericIndexValue - middleNumericIndexValue) <= this->NumericIndexValueTolerance)
-      {
-        return middle;
-      }
-      if (numericIndexValue > middleNumericIndexValue)
-      {
-        lowerBound = middle;
-      }
-      if (numericIndexValue < middleNumericIndexValue)
-      {
-        upperBound = middle;
-      }
-    }
-    if (!exactMatchRequired)
+  // Binary search will be faster for numeric index
+  if (this->IndexType == NumericIndex)
+  {
+    int itemNumber = this->GetItemNumberFromNumericIndexValue(atof(indexValue.c_str()), exactMatchRequired);
+    if (itemNumber >= 0 || !exactMatchRequired)
     {
-      return lowerBound;
+      return itemNumber;
     }
   }
 
@@ -504,6 +796,69 @@ int vtkMRMLSequenceNode::GetItemNumberFromIndexValue(const std::string& indexVal
   return -1;
 }
 
+//---------------------------------------------------------------------------
+int vtkMRMLSequenceNode::GetItemNumberFromNumericIndexValue(double numericIndexValue, bool exactMatchRequired /* =true */)
+{
+  int numberOfSeqItems = this->IndexEntries.size();
+  if (numberOfSeqItems == 0)
+  {
+    return -1;
+  }
+
+  int lowerBound = 0;
+  int upperBound = numberOfSeqItems-1;
+
+  // Deal with index values not within the range of index values in the Sequence
+  double lowerNumericIndexValue = this->IndexEntries[lowerBound].NumericIndexValue;
+  double upperNumericIndexValue = this->IndexEntries[upperBound].NumericIndexValue;
+  if (numericIndexValue <= lowerNumericIndexValue + this->NumericIndexValueTolerance)
+  {
+    if (numericIndexValue < lowerNumericIndexValue - this->NumericIndexValueTolerance && exactMatchRequired)
+    {
+      return -1;
+    }
+    else
+    {
+      return lowerBound;
+    }
+  }
+  if (numericIndexValue >= upperNumericIndexValue - this->NumericIndexValueTolerance)
+  {
+    if (numericIndexValue > upperNumericIndexValue + this->NumericIndexValueTolerance && exactMatchRequired)
+    {
+      return -1;
+    }
+    else
+    {
+      return upperBound;
+    }
+  }
+
+  while (upperBound - lowerBound > 1)
+  {
+    // Note that if middle is equal to either lowerBound or upperBound then upperBound - lowerBound <= 1
+    int middle = int((lowerBound + upperBound)/2);
+    double middleNumericIndexValue = this->IndexEntries[middle].NumericIndexValue;
+    if (fabs(numericIndexValue - middleNumericIndexValue) <= this->NumericIndexValueTolerance)
+    {
+      return middle;
+    }
+    if (numericIndexValue > middleNumericIndexValue)
+    {
+      lowerBound = middle;
+    }
+    if (numericIndexValue < middleNumericIndexValue)
+    {
+      upperBound = middle;
+    }
+  }
+  if (!exactMatchRequired)
+  {
+    return lowerBound;
+  }
+  return -1;
+}
+
 //---------------------------------------------------------------------------
 vtkMRMLNode* vtkMRMLSequenceNode::GetDataNodeAtValue(const std::string& indexValue, bool exactMatchRequired /* =true */)
 {
@@ -532,12 +887,134 @@ std::string vtkMRMLSequenceNode::GetNthIndexValue(int seqItemIndex)
   return this->IndexEntries[seqItemIndex].IndexValue;
 }
 
+//---------------------------------------------------------------------------
+double vtkMRMLSequenceNode::GetNthNumericIndexValue(int seqItemIndex)
+{
+  if (seqItemIndex<0 || seqItemIndex>=static_cast<int>(this->IndexEntries.size()))
+  {
+    vtkErrorMacro("vtkMRMLSequenceNode::GetNthNumericIndexValue failed, invalid seqItemIndex value: "<<seqItemIndex);
+    return 0.0;
+  }
+  return this->IndexEntries[seqItemIndex].NumericIndexValue;
+}
+
 //-----------------------------------------------------------------------------
 int vtkMRMLSequenceNode::GetNumberOfDataNodes()
 {
   return this->IndexEntries.size();
 }
 
+//-----------------------------------------------------------------------------
+int vtkMRMLSequenceNode::GetItemAttributeValueId(const std::string& value)
+{
+  std::map< std::string, int >::iterator valueIdIt = this->ItemAttributeValueIds.find(value);
+  if (valueIdIt != this->ItemAttributeValueIds.end())
+  {
+    return valueIdIt->second;
+  }
+  int valueId = static_cast<int>(this->ItemAttributeValues.size());
+  this->ItemAttributeValues.push_back(value);
+  this->ItemAttributeValueIds[value] = valueId;
+  return valueId;
+}
+
+//-----------------------------------------------------------------------------
+void vtkMRMLSequenceNode::SetNthItemAttribute(int itemNumber, const std::string& name, const char* value)
+{
+  if (itemNumber < 0 || itemNumber >= static_cast<int>(this->IndexEntries.size()))
+  {
+    vtkErrorMacro("vtkMRMLSequenceNode::SetNthItemAttribute failed: invalid item number " << itemNumber);
+    return;
+  }
+  std::vector< std::string >::iterator nameIt = std::find(this->ItemAttributeNames.begin(), this->ItemAttributeNames.end(), name);
+  if (nameIt == this->ItemAttributeNames.end())
+  {
+    if (value == NULL)
+    {
+      // attribute is not set anywhere, nothing to remove
+      return;
+    }
+    nameIt = this->ItemAttributeNames.insert(this->ItemAttributeNames.end(), name);
+  }
+  size_t columnIndex = nameIt - this->ItemAttributeNames.begin();
+  std::vector< int >& valueIds = this->IndexEntries[itemNumber].AttributeValueIds;
+  int valueId = (value != NULL ? this->GetItemAttributeValueId(value) : -1);
+  if (columnIndex >= valueIds.size())
+  {
+    if (valueId < 0)
+    {
+      // not set already
+      return;
+    }
+    valueIds.resize(columnIndex + 1, -1);
+  }
+  if (valueIds[columnIndex] == valueId)
+  {
+    // no change
+    return;
+  }
+  valueIds[columnIndex] = valueId;
+  this->Modified();
+  this->StorableModifiedTime.Modified();
+}
+
+//-----------------------------------------------------------------------------
+void vtkMRMLSequenceNode::AddItemAttributeName(const std::string& name)
+{
+  if (std::find(this->ItemAttributeNames.begin(), this->ItemAttributeNames.end(), name) != this->ItemAttributeNames.end())
+  {
+    // already added
+    return;
+  }
+  this->ItemAttributeNames.push_back(name);
+  this->Modified();
+  this->StorableModifiedTime.Modified();
+}
+
+//-----------------------------------------------------------------------------
+const char* vtkMRMLSequenceNode::GetNthItemAttribute(int itemNumber, const std::string& name)
+{
+  if (itemNumber < 0 || itemNumber >= static_cast<int>(this->IndexEntries.size()))
+  {
+    return NULL;
+  }
+  std::vector< std::string >::iterator nameIt = std::find(this->ItemAttributeNames.begin(), this->ItemAttributeNames.end(), name);
+  size_t columnIndex = nameIt - this->ItemAttributeNames.begin();
+  const std::vector< int >& valueIds = this->IndexEntries[itemNumber].AttributeValueIds;
+  if (columnIndex >= valueIds.size() || valueIds[columnIndex] < 0)
+  {
+    return NULL;
+  }
+  return this->ItemAttributeValues[valueIds[columnIndex]].c_str();
+}
+
+//-----------------------------------------------------------------------------
+void vtkMRMLSequenceNode::ApplyNthItemAttributes(int itemNumber, vtkMRMLNode* target)
+{
+  if (target == NULL || itemNumber < 0 || itemNumber >= static_cast<int>(this->IndexEntries.size()))
+  {
+    return;
+  }
+  const std::vector< int >& valueIds = this->IndexEntries[itemNumber].AttributeValueIds;
+  for (size_t columnIndex = 0; columnIndex < this->ItemAttributeNames.size(); columnIndex++)
+  {
+    const char* name = this->ItemAttributeNames[columnIndex].c_str();
+    const char* currentValue = target->GetAttribute(name);
+    int valueId = (columnIndex < valueIds.size() ? valueIds[columnIndex] : -1);
+    if (valueId < 0)
+    {
+      if (currentValue != NULL)
+      {
+        target->RemoveAttribute(name);
+      }
+    }
+    else if (currentValue == NULL || this->ItemAttributeValues[valueId] != currentValue)
+    {
+      target->SetAttribute(name, this->ItemAttributeValues[valueId].c_str());
+    }
+  }
+}
+
 //-----------------------------------------------------------------------------
 bool vtkMRMLSequenceNode::UpdateIndexValue(const std::string& oldIndexValue, const std::string& newIndexValue)
 {
@@ -557,9 +1034,32 @@ bool vtkMRMLSequenceNode::UpdateIndexValue(const std::string& oldIndexValue, con
     vtkErrorMacro("vtkMRMLSequenceNode::UpdateIndexValue failed, data node is already defined at index value " << newIndexValue);
     return false;
   }
+  int row = 0;
+  int column = 0;
+  if (this->IndexType == vtkMRMLSequenceNode::GridIndex
+    && !vtkMRMLSequenceNode::GetGridPositionFromIndexValue(newIndexValue, row, column))
+  {
+    // Validated before the item is modified: IndexValue and NumericIndexValue must be kept consistent,
+    // otherwise numeric lookups and sorting would not match the index value string of the item.
+    vtkErrorMacro("vtkMRMLSequenceNode::UpdateIndexValue failed, invalid grid index value: " << newIndexValue);
+    return false;
+  }
   // Update the index value
   this->IndexEntries[oldSeqItemIndex].IndexValue = newIndexValue;
-  if (this->IndexType == vtkMRMLSequenceNode::NumericIndex)
+  this->IndexEntries[oldSeqItemIndex].NumericIndexValue = atof(newIndexValue.c_str());
+  if (this->IndexType == vtkMRMLSequenceNode::GridIndex)
+  {
+    this->IndexEntries[oldSeqItemIndex].IndexValue = vtkMRMLSequenceNode::GetGridIndexValue(row, column);
+    this->IndexEntries[oldSeqItemIndex].NumericIndexValue = atof(this->IndexEntries[oldSeqItemIndex].IndexValue.c_str());
+    this->ExpandGridDimensions(row, column);
+    IndexEntryType movingEntry = this->IndexEntries[oldSeqItemIndex];
+    this->IndexEntries.erase(this->IndexEntries.begin() + oldSeqItemIndex);
+    this->UpdateGridItemNumbers();
+    int insertPosition = this->GetInsertPosition(movingEntry.IndexValue);
+    this->IndexEntries.insert(this->IndexEntries.begin() + insertPosition, movingEntry);
+    this->UpdateGridItemNumbers();
+  }
+  else if (this->IndexType == vtkMRMLSequenceNode::NumericIndex)
   {
     IndexEntryType movingEntry = this->IndexEntries[oldSeqItemIndex];
     // Remove from current position
@@ -655,7 +1155,7 @@ std::string vtkMRMLSequenceNode::GetDefaultStorageNodeClassName(const char* file
   }
 
   // Use specific sequence storage node, if possible
-  vtkMRMLNodeSequencer::NodeSequencer* sequencer = vtkMRMLNodeSequencer::GetInstance()->GetNodeSequencer(this->GetNthDataNode(0));
+  vtkMRMLNodeSequencer::NodeSequencer* sequencer = this->GetNodeSequencer(this->GetNthDataNode(0));
   std::string storageNodeClassName = sequencer->GetDefaultSequenceStorageNodeClassName();
   vtkSmartPointer<vtkMRMLStorageNode> storageNode = vtkSmartPointer<vtkMRMLStorageNode>::Take(
     vtkMRMLStorageNode::SafeDownCast(this->GetScene()->CreateNodeByClass(storageNodeClassName.c_str())));
@@ -719,6 +1219,7 @@ std::string vtkMRMLSequenceNode::GetIndexTypeAsString(int indexType)
   {
   case vtkMRMLSequenceNode::NumericIndex: return "numeric";
   case vtkMRMLSequenceNode::TextIndex: return "text";
+  case vtkMRMLSequenceNode::GridIndex: return "grid";
   default:
     return "";
   }
@@ -737,3 +1238,201 @@ int vtkMRMLSequenceNode::GetIndexTypeFromString(const std::string& indexTypeStri
   }
   return -1;
 }
+
+//-----------------------------------------------------------
+void vtkMRMLSequenceNode::SetIndexType(int indexType)
+{
+  if (indexType == this->IndexType)
+  {
+    return;
+  }
+  this->IndexType = indexType;
+  this->UpdateGridItemNumbers();
+  this->StorableModifiedTime.Modified();
+  this->Modified();
+}
+
+//-----------------------------------------------------------
+void vtkMRMLSequenceNode::SetGridDimensions(int numberOfRows, int numberOfColumns)
+{
+  numberOfRows = std::max(numberOfRows, 0);
+  numberOfColumns = std::max(numberOfColumns, 0);
+  if (numberOfRows == this->GridDimensions[0] && numberOfColumns == this->GridDimensions[1])
+  {
+    return;
+  }
+  this->GridDimensions[0] = numberOfRows;
+  this->GridDimensions[1] = numberOfColumns;
+  // Grid must be large enough to contain all the existing items
+  this->UpdateGridItemNumbers();
+  this->StorableModifiedTime.Modified();
+  this->Modified();
+}
+
+//-----------------------------------------------------------
+bool vtkMRMLSequenceNode::ExpandGridDimensions(int row, int column)
+{
+  if (row < this->GridDimensions[0] && column < this->GridDimensions[1])
+  {
+    return false;
+  }
+  this->SetGridDimensions(std::max(row + 1, this->GridDimensions[0]), std::max(column + 1, this->GridDimensions[1]));
+  return true;
+}
+
+//-----------------------------------------------------------
+void vtkMRMLSequenceNode::UpdateGridItemNumbers()
+{
+  if (this->IndexType != vtkMRMLSequenceNode::GridIndex)
+  {
+    this->GridItemNumbers.clear();
+    return;
+  }
+
+  // Make sure all items fit into the grid
+  int numberOfItems = static_cast<int>(this->IndexEntries.size());
+  int row = 0;
+  int column = 0;
+  for (int itemNumber = 0; itemNumber < numberOfItems; itemNumber++)
+  {
+    if (vtkMRMLSequenceNode::GetGridPositionFromIndexValue(this->IndexEntries[itemNumber].IndexValue, row, column))
+    {
+      this->GridDimensions[0] = std::max(row + 1, this->GridDimensions[0]);
+      this->GridDimensions[1] = std::max(column + 1, this->GridDimensions[1]);
+    }
+  }
+
+  this->GridItemNumbers.clear();
+  for (int itemNumber = 0; itemNumber < numberOfItems; itemNumber++)
+  {
+    if (!vtkMRMLSequenceNode::GetGridPositionFromIndexValue(this->IndexEntries[itemNumber].IndexValue, row, column))
+    {
+      vtkWarningMacro("vtkMRMLSequenceNode::UpdateGridItemNumbers: invalid grid index value: " << this->IndexEntries[itemNumber].IndexValue);
+      continue;
+    }
+    this->GridItemNumbers[this->GetGridItemKey(row, column)] = itemNumber;
+  }
+}
+
+//-----------------------------------------------------------
+int vtkMRMLSequenceNode::GetItemNumberFromGridPosition(int row, int column)
+{
+  if (this->IndexType != vtkMRMLSequenceNode::GridIndex)
+  {
+    vtkErrorMacro("vtkMRMLSequenceNode::GetItemNumberFromGridPosition failed: index type is not grid");
+    return -1;
+  }
+  if (row < 0 || column < 0 || row >= this->GridDimensions[0] || column >= this->GridDimensions[1])
+  {
+    return -1;
+  }
+  std::unordered_map< long long, int >::iterator itemIt = this->GridItemNumbers.find(this->GetGridItemKey(row, column));
+  if (itemIt == this->GridItemNumbers.end())
+  {
+    return -1;
+  }
+  return itemIt->second;
+}
+
+//-----------------------------------------------------------
+long long vtkMRMLSequenceNode::GetGridItemKey(int row, int column)
+{
+  return static_cast<long long>(row) * this->GridDimensions[1] + column;
+}
+
+//-----------------------------------------------------------
+int vtkMRMLSequenceNode::GetNumberOfGridItemsUpToPosition(int row, int column)
+{
+  // Items are sorted in row-major order, find the first item after the position by binary search
+  int lowerItemNumber = 0;
+  int upperItemNumber = static_cast<int>(this->IndexEntries.size());
+  while (lowerItemNumber < upperItemNumber)
+  {
+    int middleItemNumber = lowerItemNumber + (upperItemNumber - lowerItemNumber) / 2;
+    int middleRow = 0;
+    int middleColumn = 0;
+    vtkMRMLSequenceNode::GetGridPositionFromIndexValue(this->IndexEntries[middleItemNumber].IndexValue, middleRow, middleColumn);
+    if (std::make_pair(middleRow, middleColumn) <= std::make_pair(row, column))
+    {
+      lowerItemNumber = middleItemNumber + 1;
+    }
+    else
+    {
+      upperItemNumber = middleItemNumber;
+    }
+  }
+  return lowerItemNumber;
+}
+
+//-----------------------------------------------------------
+std::string vtkMRMLSequenceNode::GetGridIndexValue(int row, int column)
+{
+  std::stringstream ss;
+  ss << row << "," << column;
+  return ss.str();
+}
+
+//-----------------------------------------------------------
+bool vtkMRMLSequenceNode::GetGridPositionFromIndexValue(const std::string& indexValue, int& row, int& column)
+{
+  const char* rowStart = indexValue.c_str();
+  char* rowEnd = NULL;
+  long parsedRow = strtol(rowStart, &rowEnd, 10);
+  if (rowEnd == rowStart)
+  {
+    return false;
+  }
+  while (*rowEnd == ' ')
+  {
+    rowEnd++;
+  }
+  if (*rowEnd != ',')
+  {
+    return false;
+  }
+  const char* columnStart = rowEnd + 1;
+  char* columnEnd = NULL;
+  long parsedColumn = strtol(columnStart, &columnEnd, 10);
+  if (columnEnd == columnStart || parsedRow < 0 || parsedColumn < 0)
+  {
+    return false;
+  }
+  // Only trailing spaces are accepted after the column (reject values such as "1,2abc" or "1,2,3")
+  while (*columnEnd == ' ')
+  {
+    columnEnd++;
+  }
+  if (*columnEnd != '\0')
+  {
+    return false;
+  }
+  // Grid dimensions are computed as position + 1, which must not overflow
+  const long maximumPosition = std::numeric_limits<int>::max() - 1;
+  if (parsedRow > maximumPosition || parsedColumn > maximumPosition)
+  {
+    return false;
+  }
+  row = static_cast<int>(parsedRow);
+  column = static_cast<int>(parsedColumn);
+  return true;
+}
+
+//-----------------------------------------------------------
+vtkMRMLNodeSequencer::NodeSequencer* vtkMRMLSequenceNode::GetNodeSequencer(vtkMRMLNode* node)
+{
+  vtkMRMLNodeSequencer* nodeSequencer = vtkMRMLNodeSequencer::GetInstance();
+  if (node == NULL)
+  {
+    return nodeSequencer->GetNodeSequencer(node);
+  }
+  // Registering a new sequencer modifies the registry, in that case the cached sequencer may not be the most specific anymore
+  if (this->CachedNodeSequencer == NULL
+    || this->CachedNodeSequencerTime != nodeSequencer->GetMTime()
+    || this->CachedNodeSequencerClassName != node->GetClassName())
+  {
+    this->CachedNodeSequencer = nodeSequencer->GetNodeSequencer(node);
+    this->CachedNodeSequencerClassName = node->GetClassName();
+    this->CachedNodeSequencerTime = nodeSequencer->GetMTime();
+  }
+  return this->CachedNodeSequencer;
+}
@@ -24,9 +24,13 @@
 
 // std includes
 #include <deque>
+#include <map>
 #include <set>
+#include <unordered_map>
+#include <vector>
 
 #include "vtkSlicerSequencesModuleMRMLExport.h"
+#include "vtkMRMLNodeSequencer.h"
 
 /// \brief MRML node for representing a sequence of MRML nodes
 ///
@@ -40,6 +44,10 @@
 ///
 /// If an index is numeric then it is sorted differently and equality determined using
 /// a numerical tolerance instead of exact string matching.
+///
+/// If an index is a grid index then index values are "i,j" pairs (for example,
+/// cardiac phase and acquisition number). Items are sorted row-major and
+/// found by direct lookup in a dense table instead of string comparison.
 
 class VTK_SLICER_SEQUENCES_MODULE_MRML_EXPORT vtkMRMLSequenceNode : public vtkMRMLStorableNode
 {
@@ -97,12 +105,65 @@ public:
   static std::string GetIndexTypeAsString(int indexType);
   static int GetIndexTypeFromString(const std::string &indexTypeString);
 
+  /// Set number of rows and columns of a grid index.
+  /// Dimensions are automatically extended when an item is added outside the current grid.
+  void SetGridDimensions(int numberOfRows, int numberOfColumns);
+  /// Get number of rows and columns of a grid index.
+  vtkGetVector2Macro(GridDimensions, int);
+
+  /// Store data that is identical in neighbor items only once.
+  /// For example, in a sequence of deforming models the mesh connectivity is usually the same for all items,
+  /// therefore only the points and varying arrays need to be stored for each item.
+  /// Sharing is applied when data nodes are added. Shared data objects must not be modified in-place.
+  /// Disabled by default.
+  vtkGetMacro(ShareItemContent, bool);
+  vtkSetMacro(ShareItemContent, bool);
+  vtkBooleanMacro(ShareItemContent, bool);
+
+  /// Get item number at the specified grid position. Returns -1 if there is no item at that position.
+  /// Only applicable if index type is GridIndex.
+  int GetItemNumberFromGridPosition(int row, int column);
+
+  /// Helper functions for converting between grid index value ("row,column") and grid position.
+  /// Row and column must be non-negative and less than the maximum int value, otherwise the index value is invalid.
+  static std::string GetGridIndexValue(int row, int column);
+  static bool GetGridPositionFromIndexValue(const std::string& indexValue, int& row, int& column);
+
   /// Add a copy of the provided node to this sequence as a data node.
   /// If a sequence item is not found by that index, a new item is added.
   /// Always performs deep-copy.
+  /// Node attributes that have an item attribute column (see AddItemAttributeName)
+  /// are moved from the data node copy into the item attribute store.
   /// Returns the data node copy that has just been created.
   vtkMRMLNode* SetDataNodeAtValue(vtkMRMLNode* node, const std::string& indexValue);
 
+  /// Add the provided node to this sequence as a data node, without making a copy.
+  /// This is faster than SetDataNodeAtValue, but the node must not be in any scene
+  /// and must not be used or modified by the caller after this call.
+  /// Node attributes that have an item attribute column (see AddItemAttributeName) are moved
+  /// into the item attribute store, therefore they are removed from the provided node.
+  /// If a sequence item is not found by that index, a new item is added.
+  /// Returns the data node.
+  vtkMRMLNode* SetDataNodeAtValueWithoutCopy(vtkMRMLNode* node, const std::string& indexValue);
+
+  /// Allocate data nodes in advance, for fast adding of many items (e.g., during recording).
+  /// Nodes are created as deep copies of the template node, therefore they have the same
+  /// type and data layout (e.g., image dimensions). SetDataNodeAtValue copies the content of the added node
+  /// into a preallocated node of the same class, reusing its data buffers if the layout matches.
+  /// If the pool is empty then nodes are allocated as usual and the miss is counted.
+  void PreallocateDataNodes(vtkMRMLNode* templateNode, int numberOfNodes);
+  /// Release all preallocated data nodes that have not been used yet.
+  void RemoveAllPreallocatedDataNodes();
+  /// Remove a preallocated node of the same class as the specified node from the pool and return it.
+  /// Returns NULL if no suitable node is available (and counts it as a miss).
+  /// Useful for copying content into a preallocated node before calling SetDataNodeAtValueWithoutCopy.
+  vtkSmartPointer<vtkMRMLNode> TakePreallocatedDataNode(vtkMRMLNode* node);
+  /// Number of preallocated data nodes that have not been used yet.
+  int GetNumberOfPreallocatedDataNodes();
+  /// Number of times a data node had to be allocated because no preallocated node was available.
+  /// Only counted after PreallocateDataNodes has been called. Reset by PreallocateDataNodes.
+  vtkGetMacro(NumberOfPreallocatedDataNodeMisses, int);
+
   /// Update an existing data node.
   /// Return true if a data node was found by that index.
   bool UpdateDataNodeAtValue(vtkMRMLNode* node, const std::string& indexValue, bool shallowCopy = false);
@@ -120,15 +181,43 @@ public:
 
   std::string GetNthIndexValue(int itemNumber);
 
+  /// Get the n-th index value converted to a number.
+  /// The numeric value is cached for each item, therefore no string conversion is performed.
+  double GetNthNumericIndexValue(int itemNumber);
+
   /// If exact match is not required and index is numeric then the best matching data node is returned.
   /// If the sequences has numeric index, uses data node just before the index value in the case of non-exact match
   int GetItemNumberFromIndexValue(const std::string& indexValue, bool exactMatchRequired = true);
 
+  /// Find item number by numeric index value, using binary search on the cached numeric index values.
+  /// Items are assumed to be sorted by index value (as in sequences with numeric index).
+  /// If exact match is not required then the item just before the index value is returned.
+  int GetItemNumberFromNumericIndexValue(double numericIndexValue, bool exactMatchRequired = true);
+
   bool UpdateIndexValue(const std::string& oldIndexValue, const std::string& newIndexValue);
 
   /// Return the number of nodes stored in this sequence.
   int GetNumberOfDataNodes();
 
+  /// Set a per-item attribute (such as frame status or tool state in a recording).
+  /// Item attributes are stored compactly in the sequence node (one column per attribute name,
+  /// each distinct value is stored only once), which requires much less memory than
+  /// setting MRML node attributes in every data node.
+  /// Setting NULL value removes the attribute from the item.
+  void SetNthItemAttribute(int itemNumber, const std::string& name, const char* value);
+  /// Add an item attribute column without setting any values.
+  /// Node attributes with this name are moved from data nodes into the item attribute store
+  /// when data nodes are added to the sequence (e.g., when recording proxy node attributes).
+  void AddItemAttributeName(const std::string& name);
+  /// Get a per-item attribute. Returns NULL if the attribute is not set for the item.
+  const char* GetNthItemAttribute(int itemNumber, const std::string& name);
+  /// Get names of all item attributes that have been set in this sequence.
+  const std::vector< std::string >& GetItemAttributeNames() { return this->ItemAttributeNames; };
+  /// Set item attributes of the n-th item as MRML node attributes in the target node.
+  /// Only attributes with changed value are set in the target node.
+  /// Item attributes that are not set for this item are removed from the target node.
+  void ApplyNthItemAttributes(int itemNumber, vtkMRMLNode* target);
+
   /// Return the class name of the data nodes (e.g., vtkMRMLTransformNode). If there are no data nodes yet then it returns empty string.
   std::string GetDataNodeClassName();
 
@@ -151,6 +240,7 @@ public:
   {
     NumericIndex = 0,
     TextIndex,
+    GridIndex,
     NumberOfIndexTypes // this line must be the last one
   };
 
@@ -166,11 +256,42 @@ protected:
 
   void ReadIndexValues(const std::string& indexText);
 
+  /// Rebuild the grid position to item number lookup table from the index entries
+  void UpdateGridItemNumbers();
+
+  /// Returns the key of a grid position in GridItemNumbers
+  long long GetGridItemKey(int row, int column);
+
+  /// Returns the number of items at or before the grid position (in row-major order).
+  /// Items are sorted in row-major order, therefore this is the item number that follows the position.
+  int GetNumberOfGridItemsUpToPosition(int row, int column);
+
+  /// Extend grid dimensions so that the specified position is inside the grid.
+  /// Returns true if dimensions have been changed.
+  bool ExpandGridDimensions(int row, int column);
+
+  /// Get sequencer for a data node. Normally all data nodes have the same class,
+  /// therefore the sequencer is only looked up once.
+  vtkMRMLNodeSequencer::NodeSequencer* GetNodeSequencer(vtkMRMLNode* node);
+
+  /// Add node to the sequence scene (as is or a copy of it) and store it at the specified index value
+  vtkMRMLNode* SetDataNodeAtValueInternal(vtkMRMLNode* node, const std::string& indexValue, bool copy);
+
+  /// Get index of a value in ItemAttributeValues, adds the value if not found.
+  int GetItemAttributeValueId(const std::string& value);
+
+  /// Read item attributes from XML attribute values (see WriteXML)
+  void ReadItemAttributes(const std::string& namesText, const std::string& valuesText, const std::string& valueIdsText);
+
   struct IndexEntryType
   {
     std::string IndexValue;
+    /// Index value converted to number, cached to avoid string conversions in lookups
+    double NumericIndexValue;
     vtkMRMLNode* DataNode;
     std::string DataNodeID; // only used temporarily, during scene load
+    /// Index in ItemAttributeValues for each item attribute column (-1 or missing if not set)
+    std::vector< int > AttributeValueIds;
   };
 
 protected:
@@ -180,6 +301,8 @@ protected:
   std::string IndexUnit;
   int IndexType;
   double NumericIndexValueTolerance;
+  int GridDimensions[2];
+  bool ShareItemContent;
 
   /// Need to store the nodes in the scene, because for reading/writing nodes
   /// we need MRML storage nodes, which only work if they refer to a data node in the same scene
@@ -187,6 +310,28 @@ protected:
 
   /// List of data items (the scene may contain some more nodes, such as storage nodes)
   std::deque< IndexEntryType > IndexEntries;
+
+  /// Item number for each non-empty grid position, keyed by row * numberOfColumns + column.
+  /// Rebuilt when the grid dimensions change. Only used if index type is GridIndex.
+  std::unordered_map< long long, int > GridItemNumbers;
+
+  /// Names of item attributes, one column for each
+  std::vector< std::string > ItemAttributeNames;
+  /// Distinct item attribute values, referred to by index from IndexEntryType::AttributeValueIds
+  std::vector< std::string > ItemAttributeValues;
+  /// Lookup table to find a value in ItemAttributeValues
+  std::map< std::string, int > ItemAttributeValueIds;
+
+  /// Data nodes that are allocated but not used yet (see PreallocateDataNodes)
+  std::deque< vtkSmartPointer<vtkMRMLNode> > PreallocatedDataNodes;
+  bool DataNodePreallocationEnabled;
+  int NumberOfPreallocatedDataNodeMisses;
+
+  /// Sequencer of the data nodes (see GetNodeSequencer).
+  vtkMRMLNodeSequencer::NodeSequencer* CachedNodeSequencer;
+  std::string CachedNodeSequencerClassName;
+  /// Modification time of the sequencer registry when CachedNodeSequencer was looked up
+  vtkMTimeType CachedNodeSequencerTime;
 };
 
 #endif
@@ -21,13 +21,22 @@
 ==============================================================================*/
 
 // MRML includes
+#include <vtkMRMLModelNode.h>
+#include <vtkMRMLNodeSequencer.h>
+#include <vtkMRMLScalarVolumeNode.h>
 #include <vtkMRMLSequenceNode.h>
+#include <vtkMRMLTextNode.h>
 #include <vtkMRMLTransformNode.h>
 #include <vtkMRMLScene.h>
 
 // VTK includes
+#include <vtkCellArray.h>
+#include <vtkImageData.h>
 #include <vtkMatrix4x4.h>
 #include <vtkNew.h>
+#include <vtkPointData.h>
+#include <vtkPoints.h>
+#include <vtkPolyData.h>
 
 #include "vtkMRMLCoreTestingMacros.h"
 #include "vtkTestingOutputWindow.h"
@@ -53,6 +62,311 @@ bool SequenceSortedByIndex(vtkMRMLSequenceNode* seqNode)
   return true;
 }
 
+namespace
+{
+
+//-----------------------------------------------------------------------------
+void AddTransformItems(vtkMRMLSequenceNode* seqNode, vtkMRMLTransformNode* dataNode, int numberOfDataNodes)
+{
+  seqNode->SetIndexType(vtkMRMLSequenceNode::NumericIndex);
+  vtkNew<vtkMatrix4x4> transformMatrix;
+  for (int i = 0; i < numberOfDataNodes; i++)
+  {
+    std::ostringstream indexStr;
+    indexStr << i*10.0+5.0;
+    transformMatrix->SetElement(1, 3, i * 20.0);
+    dataNode->SetMatrixTransformFromParent(transformMatrix.GetPointer());
+    seqNode->SetDataNodeAtValue(dataNode, indexStr.str().c_str());
+  }
+}
+
+//-----------------------------------------------------------------------------
+int testDataNodeWithoutCopy()
+{
+  vtkNew< vtkMRMLSequenceNode > seqNode;
+  vtkNew<vtkMRMLTransformNode> dataNode;
+  AddTransformItems(seqNode.GetPointer(), dataNode.GetPointer(), 10);
+
+  // Adding a data node without copying
+  int numberOfDataNodesBeforeAdd = seqNode->GetNumberOfDataNodes();
+  vtkNew<vtkMRMLTransformNode> preparedDataNode;
+  CHECK_POINTER(seqNode->SetDataNodeAtValueWithoutCopy(preparedDataNode.GetPointer(), "2000"), preparedDataNode.GetPointer());
+  CHECK_POINTER(seqNode->GetDataNodeAtValue("2000"), preparedDataNode.GetPointer());
+  CHECK_INT(seqNode->GetNumberOfDataNodes(), numberOfDataNodesBeforeAdd + 1);
+  TESTING_OUTPUT_ASSERT_ERRORS_BEGIN();
+  CHECK_NULL(seqNode->SetDataNodeAtValueWithoutCopy(preparedDataNode.GetPointer(), "2001"));
+  TESTING_OUTPUT_ASSERT_ERRORS_END();
+  CHECK_BOOL(SequenceSortedByIndex(seqNode.GetPointer()), true);
+  return EXIT_SUCCESS;
+}
+
+//-----------------------------------------------------------------------------
+int testPreallocatedDataNodes()
+{
+  vtkNew< vtkMRMLSequenceNode > seqNode;
+  vtkNew<vtkMRMLTransformNode> dataNode;
+  AddTransformItems(seqNode.GetPointer(), dataNode.GetPointer(), 10);
+
+  // Preallocated data nodes
+  seqNode->PreallocateDataNodes(dataNode.GetPointer(), 2);
+  CHECK_INT(seqNode->GetNumberOfPreallocatedDataNodes(), 2);
+  seqNode->SetDataNodeAtValue(dataNode.GetPointer(), "3000");
+  seqNode->SetDataNodeAtValue(dataNode.GetPointer(), "3001");
+  CHECK_INT(seqNode->GetNumberOfPreallocatedDataNodes(), 0);
+  CHECK_INT(seqNode->GetNumberOfPreallocatedDataNodeMisses(), 0);
+  TESTING_OUTPUT_ASSERT_WARNINGS_BEGIN();
+  CHECK_NOT_NULL(seqNode->SetDataNodeAtValue(dataNode.GetPointer(), "3002"));
+  TESTING_OUTPUT_ASSERT_WARNINGS_END();
+  CHECK_INT(seqNode->GetNumberOfPreallocatedDataNodeMisses(), 1);
+  seqNode->RemoveAllPreallocatedDataNodes();
+  return EXIT_SUCCESS;
+}
+
+//-----------------------------------------------------------------------------
+int testItemAttributes()
+{
+  vtkNew< vtkMRMLSequenceNode > seqNode;
+  vtkNew<vtkMRMLTransformNode> dataNode;
+  AddTransformItems(seqNode.GetPointer(), dataNode.GetPointer(), 10);
+
+  // Per-item attributes
+  seqNode->SetNthItemAttribute(0, "Status", "OK");
+  seqNode->SetNthItemAttribute(1, "Status", "OK");
+  seqNode->SetNthItemAttribute(2, "Status", "INVALID");
+  CHECK_INT(static_cast<int>(seqNode->GetItemAttributeNames().size()), 1);
+  CHECK_STD_STRING(seqNode->GetNthItemAttribute(1, "Status"), "OK");
+  CHECK_NULL(seqNode->GetNthItemAttribute(3, "Status"));
+  vtkNew<vtkMRMLTransformNode> proxyNode;
+  seqNode->ApplyNthItemAttributes(2, proxyNode.GetPointer());
+  CHECK_STD_STRING(proxyNode->GetAttribute("Status"), "INVALID");
+  seqNode->ApplyNthItemAttributes(3, proxyNode.GetPointer());
+  CHECK_NULL(proxyNode->GetAttribute("Status"));
+  // Item attributes are not removed from the proxy node when item content is copied into it
+  vtkMRMLNodeSequencer::NodeSequencer* transformSequencer = vtkMRMLNodeSequencer::GetInstance()->GetNodeSequencer(proxyNode.GetPointer());
+  seqNode->ApplyNthItemAttributes(2, proxyNode.GetPointer());
+  transformSequencer->SetPreservedAttributeNames(proxyNode.GetPointer(), seqNode->GetItemAttributeNames());
+  transformSequencer->CopyNode(seqNode->GetNthDataNode(2), proxyNode.GetPointer(), false);
+  CHECK_STD_STRING(proxyNode->GetAttribute("Status"), "INVALID");
+  transformSequencer->SetPreservedAttributeNames(proxyNode.GetPointer(), std::vector<std::string>());
+  transformSequencer->CopyNode(seqNode->GetNthDataNode(2), proxyNode.GetPointer(), false);
+  CHECK_NULL(proxyNode->GetAttribute("Status"));
+  seqNode->SetNthItemAttribute(2, "Status", NULL);
+  CHECK_NULL(seqNode->GetNthItemAttribute(2, "Status"));
+  // Node attributes of added items are moved into the item attribute store
+  seqNode->AddItemAttributeName("ToolState");
+  vtkNew<vtkMRMLTransformNode> attributeDataNode;
+  attributeDataNode->SetAttribute("ToolState", "MISSING");
+  vtkMRMLNode* addedAttributeDataNode = seqNode->SetDataNodeAtValue(attributeDataNode.GetPointer(), "4001");
+  CHECK_NULL(addedAttributeDataNode->GetAttribute("ToolState"));
+  CHECK_STD_STRING(seqNode->GetNthItemAttribute(seqNode->GetItemNumberFromIndexValue("4001"), "ToolState"), "MISSING");
+  return EXIT_SUCCESS;
+}
+
+//-----------------------------------------------------------------------------
+int testGridIndex()
+{
+  vtkNew<vtkMRMLTransformNode> dataNode;
+  vtkNew< vtkMRMLSequenceNode > gridSeqNode;
+  gridSeqNode->SetIndexType(vtkMRMLSequenceNode::GridIndex);
+  gridSeqNode->SetGridDimensions(3, 4);
+  // Add items in reverse order to check sorting
+  for (int row = 2; row >= 0; row--)
+  {
+    for (int column = 3; column >= 0; column--)
+    {
+      if (row == 1 && column == 2)
+      {
+        // leave one grid position empty
+        continue;
+      }
+      gridSeqNode->SetDataNodeAtValue(dataNode.GetPointer(), vtkMRMLSequenceNode::GetGridIndexValue(row, column));
+    }
+  }
+  CHECK_INT(gridSeqNode->GetNumberOfDataNodes(), 11);
+  CHECK_STD_STRING(gridSeqNode->GetNthIndexValue(0), "0,0");
+  CHECK_STD_STRING(gridSeqNode->GetNthIndexValue(10), "2,3");
+  CHECK_INT(gridSeqNode->GetItemNumberFromGridPosition(1, 3), 6);
+  CHECK_INT(gridSeqNode->GetItemNumberFromIndexValue("1, 3"), 6);
+  CHECK_INT(gridSeqNode->GetItemNumberFromGridPosition(1, 2), -1);
+  CHECK_INT(gridSeqNode->GetItemNumberFromIndexValue("1,2", false), 5);
+
+  // Adding outside of the grid extends the grid
+  gridSeqNode->SetDataNodeAtValue(dataNode.GetPointer(), "3,1");
+  CHECK_INT(gridSeqNode->GetGridDimensions()[0], 4);
+  CHECK_INT(gridSeqNode->GetItemNumberFromIndexValue("3,1"), 11);
+
+  // Filling the empty position updates item numbers
+  gridSeqNode->SetDataNodeAtValue(dataNode.GetPointer(), "1,2");
+  CHECK_INT(gridSeqNode->GetItemNumberFromGridPosition(1, 2), 6);
+  CHECK_INT(gridSeqNode->GetItemNumberFromGridPosition(1, 3), 7);
+
+  gridSeqNode->RemoveDataNodeAtValue("0,0");
+  CHECK_INT(gridSeqNode->GetItemNumberFromGridPosition(0, 0), -1);
+  CHECK_INT(gridSeqNode->GetItemNumberFromGridPosition(0, 1), 0);
+
+  // Grid positions far apart do not require storage for the positions in between
+  gridSeqNode->SetDataNodeAtValue(dataNode.GetPointer(), "100000,100000");
+  CHECK_INT(gridSeqNode->GetItemNumberFromIndexValue("100000,100000"), 12);
+  CHECK_INT(gridSeqNode->GetItemNumberFromIndexValue("50000,7", false), 11);
+  // Positions that would overflow grid dimensions are invalid
+  int row = 0;
+  int column = 0;
+  CHECK_BOOL(vtkMRMLSequenceNode::GetGridPositionFromIndexValue("2147483647,0", row, column), false);
+  CHECK_BOOL(vtkMRMLSequenceNode::GetGridPositionFromIndexValue("0,99999999999999999999", row, column), false);
+  // Trailing characters after the column are invalid
+  CHECK_BOOL(vtkMRMLSequenceNode::GetGridPositionFromIndexValue("1,2abc", row, column), false);
+  CHECK_BOOL(vtkMRMLSequenceNode::GetGridPositionFromIndexValue("1,2,3", row, column), false);
+  CHECK_BOOL(vtkMRMLSequenceNode::GetGridPositionFromIndexValue("1,2 ", row, column), true);
+  CHECK_INT(gridSeqNode->GetItemNumberFromIndexValue("1,3,0"), -1);
+  TESTING_OUTPUT_ASSERT_ERRORS_BEGIN();
+  CHECK_NULL(gridSeqNode->SetDataNodeAtValue(dataNode.GetPointer(), "2147483647,2147483647"));
+  TESTING_OUTPUT_ASSERT_ERRORS_END();
+
+  // Failed index value update leaves the item unchanged
+  int movedItemNumber = gridSeqNode->GetItemNumberFromIndexValue("3,1");
+  TESTING_OUTPUT_ASSERT_ERRORS_BEGIN();
+  CHECK_BOOL(gridSeqNode->UpdateIndexValue("3,1", "5,x"), false);
+  TESTING_OUTPUT_ASSERT_ERRORS_END();
+  CHECK_INT(gridSeqNode->GetItemNumberFromIndexValue("3,1"), movedItemNumber);
+  CHECK_STD_STRING(gridSeqNode->GetNthIndexValue(movedItemNumber), "3,1");
+  CHECK_DOUBLE(gridSeqNode->GetNthNumericIndexValue(movedItemNumber), 3.0);
+  return EXIT_SUCCESS;
+}
+
+//-----------------------------------------------------------------------------
+int testShareItemContent()
+{
+  // Sharing of mesh topology between items
+  vtkNew< vtkMRMLSequenceNode > modelSeqNode;
+  modelSeqNode->SetShareItemContent(true);
+  vtkNew<vtkMRMLModelNode> modelNode;
+  vtkNew<vtkPoints> points;
+  points->InsertNextPoint(0, 0, 0);
+  points->InsertNextPoint(1, 0, 0);
+  points->InsertNextPoint(0, 1, 0);
+  vtkNew<vtkCellArray> polys;
+  vtkIdType triangle[3] = { 0, 1, 2 };
+  polys->InsertNextCell(3, triangle);
+  vtkNew<vtkPolyData> polyData;
+  polyData->SetPoints(points.GetPointer());
+  polyData->SetPolys(polys.GetPointer());
+  modelNode->SetAndObservePolyData(polyData.GetPointer());
+  vtkMRMLModelNode* modelItem0 = vtkMRMLModelNode::SafeDownCast(modelSeqNode->SetDataNodeAtValue(modelNode.GetPointer(), "0"));
+  points->SetPoint(2, 0, 2, 0);
+  points->Modified();
+  vtkMRMLModelNode* modelItem1 = vtkMRMLModelNode::SafeDownCast(modelSeqNode->SetDataNodeAtValue(modelNode.GetPointer(), "1"));
+  CHECK_NOT_NULL(modelItem0);
+  CHECK_NOT_NULL(modelItem1);
+  CHECK_POINTER(modelItem0->GetPolyData()->GetPolys(), modelItem1->GetPolyData()->GetPolys());
+  CHECK_POINTER_DIFFERENT(modelItem0->GetPolyData()->GetPoints(), modelItem1->GetPolyData()->GetPoints());
+  CHECK_DOUBLE(modelItem1->GetPolyData()->GetPoint(2)[1], 2.0);
+  // Item inserted between items is compared to the next item as well
+  vtkIdType otherTriangle[3] = { 2, 1, 0 };
+  vtkNew<vtkCellArray> otherPolys;
+  otherPolys->InsertNextCell(3, otherTriangle);
+  polyData->SetPolys(otherPolys.GetPointer());
+  vtkMRMLModelNode* modelItem3 = vtkMRMLModelNode::SafeDownCast(modelSeqNode->SetDataNodeAtValue(modelNode.GetPointer(), "3"));
+  vtkMRMLModelNode* modelItem2 = vtkMRMLModelNode::SafeDownCast(modelSeqNode->SetDataNodeAtValue(modelNode.GetPointer(), "2"));
+  CHECK_NOT_NULL(modelItem2);
+  CHECK_NOT_NULL(modelItem3);
+  CHECK_POINTER_DIFFERENT(modelItem2->GetPolyData()->GetPolys(), modelItem1->GetPolyData()->GetPolys());
+  CHECK_POINTER(modelItem2->GetPolyData()->GetPolys(), modelItem3->GetPolyData()->GetPolys());
+
+  // Proxy node gets its own copy of shared topology, which is not copied again if it has not been modified
+  vtkNew<vtkMRMLModelNode> proxyNode;
+  vtkMRMLNodeSequencer::NodeSequencer* modelSequencer = vtkMRMLNodeSequencer::GetInstance()->GetNodeSequencer(proxyNode.GetPointer());
+  modelSequencer->CopyNode(modelItem0, proxyNode.GetPointer(), false);
+  vtkCellArray* proxyPolys = proxyNode->GetPolyData()->GetPolys();
+  CHECK_POINTER_DIFFERENT(proxyPolys, modelItem0->GetPolyData()->GetPolys());
+  modelSequencer->CopyNode(modelItem1, proxyNode.GetPointer(), false);
+  CHECK_POINTER(proxyNode->GetPolyData()->GetPolys(), proxyPolys);
+  vtkMTimeType proxyPolysMTime = proxyPolys->GetData()->GetMTime();
+  modelSequencer->CopyNode(modelItem0, proxyNode.GetPointer(), false);
+  CHECK_POINTER(proxyNode->GetPolyData()->GetPolys(), proxyPolys);
+  CHECK_BOOL(proxyPolys->GetData()->GetMTime() == proxyPolysMTime, true);
+  CHECK_DOUBLE(proxyNode->GetPolyData()->GetPoint(2)[1], 1.0);
+  // Modifying the proxy in-place does not change the items
+  proxyPolys->GetData()->SetValue(1, 2);
+  proxyPolys->GetData()->Modified();
+  CHECK_INT(modelItem0->GetPolyData()->GetPolys()->GetData()->GetValue(1), 0);
+  modelSequencer->CopyNode(modelItem0, proxyNode.GetPointer(), false);
+  CHECK_INT(proxyNode->GetPolyData()->GetPolys()->GetData()->GetValue(1), 0);
+  return EXIT_SUCCESS;
+}
+
+//-----------------------------------------------------------------------------
+int testPrecopyAndPrepareNodeContent()
+{
+  // Copy of volume content in advance (may be done in worker threads)
+  vtkSmartPointer<vtkMRMLScalarVolumeNode> sourceVolumes[2];
+  for (int i = 0; i < 2; i++)
+  {
+    vtkNew<vtkImageData> imageData;
+    imageData->SetDimensions(4, 4, 4);
+    imageData->AllocateScalars(VTK_UNSIGNED_CHAR, 1);
+    imageData->GetPointData()->GetScalars()->FillComponent(0, i + 1);
+    sourceVolumes[i] = vtkSmartPointer<vtkMRMLScalarVolumeNode>::New();
+    sourceVolumes[i]->SetAndObserveImageData(imageData.GetPointer());
+  }
+  vtkNew<vtkMRMLScalarVolumeNode> targetVolume;
+  vtkMRMLNodeSequencer::NodeSequencer* volumeSequencer = vtkMRMLNodeSequencer::GetInstance()->GetNodeSequencer(targetVolume.GetPointer());
+  CHECK_BOOL(volumeSequencer->PrecopyNodeContent(sourceVolumes[0], targetVolume.GetPointer()), false);
+  volumeSequencer->CopyNode(sourceVolumes[0], targetVolume.GetPointer(), false);
+  vtkImageData* targetImageData = targetVolume->GetImageData();
+  CHECK_BOOL(volumeSequencer->PrecopyNodeContent(sourceVolumes[1], targetVolume.GetPointer()), true);
+  volumeSequencer->CopyNode(sourceVolumes[1], targetVolume.GetPointer(), false);
+  CHECK_POINTER(targetVolume->GetImageData(), targetImageData);
+  CHECK_DOUBLE(targetVolume->GetImageData()->GetScalarComponentAsDouble(1, 2, 3, 0), 2.0);
+
+  // Double buffering: prepared content is swapped in, the replaced image is reused as back buffer
+  CHECK_BOOL(volumeSequencer->PrepareNodeContent(sourceVolumes[0], targetVolume.GetPointer()), true);
+  CHECK_DOUBLE(targetVolume->GetImageData()->GetScalarComponentAsDouble(1, 2, 3, 0), 2.0);
+  volumeSequencer->CopyNode(sourceVolumes[0], targetVolume.GetPointer(), false);
+  CHECK_POINTER_DIFFERENT(targetVolume->GetImageData(), targetImageData);
+  CHECK_DOUBLE(targetVolume->GetImageData()->GetScalarComponentAsDouble(1, 2, 3, 0), 1.0);
+  CHECK_BOOL(volumeSequencer->PrepareNodeContent(sourceVolumes[1], targetVolume.GetPointer()), true);
+  volumeSequencer->CopyNode(sourceVolumes[1], targetVolume.GetPointer(), false);
+  CHECK_POINTER(targetVolume->GetImageData(), targetImageData);
+  CHECK_DOUBLE(targetVolume->GetImageData()->GetScalarComponentAsDouble(1, 2, 3, 0), 2.0);
+  // Multiple items can be prepared in advance, buffers of items that are not needed anymore are recycled
+  CHECK_BOOL(volumeSequencer->PrepareNodeContent(sourceVolumes[0], targetVolume.GetPointer()), true);
+  CHECK_BOOL(volumeSequencer->PrepareNodeContent(sourceVolumes[1], targetVolume.GetPointer()), true);
+  unsigned long preparedMemorySize = volumeSequencer->GetPreparedNodeContentMemorySize();
+  CHECK_BOOL(preparedMemorySize > 0, true);
+  std::vector<vtkMRMLNode*> keptSources;
+  keptSources.push_back(sourceVolumes[0]);
+  volumeSequencer->RecyclePreparedNodeContent(targetVolume.GetPointer(), keptSources);
+  CHECK_BOOL(volumeSequencer->GetPreparedNodeContentMemorySize() == preparedMemorySize, true);
+  volumeSequencer->CopyNode(sourceVolumes[0], targetVolume.GetPointer(), false);
+  CHECK_DOUBLE(targetVolume->GetImageData()->GetScalarComponentAsDouble(1, 2, 3, 0), 1.0);
+  volumeSequencer->DiscardPreparedNodeContent(targetVolume.GetPointer());
+  CHECK_BOOL(volumeSequencer->GetPreparedNodeContentMemorySize() == 0, true);
+  return EXIT_SUCCESS;
+}
+
+//-----------------------------------------------------------------------------
+int testNodeReferencesPreservedOnCopy()
+{
+  // Node references are kept when content is copied
+  vtkNew<vtkMRMLScene> referenceScene;
+  vtkMRMLTextNode* referencedTextNode = vtkMRMLTextNode::SafeDownCast(referenceScene->AddNewNodeByClass("vtkMRMLTextNode"));
+  vtkMRMLTextNode* targetTextNode = vtkMRMLTextNode::SafeDownCast(referenceScene->AddNewNodeByClass("vtkMRMLTextNode"));
+  targetTextNode->SetNodeReferenceID("testRole", referencedTextNode->GetID());
+  vtkNew<vtkMRMLTextNode> sourceTextNode;
+  sourceTextNode->SetText("updated");
+  vtkMRMLNodeSequencer::NodeSequencer* textSequencer = vtkMRMLNodeSequencer::GetInstance()->GetNodeSequencer(targetTextNode);
+  vtkNew<vtkMRMLScalarVolumeNode> volumeNode;
+  vtkMRMLNodeSequencer::NodeSequencer* volumeSequencer = vtkMRMLNodeSequencer::GetInstance()->GetNodeSequencer(volumeNode.GetPointer());
+  CHECK_BOOL(textSequencer->GetCopyPreservesNodeReferences(), false);
+  CHECK_BOOL(volumeSequencer->GetCopyPreservesNodeReferences(), true);
+  textSequencer->CopyNodeContent(sourceTextNode.GetPointer(), targetTextNode);
+  CHECK_STD_STRING(targetTextNode->GetText(), "updated");
+  CHECK_POINTER(targetTextNode->GetNodeReference("testRole"), referencedTextNode);
+  return EXIT_SUCCESS;
+}
+
+} // end of anonymous namespace
+
 //-----------------------------------------------------------------------------
 int vtkMRMLSequenceNodeTest1( int, char * [] )
 {
@@ -113,6 +427,34 @@ int vtkMRMLSequenceNodeTest1( int, char * [] )
   seqNode->UpdateIndexValue("96", "32");
   CHECK_BOOL(SequenceSortedByIndex(seqNode.GetPointer()), true);
 
+  if (testDataNodeWithoutCopy() != EXIT_SUCCESS)
+  {
+    return EXIT_FAILURE;
+  }
+  if (testPreallocatedDataNodes() != EXIT_SUCCESS)
+  {
+    return EXIT_FAILURE;
+  }
+  if (testItemAttributes() != EXIT_SUCCESS)
+  {
+    return EXIT_FAILURE;
+  }
+  if (testGridIndex() != EXIT_SUCCESS)
+  {
+    return EXIT_FAILURE;
+  }
+  if (testShareItemContent() != EXIT_SUCCESS)
+  {
+    return EXIT_FAILURE;
+  }
+  if (testPrecopyAndPrepareNodeContent() != EXIT_SUCCESS)
+  {
+    return EXIT_FAILURE;
+  }
+  if (testNodeReferencesPreservedOnCopy() != EXIT_SUCCESS)
+  {
+    return EXIT_FAILURE;
+  }
 
     /*
   bool res = true;
@@ -21,6 +21,8 @@
 // MRML includes
 #include <vtkMRMLLinearTransformNode.h>
 #include <vtkMRMLLinearTransformSequenceStorageNode.h>
+#include <vtkMRMLMarkupsFiducialNode.h>
+#include <vtkMRMLMarkupsSequenceStorageNode.h>
 #include <vtkMRMLModelNode.h>
 #include <vtkMRMLScalarVolumeNode.h>
 #include <vtkMRMLScene.h>
@@ -32,14 +34,173 @@
 // VTK includes
 #include <vtkMatrix4x4.h>
 #include <vtkNew.h>
+#include <vtkVariant.h>
+
+// STD includes
+#include <fstream>
 
 #include "vtkMRMLCoreTestingMacros.h"
 
 //-----------------------------------------------------------------------------
-int vtkMRMLSequenceStorageNodeTest1( int, char * [] )
+// Write markups sequence items with different number of points to file and read them back
+int testMarkupsSequenceWriteRead(const std::string& tempDir)
+{
+  const int numberOfItems = 3;
+  const int numberOfPoints[numberOfItems] = { 1, 4, 2 };
+
+  vtkNew<vtkMRMLSequenceNode> sequenceNode;
+  for (int itemIndex = 0; itemIndex < numberOfItems; itemIndex++)
+  {
+    vtkNew<vtkMRMLMarkupsFiducialNode> markupsNode;
+    markupsNode->SetName((std::string("frame, ") + vtkVariant(itemIndex).ToString()).c_str());
+    for (int pointIndex = 0; pointIndex < numberOfPoints[itemIndex]; pointIndex++)
+    {
+      markupsNode->AddFiducial(itemIndex * 10.0 + pointIndex, -pointIndex * 0.125, 1.0 / 3.0);
+      markupsNode->SetNthFiducialLabel(pointIndex, std::string("F-") + vtkVariant(pointIndex).ToString());
+    }
+    sequenceNode->SetDataNodeAtValue(markupsNode.GetPointer(), vtkVariant(itemIndex * 0.5).ToString());
+  }
+
+  std::string fileName = tempDir + "/vtkMRMLSequenceStorageNodeTest1.seq.mkp.csv";
+  vtkNew<vtkMRMLMarkupsSequenceStorageNode> storageNode;
+  CHECK_BOOL(storageNode->CanWriteFromReferenceNode(sequenceNode.GetPointer()), true);
+  storageNode->SetFileName(fileName.c_str());
+  CHECK_INT(storageNode->WriteData(sequenceNode.GetPointer()), 1);
+
+  vtkNew<vtkMRMLSequenceNode> readSequenceNode;
+  CHECK_BOOL(storageNode->CanReadInReferenceNode(readSequenceNode.GetPointer()), true);
+  CHECK_INT(storageNode->ReadData(readSequenceNode.GetPointer()), 1);
+  CHECK_INT(readSequenceNode->GetNumberOfDataNodes(), numberOfItems);
+  for (int itemIndex = 0; itemIndex < numberOfItems; itemIndex++)
+  {
+    CHECK_STD_STRING(readSequenceNode->GetNthIndexValue(itemIndex), sequenceNode->GetNthIndexValue(itemIndex));
+    vtkMRMLMarkupsFiducialNode* writtenNode = vtkMRMLMarkupsFiducialNode::SafeDownCast(sequenceNode->GetNthDataNode(itemIndex));
+    vtkMRMLMarkupsFiducialNode* readNode = vtkMRMLMarkupsFiducialNode::SafeDownCast(readSequenceNode->GetNthDataNode(itemIndex));
+    CHECK_NOT_NULL(readNode);
+    CHECK_STD_STRING(std::string(readNode->GetName()), std::string(writtenNode->GetName()));
+    CHECK_INT(readNode->GetNumberOfFiducials(), numberOfPoints[itemIndex]);
+    for (int pointIndex = 0; pointIndex < numberOfPoints[itemIndex]; pointIndex++)
+    {
+      CHECK_STD_STRING(readNode->GetNthFiducialLabel(pointIndex), writtenNode->GetNthFiducialLabel(pointIndex));
+      double writtenPosition[3] = { 0.0, 0.0, 0.0 };
+      double readPosition[3] = { 0.0, 0.0, 0.0 };
+      writtenNode->GetNthFiducialPosition(pointIndex, writtenPosition);
+      readNode->GetNthFiducialPosition(pointIndex, readPosition);
+      for (int i = 0; i < 3; i++)
+      {
+        CHECK_DOUBLE(readPosition[i], writtenPosition[i]);
+      }
+    }
+  }
+
+  // Sequences of other node types are not read by the markups sequence reader
+  vtkNew<vtkMRMLSequenceNode> transformSequenceNode;
+  vtkNew<vtkMRMLLinearTransformNode> transformNode;
+  transformSequenceNode->SetDataNodeAtValue(transformNode.GetPointer(), "0");
+  CHECK_BOOL(storageNode->CanReadInReferenceNode(transformSequenceNode.GetPointer()), false);
+
+  return EXIT_SUCCESS;
+}
+
+//-----------------------------------------------------------------------------
+// Item attributes and MRML node attributes of markups sequence items are preserved when the file is saved and reloaded
+int testMarkupsSequenceItemAttributes(const std::string& tempDir)
+{
+  const int numberOfItems = 3;
+  vtkNew<vtkMRMLSequenceNode> sequenceNode;
+  for (int itemIndex = 0; itemIndex < numberOfItems; itemIndex++)
+  {
+    vtkNew<vtkMRMLMarkupsFiducialNode> markupsNode;
+    markupsNode->AddFiducial(itemIndex, 0.0, 0.0);
+    markupsNode->SetAttribute("Comment", (std::string("frame, ") + vtkVariant(itemIndex).ToString()).c_str());
+    sequenceNode->SetDataNodeAtValue(markupsNode.GetPointer(), vtkVariant(itemIndex).ToString());
+  }
+  sequenceNode->SetNthItemAttribute(0, "ToolStatus", "OK");
+  sequenceNode->SetNthItemAttribute(2, "ToolStatus", "MISSING");
+
+  std::string fileName = tempDir + "/vtkMRMLSequenceStorageNodeTest1ItemAttributes.seq.mkp.csv";
+  vtkNew<vtkMRMLMarkupsSequenceStorageNode> storageNode;
+  storageNode->SetFileName(fileName.c_str());
+  CHECK_INT(storageNode->WriteData(sequenceNode.GetPointer()), 1);
+
+  // Reload into the same sequence node (as when the scene is reloaded, item attribute columns are read from the scene file)
+  CHECK_INT(storageNode->ReadData(sequenceNode.GetPointer()), 1);
+  CHECK_INT(sequenceNode->GetNumberOfDataNodes(), numberOfItems);
+  CHECK_STRING(sequenceNode->GetNthItemAttribute(0, "ToolStatus"), "OK");
+  CHECK_NULL(sequenceNode->GetNthItemAttribute(1, "ToolStatus"));
+  CHECK_STRING(sequenceNode->GetNthItemAttribute(2, "ToolStatus"), "MISSING");
+  for (int itemIndex = 0; itemIndex < numberOfItems; itemIndex++)
+  {
+    vtkMRMLNode* readNode = sequenceNode->GetNthDataNode(itemIndex);
+    CHECK_NOT_NULL(readNode);
+    CHECK_STD_STRING(std::string(readNode->GetAttribute("Comment")), std::string("frame, ") + vtkVariant(itemIndex).ToString());
+    // item attributes are kept in the item attribute store, not in the data nodes
+    CHECK_NULL(readNode->GetAttribute("ToolStatus"));
+  }
+
+  // Read into a new sequence node: item attributes are available as node attributes
+  vtkNew<vtkMRMLSequenceNode> readSequenceNode;
+  CHECK_INT(storageNode->ReadData(readSequenceNode.GetPointer()), 1);
+  CHECK_INT(readSequenceNode->GetNumberOfDataNodes(), numberOfItems);
+  CHECK_STRING(readSequenceNode->GetNthDataNode(0)->GetAttribute("ToolStatus"), "OK");
+  CHECK_NULL(readSequenceNode->GetNthDataNode(1)->GetAttribute("ToolStatus"));
+  CHECK_STRING(readSequenceNode->GetNthDataNode(2)->GetAttribute("ToolStatus"), "MISSING");
+
+  return EXIT_SUCCESS;
+}
+
+//-----------------------------------------------------------------------------
+// Per-frame transform status of sequence metafiles is stored in the item attribute store and written back
+int testTransformSequenceStatus(const std::string& tempDir)
+{
+  std::string fileName = tempDir + "/vtkMRMLSequenceStorageNodeTest1TransformStatus.seq.mhd";
+  {
+    std::ofstream headerStream(fileName.c_str());
+    headerStream << "ObjectType = Image" << std::endl;
+    for (int frameNumber = 0; frameNumber < 3; frameNumber++)
+    {
+      headerStream << "Seq_Frame000" << frameNumber << "_ProbeToTrackerTransform = 1 0 0 " << frameNumber << " 0 1 0 0 0 0 1 0 0 0 0 1" << std::endl;
+      headerStream << "Seq_Frame000" << frameNumber << "_ProbeToTrackerTransformStatus = " << (frameNumber == 1 ? "INVALID" : "OK") << std::endl;
+      headerStream << "Seq_Frame000" << frameNumber << "_Timestamp = " << frameNumber << std::endl;
+    }
+    headerStream << "ElementDataFile = LOCAL" << std::endl;
+  }
+
+  std::deque< vtkSmartPointer<vtkMRMLSequenceNode> > createdNodes;
+  std::map< int, std::string > frameNumberToIndexValueMap;
+  std::map< std::string, std::string > imageMetaData;
+  CHECK_INT(vtkMRMLLinearTransformSequenceStorageNode::ReadSequenceFileTransforms(fileName, NULL, createdNodes,
+    frameNumberToIndexValueMap, imageMetaData), 1);
+  vtkMRMLSequenceNode* transformSequenceNode = createdNodes[0];
+  CHECK_INT(transformSequenceNode->GetNumberOfDataNodes(), 3);
+  CHECK_STRING(transformSequenceNode->GetNthItemAttribute(0, "Sequences.TransformStatus"), "OK");
+  CHECK_STRING(transformSequenceNode->GetNthItemAttribute(1, "Sequences.TransformStatus"), "INVALID");
+  // status is kept in the item attribute store, not in the data nodes
+  CHECK_NULL(transformSequenceNode->GetNthDataNode(1)->GetAttribute("Sequences.TransformStatus"));
+
+  // Status is written back to file
+  std::string writtenFileName = tempDir + "/vtkMRMLSequenceStorageNodeTest1TransformStatusWritten.seq.mhd";
+  std::deque< vtkMRMLSequenceNode* > transformSequenceNodes;
+  transformSequenceNodes.push_back(transformSequenceNode);
+  std::deque< std::string > transformNames;
+  transformNames.push_back("ProbeToTracker");
+  CHECK_BOOL(vtkMRMLLinearTransformSequenceStorageNode::WriteSequenceMetafileTransforms(writtenFileName, transformSequenceNodes,
+    transformNames, transformSequenceNode, NULL), true);
+  std::deque< vtkSmartPointer<vtkMRMLSequenceNode> > readNodes;
+  CHECK_INT(vtkMRMLLinearTransformSequenceStorageNode::ReadSequenceFileTransforms(writtenFileName, NULL, readNodes,
+    frameNumberToIndexValueMap, imageMetaData), 1);
+  CHECK_STRING(readNodes[0]->GetNthItemAttribute(1, "Sequences.TransformStatus"), "INVALID");
+  CHECK_STRING(readNodes[0]->GetNthItemAttribute(2, "Sequences.TransformStatus"), "OK");
+
+  return EXIT_SUCCESS;
+}
+
+//-----------------------------------------------------------------------------
+int vtkMRMLSequenceStorageNodeTest1( int argc, char * argv[] )
 {
   vtkNew<vtkMRMLScene> scene;
   scene->RegisterNodeClass(vtkSmartPointer<vtkMRMLLinearTransformSequenceStorageNode>::New());
+  scene->RegisterNodeClass(vtkSmartPointer<vtkMRMLMarkupsSequenceStorageNode>::New());
   scene->RegisterNodeClass(vtkSmartPointer<vtkMRMLSequenceNode>::New());
   scene->RegisterNodeClass(vtkSmartPointer<vtkMRMLSequenceStorageNode>::New());
   scene->RegisterNodeClass(vtkSmartPointer<vtkMRMLVolumeSequenceStorageNode>::New());
@@ -74,6 +235,16 @@ int vtkMRMLSequenceStorageNodeTest1( int, char * [] )
     CHECK_NOT_NULL(addedTransformStorageNode);
   }
 
+  // Add markups fiducial node sequence
+  {
+    vtkSmartPointer<vtkMRMLSequenceNode> markupsSequenceNode = vtkMRMLSequenceNode::SafeDownCast(scene->AddNewNodeByClass("vtkMRMLSequenceNode"));
+    vtkSmartPointer<vtkMRMLMarkupsFiducialNode> markupsNode = vtkMRMLMarkupsFiducialNode::SafeDownCast(scene->AddNewNodeByClass("vtkMRMLMarkupsFiducialNode"));
+    markupsSequenceNode->SetDataNodeAtValue(markupsNode.GetPointer(), "0");
+    markupsSequenceNode->AddDefaultStorageNode();
+    vtkSmartPointer<vtkMRMLMarkupsSequenceStorageNode> addedMarkupsStorageNode = vtkMRMLMarkupsSequenceStorageNode::SafeDownCast(markupsSequenceNode->GetStorageNode());
+    CHECK_NOT_NULL(addedMarkupsStorageNode);
+  }
+
   // Create generic node sequence
   {
     vtkSmartPointer<vtkMRMLSequenceNode> genericSequenceNode = vtkMRMLSequenceNode::SafeDownCast(scene->AddNewNodeByClass("vtkMRMLSequenceNode"));
@@ -104,5 +275,23 @@ int vtkMRMLSequenceStorageNodeTest1( int, char * [] )
     CHECK_NOT_NULL(createdTransformStorageNode);
   }
 
+  if (argc < 2)
+  {
+    std::cerr << "Usage: vtkMRMLSequenceStorageNodeTest1 /path/to/temp" << std::endl;
+    return EXIT_FAILURE;
+  }
+  if (testMarkupsSequenceWriteRead(argv[1]) != EXIT_SUCCESS)
+  {
+    return EXIT_FAILURE;
+  }
+  if (testMarkupsSequenceItemAttributes(argv[1]) != EXIT_SUCCESS)
+  {
+    return EXIT_FAILURE;
+  }
+  if (testTransformSequenceStatus(argv[1]) != EXIT_SUCCESS)
+  {
+    return EXIT_FAILURE;
+  }
+
   return EXIT_SUCCESS;
 }